@@ -21,6 +21,19 @@ MIDI -> uint8_t stream (cmd, val) for MusicBox (новый формат).
  - Длительности раскладываются на "красивые" куски: 16,12,8,6,4,3,2,1 (L01,L2D,L02,L4D,L04,L8D,L08,L16).
  - Конец песни (PAUSE,0) НЕ добавляем (по договорённости).
 
+Бинарный поток (--bin FILE):
+ - те же пары (cmd, val) сырыми байтами — для образа внешней I2C EEPROM
+   (songimage.py, PLAYER_SONG_SOURCE_I2C); C-массив при этом тоже печатается.
+
+Ансамбль (--parts N):
+ - N партий для N шкатулок: если нот-треков несколько — партия = трек,
+   иначе полифония одного трека раскладывается по голосам (0 = верхний, 1 = второй сверху, ...).
+ - Все партии режутся по ОБЩЕЙ сетке событий (объединение начал/концов нот всех партий + TEMPO),
+   поэтому у всех потоков одинаковая длина и одинаковые позиции событий (song_pos) —
+   синхронизация Sync.h работает без изменений.
+ - Продолжение ноты, разрезанной сеткой или "красивым" разбиением, помечается LGT
+   (плеер меняет только высоту, огибающую не перезапускает) — на слух это одна нота.
+
 ВАЖНО (фикс бага):
  - Одинаковые ноты подряд НЕ СКЛЕИВАЕМ в одну длинную ноту.
    Даже если они одинаковые, это должны быть отдельные "триггеры" ноты.
@@ -31,7 +44,7 @@ from __future__ import annotations
 import argparse
 import re
 from dataclasses import dataclass
-from typing import Dict, List, Tuple, Set
+from typing import Dict, List, Optional, Tuple, Set
 
 try:
 	import mido
@@ -74,6 +87,8 @@ class OutItem:
 	tempo10: int = 0
 	bpm: float = 0.0
 	trans: int = 0
+	tie: bool = False	# продолжение ноты (LGT)
+	note: int = 0		# MIDI нота (0 = пауза) — для --bin
 
 
 #=====================================================================#
@@ -194,6 +209,16 @@ def _append_note_msgs_from_track(track: "mido.MidiTrack",
 		else:
 			out.append(NoteMsg(t=abs_t, is_on=False, note=note, vel=0, ch=ch))
 
+def tracks_with_notes(mid: "mido.MidiFile") -> List[List[NoteMsg]]:
+	out: List[List[NoteMsg]] = []
+	for tr in mid.tracks:
+		msgs: List[NoteMsg] = []
+		_append_note_msgs_from_track(tr, msgs)
+		if msgs:
+			msgs.sort(key=lambda m: (m.t, 0 if not m.is_on else 1, m.note))
+			out.append(msgs)
+	return out
+
 def pick_first_track_with_notes(mid: "mido.MidiFile") -> Tuple[int, List[NoteMsg]]:
 	for i, tr in enumerate(mid.tracks):
 		msgs: List[NoteMsg] = []
@@ -238,6 +263,13 @@ def merge_adjacent_segments(segs: List[NoteSeg],
 	return out
 
 def build_timeline_segments_highest(msgs: List[NoteMsg]) -> List[NoteSeg]:
+	return build_timeline_segments_rank(msgs, 0, trim=True)
+
+def build_timeline_segments_rank(msgs: List[NoteMsg], rank: int, trim: bool) -> List[NoteSeg]:
+	"""
+	Моно-голос номер rank: 0 = самая высокая активная нота, 1 = вторая сверху, ...
+	trim=False — паузы в начале/конце не обрезаем (партии ансамбля выравниваются общей сеткой).
+	"""
 	if not msgs:
 		return []
 
@@ -280,14 +312,16 @@ def build_timeline_segments_highest(msgs: List[NoteMsg]) -> List[NoteSeg]:
 			if m.is_on:
 				active[m.note] = m.t
 
-		cur_note = max(active.keys()) if active else 0
+		ranked = sorted(active.keys(), reverse=True)
+		cur_note = ranked[rank] if rank < len(ranked) else 0
 
 	segs = merge_adjacent_segments(segs, note_on_at)
 
-	while segs and segs[0].note == 0:
-		segs.pop(0)
-	while segs and segs[-1].note == 0:
-		segs.pop()
+	if trim:
+		while segs and segs[0].note == 0:
+			segs.pop(0)
+		while segs and segs[-1].note == 0:
+			segs.pop()
 
 	return segs
 
@@ -410,14 +444,23 @@ def segments_to_events(segs: List[NoteSeg],
 # Вставка TEMPO + красивое разбиение длительностей
 #=====================================================================#
 
-def append_note_items(out: List[OutItem], note: int, dur16: int) -> None:
+def append_note_items(out: List[OutItem], note: int, dur16: int, tie: Optional[bool] = None) -> None:
+	"""
+	tie=None  — как раньше: каждый кусок разбиения — отдельная нота.
+	tie=bool  — ансамбль: первый кусок продолжает предыдущую ноту, если tie=True,
+	            остальные куски разбиения — всегда продолжение (LGT).
+	"""
 	if dur16 <= 0:
 		return
 
 	note_token = "PAUSE" if note == 0 else midi_note_to_token(note)
 
-	for d in split_dur16_pretty(dur16):
-		out.append(OutItem(kind="note", note_token=note_token, dur_token=dur16_to_token(d), dur16=d))
+	for i, d in enumerate(split_dur16_pretty(dur16)):
+		piece_tie = False
+		if tie is not None and note != 0:
+			piece_tie = tie if i == 0 else True
+		out.append(OutItem(kind="note", note_token=note_token, dur_token=dur16_to_token(d), dur16=d, tie=piece_tie,
+						   note=int(note)))
 
 def insert_tempo_into_events(events: List[Tuple[int, int]],
 							 tempos: List[TempoPoint]) -> List[OutItem]:
@@ -465,6 +508,77 @@ def insert_tempo_into_events(events: List[Tuple[int, int]],
 	return out
 
 
+#=====================================================================#
+# Ансамбль: партии на общей сетке событий
+#=====================================================================#
+
+def build_ensemble_items(parts_segs: List[List[NoteSeg]],
+						 tempos: List[TempoPoint],
+						 ticks_per_16: float,
+						 base_tick: int) -> List[List[OutItem]]:
+	"""
+	Каждая партия раскладывается по ячейкам 1/16: (нота, id сегмента).
+	Граница события — там, где ячейка меняется хотя бы в одной партии, или стоит TEMPO.
+	Все партии режутся по одним и тем же границам -> одинаковая раскладка байт.
+	"""
+	grid_ticks_i = int(round(ticks_per_16))
+	if grid_ticks_i <= 0:
+		grid_ticks_i = 1
+
+	quantized: List[List[Tuple[int, int, int, int]]] = []
+	total = 0
+	for segs in parts_segs:
+		q: List[Tuple[int, int, int, int]] = []
+		for sid, s in enumerate(segs):
+			if s.note == 0:
+				continue
+			qs = quantize_tick(max(0, int(s.start - base_tick)), grid_ticks_i)
+			qe = quantize_tick(max(0, int(s.end - base_tick)), grid_ticks_i)
+			a = int(round(qs / ticks_per_16))
+			b = int(round(qe / ticks_per_16))
+			if b <= a:
+				b = a + 1
+			q.append((a, b, clamp(int(s.note), 1, 127), sid))
+			total = max(total, b)
+		quantized.append(q)
+
+	# ячейки: позже начавшийся сегмент перекрывает хвост предыдущего (как в моно)
+	cells: List[List[Tuple[int, int]]] = []
+	for q in quantized:
+		c = [(0, -1)] * total
+		for a, b, note, sid in q:
+			for t in range(a, b):
+				c[t] = (note, sid)
+		cells.append(c)
+
+	bounds: Set[int] = {0, total}
+	for c in cells:
+		for t in range(1, total):
+			if c[t] != c[t - 1]:
+				bounds.add(t)
+
+	tempo_at: Dict[int, List[TempoPoint]] = {}
+	for tp in sorted(tempos, key=lambda x: x.pos16):
+		if 0 < tp.pos16 < total:
+			bounds.add(tp.pos16)
+			tempo_at.setdefault(tp.pos16, []).append(tp)
+
+	bs = sorted(bounds)
+
+	out: List[List[OutItem]] = []
+	for c in cells:
+		items: List[OutItem] = []
+		for i in range(len(bs) - 1):
+			a, b = bs[i], bs[i + 1]
+			for tp in tempo_at.get(a, []):
+				items.append(OutItem(kind="tempo", tempo10=tp.tempo10, bpm=tp.bpm))
+			note, sid = c[a]
+			tie = a > 0 and note != 0 and c[a - 1] == (note, sid)
+			append_note_items(items, note, b - a, tie)
+		out.append(items)
+	return out
+
+
 #=====================================================================#
 # Форматирование C-массива:
 #  - первая строка: TEMPO, X, TRANS, 0
@@ -512,7 +626,8 @@ def format_as_c_array(items: List[OutItem],
 		if bar_sum > 0 and (bar_sum + it.dur16) > bar_16_len:
 			flush_bar_row()
 
-		row.append(f"{it.note_token}, {it.dur_token}")
+		dur_token = f"({it.dur_token} | LGT)" if it.tie else it.dur_token
+		row.append(f"{it.note_token}, {dur_token}")
 		bar_sum += it.dur16
 
 		if bar_sum >= bar_16_len:
@@ -526,6 +641,35 @@ def format_as_c_array(items: List[OutItem],
 	return "\n".join(lines)
 
 
+#=====================================================================#
+# Бинарный поток (cmd, val) — как байты C-массива
+#=====================================================================#
+
+_CMD_PAUSE = 0x00
+_CMD_TEMPO = 0xFF
+_CMD_TRANS = 0xFE
+_DUR_LGT = 0x40
+
+def format_as_bytes(items: List[OutItem],
+					initial_tempo10: int,
+					initial_trans: int) -> bytes:
+	out = bytearray([_CMD_TEMPO, initial_tempo10 & 0xFF, _CMD_TRANS, initial_trans & 0xFF])
+
+	for it in items:
+		if it.kind == "tempo":
+			out += bytes([_CMD_TEMPO, it.tempo10 & 0xFF])
+			continue
+
+		# L01 = 0 (правило len16=0), остальные — число 16-х
+		dur = 0 if it.dur16 == 16 else it.dur16
+		if it.tie:
+			dur |= _DUR_LGT
+		cmd = _CMD_PAUSE if it.note == 0 else clamp(it.note, 1, 127)
+		out += bytes([cmd, dur])
+
+	return bytes(out)
+
+
 #=====================================================================#
 # Inspect
 #=====================================================================#
@@ -587,6 +731,11 @@ def main() -> None:
 	# Если кто-то передаст --transpose, применяем это как initial TRANS, но ноты НЕ СДВИГАЕМ.
 	ap.add_argument("--transpose", type=int, default=None)
 
+	ap.add_argument("--parts", type=int, default=0,
+					help="Ensemble: emit N part streams <name>_p0..p<N-1> (per track, or per voice of one track).")
+	ap.add_argument("--bin", type=str, default=None,
+					help="Also write the raw (cmd,val) stream to FILE (for songimage.py / I2C EEPROM).")
+
 	args = ap.parse_args()
 
 	if args.inspect:
@@ -598,21 +747,42 @@ def main() -> None:
 	if not args.midi:
 		raise SystemExit("Нужен MIDI файл. Пример: python mid2code.py input.mid --name song0")
 
+	if args.bin and args.parts > 0:
+		raise SystemExit("--bin пока только для одной партии (без --parts).")
+
 	mid = mido.MidiFile(args.midi)
 	time_sig = read_time_signature(mid)
 
 	ticks_per_beat = int(mid.ticks_per_beat)
 	ticks_per_16 = float(ticks_per_beat) / 4.0
 
-	_track_idx, msgs = pick_first_track_with_notes(mid)
-	if not msgs:
-		raise SystemExit("Не найдено нот (note_on/note_off) ни в одном треке.")
+	parts_segs: List[List[NoteSeg]] = []
 
-	segs = build_timeline_segments_highest(msgs)
-	if not segs:
-		raise SystemExit("Ноты найдены, но после моно-таймлайна сегментов не осталось.")
+	if args.parts > 0:
+		tracks = tracks_with_notes(mid)
+		if not tracks:
+			raise SystemExit("Не найдено нот (note_on/note_off) ни в одном треке.")
+
+		if len(tracks) > 1:
+			parts_segs = [build_timeline_segments_rank(t, 0, trim=False) for t in tracks[:args.parts]]
+		else:
+			parts_segs = [build_timeline_segments_rank(tracks[0], k, trim=False) for k in range(args.parts)]
 
-	base_tick = int(segs[0].start)
+		starts = [s.start for p in parts_segs for s in p if s.note != 0]
+		if not starts:
+			raise SystemExit("Ноты найдены, но ни в одной партии сегментов не осталось.")
+		base_tick = int(min(starts))
+		segs = []
+	else:
+		_track_idx, msgs = pick_first_track_with_notes(mid)
+		if not msgs:
+			raise SystemExit("Не найдено нот (note_on/note_off) ни в одном треке.")
+
+		segs = build_timeline_segments_highest(msgs)
+		if not segs:
+			raise SystemExit("Ноты найдены, но после моно-таймлайна сегментов не осталось.")
+
+		base_tick = int(segs[0].start)
 
 	events = segments_to_events(
 		segs=segs,
@@ -646,9 +816,27 @@ def main() -> None:
 		if initial_trans > 127:
 			initial_trans = 127
 
-	items = insert_tempo_into_events(events=events, tempos=tempos)
-
 	name = sanitize_name_lower(str(args.name))
+
+	if args.parts > 0:
+		parts_items = build_ensemble_items(parts_segs, tempos, ticks_per_16, base_tick)
+		chunks: List[str] = []
+		for k, items in enumerate(parts_items):
+			chunks.append(format_as_c_array(
+				items=items,
+				name=f"{name}_p{k}",
+				time_sig=time_sig,
+				initial_tempo10=initial_tempo10,
+				initial_trans=initial_trans,
+			))
+		print("\n\n".join(chunks))
+		print()
+		print(f"// songs[]:      SONG_ENTRY({name}_p0),")
+		for k in range(1, len(parts_items)):
+			print(f"// song_parts[]: PART_ENTRY(<индекс {name}_p0 в songs[]>, {k}, {name}_p{k}),")
+		return
+
+	items = insert_tempo_into_events(events=events, tempos=tempos)
 	c_code = format_as_c_array(
 		items=items,
 		name=name,
@@ -658,5 +846,9 @@ def main() -> None:
 	)
 	print(c_code)
 
+	if args.bin:
+		with open(args.bin, "wb") as f:
+			f.write(format_as_bytes(items, initial_tempo10, initial_trans))
+
 if __name__ == "__main__":
 	main()
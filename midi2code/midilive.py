@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+midilive.py
+
+Живой поток MIDI для PLAYER_MIDI (src/Midi.h): .mid -> note on/off на 31250 бод, как с клавиатуры.
+
+Поток:
+    - note on/off всех дорожек (или --channel) в порядке времени, каналы сохраняются (--to-channel — в один)
+    - running status: статус-байт только при смене; note off -> note on с velocity 0 (--no-running — без этого)
+    - байты на линии — подряд, следующий не раньше конца предыдущего (10 бит = 320 мкс)
+
+Проверка (--check) — модель приёмника шкатулки на уровне тактов:
+    - уровни линии по времени -> PCINT: вход не раньше конца текущего прерывания (аудио-ISR на сетке аудио-тика,
+      длинная — на нотном тике; сама PCINT после байта) + MIDI_ENTRY_CYCLES
+    - выборки битов по TCNT0, как isrMidiByte() (Player.h): середина бита + опоздание входа + проход цикла,
+      часы шкатулки расходятся с передатчиком на --clock-error
+    - разбор — копия Midi_onByte(); события сравниваются с переданными
+    - задержка: от конца сообщения на линии (стоп-бит последнего байта) до звука —
+      следующий аудио-тик после note on + расчёт сэмпла + защёлка PWM (худший случай, период Timer0)
+
+Подключение: TX USB-UART адаптера (31250 бод умеют FTDI/CP2102) -> MIDI_PIN через оптрон или напрямую
+(уровни 5 В, общая земля), либо настоящий MIDI-выход (тогда --port не нужен, проверка — --check).
+
+Пример:
+    python midilive.py ../songs/Titanic.mid --check
+    python midilive.py ../songs/Titanic.mid --port /dev/ttyUSB0
+    python midilive.py ../songs/Titanic.mid --out titanic.raw --timed titanic.txt
+"""
+
+from __future__ import annotations
+
+import argparse
+import bisect
+import random
+import time
+from typing import List, Optional, Tuple
+
+# Должны совпадать с Player.h / Midi.h
+F_CPU = 16_500_000
+MIDI_BAUD = 31250
+MIDI_BIT_CYCLES = (F_CPU + MIDI_BAUD // 2) // MIDI_BAUD
+MIDI_ENTRY_CYCLES = 64
+MIDI_LATE_CYCLES = 240
+AUDIO_TICK_CYCLES_T1 = 8 * ((F_CPU + 8 * 24000 // 2) // (8 * 24000))	# Timer1 CTC, /8
+AUDIO_TICK_CYCLES_T0 = 256 * 3											# PLAYER_AUDIO_CLOCK_TIMER0
+NOTE_TICK_TARGET_HZ = 200
+PWM_PERIOD_CYCLES = 256
+
+# Модель времени кода (такты, оценки по листингу)
+LOOP_CYCLES = 28			# проход цикла приёма (TCNT0, флаг, сравнение)
+RENDER_CYCLES = 110			# сэмпл в цикле приёма / в аудио-ISR
+EXIT_CYCLES = 90			# после стоп-бита: разбор, синтезатор, нотные тики, эпилог
+RETURN_CYCLES = 60			# вход по подъёму: проверка пина и выход
+
+Event = Tuple[str, int, int]	# ("on"/"off", канал 0..15, нота)
+
+
+#=====================================================================#
+# .mid -> сообщения -> байты
+#=====================================================================#
+
+def read_messages(path: str, channel: Optional[int], to_channel: Optional[int]) -> List[Tuple[float, List[int]]]:
+	"""(время, байты сообщения) для note on/off, время в секундах от начала."""
+	try:
+		import mido
+	except ImportError as e:
+		raise SystemExit(f"Не найден пакет 'mido'. Установи: pip install mido\nТекст ошибки: {e}")
+
+	out = []
+	now = 0.0
+	for msg in mido.MidiFile(path):
+		now += msg.time
+		if msg.type not in ("note_on", "note_off"):
+			continue
+		if channel is not None and msg.channel != channel - 1:
+			continue
+		ch = msg.channel if to_channel is None else to_channel - 1
+		status = (0x90 if msg.type == "note_on" else 0x80) | ch
+		out.append((now, [status, msg.note, msg.velocity]))
+	if not out:
+		raise SystemExit(f"{path}: нет нот.")
+	return out
+
+
+def encode(messages: List[Tuple[float, List[int]]], running: bool) -> Tuple[List[Tuple[float, List[int]]], int]:
+	"""Running status и note off -> note on velocity 0. @return (сообщения, сэкономлено байт)."""
+	out = []
+	last = 0
+	saved = 0
+	for t, (status, note, vel) in messages:
+		if running and (status & 0xF0) == 0x80:
+			status, vel = 0x90 | (status & 0x0F), 0
+		if running and status == last:
+			out.append((t, [note, vel]))
+			saved += 1
+		else:
+			out.append((t, [status, note, vel]))
+		last = status
+	return out, saved
+
+
+def schedule(messages: List[Tuple[float, List[int]]]) -> Tuple[List[float], List[int], List[int]]:
+	"""Байты на линии: (начала байт, байты, индекс последнего байта каждого сообщения)."""
+	starts: List[float] = []
+	data: List[int] = []
+	ends: List[int] = []
+	free = 0.0
+	byte_time = 10.0 / MIDI_BAUD
+	for t, msg in messages:
+		at = max(t, free)
+		for b in msg:
+			starts.append(at)
+			data.append(b)
+			at += byte_time
+		free = at
+		ends.append(len(data) - 1)
+	return starts, data, ends
+
+
+#=====================================================================#
+# Разбор — как Midi_onByte() (Midi.h)
+#=====================================================================#
+
+class Parser:
+	def __init__(self, channel: int = 0) -> None:
+		self.status = 0
+		self.have = 0
+		self.data0 = 0
+		self.channel = channel		# MIDI_CHANNEL: 0 — все
+
+	def byte(self, b: int) -> Optional[Event]:
+		if b >= 0xF8:
+			return None
+		if b & 0x80:
+			self.status = 0 if b >= 0xF0 else b
+			self.have = 0
+			return None
+		if self.status == 0:
+			return None
+		kind = self.status & 0xF0
+		if kind in (0xC0, 0xD0):
+			return None
+		if self.have == 0:
+			self.data0 = b
+			self.have = 1
+			return None
+		self.have = 0
+		ch = self.status & 0x0F
+		if self.channel and ch != self.channel - 1:
+			return None
+		if kind == 0x90 and b != 0:
+			return ("on", ch, self.data0)
+		if kind in (0x80, 0x90):
+			return ("off", ch, self.data0)
+		return None
+
+
+def events_of(data: List[int], channel: int) -> List[Event]:
+	p = Parser(channel)
+	return [e for e in (p.byte(b) for b in data) if e is not None]
+
+
+#=====================================================================#
+# Модель приёмника (isrMidiByte(), Player.h)
+#=====================================================================#
+
+class Line:
+	"""Уровень линии по времени (секунды)."""
+
+	def __init__(self, starts: List[float], data: List[int]) -> None:
+		self.starts = starts
+		self.data = data
+
+	def level(self, t: float) -> int:
+		i = bisect.bisect_right(self.starts, t) - 1
+		if i < 0:
+			return 1
+		bit = int((t - self.starts[i]) * MIDI_BAUD)
+		if bit == 0:
+			return 0
+		if bit <= 8:
+			return (self.data[i] >> (bit - 1)) & 1
+		return 1
+
+	def edges(self) -> List[float]:
+		"""Все фронты (любые — PCINT ловит оба)."""
+		out = []
+		for s, b in zip(self.starts, self.data):
+			bits = [0] + [(b >> k) & 1 for k in range(8)] + [1]
+			lvl = 1
+			for k, v in enumerate(bits):
+				if v != lvl:
+					out.append(s + k / MIDI_BAUD)
+					lvl = v
+		return out
+
+
+class Receiver:
+	def __init__(self, args: argparse.Namespace, line: Line) -> None:
+		self.line = line
+		self.hz = F_CPU * (1.0 + args.clock_error / 100.0)		# реальные такты шкатулки
+		self.tick = AUDIO_TICK_CYCLES_T0 if args.timer0 else AUDIO_TICK_CYCLES_T1
+		self.note_div = max(1, round(F_CPU / self.tick / NOTE_TICK_TARGET_HZ))
+		self.isr = args.isr_cycles
+		self.note_isr = args.note_isr_cycles
+		self.rng = random.Random(args.seed)
+
+	def cycles(self, t: float) -> float:
+		return t * self.hz
+
+	def seconds(self, c: float) -> float:
+		return c / self.hz
+
+	def audio_busy_until(self, c: float) -> float:
+		"""Аудио-ISR, начатая до c, ещё идёт — её конец (иначе c)."""
+		k = int(c // self.tick)
+		dur = self.note_isr if k % self.note_div == 0 else self.isr
+		end = k * self.tick + dur
+		return end if end > c else c
+
+	def next_tick(self, c: float) -> float:
+		return (int(c // self.tick) + 1) * self.tick
+
+	def run(self) -> Tuple[List[Tuple[int, float]], int, float]:
+		"""@return ([(байт, такт выхода из ISR)], ошибок кадра, худший запас выборки в битах)."""
+		edges = [self.cycles(t) for t in self.line.edges()]
+		got: List[Tuple[int, float]] = []
+		errors = 0
+		margin = 1.0
+		free = 0.0
+		i = 0
+		while i < len(edges):
+			edge = edges[i]
+			# PCINT ждёт своё прерывание (после байта) или аудио-ISR (у PCINT приоритет выше)
+			start = edge if edge >= free else free
+			start = self.audio_busy_until(start)
+			entry = start + MIDI_ENTRY_CYCLES				# первое чтение TCNT0
+			if self.line.level(self.seconds(entry)):
+				free = entry + RETURN_CYCLES
+				i = bisect.bisect_right(edges, entry)
+				continue
+
+			base = entry - MIDI_ENTRY_CYCLES - MIDI_LATE_CYCLES / 2	# так ISR считает фронт старт-бита
+			value = 0
+			framed = False
+			c = base
+			for bit in range(10):
+				# сэмпл в цикле не ближе MIDI_RENDER_GUARD к выборке — сдвигает её только проход цикла
+				c = base + (bit + 0.5) * MIDI_BIT_CYCLES + self.rng.uniform(0, LOOP_CYCLES)
+				t = self.seconds(c)
+				lvl = self.line.level(t)
+				j = bisect.bisect_right(self.line.starts, t) - 1
+				if j >= 0:
+					pos = (t - self.line.starts[j]) * MIDI_BAUD
+					if pos < 10.0:
+						frac = pos - int(pos)
+						margin = min(margin, frac, 1.0 - frac)
+				if bit == 0:
+					if lvl:
+						break
+				elif bit <= 8:
+					value |= lvl << (bit - 1)
+				else:
+					framed = lvl == 1
+			exit_c = c + EXIT_CYCLES
+			if bit == 9:
+				if framed:
+					got.append((value, exit_c))
+				else:
+					errors += 1
+			free = exit_c
+			i = bisect.bisect_right(edges, entry)
+		return got, errors, margin
+
+
+#=====================================================================#
+# Команды
+#=====================================================================#
+
+def check(args: argparse.Namespace, starts: List[float], data: List[int], ends: List[int], saved: int) -> int:
+	line = Line(starts, data)
+	rx = Receiver(args, line)
+	got, errors, margin = rx.run()
+
+	sent_events = events_of(data, args.midi_channel)
+	rx_bytes = [b for b, _ in got]
+	rx_events = events_of(rx_bytes, args.midi_channel)
+
+	# задержка note on: конец сообщения на линии -> звук
+	p = Parser(args.midi_channel)
+	lat_end: List[float] = []
+	lat_msg: List[float] = []
+	msg_first = 0
+	end_set = set(ends)
+	first_of = {}
+	for k, last in enumerate(ends):
+		first_of[last] = msg_first
+		msg_first = last + 1
+	exits = {}
+	if rx_bytes == data:
+		exits = {k: c for k, (_, c) in enumerate(got)}
+	for k, b in enumerate(data):
+		ev = p.byte(b)
+		if ev is None or ev[0] != "on" or k not in exits or k not in end_set:
+			continue
+		sound = rx.next_tick(exits[k]) + RENDER_CYCLES + PWM_PERIOD_CYCLES
+		wire_end = starts[k] + 10.0 / MIDI_BAUD
+		lat_end.append(rx.seconds(sound) - wire_end)
+		lat_msg.append(rx.seconds(sound) - starts[first_of[k]])
+
+	busy = 10.0 / MIDI_BAUD * len(data)
+	span = max(starts[-1] - starts[0], 1e-9)
+	print(f"{args.midi}: {len(ends)} сообщений, {len(data)} байт (running status: -{saved}), "
+		  f"линия занята {100.0 * busy / span:.1f}% времени")
+	print(f"приём: {len(rx_bytes)}/{len(data)} байт, ошибок кадра {errors}, "
+		  f"события {'совпадают' if rx_events == sent_events else 'НЕ совпадают'} ({len(rx_events)}), "
+		  f"запас выборки {margin:.2f} бита")
+	if lat_end:
+		ms = 1000.0
+		print(f"note on, конец сообщения -> звук: мин {min(lat_end) * ms:.3f} / ср "
+			  f"{sum(lat_end) / len(lat_end) * ms:.3f} / макс {max(lat_end) * ms:.3f} мс")
+		print(f"note on, первый байт сообщения -> звук: макс {max(lat_msg) * ms:.3f} мс")
+
+	ok = rx_events == sent_events and errors == 0 and lat_end and max(lat_end) < 0.001
+	return 0 if ok else 1
+
+
+def send(port_name: str, messages: List[Tuple[float, List[int]]]) -> None:
+	import serial  # pyserial
+
+	with serial.Serial(port_name, MIDI_BAUD, bytesize=8, parity="N", stopbits=1) as port:
+		t0 = time.monotonic()
+		for t, msg in messages:
+			wait = t0 + t - time.monotonic()
+			if wait > 0:
+				time.sleep(wait)
+			port.write(bytes(msg))
+		port.flush()
+
+
+def main() -> None:
+	ap = argparse.ArgumentParser(description="Play a .mid file as a live 31250-baud MIDI stream (PLAYER_MIDI) or check it against the receiver model.")
+	ap.add_argument("midi", help="MIDI file.")
+	ap.add_argument("--channel", type=int, default=None, help="Only this channel of the file (1..16).")
+	ap.add_argument("--to-channel", type=int, default=None, help="Send everything on this channel (1..16).")
+	ap.add_argument("--no-running", action="store_true", help="Full status byte in every message, note off as 0x80.")
+	ap.add_argument("--port", type=str, default=None, help="Serial port at 31250 baud (e.g. /dev/ttyUSB0, COM3).")
+	ap.add_argument("--out", type=str, default=None, help="Write the raw byte stream to a file.")
+	ap.add_argument("--timed", type=str, default=None, help="Write '<start us> <byte hex>' lines (wire timing).")
+	ap.add_argument("--check", action="store_true", help="Replay through the receiver model: bytes, events, latency.")
+	ap.add_argument("--midi-channel", type=int, default=0, help="MIDI_CHANNEL of the firmware (0 = omni).")
+	ap.add_argument("--timer0", action="store_true", help="Firmware built with PLAYER_AUDIO_CLOCK_TIMER0.")
+	ap.add_argument("--isr-cycles", type=int, default=160, help="Audio ISR length, cycles.")
+	ap.add_argument("--note-isr-cycles", type=int, default=260, help="Audio ISR length on a note tick in live mode, cycles.")
+	ap.add_argument("--clock-error", type=float, default=1.0, help="Box clock vs sender, percent (+ = box faster).")
+	ap.add_argument("--seed", type=int, default=1, help="Random seed of the model.")
+	args = ap.parse_args()
+
+	messages, saved = encode(read_messages(args.midi, args.channel, args.to_channel), not args.no_running)
+	starts, data, ends = schedule(messages)
+
+	if args.out:
+		with open(args.out, "wb") as f:
+			f.write(bytes(data))
+		print(f"{args.out}: {len(data)} байт")
+	if args.timed:
+		with open(args.timed, "w", encoding="utf-8") as f:
+			for s, b in zip(starts, data):
+				f.write(f"{s * 1e6:.1f} {b:02X}\n")
+		print(f"{args.timed}: {len(data)} строк")
+	if args.check:
+		raise SystemExit(check(args, starts, data, ends, saved))
+	if args.port:
+		send(args.port, messages)
+		return
+	if not (args.out or args.timed):
+		raise SystemExit("Нужен --port, --out, --timed или --check.")
+
+
+if __name__ == "__main__":
+	main()
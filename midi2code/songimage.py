@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+songimage.py
+
+Образ внешней I2C EEPROM (24LCxx) с песнями для PLAYER_SONG_SOURCE_I2C (src/SongStream.h).
+
+Вход: потоки песен из midi2code.py --bin (пары cmd, val — как массивы Songs.h).
+
+Образ:
+    [0] 'M' [1] 'B' [2] число песен [3] 0
+    [4 + 4*i] адрес песни i (lo, hi), длина (lo, hi)
+    дальше — потоки песен подряд, каждый с чётного адреса
+    (пара cmd/val никогда не рвётся границей блока чтения)
+
+Пример:
+    python midi2code.py a.mid --name a --bin a.bin
+    python midi2code.py b.mid --name b --bin b.bin
+    python songimage.py a.bin b.bin -o songs.eep
+    # записать songs.eep в EEPROM любым программатором 24LCxx
+"""
+
+from __future__ import annotations
+
+import argparse
+from typing import List
+
+# Должны совпадать с SongStream.h
+MAX_SONGS = 8
+HEADER_LEN = 4
+ENTRY_LEN = 4
+
+
+def build_image(songs: List[bytes], size: int) -> bytes:
+	if not songs:
+		raise SystemExit("Нужна хотя бы одна песня.")
+	if len(songs) > MAX_SONGS:
+		raise SystemExit(f"Не больше {MAX_SONGS} песен (SONG_STREAM_MAX_SONGS).")
+
+	img = bytearray(b"MB" + bytes([len(songs), 0]))
+	img += bytes(ENTRY_LEN * len(songs))
+
+	for i, data in enumerate(songs):
+		if len(data) & 1:
+			raise SystemExit(f"Песня {i}: нечётная длина {len(data)} — это не поток пар (cmd, val).")
+
+		if len(img) & 1:
+			img.append(0)
+
+		addr = len(img)
+		e = HEADER_LEN + ENTRY_LEN * i
+		img[e:e + ENTRY_LEN] = bytes([addr & 0xFF, addr >> 8, len(data) & 0xFF, len(data) >> 8])
+		img += data
+
+	if len(img) > size:
+		raise SystemExit(f"Образ {len(img)} байт не влезает в EEPROM {size} байт.")
+
+	return bytes(img)
+
+
+def main() -> None:
+	ap = argparse.ArgumentParser(description="Build I2C EEPROM image from midi2code.py --bin streams.")
+	ap.add_argument("songs", nargs="+", help="Song streams (.bin), in playback order.")
+	ap.add_argument("-o", "--out", type=str, required=True, help="Output image file.")
+	ap.add_argument("--size", type=int, default=32768, help="EEPROM size in bytes (24LC256 = 32768).")
+	args = ap.parse_args()
+
+	songs: List[bytes] = []
+	for path in args.songs:
+		with open(path, "rb") as f:
+			songs.append(f.read())
+
+	img = build_image(songs, args.size)
+
+	with open(args.out, "wb") as f:
+		f.write(img)
+
+	print(f"{args.out}: {len(songs)} песен, {len(img)} из {args.size} байт")
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+songupload.py
+
+Загрузка песни в EEPROM шкатулки по UART для PLAYER_SONG_UPLOAD (src/Upload.h) — без перепрошивки.
+
+Вход: поток песни из midi2code.py --bin (пары cmd, val — как массивы Songs.h).
+
+Кадр (8N1, 2400 бод по умолчанию):
+    'M' 'U' [len lo][len hi] data[len] [crc lo][crc hi]
+    crc — CRC-CCITT по data (как _crc_ccitt_update() из avr-libc, начальное 0xFFFF)
+
+Подключение: TX USB-UART адаптера -> UPLOAD_PIN (PB2), общая земля.
+Шкатулка пишет байт в EEPROM ~3.3 мс, байт на 2400 бод идёт ~4.2 мс — пауз между байтами не нужно.
+Записанную песню шкатулка сразу начинает играть.
+
+Пример:
+    python midi2code.py a.mid --name a --bin a.bin
+    python songupload.py a.bin --port /dev/ttyUSB0
+    python songupload.py a.bin --out a.frame     # только кадр в файл (pyserial не нужен)
+"""
+
+from __future__ import annotations
+
+import argparse
+
+# Должны совпадать с Upload.h
+UPLOAD_MAX_LEN = 252
+UPLOAD_BAUD = 2400
+
+
+def crc_ccitt_update(crc: int, data: int) -> int:
+	"""_crc_ccitt_update() из avr-libc (util/crc16.h)."""
+	data ^= crc & 0xFF
+	data = (data ^ (data << 4)) & 0xFF
+	return (((data << 8) | (crc >> 8)) ^ (data >> 4) ^ (data << 3)) & 0xFFFF
+
+
+def build_frame(data: bytes, max_len: int) -> bytes:
+	if not data:
+		raise SystemExit("Пустая песня.")
+	if len(data) & 1:
+		raise SystemExit(f"Нечётная длина {len(data)} — это не поток пар (cmd, val).")
+	if len(data) > max_len:
+		raise SystemExit(f"Песня {len(data)} байт не влезает в слот {max_len} байт (UPLOAD_MAX_LEN).")
+
+	crc = 0xFFFF
+	for b in data:
+		crc = crc_ccitt_update(crc, b)
+
+	n = len(data)
+	return b"MU" + bytes([n & 0xFF, n >> 8]) + data + bytes([crc & 0xFF, crc >> 8])
+
+
+def main() -> None:
+	ap = argparse.ArgumentParser(description="Upload a midi2code.py --bin song into the music box EEPROM over UART.")
+	ap.add_argument("song", help="Song stream (.bin).")
+	ap.add_argument("--port", type=str, default=None, help="Serial port (e.g. /dev/ttyUSB0, COM3).")
+	ap.add_argument("--baud", type=int, default=UPLOAD_BAUD, help="Baud rate (UPLOAD_BAUD).")
+	ap.add_argument("--max-len", type=int, default=UPLOAD_MAX_LEN, help="Slot size in bytes (UPLOAD_MAX_LEN).")
+	ap.add_argument("--out", type=str, default=None, help="Write the frame to a file instead of the port.")
+	args = ap.parse_args()
+
+	with open(args.song, "rb") as f:
+		frame = build_frame(f.read(), args.max_len)
+
+	if args.out:
+		with open(args.out, "wb") as f:
+			f.write(frame)
+		print(f"{args.out}: кадр {len(frame)} байт")
+		return
+
+	if not args.port:
+		raise SystemExit("Нужен --port (или --out).")
+
+	import serial  # pyserial
+
+	with serial.Serial(args.port, args.baud, bytesize=8, parity="N", stopbits=1) as port:
+		port.write(frame)
+		port.flush()
+
+	print(f"{args.port}: отправлено {len(frame)} байт ({len(frame) * 10 / args.baud:.1f} с)")
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+size_report.py
+
+Отчёт "кто съел flash/SRAM" для прошивки MusicBox + регрессионный гейт по бюджету.
+
+Источники:
+ - map-файл линкера (-Wl,-Map=MusicBox.map): размер каждой входной секции и объектник,
+   из которого она пришла -> разбивка по файлам ядра Digistump, crt/libgcc и main.cpp.
+ - avr-nm --size-sort -S -C: размеры символов -> внутри main.cpp отделяем
+   песни (массивы из Songs.h) и таблицы (Synth.h / Sampler.h) от кода плеера.
+
+Группы:
+ - song:<имя>    — массив песни из Songs.h (const uint8_t имя[] PROGMEM)
+ - table:<имя>   — прочие PROGMEM таблицы: songs[] / song_titles / song_parts из Songs.h,
+                   Synth.h / Sampler.h / Lights.h / Pixels.h (notes_add, waveform, клипы, палитра, ...)
+ - player        — всё остальное из main.cpp (код плеера, ISR и т.п.)
+ - core:<файл>   — объектник ядра Digistump (DIGISTUMP_CORE_SOURCES)
+ - libc          — crt, libgcc, avr-libc
+ - other         — *fill*, выравнивание и то, что не удалось отнести
+
+flash = .text (+ .progmem) + .data (начальные значения лежат во flash)
+sram  = .data + .bss + .noinit
+
+Бюджет (budget.txt): строки "группа flash sram". Гейт падает (exit 1), если группа
+или итог выросли больше чем на --threshold байт, а также если у группы или у total
+нет строки в бюджете (иначе новый код рос бы незамеченным). Обновить бюджет: --update.
+В CMake гейт выключен (MUSICBOX_SIZE_GATE=OFF), пока в budget.txt нет измеренных строк кода.
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+from dataclasses import dataclass
+from typing import Dict, List, Optional, Tuple
+
+#=====================================================================#
+# Внутренние структуры
+#=====================================================================#
+
+@dataclass
+class Usage:
+	flash: int = 0
+	sram: int = 0
+
+	def add(self, other: "Usage") -> None:
+		self.flash += other.flash
+		self.sram += other.sram
+
+
+#=====================================================================#
+# Исходники: какие символы считаются песнями / таблицами
+#=====================================================================#
+
+# любая PROGMEM таблица, в том числе многомерная (pixels_palette[12][3])
+_PROGMEM_ARRAY_RE = re.compile(r"^\s*(?:static\s+)?const\s+\w+\s+(\w+)\s*(?:\[[^\]]*\]\s*)+PROGMEM", re.M)
+
+# песня — байтовый поток без размера: const uint8_t имя[] PROGMEM
+# (songs[], song_titles, song_parts из Songs.h — таблицы, а не песни)
+_SONG_ARRAY_RE = re.compile(r"^\s*const\s+uint8_t\s+(\w+)\s*\[\s*\]\s*PROGMEM", re.M)
+
+def _read(path: str) -> str:
+	if not os.path.isfile(path):
+		return ""
+	with open(path, "r", encoding="utf-8") as f:
+		return f.read()
+
+def progmem_arrays(path: str) -> List[str]:
+	return _PROGMEM_ARRAY_RE.findall(_read(path))
+
+def song_arrays(path: str) -> List[str]:
+	return _SONG_ARRAY_RE.findall(_read(path))
+
+
+#=====================================================================#
+# map-файл: размер по объектникам
+#=====================================================================#
+
+# выходные секции, которые нас интересуют, и куда они считаются
+_OUT_SECTIONS = {
+	".text":   (True, False),
+	".data":   (True, True),
+	".bss":    (False, True),
+	".noinit": (False, True),
+}
+
+def classify_object(path: str) -> str:
+	p = path.replace("\\", "/")
+	base = os.path.basename(p)
+
+	m = re.search(r"/cores/tiny/([^/]+?)\.(?:obj|o)$", p)
+	if m:
+		return f"core:{m.group(1)}"
+
+	if re.search(r"/src/main\.cpp\.(?:obj|o)$", p):
+		return "player"
+
+	if base.startswith("crt") or "libgcc" in p or "libc.a" in p or "libm.a" in p or "libattiny" in p:
+		return "libc"
+
+	return "other"
+
+def parse_map(path: str) -> Dict[str, Usage]:
+	with open(path, "r", encoding="utf-8", errors="replace") as f:
+		lines = f.read().splitlines()
+
+	# всё до "Linker script and memory map" — discarded/archive, пропускаем
+	start = 0
+	for i, ln in enumerate(lines):
+		if ln.startswith("Linker script and memory map"):
+			start = i + 1
+			break
+
+	out: Dict[str, Usage] = {}
+	cur_out: Optional[str] = None
+	pending_name: Optional[str] = None
+
+	def account(size: int, obj: str) -> None:
+		if cur_out is None or size <= 0:
+			return
+		to_flash, to_sram = _OUT_SECTIONS[cur_out]
+		grp = out.setdefault(classify_object(obj) if obj else "other", Usage())
+		if to_flash:
+			grp.flash += size
+		if to_sram:
+			grp.sram += size
+
+	for ln in lines[start:]:
+		# выходная секция: начинается с колонки 0
+		if ln and not ln[0].isspace():
+			name = ln.split()[0]
+			cur_out = name if name in _OUT_SECTIONS else None
+			pending_name = None
+			continue
+
+		if cur_out is None:
+			continue
+
+		parts = ln.split()
+		if not parts:
+			continue
+
+		# " *fill*  0xADDR  0xSIZE"
+		if parts[0] == "*fill*" and len(parts) >= 3:
+			account(int(parts[2], 16), "")
+			continue
+
+		# " .text.foo  0xADDR  0xSIZE  file.o"
+		if parts[0].startswith(".") and len(parts) >= 4 and parts[1].startswith("0x") and parts[2].startswith("0x"):
+			account(int(parts[2], 16), " ".join(parts[3:]))
+			pending_name = None
+			continue
+
+		# длинное имя секции — адрес/размер/файл на следующей строке
+		if parts[0].startswith(".") and len(parts) == 1:
+			pending_name = parts[0]
+			continue
+
+		if pending_name and len(parts) >= 3 and parts[0].startswith("0x") and parts[1].startswith("0x"):
+			account(int(parts[1], 16), " ".join(parts[2:]))
+			pending_name = None
+			continue
+
+	return out
+
+
+#=====================================================================#
+# avr-nm: размеры символов
+#=====================================================================#
+
+def run_nm(nm: str, elf: str) -> List[Tuple[str, int, str]]:
+	res = subprocess.run(
+		[nm, "--size-sort", "-S", "-C", "--radix=d", elf],
+		check=True, stdout=subprocess.PIPE, universal_newlines=True,
+	)
+	out: List[Tuple[str, int, str]] = []
+	for ln in res.stdout.splitlines():
+		parts = ln.split(None, 3)
+		if len(parts) < 4:
+			continue
+		_addr, size, kind, name = parts
+		out.append((name.strip(), int(size, 10), kind))
+	return out
+
+def split_player(groups: Dict[str, Usage],
+				 symbols: List[Tuple[str, int, str]],
+				 songs: List[str],
+				 tables: List[str]) -> None:
+	"""Вынимаем песни и таблицы из группы player (все они живут в main.cpp)."""
+	player = groups.setdefault("player", Usage())
+	song_set = set(songs)
+	table_set = set(tables)
+
+	for name, size, kind in symbols:
+		# только данные во flash (PROGMEM -> .text): тип t/T/r/R у avr-nm
+		if kind not in ("t", "T", "r", "R"):
+			continue
+		if name in song_set:
+			grp = f"song:{name}"
+		elif name in table_set:
+			grp = f"table:{name}"
+		else:
+			continue
+
+		groups.setdefault(grp, Usage()).flash += size
+		player.flash -= size
+
+
+#=====================================================================#
+# Бюджет
+#=====================================================================#
+
+def read_budget(path: str) -> Dict[str, Usage]:
+	out: Dict[str, Usage] = {}
+	if not os.path.isfile(path):
+		return out
+	with open(path, "r", encoding="utf-8") as f:
+		for ln in f:
+			ln = ln.split("#", 1)[0].strip()
+			if not ln:
+				continue
+			parts = ln.split()
+			if len(parts) != 3:
+				continue
+			out[parts[0]] = Usage(flash=int(parts[1]), sram=int(parts[2]))
+	return out
+
+def write_budget(path: str, groups: Dict[str, Usage], total: Usage) -> None:
+	lines: List[str] = []
+	lines.append("# MusicBox flash/SRAM budget (sizereport/size_report.py --update)")
+	lines.append("# group                          flash   sram")
+	for name in sorted(groups):
+		u = groups[name]
+		lines.append(f"{name:<32} {u.flash:>6} {u.sram:>6}")
+	lines.append(f"{'total':<32} {total.flash:>6} {total.sram:>6}")
+	with open(path, "w", encoding="utf-8", newline="\n") as f:
+		f.write("\n".join(lines) + "\n")
+
+
+#=====================================================================#
+# Отчёт
+#=====================================================================#
+
+def fmt_delta(now: int, ref: Optional[int]) -> str:
+	if ref is None:
+		return "     -"
+	d = now - ref
+	return f"{d:+6d}" if d else "     0"
+
+def main() -> int:
+	ap = argparse.ArgumentParser(description="MusicBox flash/SRAM per-symbol report with budget gate.")
+	ap.add_argument("--elf", required=True, help="MusicBox.elf")
+	ap.add_argument("--map", required=True, help="Linker map file (-Wl,-Map=...)")
+	ap.add_argument("--nm", default="avr-nm", help="avr-nm executable")
+	ap.add_argument("--src", required=True, help="src/ directory (Songs.h, Synth.h, Sampler.h)")
+	ap.add_argument("--budget", required=True, help="Checked-in budget file")
+	ap.add_argument("--threshold", type=int, default=16, help="Allowed growth per group, bytes")
+	ap.add_argument("--flash-limit", type=int, default=6012, help="Flash available after micronucleus")
+	ap.add_argument("--sram-limit", type=int, default=512, help="ATtiny85 SRAM")
+	ap.add_argument("--top", type=int, default=10, help="Print N largest symbols")
+	ap.add_argument("--update", action="store_true", help="Rewrite budget from current build and exit 0")
+	args = ap.parse_args()
+
+	songs_h = os.path.join(args.src, "Songs.h")
+	songs = song_arrays(songs_h)
+	tables = [t for t in progmem_arrays(songs_h) if t not in songs]
+	for name in ("Synth.h", "Sampler.h", "Lights.h", "Pixels.h"):
+		tables += progmem_arrays(os.path.join(args.src, name))
+
+	groups = parse_map(args.map)
+	symbols = run_nm(args.nm, args.elf)
+	split_player(groups, symbols, songs, tables)
+
+	total = Usage()
+	for u in groups.values():
+		total.add(u)
+
+	if args.update:
+		write_budget(args.budget, groups, total)
+		print(f"Budget updated: {args.budget}")
+		return 0
+
+	budget = read_budget(args.budget)
+
+	print(f"{'group':<32} {'flash':>6} {'d':>6}   {'sram':>5} {'d':>6}")
+	for name in sorted(groups, key=lambda n: (-groups[n].flash, n)):
+		u = groups[name]
+		b = budget.get(name)
+		print(f"{name:<32} {u.flash:>6} {fmt_delta(u.flash, b.flash if b else None)}   "
+			  f"{u.sram:>5} {fmt_delta(u.sram, b.sram if b else None)}")
+
+	bt = budget.get("total")
+	print(f"{'total':<32} {total.flash:>6} {fmt_delta(total.flash, bt.flash if bt else None)}   "
+		  f"{total.sram:>5} {fmt_delta(total.sram, bt.sram if bt else None)}")
+	print(f"flash headroom: {args.flash_limit - total.flash} of {args.flash_limit}, "
+		  f"static SRAM headroom: {args.sram_limit - total.sram} of {args.sram_limit}")
+
+	if args.top > 0:
+		print()
+		print(f"Top {args.top} symbols (avr-nm --size-sort):")
+		for name, size, kind in reversed(symbols[-args.top:]):
+			print(f"  {size:>6} {kind} {name}")
+
+	# Гейт
+	failed: List[str] = []
+	missing: List[str] = []
+	for name, u in sorted(groups.items()):
+		b = budget.get(name)
+		if b is None:
+			missing.append(name)
+			continue
+		if u.flash > b.flash + args.threshold or u.sram > b.sram + args.threshold:
+			failed.append(f"{name}: flash {b.flash} -> {u.flash}, sram {b.sram} -> {u.sram}")
+
+	if bt is None:
+		missing.append("total")
+	elif total.flash > bt.flash + args.threshold or total.sram > bt.sram + args.threshold:
+		failed.append(f"total: flash {bt.flash} -> {total.flash}, sram {bt.sram} -> {total.sram}")
+
+	if total.flash > args.flash_limit:
+		failed.append(f"total flash {total.flash} exceeds limit {args.flash_limit}")
+
+	print()
+	if failed:
+		print(f"SIZE BUDGET EXCEEDED (threshold {args.threshold} bytes):")
+		for f in failed:
+			print("  " + f)
+
+	if missing:
+		print("NO SIZE BUDGET for: " + ", ".join(missing))
+		print("  run the size_budget_update target (with -DMUSICBOX_SIZE_GATE=OFF) and commit budget.txt")
+
+	if failed or missing:
+		return 1
+
+	print("Size budget OK.")
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())
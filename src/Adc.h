@@ -0,0 +1,203 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file Adc.h
+ * АЦП в фоне: датчик крышки (фоторезистор) и ручка громкости, без analogRead().
+ *
+ * Проблема:
+ *  - analogRead() ядра (wiring_analog.c) ждёт конец преобразования циклом (~100 мкс)
+ *    на каждый отсчёт, а setup() и вовсе выключает АЦП (power_adc_disable())
+ *
+ * Идея:
+ *  - автозапуск преобразования по флагу TOV0 (переполнение Timer0, ADTS = 100):
+ *    старт всегда на границе периода PWM, АЦП /128 — 13.5 тактов АЦП = 6.75 периода Timer0,
+ *    поэтому ISR(ADC_vect) приходит через ~190 тактов после переполнения и до следующего
+ *    (в режиме PLAYER_AUDIO_CLOCK_TIMER0 — не вплотную к аудио-ISR; длинный нотный тик
+ *    её просто задерживает — результат ждёт в ADC до следующего преобразования)
+ *  - перезапуск: TOV0 сбрасывает аудио-ISR (Timer0) или ISR(ADC_vect) сама (Timer1: TOIE0 выключен)
+ *  - ISR(ADC_vect) только складывает 8-битный отсчёт (ADLAR, ADCH); после ADC_OVERSAMPLE
+ *    отсчётов — среднее, уровень крышки (с гистерезисом) или громкость, затем следующий канал.
+ *    Первый отсчёт после смены канала выбрасывается (MUX мог смениться уже во время старта)
+ *  - ~9 кГц преобразований, на канал ~270 обновлений/с; loop() ничего не опрашивает
+ *
+ * Подключение (опорное — VCC, делители ратиометричны):
+ *  - крышка: фоторезистор между ADC_LID_PIN и VCC, резистор ~10..47 кОм на GND;
+ *    светло (крышка открыта) — высокий уровень
+ *  - громкость: потенциометр между VCC и GND, движок — на ADC_VOLUME_PIN
+ *
+ * Проверка на хосте: tests/AdcTest.cpp (автозапуск от TOV0, MUX на преобразование позже, шум, гистерезис, громкость).
+ *
+ * Включается PLAYER_LID=1 и/или PLAYER_VOLUME=1 (CMake: -DMUSICBOX_LID=ON, -DMUSICBOX_VOLUME=ON).
+ */
+
+#ifndef PLAYER_LID
+	#define PLAYER_LID				0
+#endif
+#ifndef PLAYER_VOLUME
+	#define PLAYER_VOLUME			0
+#endif
+
+#define PLAYER_ADC					(PLAYER_LID || PLAYER_VOLUME)
+
+// Пины (PORTB; ADC есть на PB2, PB3, PB4, PB5)
+#ifndef ADC_LID_PIN
+	#define ADC_LID_PIN				PB2
+#endif
+#ifndef ADC_VOLUME_PIN
+	#define ADC_VOLUME_PIN			PB3
+#endif
+
+// Порог крышки (0..255) и гистерезис
+#ifndef ADC_LID_LEVEL
+	#define ADC_LID_LEVEL			128
+#endif
+#define ADC_LID_HYST				16
+
+// Отсчётов на одно значение (степень двойки, <= 256)
+#define ADC_OVERSAMPLE_SHIFT		4
+#define ADC_OVERSAMPLE				(1u << ADC_OVERSAMPLE_SHIFT)
+
+// MUX канала для пина: PB5 = ADC0, PB2 = ADC1, PB4 = ADC2, PB3 = ADC3
+#define ADC_MUX_OF_PIN(p)			(((p) == PB5) ? 0 : ((p) == PB2) ? 1 : ((p) == PB4) ? 2 : ((p) == PB3) ? 3 : 0xFF)
+
+// АЦП на этом пине?
+#define ADC_USE_PIN(p)				((PLAYER_LID && ((p) == ADC_LID_PIN)) || (PLAYER_VOLUME && ((p) == ADC_VOLUME_PIN)))
+
+#if PLAYER_LID && (ADC_MUX_OF_PIN(ADC_LID_PIN) == 0xFF)
+	#error "ADC_LID_PIN has no ADC channel (use PB2..PB5)"
+#endif
+#if PLAYER_VOLUME && (ADC_MUX_OF_PIN(ADC_VOLUME_PIN) == 0xFF)
+	#error "ADC_VOLUME_PIN has no ADC channel (use PB2..PB5)"
+#endif
+#if PLAYER_LID && PLAYER_VOLUME && (ADC_LID_PIN == ADC_VOLUME_PIN)
+	#error "ADC_LID_PIN and ADC_VOLUME_PIN are the same pin"
+#endif
+#if (ADC_LID_LEVEL < ADC_LID_HYST) || (ADC_LID_LEVEL + ADC_LID_HYST > 255)
+	#error "ADC_LID_LEVEL must be within ADC_LID_HYST..255-ADC_LID_HYST"
+#endif
+
+// ADMUX: опорное VCC, левое выравнивание (8 бит в ADCH)
+#define ADC_ADMUX(pin)				(_BV(ADLAR) | ADC_MUX_OF_PIN(pin))
+
+// Каналы по кругу
+#define ADC_SLOT_LID				0
+#define ADC_SLOT_VOLUME				1
+
+//=====================================================================//
+// Состояние АЦП
+//=====================================================================//
+typedef struct {
+	uint8_t  slot;						// ADC_SLOT_* текущего канала
+	uint8_t  n;							// отсчётов канала (0 — выбрасывается)
+	uint16_t acc;						// сумма отсчётов
+	uint8_t  lid;						// среднее канала крышки
+	uint8_t  lid_open;					// крышка открыта (с гистерезисом)
+	uint8_t  volume;					// громкость 0..255 (квадрат ручки — ближе к слуху)
+} AdcState;
+
+#if PLAYER_ADC
+
+//---------------------------------------------------------------------//
+// ADMUX канала
+//---------------------------------------------------------------------//
+static inline uint8_t Adc_admux(const uint8_t slot)
+{
+#if PLAYER_LID && PLAYER_VOLUME
+	return static_cast<uint8_t>((slot == ADC_SLOT_LID) ? ADC_ADMUX(ADC_LID_PIN) : ADC_ADMUX(ADC_VOLUME_PIN));
+#elif PLAYER_LID
+	(void)slot;
+	return static_cast<uint8_t>(ADC_ADMUX(ADC_LID_PIN));
+#else
+	(void)slot;
+	return static_cast<uint8_t>(ADC_ADMUX(ADC_VOLUME_PIN));
+#endif
+}
+
+//---------------------------------------------------------------------//
+// Инициализация: цифровые входы пинов выключены, автозапуск от TOV0, первое преобразование
+//---------------------------------------------------------------------//
+static inline void Adc_begin(volatile AdcState &a)
+{
+#if PLAYER_LID
+	DDRB  &= static_cast<uint8_t>(~_BV(ADC_LID_PIN));
+	DIDR0 |= _BV(ADC_LID_PIN);			// ADCnD совпадает с номером пина PBn
+	a.slot = ADC_SLOT_LID;
+#else
+	a.slot = ADC_SLOT_VOLUME;
+#endif
+#if PLAYER_VOLUME
+	DDRB  &= static_cast<uint8_t>(~_BV(ADC_VOLUME_PIN));
+	DIDR0 |= _BV(ADC_VOLUME_PIN);
+#endif
+
+	a.n        = 0;
+	a.acc      = 0;
+	a.lid      = 0;
+	a.lid_open = 0;						// до первого значения — закрыта (музыка не начинается)
+	a.volume   = 255;
+
+	ADMUX  = Adc_admux(a.slot);
+	ADCSRB = _BV(ADTS2);				// автозапуск: переполнение Timer0
+	ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) |
+			 _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);	// /128: ~129 кГц при 16.5 МГц
+}
+
+//---------------------------------------------------------------------//
+// ISR(ADC_vect): отсчёт в сумму; канал готов — значение и следующий канал
+//---------------------------------------------------------------------//
+static inline void Adc_onConversion(volatile AdcState &a)
+{
+	const uint8_t sample = ADCH;
+	const uint8_t n = a.n;
+
+	if (n == 0) {
+		a.n = 1;						// первый отсчёт после смены канала
+		return;
+	}
+
+	a.acc = static_cast<uint16_t>(a.acc + sample);
+	if (n < ADC_OVERSAMPLE) {
+		a.n = static_cast<uint8_t>(n + 1);
+		return;
+	}
+
+	const auto level = static_cast<uint8_t>(a.acc >> ADC_OVERSAMPLE_SHIFT);
+	a.acc = 0;
+	a.n   = (PLAYER_LID && PLAYER_VOLUME) ? 0 : 1;	// один канал — выбрасывать нечего
+
+#if PLAYER_LID
+	if (a.slot == ADC_SLOT_LID) {
+		a.lid = level;
+		if (a.lid_open) {
+			if (level < ADC_LID_LEVEL - ADC_LID_HYST) {
+				a.lid_open = 0;
+			}
+		} else if (level >= ADC_LID_LEVEL + ADC_LID_HYST) {
+			a.lid_open = 1;
+		}
+	}
+#endif
+#if PLAYER_VOLUME
+	if (a.slot == ADC_SLOT_VOLUME) {
+		// level^2 / 256 с 255 -> 255: ручка ближе к слуху, чем линейная
+		a.volume = static_cast<uint8_t>((static_cast<uint16_t>(level) * static_cast<uint16_t>(level + 1)) >> 8);
+	}
+#endif
+
+#if PLAYER_LID && PLAYER_VOLUME
+	a.slot  = static_cast<uint8_t>(a.slot ^ 1);
+	ADMUX   = Adc_admux(a.slot);
+#endif
+}
+
+//---------------------------------------------------------------------//
+// Аудио-ISR: сэмпл с учётом громкости (255 — без изменений)
+//---------------------------------------------------------------------//
+static inline uint8_t Adc_scale(volatile AdcState &a, const uint8_t sample)
+{
+	return static_cast<uint8_t>((static_cast<uint16_t>(sample) * static_cast<uint16_t>(a.volume + 1)) >> 8);
+}
+
+#endif
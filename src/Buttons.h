@@ -0,0 +1,216 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file Buttons.h
+ * Кнопки: захват по PCINT, антидребезг счётчиком на нотном тике, события — битами в GPIOR0.
+ *
+ * Проблема:
+ *  - опрос пинов в loop() не даёт процессору спать, а дребезг контактов (~1..10 мс)
+ *    без фильтра превращает одно нажатие в несколько
+ *
+ * Идея:
+ *  - фронт на пине кнопки -> ISR(PCINT0_vect) только ставит busy (Buttons_onEdge())
+ *  - пока busy — раз в нотный тик (~5 мс) счётчик антидребезга и таймеры нажатия
+ *    (Buttons_noteTick()); всё отпущено и разобрано — busy = 0, дальше одна проверка флага
+ *  - события (короткое, длинное, двойное) — биты в GPIOR0: ISR ставит бит (sbi),
+ *    loop() проверяет и сбрасывает его одной инструкцией (sbis/cbi) — без cli() и без гонок
+ *  - PCINT будит из любого сна: idle (аудио идёт) и power-down (Player::powerDown(),
+ *    нажатие, разбудившее шкатулку, событий не даёт)
+ *
+ * Подключение: кнопка между пином и GND, подтяжка внутренняя.
+ *
+ * Включается PLAYER_BUTTONS=1 (CMake: -DMUSICBOX_BUTTONS=ON).
+ */
+
+#ifndef PLAYER_BUTTONS
+	#define PLAYER_BUTTONS			0
+#endif
+
+// Число кнопок (1..2) и их пины (PORTB)
+#ifndef BUTTONS_COUNT
+	#define BUTTONS_COUNT			1
+#endif
+#ifndef BUTTON_PIN0
+	#define BUTTON_PIN0				PB2
+#endif
+#ifndef BUTTON_PIN1
+	#define BUTTON_PIN1				PB3
+#endif
+
+// Байт событий: регистр в младших 32 адресах I/O (sbi/cbi атомарны)
+#ifndef BUTTONS_EVENTS
+	#define BUTTONS_EVENTS			GPIOR0
+#endif
+
+// Тайминги, нотные тики (~196 Гц)
+#define BUTTON_DEBOUNCE_TICKS		4	// ~20 мс устойчивого уровня
+#define BUTTON_LONG_TICKS			120	// ~0.6 с удержания — длинное
+#define BUTTON_DOUBLE_TICKS			60	// ~0.3 с на второе нажатие — двойное
+
+#if (BUTTONS_COUNT < 1) || (BUTTONS_COUNT > 2)
+	#error "BUTTONS_COUNT must be 1 or 2"
+#endif
+
+// События кнопки n (биты BUTTONS_EVENTS)
+#define BUTTON_EV_SHORT(n)			_BV(3 * (n))
+#define BUTTON_EV_LONG(n)			_BV(3 * (n) + 1)
+#define BUTTON_EV_DOUBLE(n)			_BV(3 * (n) + 2)
+
+// Автомат кнопки
+#define BUTTON_ST_IDLE				0	// отпущена
+#define BUTTON_ST_DOWN				1	// нажата, ещё не длинное
+#define BUTTON_ST_GAP				2	// отпущена после короткого, ждём второе нажатие
+#define BUTTON_ST_RELEASE			3	// событие уже отдано, ждём отпускания
+
+// Кнопка на этом пине?
+#define BUTTONS_USE_PIN(p)			(((p) == BUTTON_PIN0) || ((BUTTONS_COUNT > 1) && ((p) == BUTTON_PIN1)))
+
+//=====================================================================//
+// Состояние кнопок
+//=====================================================================//
+typedef struct {
+	uint8_t busy;						// был фронт / идёт разбор
+	uint8_t stable[BUTTONS_COUNT];		// уровень после антидребезга (1 = нажата)
+	uint8_t bounce[BUTTONS_COUNT];		// тиков подряд с уровнем != stable
+	uint8_t state[BUTTONS_COUNT];		// BUTTON_ST_*
+	uint8_t timer[BUTTONS_COUNT];		// нотных тиков в состоянии
+	uint8_t mute;						// нажатие разбудило шкатулку — без событий
+} ButtonsState;
+
+//---------------------------------------------------------------------//
+// Маска пина кнопки n
+//---------------------------------------------------------------------//
+static inline uint8_t Buttons_mask(const uint8_t n) {
+	return static_cast<uint8_t>((n == 0) ? _BV(BUTTON_PIN0) : _BV(BUTTON_PIN1));
+}
+
+//---------------------------------------------------------------------//
+// Инициализация: входы с подтяжкой, PCINT на пины кнопок
+//---------------------------------------------------------------------//
+static inline void Buttons_begin(volatile ButtonsState &b)
+{
+	uint8_t pins = 0;
+	for (uint8_t n = 0; n < BUTTONS_COUNT; n++) {
+		pins |= Buttons_mask(n);
+		b.stable[n] = 0;
+		b.bounce[n] = 0;
+		b.state[n]  = BUTTON_ST_IDLE;
+	}
+
+	DDRB  &= static_cast<uint8_t>(~pins);
+	PORTB |= pins;
+	PCMSK |= pins;
+	GIMSK |= _BV(PCIE);
+
+	b.busy = 1;		// кнопку могли держать при включении
+	b.mute = 0;
+	BUTTONS_EVENTS = 0;
+}
+
+//---------------------------------------------------------------------//
+// ISR(PCINT0_vect): любой фронт — разбор на ближайших нотных тиках
+//---------------------------------------------------------------------//
+static inline void Buttons_onEdge(volatile ButtonsState &b) {
+	b.busy = 1;
+}
+
+//---------------------------------------------------------------------//
+// Нотный тик: антидребезг и автомат нажатия (только пока busy)
+//---------------------------------------------------------------------//
+static inline void Buttons_noteTick(volatile ButtonsState &b)
+{
+	if (!b.busy) {
+		return;
+	}
+
+	const uint8_t pins = PINB;
+	uint8_t settled = 1;
+
+	for (uint8_t n = 0; n < BUTTONS_COUNT; n++) {
+		const uint8_t down = (pins & Buttons_mask(n)) ? 0 : 1;
+
+		// антидребезг: новый уровень держится BUTTON_DEBOUNCE_TICKS тиков подряд
+		bool changed = false;
+		if (down == b.stable[n]) {
+			b.bounce[n] = 0;
+		} else if (++b.bounce[n] >= BUTTON_DEBOUNCE_TICKS) {
+			b.bounce[n] = 0;
+			b.stable[n] = down;
+			changed     = true;
+		}
+
+		uint8_t state = b.state[n];
+		uint8_t timer = b.timer[n];
+		if (timer != 255) {
+			timer++;
+		}
+
+		uint8_t ev = 0;
+		switch (state) {
+			case BUTTON_ST_IDLE:
+				if (changed && down) {
+					state = BUTTON_ST_DOWN;
+					timer = 0;
+				}
+				break;
+
+			case BUTTON_ST_DOWN:
+				if (changed) {
+					state = BUTTON_ST_GAP;
+					timer = 0;
+				} else if (timer >= BUTTON_LONG_TICKS) {
+					ev    = BUTTON_EV_LONG(n);
+					state = BUTTON_ST_RELEASE;
+				}
+				break;
+
+			case BUTTON_ST_GAP:
+				if (changed) {
+					ev    = BUTTON_EV_DOUBLE(n);
+					state = BUTTON_ST_RELEASE;
+				} else if (timer >= BUTTON_DOUBLE_TICKS) {
+					ev    = BUTTON_EV_SHORT(n);
+					state = BUTTON_ST_IDLE;
+				}
+				break;
+
+			case BUTTON_ST_RELEASE:
+			default:
+				if (changed && !down) {
+					state = BUTTON_ST_IDLE;
+				}
+				break;
+		}
+
+		b.state[n] = state;
+		b.timer[n] = timer;
+
+		if (ev != 0 && !b.mute) {
+			BUTTONS_EVENTS |= ev;
+		}
+		if (state != BUTTON_ST_IDLE || b.bounce[n] != 0 || b.stable[n]) {
+			settled = 0;
+		}
+	}
+
+	// всё отпущено и разобрано — до следующего фронта тиков нет
+	if (settled) {
+		b.busy = 0;
+		b.mute = 0;
+	}
+}
+
+//---------------------------------------------------------------------//
+// loop(): забрать событие (ev — константа BUTTON_EV_*: sbis + cbi, без cli()).
+// @return true — событие было.
+//---------------------------------------------------------------------//
+static inline bool Buttons_take(const uint8_t ev)
+{
+	if (!(BUTTONS_EVENTS & ev)) {
+		return false;
+	}
+	BUTTONS_EVENTS &= static_cast<uint8_t>(~ev);
+	return true;
+}
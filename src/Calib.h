@@ -0,0 +1,275 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+
+/**
+ * @file Calib.h
+ * Калибровка часов без кварца по внешнему эталону (строй и темп одинаковы на всех шкатулках).
+ *
+ * Проблема:
+ *  - RC-генератор ATtiny85 (через PLL -> F_CPU) у каждой шкатулки уходит на свои
+ *    несколько процентов: f_note_hz и весь строй notes_add[] рассчитаны под номинальную F_CPU
+ *
+ * Эталон:
+ *  - меандр CALIB_REF_HZ на CALIB_PIN при включении (DS3231 SQW 1.024 кГц, генератор и т.п.)
+ *  - нет эталона (нет фронтов ~16 мс) — калибровка пропускается, берётся сохранённая
+ *
+ * Измерение:
+ *  - у Timer1 ATtiny85 нет input capture (ICP), поэтому фронты ловим опросом пина
+ *    с cli(), а время берём из Timer1 (CK/64) + счётчик TOV1: дрожание опроса — доли
+ *    тика таймера, на CALIB_FINE_PERIODS периодах это единицы ppm
+ *  - счёт тиков таймера за N периодов сравнивается с ожидаемым при номинальной F_CPU
+ *
+ * Калибровка (при включении с эталоном):
+ *  1. OSCCAL шагами по 1 (короткое измерение на каждом шаге) — до ближайшего к номиналу
+ *  2. точное измерение -> остаток в поправку tune_q15 = 32768 * ожидаемое / измеренное
+ *  3. OSCCAL + tune_q15 -> EEPROM (только изменившиеся байты)
+ *
+ * При каждом включении (Calib_begin()):
+ *  - OSCCAL из EEPROM, tune_q15 -> приращения фазы (Synth_setTune()) и реальная частота
+ *    аудио-тика для делителя нотного тика (Calib_scaleHz())
+ *
+ * Пин нужен только на время загрузки — после него его могут занять Pixels.h / SoftPwm.h / Sync.h.
+ * Проверка на хосте: tests/CalibTest.cpp (модель OSCCAL + Timer1, ошибка часов -5..+6%).
+ *
+ * Включается PLAYER_CALIBRATE=1 (CMake: -DMUSICBOX_CALIBRATE=ON).
+ */
+
+#ifndef PLAYER_CALIBRATE
+	#define PLAYER_CALIBRATE	0
+#endif
+
+// Пин эталона (PORTB)
+#ifndef CALIB_PIN
+	#define CALIB_PIN			PB2
+#endif
+
+// Частота эталона, Гц
+#ifndef CALIB_REF_HZ
+	#define CALIB_REF_HZ		1024UL
+#endif
+
+// Периодов эталона на шаг OSCCAL и на точное измерение
+#define CALIB_COARSE_PERIODS	32
+#define CALIB_FINE_PERIODS		256
+
+// Нет фронта за столько переполнений Timer1 (~1 мс каждое) — эталона нет
+#define CALIB_EDGE_TIMEOUT_OVF	16
+
+// Максимум шагов OSCCAL за одну калибровку
+#define CALIB_MAX_STEPS			32
+
+// tune_q15 за пределами 1 +- 1/8 — мусор (не тот сигнал на пине)
+#define CALIB_TUNE_MIN			28672u
+#define CALIB_TUNE_MAX			36864u
+
+// Запись в EEPROM: [CALIB_MAGIC][OSCCAL][tune lo][tune hi]
+#define CALIB_MAGIC				0xCA
+#define CALIB_EEPROM_LEN		4
+
+#define CALIB_TUNE_ONE			32768u
+
+// Ожидаемый счёт Timer1 (CK/64) за N периодов при номинальной F_CPU
+#define CALIB_EXPECTED(n)		((static_cast<uint32_t>(F_CPU) / 64UL) * (n) / CALIB_REF_HZ)
+
+#if (CALIB_REF_HZ < 64UL) || (CALIB_REF_HZ > 8192UL)
+	#error "CALIB_REF_HZ must be 64..8192"
+#endif
+
+//---------------------------------------------------------------------//
+// Поправка по счёту таймера: 32768 * expected / measured (0 = мусор)
+//---------------------------------------------------------------------//
+static inline uint16_t Calib_tuneQ15(const uint32_t measured, const uint32_t expected)
+{
+	if (measured == 0) {
+		return 0;
+	}
+
+	const uint32_t t = ((expected << 15) + (measured / 2UL)) / measured;
+
+	if (t < CALIB_TUNE_MIN || t > CALIB_TUNE_MAX) {
+		return 0;
+	}
+
+	return static_cast<uint16_t>(t);
+}
+
+//---------------------------------------------------------------------//
+// Реальная частота по номинальной: f * 32768 / tune_q15
+//---------------------------------------------------------------------//
+static inline uint32_t Calib_scaleHz(const uint32_t hz, const uint16_t tuneQ15)
+{
+	if (tuneQ15 == 0) {
+		return hz;
+	}
+
+	return ((hz << 15) + (tuneQ15 / 2u)) / tuneQ15;
+}
+
+//---------------------------------------------------------------------//
+// Ждать нарастающий фронт эталона, считая переполнения Timer1.
+// @return false — фронта нет дольше CALIB_EDGE_TIMEOUT_OVF переполнений.
+//---------------------------------------------------------------------//
+static inline bool Calib_waitRise(uint16_t &ovf)
+{
+	uint8_t quiet = 0;
+
+	// сначала 0, потом 1
+	for (uint8_t want = 0; want < 2; want++) {
+		for (;;) {
+			const uint8_t level = (PINB & _BV(CALIB_PIN)) ? 1 : 0;
+			if (level == want) {
+				break;
+			}
+			if (TIFR & _BV(TOV1)) {
+				TIFR = _BV(TOV1);
+				ovf++;
+				if (++quiet > CALIB_EDGE_TIMEOUT_OVF) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// Тиков Timer1 (CK/64) за periods периодов эталона (0 — эталона нет).
+// Вызывать с cli(), Timer1 занимается на время измерения.
+//---------------------------------------------------------------------//
+static inline uint32_t Calib_measure(const uint16_t periods)
+{
+	TCCR1 = _BV(CS12) | _BV(CS11) | _BV(CS10);		// CK/64, нормальный режим
+
+	uint16_t ovf = 0;
+	if (!Calib_waitRise(ovf)) {
+		return 0;
+	}
+
+	TCNT1 = 0;
+	TIFR  = _BV(TOV1);
+	ovf   = 0;
+
+	for (uint16_t i = 0; i < periods; i++) {
+		if (!Calib_waitRise(ovf)) {
+			return 0;
+		}
+	}
+
+	// переполнение могло случиться между фронтом и чтением TCNT1
+	const uint8_t t = TCNT1;
+	if ((TIFR & _BV(TOV1)) && t < 128) {
+		ovf++;
+	}
+
+	return (static_cast<uint32_t>(ovf) << 8) | t;
+}
+
+//---------------------------------------------------------------------//
+// Сменить OSCCAL плавно (шагами по 1 — PLL не теряет захват).
+// Половины диапазона (бит 7) перекрываются, между ними не переходим.
+//---------------------------------------------------------------------//
+static inline void Calib_setOsccal(const uint8_t target)
+{
+	uint8_t v = OSCCAL;
+
+	if ((v ^ target) & 0x80) {
+		return;
+	}
+
+	while (v != target) {
+		v = (v < target) ? static_cast<uint8_t>(v + 1) : static_cast<uint8_t>(v - 1);
+		OSCCAL = v;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Калибровка по эталону: OSCCAL + остаток.
+// @return tune_q15 (0 — эталона нет или сигнал не похож на эталон).
+//---------------------------------------------------------------------//
+static inline uint16_t Calib_run()
+{
+	const uint32_t expCoarse = CALIB_EXPECTED(CALIB_COARSE_PERIODS);
+
+	uint8_t  best    = OSCCAL;
+	uint32_t bestErr = 0xFFFFFFFFUL;
+	int8_t   dir     = 0;
+
+	for (uint8_t step = 0; step < CALIB_MAX_STEPS; step++) {
+		const uint32_t m = Calib_measure(CALIB_COARSE_PERIODS);
+		if (Calib_tuneQ15(m, expCoarse) == 0) {
+			Calib_setOsccal(best);
+			return 0;
+		}
+
+		const uint32_t err = (m > expCoarse) ? (m - expCoarse) : (expCoarse - m);
+		if (err < bestErr) {
+			bestErr = err;
+			best    = OSCCAL;
+		}
+
+		// быстрее номинала -> вниз, медленнее -> вверх; смена направления = проскочили
+		const int8_t want = (m > expCoarse) ? -1 : 1;
+		if (dir != 0 && want != dir) {
+			break;
+		}
+		dir = want;
+
+		const uint8_t o = OSCCAL;
+		if ((want < 0 && (o & 0x7F) == 0) || (want > 0 && (o & 0x7F) == 0x7F)) {
+			break;
+		}
+		Calib_setOsccal(static_cast<uint8_t>(o + want));
+	}
+
+	Calib_setOsccal(best);
+
+	return Calib_tuneQ15(Calib_measure(CALIB_FINE_PERIODS), CALIB_EXPECTED(CALIB_FINE_PERIODS));
+}
+
+//---------------------------------------------------------------------//
+// При включении: калибровка (если на пине эталон) или сохранённые значения.
+// Вызывать до настройки таймеров, прерывания запрещаются на время работы.
+//
+// @param addr Адрес записи в EEPROM (CALIB_EEPROM_LEN байт).
+// @return tune_q15 для Synth_setTune() / Calib_scaleHz() (CALIB_TUNE_ONE — без поправки).
+//---------------------------------------------------------------------//
+static inline uint16_t Calib_begin(uint8_t *addr)
+{
+	const uint8_t sreg = SREG;
+	cli();
+
+	// сохранённая калибровка
+	uint16_t tune = CALIB_TUNE_ONE;
+	if (eeprom_read_byte(addr) == CALIB_MAGIC) {
+		Calib_setOsccal(eeprom_read_byte(addr + 1));
+
+		const auto t = static_cast<uint16_t>(eeprom_read_byte(addr + 2) |
+			(static_cast<uint16_t>(eeprom_read_byte(addr + 3)) << 8));
+		if (t >= CALIB_TUNE_MIN && t <= CALIB_TUNE_MAX) {
+			tune = t;
+		}
+	}
+
+	// эталон на пине -> новая калибровка
+	DDRB  &= static_cast<uint8_t>(~_BV(CALIB_PIN));
+	PORTB |= _BV(CALIB_PIN);		// подтяжка: без эталона пин в 1, фронтов нет
+
+	const uint16_t t = Calib_run();
+	if (t != 0) {
+		tune = t;
+		eeprom_update_byte(addr,     CALIB_MAGIC);
+		eeprom_update_byte(addr + 1, OSCCAL);
+		eeprom_update_byte(addr + 2, static_cast<uint8_t>(t));
+		eeprom_update_byte(addr + 3, static_cast<uint8_t>(t >> 8));
+	}
+
+	PORTB &= static_cast<uint8_t>(~_BV(CALIB_PIN));
+	TCCR1  = 0;
+
+	SREG = sreg;
+	return tune;
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file Ir.h
+ * ИК-пульт (NEC и RC5) без своего таймера: пин опрашивается в аудио-ISR.
+ *
+ * Проблема:
+ *  - DigisparkIRLib (IRLibTimer.h) хочет своё прерывание раз в 50 мкс, а на ATtiny85
+ *    Timer0 — PWM динамика, Timer1 — аудио-тик (или PWM динамика с PLAYER_SPEAKER_OC1B)
+ *
+ * Идея:
+ *  - аудио-тик (~42 мкс от Timer1, ~47 мкс от Timer0) и есть период выборки:
+ *    на сэмпл — чтение пина и инкремент длины текущего уровня (Ir_tick())
+ *  - на фронте (~70 раз за посылку NEC, ~30 за RC5) длительность ушедшего уровня
+ *    сразу разбирают оба декодера — короткие автоматы без циклов (Ir_onEdge())
+ *  - готовая команда — в очередь IR_QUEUE_LEN, loop() забирает её (Ir_read())
+ *    и листает песни (MusicBox.h)
+ *
+ * Приёмник: TSOP38238 и аналоги (выход 0 = есть несущая, "метка"), питание 5 В.
+ *
+ * NEC: ведущая метка 9 мс + пауза 4.5 мс, 32 бита (адрес, ~адрес, команда, ~команда),
+ *      0 = 562 + 562 мкс, 1 = 562 + 1687 мкс. Код повтора (пауза 2.25 мс) не даёт команду —
+ *      удержание кнопки не листает песни подряд.
+ * RC5: манчестер, 14 бит по 1.778 мс (S1 S2 T A4..A0 C5..C0), команда 0..127.
+ *      Повторы удержанной кнопки (тот же бит T) отбрасываются.
+ *
+ * Пороги считаются из реальной частоты аудио-тика (Ir_begin()); длительность уровня —
+ * один байт, больше 255 тиков (~10 мс) — "долго" (покой между посылками).
+ *
+ * Проверка на хосте: tests/IrTest.cpp (NEC с кодами повтора и RC5 с разбросом фронтов, Timer1- и Timer0-аудио).
+ *
+ * Включается PLAYER_IR=1 (CMake: -DMUSICBOX_IR=ON).
+ */
+
+#ifndef PLAYER_IR
+	#define PLAYER_IR				0
+#endif
+
+// Пин приёмника (PORTB)
+#ifndef IR_PIN
+	#define IR_PIN					PB2
+#endif
+
+// Очередь команд ISR -> loop (степень двойки)
+#define IR_QUEUE_LEN				4
+
+// Команды, которые листают песни (MusicBox.h); для своего пульта — смотреть коды в отладочном выводе
+#ifndef IR_NEC_CMD_NEXT
+	#define IR_NEC_CMD_NEXT			0x40	// ">>|" типового 21-кнопочного пульта
+#endif
+#ifndef IR_NEC_CMD_PREV
+	#define IR_NEC_CMD_PREV			0x44	// "|<<"
+#endif
+#ifndef IR_RC5_CMD_NEXT
+	#define IR_RC5_CMD_NEXT			0x20	// "канал +" (пульты Philips)
+#endif
+#ifndef IR_RC5_CMD_PREV
+	#define IR_RC5_CMD_PREV			0x21	// "канал -"
+#endif
+
+#define IR_PROTO_NEC				1
+#define IR_PROTO_RC5				2
+
+// Автомат NEC
+#define IR_NEC_IDLE					0
+#define IR_NEC_LEAD_SPACE			1	// была ведущая метка
+#define IR_NEC_BIT_MARK				2	// ждём конец метки бита
+#define IR_NEC_BIT_SPACE			3	// ждём конец паузы бита
+
+// RC5: rc5_halves — сброшено, ждём покой на линии
+#define IR_RC5_WAIT_IDLE			0xFF
+
+// Пороги, аудио-тики (IrState::t[])
+#define IR_T_NEC_LEAD_MARK			0	// ведущая метка, от
+#define IR_T_NEC_LEAD_SPACE_MIN		1	// пауза после неё (кадр), от
+#define IR_T_NEC_LEAD_SPACE_MAX		2	//   до
+#define IR_T_NEC_MARK_MIN			3	// метка бита, от
+#define IR_T_NEC_MARK_MAX			4	//   до
+#define IR_T_NEC_ONE				5	// пауза бита: короче — 0, от — 1
+#define IR_T_NEC_SPACE_MAX			6	//   до
+#define IR_T_RC5_HALF_MIN			7	// полбита, от
+#define IR_T_RC5_FULL				8	// длиннее — целый бит
+#define IR_T_RC5_FULL_MAX			9	// целый бит, до
+#define IR_T_COUNT					10
+
+//=====================================================================//
+// Команда с пульта
+//=====================================================================//
+typedef struct {
+	uint8_t proto;					// IR_PROTO_*
+	uint8_t addr;					// адрес (устройство)
+	uint8_t cmd;					// команда (кнопка)
+} IrCommand;
+
+//=====================================================================//
+// Состояние приёмника
+//=====================================================================//
+typedef struct {
+	// ISR: текущий уровень пина
+	uint8_t  level;					// последний уровень (0 = метка)
+	uint8_t  run;					// аудио-тиков в нём (насыщается на 255)
+
+	// NEC
+	uint8_t  nec_state;				// IR_NEC_*
+	uint8_t  nec_bits;				// принято бит
+	uint32_t nec_data;				// биты, младший первым
+
+	// RC5
+	uint8_t  rc5_halves;			// принято полубит (0 = ждём посылку, IR_RC5_WAIT_IDLE — покой)
+	uint8_t  rc5_first;				// первая половина текущего бита (1 = метка)
+	uint16_t rc5_data;				// биты, старший первым
+	uint8_t  rc5_toggle;			// бит T последней команды (0xFF — ещё не было)
+
+	// очередь ISR -> loop
+	IrCommand queue[IR_QUEUE_LEN];
+	uint8_t  head;					// следующая к чтению (loop)
+	uint8_t  tail;					// куда класть (ISR)
+
+	uint8_t  t[IR_T_COUNT];			// пороги, аудио-тики
+} IrState;
+
+//---------------------------------------------------------------------//
+// Микросекунды -> аудио-тики (только для Ir_begin())
+//---------------------------------------------------------------------//
+static inline uint8_t Ir_ticks(const uint32_t us, const uint32_t audioHz) {
+	return static_cast<uint8_t>((us * audioHz + 500000UL) / 1000000UL);
+}
+
+//---------------------------------------------------------------------//
+// Инициализация: пин на вход с подтяжкой, пороги из частоты аудио-тика.
+// @param audioHz Реальная частота аудио-тика (Player.h: PLAYER_AUDIO_HZ), до ~28 кГц.
+//---------------------------------------------------------------------//
+static inline void Ir_begin(volatile IrState &st, const uint32_t audioHz)
+{
+	DDRB  &= static_cast<uint8_t>(~_BV(IR_PIN));
+	PORTB |= _BV(IR_PIN);
+
+	st.level      = _BV(IR_PIN);
+	st.run        = 255;
+	st.nec_state  = IR_NEC_IDLE;
+	st.rc5_halves = IR_RC5_WAIT_IDLE;
+	st.rc5_toggle = 0xFF;
+	st.head       = 0;
+	st.tail       = 0;
+
+	// допуски широкие: приёмник удлиняет метки на ~100 мкс, кварца у пультов нет
+	st.t[IR_T_NEC_LEAD_MARK]      = Ir_ticks(7000, audioHz);
+	st.t[IR_T_NEC_LEAD_SPACE_MIN] = Ir_ticks(3400, audioHz);
+	st.t[IR_T_NEC_LEAD_SPACE_MAX] = Ir_ticks(5600, audioHz);
+	st.t[IR_T_NEC_MARK_MIN]       = Ir_ticks(300, audioHz);
+	st.t[IR_T_NEC_MARK_MAX]       = Ir_ticks(900, audioHz);
+	st.t[IR_T_NEC_ONE]            = Ir_ticks(1100, audioHz);
+	st.t[IR_T_NEC_SPACE_MAX]      = Ir_ticks(2200, audioHz);
+	st.t[IR_T_RC5_HALF_MIN]       = Ir_ticks(500, audioHz);
+	st.t[IR_T_RC5_FULL]           = Ir_ticks(1330, audioHz);
+	st.t[IR_T_RC5_FULL_MAX]       = Ir_ticks(2200, audioHz);
+}
+
+//---------------------------------------------------------------------//
+// ISR: команда в очередь (полна — теряется)
+//---------------------------------------------------------------------//
+static inline void Ir_push(volatile IrState &st, const uint8_t proto, const uint8_t addr, const uint8_t cmd)
+{
+	const uint8_t t = st.tail;
+	const auto next = static_cast<uint8_t>((t + 1) & (IR_QUEUE_LEN - 1));
+	if (next == st.head) {
+		return;
+	}
+
+	st.queue[t].proto = proto;
+	st.queue[t].addr  = addr;
+	st.queue[t].cmd   = cmd;
+	st.tail = next;
+}
+
+//---------------------------------------------------------------------//
+// NEC: закончился уровень длиной dur (mark = это была метка)
+//---------------------------------------------------------------------//
+static inline void Ir_nec(volatile IrState &st, const bool mark, const uint8_t dur)
+{
+	switch (st.nec_state) {
+		case IR_NEC_IDLE:
+			if (mark && dur >= st.t[IR_T_NEC_LEAD_MARK] && dur != 255) {
+				st.nec_state = IR_NEC_LEAD_SPACE;
+			}
+			return;
+
+		case IR_NEC_LEAD_SPACE:
+			// 2.25 мс — код повтора: команды нет
+			if (dur >= st.t[IR_T_NEC_LEAD_SPACE_MIN] && dur <= st.t[IR_T_NEC_LEAD_SPACE_MAX]) {
+				st.nec_bits  = 0;
+				st.nec_state = IR_NEC_BIT_MARK;
+			} else {
+				st.nec_state = IR_NEC_IDLE;
+			}
+			return;
+
+		case IR_NEC_BIT_MARK:
+			if (dur < st.t[IR_T_NEC_MARK_MIN] || dur > st.t[IR_T_NEC_MARK_MAX]) {
+				st.nec_state = IR_NEC_IDLE;
+				return;
+			}
+			if (st.nec_bits == 32) {
+				// стоп-метка: команда и её инверсия (адрес бывает 16-битным — не проверяем)
+				const uint32_t d = st.nec_data;
+				const auto cmd = static_cast<uint8_t>(d >> 16);
+				if (static_cast<uint8_t>(cmd ^ static_cast<uint8_t>(d >> 24)) == 0xFF) {
+					Ir_push(st, IR_PROTO_NEC, static_cast<uint8_t>(d), cmd);
+				}
+				st.nec_state = IR_NEC_IDLE;
+				return;
+			}
+			st.nec_state = IR_NEC_BIT_SPACE;
+			return;
+
+		case IR_NEC_BIT_SPACE:
+		default:
+			if (dur < st.t[IR_T_NEC_MARK_MIN] || dur > st.t[IR_T_NEC_SPACE_MAX]) {
+				st.nec_state = IR_NEC_IDLE;
+				return;
+			}
+			st.nec_data = (st.nec_data >> 1) | ((dur >= st.t[IR_T_NEC_ONE]) ? 0x80000000UL : 0UL);
+			st.nec_bits++;
+			st.nec_state = IR_NEC_BIT_MARK;
+			return;
+	}
+}
+
+//---------------------------------------------------------------------//
+// RC5: очередной полубит (mark = метка во второй/первой половине бита).
+// @return false — не манчестер (две одинаковые половины), посылка сброшена.
+//---------------------------------------------------------------------//
+static inline bool Ir_rc5Half(volatile IrState &st, const uint8_t mark)
+{
+	const uint8_t n = st.rc5_halves;
+
+	if ((n & 1) == 0) {
+		st.rc5_first = mark;
+	} else {
+		if (st.rc5_first == mark) {
+			st.rc5_halves = IR_RC5_WAIT_IDLE;
+			return false;
+		}
+		// 1 = пауза -> метка
+		st.rc5_data = static_cast<uint16_t>((st.rc5_data << 1) | mark);
+	}
+
+	st.rc5_halves = static_cast<uint8_t>(n + 1);
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// RC5: закончился уровень длиной dur
+//---------------------------------------------------------------------//
+static inline void Ir_rc5(volatile IrState &st, const bool mark, const uint8_t dur)
+{
+	// посылка — только после покоя (>= 255 тиков): биты NEC иначе похожи на манчестер
+	if (dur < st.t[IR_T_RC5_HALF_MIN] || dur > st.t[IR_T_RC5_FULL_MAX]) {
+		st.rc5_halves = (!mark && dur == 255) ? 0 : IR_RC5_WAIT_IDLE;
+		return;
+	}
+	if (st.rc5_halves == IR_RC5_WAIT_IDLE) {
+		return;
+	}
+
+	uint8_t halves = (dur > st.t[IR_T_RC5_FULL]) ? 2 : 1;
+	const uint8_t m = mark ? 1 : 0;
+
+	if (st.rc5_halves == 0) {
+		// посылка начинается с метки; первая половина S1 (пауза) сливается с покоем
+		if (!mark) {
+			return;
+		}
+		st.rc5_data = 0;
+		Ir_rc5Half(st, 0);
+	}
+
+	while (halves-- != 0) {
+		if (!Ir_rc5Half(st, m)) {
+			return;
+		}
+	}
+
+	// последний бит = 0: его вторая половина (пауза) сливается с покоем
+	if (st.rc5_halves == 27 && mark) {
+		Ir_rc5Half(st, 0);
+	}
+
+	if (st.rc5_halves < 28) {
+		return;
+	}
+	st.rc5_halves = IR_RC5_WAIT_IDLE;
+
+	const uint16_t d = st.rc5_data;
+	const auto toggle = static_cast<uint8_t>((d >> 11) & 1);
+	if (toggle == st.rc5_toggle) {
+		return;		// та же кнопка всё ещё нажата
+	}
+	st.rc5_toggle = toggle;
+
+	// S2 = 0 — команды 64..127
+	const auto cmd = static_cast<uint8_t>((d & 0x3F) | ((d & 0x1000) ? 0 : 0x40));
+	Ir_push(st, IR_PROTO_RC5, static_cast<uint8_t>((d >> 6) & 0x1F), cmd);
+}
+
+//---------------------------------------------------------------------//
+// ISR: фронт — длительность ушедшего уровня обоим декодерам
+//---------------------------------------------------------------------//
+static inline void Ir_onEdge(volatile IrState &st, const uint8_t level)
+{
+	const uint8_t dur  = st.run;
+	const bool    mark = (st.level == 0);
+
+	st.level = level;
+	st.run   = 1;
+
+	Ir_nec(st, mark, dur);
+	Ir_rc5(st, mark, dur);
+}
+
+//---------------------------------------------------------------------//
+// Аудио-тик: чтение пина; тот же уровень — только счёт его длины
+//---------------------------------------------------------------------//
+static inline void Ir_tick(volatile IrState &st)
+{
+	const uint8_t level = PINB & _BV(IR_PIN);
+
+	if (level == st.level) {
+		const auto run = static_cast<uint8_t>(st.run + 1);
+		if (run != 0) {
+			st.run = run;
+		}
+		return;
+	}
+
+	Ir_onEdge(st, level);
+}
+
+//---------------------------------------------------------------------//
+// loop(): забрать команду.
+// @return false — очередь пуста.
+//---------------------------------------------------------------------//
+static inline bool Ir_read(volatile IrState &st, IrCommand &out)
+{
+	const uint8_t h = st.head;
+	if (h == st.tail) {
+		return false;
+	}
+
+	out.proto = st.queue[h].proto;
+	out.addr  = st.queue[h].addr;
+	out.cmd   = st.queue[h].cmd;
+	st.head   = static_cast<uint8_t>((h + 1) & (IR_QUEUE_LEN - 1));
+	return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file IrqProfile.h
+ * Профилирование прерываний (PLAYER_IRQ_PROFILE): сколько раз в секунду срабатывает
+ * каждый вектор и сколько CPU съедает аудио-ISR.
+ *
+ * Идея:
+ *  - в ISR только инкременты счётчиков (несколько тактов)
+ *  - "секунда" = f_note_hz нотных тиков (часы плеера, без millis())
+ *  - на границе секунды ISR копирует накопленное в irq_last и поднимает irq_ready,
+ *    loop() забирает снимок и печатает
+ *
+ * Что считаем:
+ *  - audio      — аудио-тики (TIM1_COMPA_vect или каждый N-й TIM0_OVF_vect)
+ *  - t0_ovf     — все входы в TIM0_OVF_vect (режим PLAYER_AUDIO_CLOCK_TIMER0)
+ *  - note       — нотные тики
+ *  - core_millis — переполнения millis-таймера ядра (ISR в wiring.c, если он слинкован)
+ *  - usi_ovf / adc / pcint — входы в USI_OVF_vect (Twi.h), ADC_vect (Adc.h), PCINT0_vect
+ *      (MIDI, загрузка, кнопки, RTC); 0, если вектор не собран
+ *  - busy/busy_max — время от аудио-тика до конца аудио-ISR в тиках таймера-источника
+ *      (Player.h: irqProfileElapsed()):
+ *      Timer1 режим: TCNT1 (1 тик = 8 тактов), Timer0 режим: TCNT0 (1 тик = 1 такт).
+ *      Счётчик короче самого ISR на нотном тике (круг TCNT0 — 256 тактов), поэтому поднятый
+ *      за время ISR флаг таймера (TOV0 / OCF1A, он ждёт до выхода из ISR) добавляет круг:
+ *      предел измерения — два круга (511 тактов в Timer0 режиме, 171 тик в Timer1).
+ *      ISR ещё длиннее теряет тик таймера целиком — это видно по audio/t0_ovf меньше нормы
+ *
+ * Включается PLAYER_IRQ_PROFILE=1 (CMake: -DMUSICBOX_IRQ_PROFILE=ON).
+ */
+
+#ifndef PLAYER_IRQ_PROFILE
+	#define PLAYER_IRQ_PROFILE	0
+#endif
+
+//=====================================================================//
+// Счётчики за секунду
+//=====================================================================//
+typedef struct {
+	uint16_t audio;			// аудио-тиков
+	uint16_t t0_ovf;		// входов в TIM0_OVF_vect
+	uint16_t note;			// нотных тиков
+	uint16_t core_millis;	// переполнений millis-таймера ядра
+	uint16_t usi_ovf;		// входов в USI_OVF_vect
+	uint16_t adc;			// входов в ADC_vect
+	uint16_t pcint;			// входов в PCINT0_vect
+	uint32_t busy;			// сумма времени в аудио-ISR (тики таймера)
+	uint16_t busy_max;		// худший аудио-ISR (тики таймера)
+} IrqCounters;
+
+//---------------------------------------------------------------------//
+// Сброс счётчиков
+//---------------------------------------------------------------------//
+static inline void IrqProfile_clear(volatile IrqCounters &c) {
+	c.audio       = 0;
+	c.t0_ovf      = 0;
+	c.note        = 0;
+	c.core_millis = 0;
+	c.usi_ovf     = 0;
+	c.adc         = 0;
+	c.pcint       = 0;
+	c.busy        = 0;
+	c.busy_max    = 0;
+}
+
+//---------------------------------------------------------------------//
+// Конец аудио-ISR: elapsed = сколько тиков таймера-источника прошло с аудио-тика
+//---------------------------------------------------------------------//
+static inline void IrqProfile_onAudioIsr(volatile IrqCounters &c, const uint16_t elapsed)
+{
+	c.audio++;
+	c.busy += elapsed;
+
+	if (elapsed > c.busy_max) {
+		c.busy_max = elapsed;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Нотный тик: на границе секунды отдаём снимок в last и поднимаем ready
+//
+// millisOvf — текущее значение счётчика переполнений millis ядра (0, если ядра нет)
+//---------------------------------------------------------------------//
+static inline void IrqProfile_onNoteTick(volatile IrqCounters &acc,
+										 volatile IrqCounters &last,
+										 volatile uint8_t &ready,
+										 volatile uint16_t &millisPrev,
+										 const uint16_t millisOvf,
+										 const uint16_t noteHz)
+{
+	acc.note++;
+	if (acc.note < noteHz) {
+		return;
+	}
+
+	acc.core_millis = static_cast<uint16_t>(millisOvf - millisPrev);
+	millisPrev = millisOvf;
+
+	last.audio       = acc.audio;
+	last.t0_ovf      = acc.t0_ovf;
+	last.note        = acc.note;
+	last.core_millis = acc.core_millis;
+	last.usi_ovf     = acc.usi_ovf;
+	last.adc         = acc.adc;
+	last.pcint       = acc.pcint;
+	last.busy        = acc.busy;
+	last.busy_max    = acc.busy_max;
+
+	IrqProfile_clear(acc);
+	ready = 1;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 
 /**
  * @file Lights.h
@@ -14,12 +15,43 @@
  *
  * Аппаратно:
  *  - PB1 (OC0B) -> PWM Timer0
- *  - Lights_tick() пишет яркость в OCR0B
+ *  - Lights_tick() пишет яркость в OCR0B (или в q8 для дизера, см. ниже)
  *
  * Входные данные:
  *  - ticksPer16: сколько "нотных тиков" приходится на 1/16 (зависит от темпа)
+ *
+ * ЭФФЕКТЫ (выбираются из песни командой LIGHT, val = LIGHTS_FX_*):
+ *  - LIGHTS_FX_BREATH (по умолчанию) — "вдох-выдох" за такт, как раньше
+ *  - LIGHTS_FX_FLASH — вспышка на атаке ноты и экспоненциальное затухание
+ *  - LIGHTS_FX_PITCH — яркость вспышки зависит от высоты ноты
+ *  - | LIGHTS_FX_ACCENT — сильная доля такта полной яркостью, остальные — слабее
+ *
+ * Эффекты кормятся событиями плеера (Lights_onNote()/Lights_onRest() — из разбора
+ * песни) и считаются только на "нотном тике": линейный уровень 0..255 ->
+ * гамма-таблица (PROGMEM) -> Q8.8 яркость. На тик: сдвиг + вычитание + pgm_read_word.
+ *
+ * ДИЗЕР (PLAYER_LED_DITHER):
+ *  - у OCR0B всего LED_MAX_PWM+1 = 16 ступеней, на медленном нотном тике они видны
+ *  - дробная часть q8 (младший байт) добавляется в 8-битный аккумулятор сигма-дельты,
+ *    перенос = +1 к целой части OCR0B; в среднем получается 16 * 256 = 12 бит яркости
+ *  - Lights_dither() вызывается из аудио-ISR каждые LIGHTS_DITHER_DIV сэмплов
+ *    (~12 кГц, это ~5 периодов PWM Timer0 на одно значение), ~10 тактов на сэмпл в среднем
+ *  - Lights_tick() при этом OCR0B не пишет, только q8
+ *  - включается PLAYER_LED_DITHER=1 (CMake: -DMUSICBOX_LED_DITHER=ON), без него OCR0B — целая часть q8
+ *
+ * ДОП. КАНАЛЫ (PLAYER_SOFT_PWM, SoftPwm.h):
+ *  - каждый канал — своя вспышка с затуханием, канал выбирается регистром ноты:
+ *    ниже LIGHTS_SPLIT_LOW — канал 0, ниже LIGHTS_SPLIT_HIGH — 1, выше — 2
+ *  - уровни отдаются через Lights_channelLevels() (та же гамма, 0..LED_MAX_PWM)
  */
 
+#ifndef PLAYER_LED_DITHER
+	#define PLAYER_LED_DITHER	0
+#endif
+
+// Дизер раз в N аудио-сэмплов (1..255)
+#define LIGHTS_DITHER_DIV		2
+
 // "Такт" в шестнадцатых (4/4 = 16). Для 3/4 можно поставить 12.
 #define LED_BAR_LEN16			16
 
@@ -28,20 +60,85 @@
 
 #define LED_MAX_Q8				((uint16_t)((uint16_t)LED_MAX_PWM << 8))
 
+//=====================================================================//
+// Эффекты (val команды LIGHT)
+//=====================================================================//
+
+#define LIGHTS_FX_BREATH		0x00	// треугольник за такт (по умолчанию)
+#define LIGHTS_FX_FLASH			0x01	// вспышка на атаке + затухание
+#define LIGHTS_FX_PITCH			0x02	// вспышка, яркость по высоте ноты
+#define LIGHTS_FX_MODE_MASK		0x0F
+#define LIGHTS_FX_ACCENT		0x80	// флаг: акцент на сильную долю
+
+// Затухание вспышки: level -= level >> LIGHTS_DECAY_SHIFT на каждом тике
+// (4 -> постоянная времени ~16 тиков ~ 80 мс при 196 Гц)
+#define LIGHTS_DECAY_SHIFT		4
+
+// Уровень вспышки без акцента (из 255), если включён LIGHTS_FX_ACCENT
+#define LIGHTS_WEAK_LEVEL		140
+
+// Нижняя нота для LIGHTS_FX_PITCH: (midi - LOW) * 4 -> 0..255
+#define LIGHTS_PITCH_LOW		36
+
+// Границы регистров для доп. каналов (PLAYER_SOFT_PWM): C4 и C5
+#define LIGHTS_SPLIT_LOW		60
+#define LIGHTS_SPLIT_HIGH		72
+
+#if defined(PLAYER_SOFT_PWM) && PLAYER_SOFT_PWM
+	#define LIGHTS_CHANNELS		SOFTPWM_CHANNELS
+#else
+	#define LIGHTS_CHANNELS		0
+#endif
+
 //=====================================================================//
 // Состояние гирлянды
 //=====================================================================//
 typedef struct {
 	uint16_t q8;		// яркость в Q8.8
 	int16_t  step_q8;	// шаг (Q8.8), знак = направление (вверх/вниз)
+	uint8_t  fx;		// эффект (LIGHTS_FX_*)
+	uint8_t  level;		// линейный уровень вспышки 0..255 (до гаммы)
+	uint8_t  pos16;		// позиция в такте (1/16) для акцента сильной доли
+	uint8_t  dither_acc;	// аккумулятор сигма-дельты (дробная часть q8)
+	uint8_t  dither_div;	// делитель аудио-тика для дизера
+#if LIGHTS_CHANNELS
+	uint8_t  ch_level[LIGHTS_CHANNELS];	// вспышки доп. каналов 0..255 (до гаммы)
+#endif
 } LightsState;
 
+//=====================================================================//
+// Гамма-таблица (PROGMEM): линейный уровень (0..63) -> Q8.8 яркость 0..LED_MAX_Q8
+// g = round(255 * (i/63)^2.2), масштаб g/255 -> 0..LED_MAX_Q8 (с округлением) — на этапе компиляции:
+// g = 255 даёт ровно LED_MAX_Q8 (полная яркость, ступень LED_MAX_PWM)
+//=====================================================================//
+
+#define LG(g)					((uint16_t)(((uint32_t)(g) * LED_MAX_Q8 + 127UL) / 255UL))
+
+const uint16_t lights_gamma[64] PROGMEM = {
+	LG(0), LG(0), LG(0), LG(0), LG(1), LG(1), LG(1), LG(2), LG(3), LG(4), LG(4), LG(5), LG(7), LG(8), LG(9), LG(11),
+	LG(13), LG(14), LG(16), LG(18), LG(20), LG(23), LG(25), LG(28), LG(31), LG(33), LG(36), LG(40), LG(43), LG(46), LG(50), LG(54),
+	LG(57), LG(61), LG(66), LG(70), LG(74), LG(79), LG(84), LG(89), LG(94), LG(99), LG(105), LG(110), LG(116), LG(122), LG(128), LG(134),
+	LG(140), LG(147), LG(153), LG(160), LG(167), LG(174), LG(182), LG(189), LG(197), LG(205), LG(213), LG(221), LG(229), LG(238), LG(246), LG(255),
+};
+
+#undef LG
+
 //---------------------------------------------------------------------//
 // Инициализация (выключено)
 //---------------------------------------------------------------------//
 static inline void Lights_begin(volatile LightsState &st) {
 	st.q8      = 0;
 	st.step_q8 = 0;
+	st.fx      = LIGHTS_FX_BREATH;
+	st.level   = 0;
+	st.pos16   = 0;
+	st.dither_acc = 0;
+	st.dither_div = LIGHTS_DITHER_DIV;
+#if LIGHTS_CHANNELS
+	for (uint8_t ch = 0; ch < LIGHTS_CHANNELS; ch++) {
+		st.ch_level[ch] = 0;
+	}
+#endif
 	OCR0B      = 0;
 }
 
@@ -53,9 +150,146 @@ static inline void Lights_reset(volatile LightsState &st) {
 	if (st.step_q8 < 0) {
 		st.step_q8 = static_cast<int16_t>(-st.step_q8);
 	}
+	// эффект по умолчанию, песня выберет свой командой LIGHT
+	st.fx    = LIGHTS_FX_BREATH;
+	st.level = 0;
+	st.pos16 = 0;
 	OCR0B = 0;
 }
 
+//---------------------------------------------------------------------//
+// Переход к следующей песне без гашения (PLAYER_LIGHTS_CROSSFADE):
+// яркость не сбрасывается, "дыхание" продолжается от неё вниз уже в темпе новой песни
+//---------------------------------------------------------------------//
+static inline void Lights_crossfade(volatile LightsState &st) {
+	if (st.step_q8 > 0) {
+		st.step_q8 = static_cast<int16_t>(-st.step_q8);
+	}
+	st.fx    = LIGHTS_FX_BREATH;
+	st.level = 0;
+	st.pos16 = 0;
+}
+
+//---------------------------------------------------------------------//
+// Вывод яркости: целая часть q8 в OCR0B (с дизером OCR0B пишет Lights_dither())
+//---------------------------------------------------------------------//
+static inline void Lights_apply(const uint16_t q8) {
+#if PLAYER_LED_DITHER
+	(void)q8;
+#else
+	OCR0B = static_cast<uint8_t>(q8 >> 8);
+#endif
+}
+
+//---------------------------------------------------------------------//
+// Дизер: вызывать из аудио-ISR на каждом сэмпле
+//---------------------------------------------------------------------//
+static inline void Lights_dither(volatile LightsState &st)
+{
+	if (--st.dither_div != 0) {
+		return;
+	}
+	st.dither_div = LIGHTS_DITHER_DIV;
+
+	const uint16_t q8  = st.q8;
+	const uint8_t  acc = st.dither_acc;
+	const auto     sum = static_cast<uint8_t>(acc + static_cast<uint8_t>(q8));
+	st.dither_acc = sum;
+
+	// перенос из дробной части -> на этот отрезок времени на ступень ярче
+	OCR0B = static_cast<uint8_t>((q8 >> 8) + (sum < acc ? 1 : 0));
+}
+
+//---------------------------------------------------------------------//
+// Выбрать эффект (команда песни LIGHT, val = LIGHTS_FX_* | LIGHTS_FX_ACCENT)
+//---------------------------------------------------------------------//
+static inline void Lights_setFx(volatile LightsState &st, const uint8_t fx) {
+	st.fx    = fx;
+	st.level = 0;
+}
+
+//---------------------------------------------------------------------//
+// Сдвинуть позицию в такте на len16 шестнадцатых (0 = целая)
+//---------------------------------------------------------------------//
+static inline void Lights_advance16(volatile LightsState &st, uint8_t len16)
+{
+	if (len16 == 0) {
+		len16 = 16;
+	}
+
+	auto pos = static_cast<uint8_t>(st.pos16 + len16);
+	while (pos >= LED_BAR_LEN16) {
+		pos = static_cast<uint8_t>(pos - LED_BAR_LEN16);
+	}
+	st.pos16 = pos;
+}
+
+//---------------------------------------------------------------------//
+// Событие плеера: нота midiNote длиной len16 (1/16) началась
+//---------------------------------------------------------------------//
+static inline void Lights_onNote(volatile LightsState &st, const uint8_t midiNote, const uint8_t len16)
+{
+	const uint8_t mode = st.fx & LIGHTS_FX_MODE_MASK;
+
+	if (mode != LIGHTS_FX_BREATH) {
+		uint8_t lvl = 255;
+
+		if (mode == LIGHTS_FX_PITCH) {
+			const auto d = static_cast<int16_t>(
+				(static_cast<int16_t>(midiNote) - static_cast<int16_t>(LIGHTS_PITCH_LOW)) * 4
+			);
+			lvl = static_cast<uint8_t>(d < 16 ? 16 : (d > 255 ? 255 : d));
+		}
+
+		// акцент: сильная доля — как есть, остальные — не ярче LIGHTS_WEAK_LEVEL
+		if ((st.fx & LIGHTS_FX_ACCENT) && st.pos16 != 0 && lvl > LIGHTS_WEAK_LEVEL) {
+			lvl = LIGHTS_WEAK_LEVEL;
+		}
+
+		// не гасим ещё яркую предыдущую вспышку
+		if (lvl > st.level) {
+			st.level = lvl;
+		}
+	}
+
+#if LIGHTS_CHANNELS
+	// доп. каналы: вспышка в канале своего регистра
+	uint8_t ch = (midiNote < LIGHTS_SPLIT_LOW) ? 0 : ((midiNote < LIGHTS_SPLIT_HIGH) ? 1 : 2);
+	if (ch >= LIGHTS_CHANNELS) {
+		ch = LIGHTS_CHANNELS - 1;
+	}
+	st.ch_level[ch] = 255;
+#endif
+
+	Lights_advance16(st, len16);
+}
+
+//---------------------------------------------------------------------//
+// Затухание вспышки на один нотный тик (до нуля за конечное время)
+//---------------------------------------------------------------------//
+static inline uint8_t Lights_decay(const uint8_t lvl) {
+	return static_cast<uint8_t>(lvl - (lvl >> LIGHTS_DECAY_SHIFT) - (lvl != 0 ? 1 : 0));
+}
+
+#if LIGHTS_CHANNELS
+//---------------------------------------------------------------------//
+// Уровни доп. каналов после гаммы: 0..LED_MAX_PWM (вызывать после Lights_tick())
+//---------------------------------------------------------------------//
+static inline void Lights_channelLevels(volatile LightsState &st, uint8_t *out)
+{
+	for (uint8_t ch = 0; ch < LIGHTS_CHANNELS; ch++) {
+		out[ch] = static_cast<uint8_t>(pgm_read_word(&lights_gamma[st.ch_level[ch] >> 2]) >> 8);
+	}
+}
+#endif
+
+//---------------------------------------------------------------------//
+// Событие плеера: пауза длиной len16 (1/16)
+//---------------------------------------------------------------------//
+static inline void Lights_onRest(volatile LightsState &st, const uint8_t len16) {
+	Lights_advance16(st, len16);
+}
+
 //---------------------------------------------------------------------//
 // Применить ticksPer16 (сколько "нотных тиков" на 1/16)
 // и пересчитать скорость "дыхания".
@@ -113,7 +347,24 @@ static inline void Lights_applyTempoTicksPer16(volatile LightsState &st, const u
 //---------------------------------------------------------------------//
 static inline void Lights_tick(volatile LightsState &st)
 {
+	// эффекты по событиям: затухание уровня + гамма
+#if LIGHTS_CHANNELS
+	for (uint8_t ch = 0; ch < LIGHTS_CHANNELS; ch++) {
+		st.ch_level[ch] = Lights_decay(st.ch_level[ch]);
+	}
+#endif
+
+	if ((st.fx & LIGHTS_FX_MODE_MASK) != LIGHTS_FX_BREATH) {
+		const uint8_t lvl = Lights_decay(st.level);
+		st.level = lvl;
+
+		st.q8 = pgm_read_word(&lights_gamma[lvl >> 2]);
+		Lights_apply(st.q8);
+		return;
+	}
+
 	if (st.step_q8 == 0) {
+		st.q8 = 0;
 		OCR0B = 0;
 		return;
 	}
@@ -139,5 +390,5 @@ static inline void Lights_tick(volatile LightsState &st)
 		}
 	}
 
-	OCR0B = static_cast<uint8_t>(st.q8 >> 8);
+	Lights_apply(st.q8);
 }
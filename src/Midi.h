@@ -0,0 +1,197 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file Midi.h
+ * Живая игра по MIDI: шкатулка — маленький звуковой модуль (note on/off, 31250 бод).
+ *
+ * Проблема:
+ *  - бит MIDI — 32 мкс (528 тактов при 16.5 МГц), аудио-тик — 42..47 мкс: выборка из аудио-тика,
+ *    как в Upload.h, не успевает даже за один бит
+ *  - через курсор песни нота звучала бы только на ближайшем нотном тике (~5 мс)
+ *
+ * Приём (Player.h: isrMidiByte()):
+ *  - спад старт-бита -> ISR(PCINT0_vect) принимает байт целиком, не выходя из прерывания (~300 мкс)
+ *  - середины битов — по TCNT0 (Timer0 всегда идёт без делителя, круг 256 тактов); вход в ISR
+ *    после фронта — MIDI_ENTRY_CYCLES + половина возможного ожидания за аудио-ISR (MIDI_LATE_CYCLES)
+ *  - аудио-тики за это время ловятся по флагу таймера: сэмпл + гирлянда + SoftUart прямо в цикле
+ *    (не ближе MIDI_RENDER_GUARD тактов к выборке бита), нотные тики — сразу после байта.
+ *    Звук не прерывается, I2C (Twi.h) на время байта просто стоит
+ *  - стоп-бит проверяется: битый байт (ошибка кадра) выбрасывается, а ISR дожидается 1 на линии
+ *    (не дольше бита) — остаток стоп-бита не примется за старт-бит и не собьёт следующий байт
+ *  - I2C, SoftUart и кнопки работают; Upload.h, Ir.h и Sync.h считают время в аудио-тиках
+ *    и с приёмом MIDI не совместимы (#error в Player.h); Pixels.h — тоже: ~300 мкс в PCINT
+ *    длиннее защёлки WS2812B (280 мкс), кадр ленты рвался бы
+ *
+ * Разбор (Midi_onByte()):
+ *  - running status: байты данных без статуса — к последнему статусу канала
+ *  - real-time (0xF8..0xFF) проходит между любыми байтами и статус не сбрасывает,
+ *    SysEx и system common (0xF0..0xF7) — сбрасывают (данные до нового статуса пропускаются)
+ *  - note on с velocity 0 = note off; note off глушит только звучащую ноту
+ *  - velocity не используется (у синтезатора нет громкости ноты), прочие сообщения пропускаются
+ *
+ * Задержка: событие уходит в синтезатор в той же ISR, сразу после стоп-бита последнего байта
+ * (9.5 бита от его фронта); звук — со следующим аудио-тиком и периодом PWM:
+ * от конца сообщения на линии до звука <= 1 аудио-тик + 15.5 мкс (< 65 мкс), разброс — один аудио-тик.
+ * Сама передача note on — 0.96 мс (0.64 мс с running status).
+ * Проверка на хосте: tests/MidiTest.cpp (поток .mid через настоящую PCINT, ошибки кадра, задержка до звука)
+ * и midi2code/midilive.py --check (модель приёмника).
+ *
+ * Живой режим: пока идут ноты (и ещё MIDI_LIVE_NOTE_TICKS, ~3 с), песня стоит,
+ * как при закрытой крышке, — нотный тик без разбора песни короткий, вход в PCINT не опаздывает.
+ * Допуск: прерывание, задержавшее PCINT, не длиннее ~MIDI_LATE_CYCLES + 80 тактов (~20 мкс).
+ * Первый статус-байт может прийти на нотный тик песни — его и ловит проверка кадра.
+ *
+ * Подключение: стандартный вход MIDI — оптрон (6N138) между DIN и MIDI_PIN, подтяжка внутренняя.
+ *
+ * Включается PLAYER_MIDI=1 (CMake: -DMUSICBOX_MIDI=ON).
+ */
+
+#ifndef PLAYER_MIDI
+	#define PLAYER_MIDI				0
+#endif
+
+// Пин приёма (PORTB)
+#ifndef MIDI_PIN
+	#define MIDI_PIN				PB2
+#endif
+
+// Канал 1..16; 0 — все каналы (omni)
+#ifndef MIDI_CHANNEL
+	#define MIDI_CHANNEL			0
+#endif
+
+// Тактов от спада старт-бита до первого чтения TCNT0 в ISR (вход + пролог)
+#ifndef MIDI_ENTRY_CYCLES
+	#define MIDI_ENTRY_CYCLES		64
+#endif
+
+// Самое долгое ожидание входа за чужим прерыванием (аудио-ISR на нотном тике в живом режиме), тактов;
+// выборки сдвинуты на половину — опоздание 0..MIDI_LATE_CYCLES ложится вокруг середины бита
+#ifndef MIDI_LATE_CYCLES
+	#define MIDI_LATE_CYCLES		240
+#endif
+
+#define MIDI_BAUD					31250UL
+#define MIDI_BIT_CYCLES				((F_CPU + MIDI_BAUD / 2UL) / MIDI_BAUD)
+
+// Аудио-сэмпл в цикле приёма — только если до выборки бита больше стольких тактов
+#define MIDI_RENDER_GUARD			192
+
+// Живой режим после последнего события, нотных тиков (~3 с)
+#define MIDI_LIVE_NOTE_TICKS		600
+
+#if (MIDI_CHANNEL < 0) || (MIDI_CHANNEL > 16)
+	#error "MIDI_CHANNEL must be 0 (omni) or 1..16"
+#endif
+#if (MIDI_BIT_CYCLES < 2 * MIDI_RENDER_GUARD) || (MIDI_ENTRY_CYCLES + MIDI_LATE_CYCLES / 2 >= MIDI_BIT_CYCLES / 2)
+	#error "MIDI: F_CPU too low for 31250 baud"
+#endif
+
+// События разбора
+#define MIDI_EV_NONE				0
+#define MIDI_EV_NOTE_ON				1
+#define MIDI_EV_NOTE_OFF			2
+
+// Нет звучащей ноты
+#define MIDI_NOTE_NONE				0xFF
+
+//=====================================================================//
+// Состояние приёма
+//=====================================================================//
+typedef struct {
+	uint8_t  status;					// running status (0 — нет: данные пропускаются)
+	uint8_t  have;						// принято байт данных сообщения
+	uint8_t  data0;						// первый байт данных (нота)
+	uint8_t  key;						// нота последнего события
+	uint8_t  sounding;					// звучащая нота (MIDI_NOTE_NONE — тишина)
+	uint8_t  errors;					// ошибок кадра (стоп-бит в 0, насыщается)
+	uint16_t live;						// нотных тиков до возврата к песне
+} MidiState;
+
+//---------------------------------------------------------------------//
+// Инициализация: вход с подтяжкой (оптрон тянет к GND), PCINT
+//---------------------------------------------------------------------//
+static inline void Midi_begin(volatile MidiState &m)
+{
+	DDRB  &= static_cast<uint8_t>(~_BV(MIDI_PIN));
+	PORTB |= _BV(MIDI_PIN);
+	PCMSK |= _BV(MIDI_PIN);
+	GIMSK |= _BV(PCIE);
+
+	m.status   = 0;
+	m.have     = 0;
+	m.key      = 0;
+	m.sounding = MIDI_NOTE_NONE;
+	m.errors   = 0;
+	m.live     = 0;
+}
+
+//---------------------------------------------------------------------//
+// Байт с линии -> событие MIDI_EV_* (нота — в key)
+//---------------------------------------------------------------------//
+static inline uint8_t Midi_onByte(volatile MidiState &m, const uint8_t b)
+{
+	if (b >= 0xF8) {
+		return MIDI_EV_NONE;			// real-time: статус не трогает
+	}
+	if (b & 0x80) {
+		m.status = (b >= 0xF0) ? 0 : b;	// SysEx / system common — running status сброшен
+		m.have   = 0;
+		return MIDI_EV_NONE;
+	}
+
+	const uint8_t status = m.status;
+	if (status == 0) {
+		return MIDI_EV_NONE;
+	}
+
+	const auto type = static_cast<uint8_t>(status & 0xF0);
+	if (type == 0xC0 || type == 0xD0) {
+		return MIDI_EV_NONE;			// один байт данных: program change, channel pressure
+	}
+	if (m.have == 0) {
+		m.data0 = b;
+		m.have  = 1;
+		return MIDI_EV_NONE;
+	}
+	m.have = 0;							// сообщение целиком, статус остаётся
+
+#if MIDI_CHANNEL
+	if ((status & 0x0F) != MIDI_CHANNEL - 1) {
+		return MIDI_EV_NONE;
+	}
+#endif
+
+	if (type == 0x90 && b != 0) {
+		m.key = m.data0;
+		return MIDI_EV_NOTE_ON;
+	}
+	if (type == 0x80 || type == 0x90) {
+		m.key = m.data0;
+		return MIDI_EV_NOTE_OFF;
+	}
+	return MIDI_EV_NONE;				// aftertouch, controller, pitch bend
+}
+
+//---------------------------------------------------------------------//
+// Событие было — живой режим заново
+//---------------------------------------------------------------------//
+static inline void Midi_touch(volatile MidiState &m) {
+	m.live = MIDI_LIVE_NOTE_TICKS;
+}
+
+//---------------------------------------------------------------------//
+// Нотный тик: отсчёт живого режима.
+// @return true — живой режим, песня стоит.
+//---------------------------------------------------------------------//
+static inline bool Midi_noteTick(volatile MidiState &m)
+{
+	const uint16_t live = m.live;
+	if (live == 0) {
+		return false;
+	}
+	m.live = static_cast<uint16_t>(live - 1);
+	return true;
+}
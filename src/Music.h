@@ -19,6 +19,8 @@
  *      * 1..127        — MIDI-нота
  *      * TEMPO (0xFF)  — смена темпа, val = tempo10 (например 9 -> 90 BPM)
  *      * TRANS (0xFE)  — транспозиция, val = int8 (например -1, 0, +1)
+ *      * SMPL (0xFD)   — запуск PCM-клипа (Sampler.h), val = индекс клипа (SMP_*)
+ *      * LIGHT (0xFC)  — эффект гирлянды (Lights.h), val = LIGHTS_FX_* (| LIGHTS_FX_ACCENT)
  *
  *  - val:
  *      * для нот/паузы — durFlags: длительность в 1/16 + флаги приёмов (STC/LGT/PMT)
@@ -66,9 +68,25 @@
 // Пример: TRANS, -1 -> все ноты ниже на 1 полутон
 #define TRANS				0xFE
 
+// SMPL, index: запустить PCM-клип из Sampler.h поверх текущей ноты (без задержки)
+// Пример: SMPL, SMP_TINE, C4F, L04 -> щипок язычка + нота
+#define SMPL				0xFD
+
+// LIGHT, fx: выбрать эффект гирлянды (LIGHTS_FX_* из Lights.h, можно | LIGHTS_FX_ACCENT)
+// Пример: LIGHT, LIGHTS_FX_FLASH | LIGHTS_FX_ACCENT -> вспышки на нотах, акцент на сильную долю
+#define LIGHT				0xFC
+
 // PAUSE: пауза (cmd = 0)
 #define PAUSE				0
 
+//=====================================================================//
+// Индексы клипов для SMPL (порядок = таблица samples[] в Sampler.h)
+//=====================================================================//
+
+#define SMP_TINE			0	// щипок язычка
+#define SMP_BELL			1	// колокольчик
+#define SMP_CHIME			2	// "дзынь"
+
 //=====================================================================//
 // durFlags: младшие 5 бит — длительность (1/16), старшие 3 — приёмы
 //=====================================================================//
@@ -79,7 +97,7 @@
 // приёмы (можно OR-ить с L*):
 //   C4F, (L08 | STC)  и т.п.
 #define STC					0x20	// staccato
-#define LGT					0x40	// legato
+#define LGT					0x40	// legato: нота без новой атаки (фаза/огибающая продолжаются)
 #define PMT					0x80	// palm mute
 
 //=====================================================================//
@@ -4,6 +4,7 @@
 #include <avr/power.h>
 
 #include "Player.h"
+#include "Stack.h"		// high-water mark стека (PLAYER_STACK_PAINT)
 
 // Digispark / ATtiny85 USB board
 // P0..P5 адресуются как 0..5
@@ -26,10 +27,28 @@
  *    случайном повторном включении заголовка в другом .cpp.
  */
 
+#if PLAYER_STACK_PAINT || PLAYER_IRQ_PROFILE
+    #if PLAYER_SOFT_UART
+        /**
+         * Отладочный вывод через UART аудио-тика (SoftUart.h): тот же Print,
+         * но байт — в буфер, без cli() на время кадра.
+         */
+        class SoftUartPrint : public Print {
+        public:
+            size_t write(uint8_t b) override { return Player::uartWrite(b); }
+        };
+
+        static SoftUartPrint debugOut;
+        #define DEBUG_OUT   debugOut
+    #else
+        #define DEBUG_OUT   Serial
+    #endif
+#endif
+
 inline void setup() {
     // Отключаем то, что можно (если макросы существуют для этого чипа)
-    #ifdef power_adc_disable
-        power_adc_disable();
+    #if defined(power_adc_disable) && !PLAYER_ADC
+        power_adc_disable();    // крышка/громкость (Adc.h) читают АЦП в фоне
     #endif
     #ifdef power_spi_disable
         power_spi_disable();
@@ -44,11 +63,152 @@ inline void setup() {
         power_timer2_disable();
     #endif
 
+    #if (PLAYER_STACK_PAINT || PLAYER_IRQ_PROFILE) && !PLAYER_SOFT_UART
+        // Отладочный канал: TinyDebugSerial (TX = PB3), только при инструментировании
+        Serial.begin(115200);
+    #endif
+
     Player::begin();
-    Player::setSong(0);	// 0..9, если мимо NUM_SONGS — будет сыгран 0
+
+    #if PLAYER_RESUME
+        // после пропадания питания — с того же такта
+        if (!Player::resumeSong()) {
+            Player::setSong(0);
+        }
+    #else
+        Player::setSong(0);	// 0..9, если мимо NUM_SONGS — будет сыгран 0
+    #endif
 }
 
 inline void loop() {
     // Timer0 занят PWM, поэтому millis()/delay() могут быть некорректны.
-    // Ничего не делаем.
+
+    #if PLAYER_PIXELS
+        // Адресная лента: кадр побайтно, между байтами отрабатывает аудио-ISR
+        Player::showPixels();
+    #endif
+
+    #if PLAYER_RESUME
+        // Контрольная точка: байт в EEPROM, только когда она свободна (ISR не ждёт)
+        Player::pollResume();
+    #endif
+
+    #if PLAYER_SONG_SOURCE_I2C
+        // Песня из I2C EEPROM: блок с опережением (чтение идёт по шине в фоне, Twi.h)
+        Player::pollSongStream();
+    #endif
+
+    #if PLAYER_OLED
+        // Дисплей: несколько байт изменившихся столбцов за проход (шина — после блоков песни)
+        Player::pollOled();
+    #endif
+
+    #if PLAYER_SONG_UPLOAD
+        // Загрузка песни: принятый байт -> слот EEPROM, только когда она свободна
+        Player::pollUpload();
+    #endif
+
+    #if PLAYER_IR
+        // ИК-пульт: команды из очереди аудио-ISR -> листаем песни
+        IrCommand ir;
+
+        while (Player::takeIrCommand(ir)) {
+            const bool next = (ir.proto == IR_PROTO_NEC) ? (ir.cmd == IR_NEC_CMD_NEXT) : (ir.cmd == IR_RC5_CMD_NEXT);
+            const bool prev = (ir.proto == IR_PROTO_NEC) ? (ir.cmd == IR_NEC_CMD_PREV) : (ir.cmd == IR_RC5_CMD_PREV);
+
+            if (next) {
+                Player::nextSong();
+            } else if (prev) {
+                Player::prevSong();
+            }
+
+            #ifdef DEBUG_OUT
+                // коды кнопок своего пульта — для IR_*_CMD_*
+                DEBUG_OUT.print(ir.proto == IR_PROTO_NEC ? F("IR NEC addr=") : F("IR RC5 addr="));
+                DEBUG_OUT.print(ir.addr);
+                DEBUG_OUT.print(F(" cmd="));
+                DEBUG_OUT.println(ir.cmd);
+            #endif
+        }
+    #endif
+
+    #if PLAYER_BUTTONS
+        // Кнопка: коротко — следующая песня, дважды — предыдущая, долго — выключиться до нажатия
+        if (Player::buttonEvent(BUTTON_EV_SHORT(0))) {
+            Player::nextSong();
+        }
+        if (Player::buttonEvent(BUTTON_EV_DOUBLE(0))) {
+            Player::prevSong();
+        }
+        if (Player::buttonEvent(BUTTON_EV_LONG(0))) {
+            Player::powerDown();
+        }
+        #if BUTTONS_COUNT > 1
+            // вторая кнопка: предыдущая песня
+            if (Player::buttonEvent(BUTTON_EV_SHORT(1)) || Player::buttonEvent(BUTTON_EV_DOUBLE(1))) {
+                Player::prevSong();
+            }
+        #endif
+    #endif
+
+    #if PLAYER_SCHEDULE
+        // Расписание: будильник RTC -> песня, доиграла -> power-down до следующего будильника
+        Player::pollSchedule();
+    #endif
+
+    #if PLAYER_STACK_PAINT
+        // Печатаем только при росте отметки (TinyDebugSerial делает cli на байт —
+        // пара потерянных сэмплов в отладочной сборке допустима; с PLAYER_SOFT_UART — без потерь)
+        static uint16_t reported = 0;
+        const uint16_t used = Stack_maxUsed();
+
+        if (used != reported) {
+            reported = used;
+            DEBUG_OUT.print(F("SRAM static="));
+            DEBUG_OUT.print(Stack_staticUsed());
+            DEBUG_OUT.print(F(" stack max="));
+            DEBUG_OUT.print(used);
+            DEBUG_OUT.print(F(" free="));
+            DEBUG_OUT.println(Stack_free());
+        }
+    #endif
+
+    #if PLAYER_IRQ_PROFILE
+        // Раз в секунду: прерывания по векторам + загрузка CPU аудио-ISR
+        IrqCounters irq;
+
+        if (Player::takeIrqProfile(irq)) {
+            const uint32_t cycles = irq.busy * IRQ_PROFILE_TICK_CYCLES;
+
+            DEBUG_OUT.print(F("irq/s audio="));
+            DEBUG_OUT.print(irq.audio);
+            DEBUG_OUT.print(F(" t0ovf="));
+            DEBUG_OUT.print(irq.t0_ovf);
+            DEBUG_OUT.print(F(" note="));
+            DEBUG_OUT.print(irq.note);
+            DEBUG_OUT.print(F(" millis="));
+            DEBUG_OUT.print(irq.core_millis);
+        #if PLAYER_TWI
+            DEBUG_OUT.print(F(" usi="));
+            DEBUG_OUT.print(irq.usi_ovf);
+        #endif
+        #if PLAYER_ADC
+            DEBUG_OUT.print(F(" adc="));
+            DEBUG_OUT.print(irq.adc);
+        #endif
+        #if PLAYER_SONG_UPLOAD || PLAYER_BUTTONS || PLAYER_SCHEDULE || PLAYER_MIDI
+            DEBUG_OUT.print(F(" pcint="));
+            DEBUG_OUT.print(irq.pcint);
+        #endif
+            DEBUG_OUT.print(F(" cpu%="));
+            DEBUG_OUT.print(cycles / (F_CPU / 100UL));
+            DEBUG_OUT.print(F(" max_cyc="));
+            DEBUG_OUT.println(static_cast<uint16_t>(irq.busy_max * IRQ_PROFILE_TICK_CYCLES));
+        }
+    #endif
+
+    #if PLAYER_BUTTONS || PLAYER_SCHEDULE
+        // Опрашивать нечего: до следующего прерывания (аудио-тик, кнопка, RTC) процессор спит
+        Player::sleepIdle();
+    #endif
 }
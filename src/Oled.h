@@ -0,0 +1,364 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+/**
+ * @file Oled.h
+ * Дисплей SSD1306 128x64 "сейчас играет": название песни и полоса прогресса — понемногу, без кадра в SRAM.
+ *
+ * Проблема:
+ *  - DigisparkOLED пишет экран через Wire (TinyWireM) с ожиданием шины: очистка 1 КБ — секунда
+ *    без loop(), а кадр 128x64 (1 КБ) в 512 байт SRAM не помещается вовсе
+ *
+ * Идея:
+ *  - кадра нет: байт столбца страницы (8 пикселей по вертикали) вычисляется заново —
+ *    строка названия из font6x8.h (PROGMEM), полоса — рамка или заливка по номеру столбца
+ *  - грязные страницы — бит в dirty + диапазон столбцов lo..hi: название меняется со сменой
+ *    песни (вся страница), полоса — только столбцы между старой и новой длиной
+ *  - полоса пересчитывается по song_pos, но грязнит экран только на границе своего столбца
+ *    (~120 обновлений на песню, а не на каждое событие)
+ *  - Oled_poll() из loop(): не больше OLED_CHUNK байт за транзакцию Twi.h, следующая — когда
+ *    предыдущая закончилась и очередь пуста (блоки песни из I2C EEPROM — вперёд дисплея)
+ *  - транзакция = адрес (страница, столбец) + данные: управляющий байт с Co = 1 перед каждой
+ *    командой, 0x40 перед данными
+ *  - старт: инициализация при выключенном дисплее (Twi_run(), до sei()), затем фоновая
+ *    очистка всех страниц и только после неё 0xAF — мусора из ОЗУ контроллера не видно
+ *
+ * Пины: шина Twi.h (SDA = PB0, SCL = PB2), адрес 0x3C.
+ *
+ * Проверка на хосте: tests/OledTest.cpp (SSD1306 с кадром на модели шины: очистка до 0xAF, название, полоса, NACK).
+ *
+ * Включается PLAYER_OLED=1 (CMake: -DMUSICBOX_OLED=ON, включает MUSICBOX_TWI).
+ */
+
+#ifndef PLAYER_OLED
+	#define PLAYER_OLED				0
+#endif
+
+#include "Twi.h"		// шина (PLAYER_TWI включается сам)
+
+#if PLAYER_OLED
+	#include <font6x8.h>			// DigisparkOLED: ssd1306xled_font6x8[], символы 32..122
+#endif
+
+// Адрес SSD1306 на шине
+#ifndef OLED_I2C_ADDR
+	#define OLED_I2C_ADDR			0x3C
+#endif
+
+// Байт данных за транзакцию (~1 мс на байт при SCL ~11 кГц)
+#ifndef OLED_CHUNK
+	#define OLED_CHUNK				8
+#endif
+
+#define OLED_WIDTH					128
+#define OLED_PAGES					8
+#define OLED_FONT_W					6
+#define OLED_TITLE_CHARS			(OLED_WIDTH / OLED_FONT_W)	// 21
+
+// Раскладка экрана (страницы по 8 строк)
+#define OLED_PAGE_TITLE				1
+#define OLED_PAGE_BAR				4
+
+// Полоса: столбцы 1..126 внутри рамки
+#define OLED_BAR_W					(OLED_WIDTH - 2)
+#define OLED_BAR_EDGE				0x7E	// края рамки и заливка
+#define OLED_BAR_EMPTY				0x42	// верх и низ рамки
+
+// Управляющий байт SSD1306
+#define OLED_CTRL_CMD				0x80	// Co = 1: одна команда, за ней снова управляющий байт
+#define OLED_CTRL_CMDS				0x00	// Co = 0: дальше только команды
+#define OLED_CTRL_DATA				0x40	// дальше только данные
+
+#define OLED_HDR					7		// 3 команды адреса + 0x40
+
+//=====================================================================//
+// Состояние дисплея
+//=====================================================================//
+typedef struct {
+	uint8_t  ok;						// дисплей ответил на инициализацию
+	uint8_t  on;						// 0xAF отправлен (после первой очистки)
+	uint8_t  dirty;						// бит страницы — есть что отправить
+	uint8_t  lo[OLED_PAGES];			// первый грязный столбец
+	uint8_t  hi[OLED_PAGES];			// за последним грязным столбцом
+	uint8_t  song;						// показанная песня
+	uint8_t  bar;						// столбцов полосы залито
+	const char *title;					// название в PROGMEM (nullptr — "#номер")
+	uint8_t  title_len;
+	uint8_t  sent_page;					// что ушло последней транзакцией (повтор при ошибке)
+	uint8_t  sent_lo;
+	uint8_t  sent_n;
+	uint8_t  tx[OLED_HDR + OLED_CHUNK];
+	TwiXfer  xfer;
+} OledState;
+
+#if PLAYER_OLED
+
+// Инициализация SSD1306 (как в DigisparkOLED, но постраничная адресация и дисплей остаётся выключенным)
+static const uint8_t oled_init_cmds[] PROGMEM = {
+	0xAE,			// дисплей выключен
+	0x20, 0x02,		// постраничная адресация
+	0xC8,			// COM снизу вверх
+	0x40,			// начальная строка 0
+	0x81, 0x3F,		// контраст
+	0xA1,			// столбец 127 -> SEG0
+	0xA6,			// не инверсия
+	0xA8, 0x3F,		// 64 строки
+	0xA4,			// изображение из ОЗУ
+	0xD3, 0x00,		// без смещения
+	0xD5, 0xF0,		// частота
+	0xD9, 0x22,		// предзаряд
+	0xDA, 0x12,		// раскладка COM
+	0xDB, 0x20,		// VCOMH
+	0x8D, 0x14,		// DC-DC вкл.
+};
+
+//---------------------------------------------------------------------//
+// Пометить столбцы lo..hi-1 страницы грязными
+//---------------------------------------------------------------------//
+static inline void Oled_markDirty(volatile OledState &o, const uint8_t page, const uint8_t lo, const uint8_t hi)
+{
+	const auto bit = static_cast<uint8_t>(_BV(page));
+
+	if (!(o.dirty & bit)) {
+		o.lo[page] = lo;
+		o.hi[page] = hi;
+		o.dirty |= bit;
+		return;
+	}
+	if (lo < o.lo[page]) {
+		o.lo[page] = lo;
+	}
+	if (hi > o.hi[page]) {
+		o.hi[page] = hi;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Символ i строки названия (' ' за концом)
+//---------------------------------------------------------------------//
+static inline char Oled_titleChar(volatile OledState &o, const uint8_t i)
+{
+	if (o.title) {
+		return (i < o.title_len) ? static_cast<char>(pgm_read_byte(&o.title[i])) : ' ';
+	}
+
+	// нет названия (песня из EEPROM и т.п.): "#12"
+	const auto n = static_cast<uint8_t>(o.song + 1);
+	switch (i) {
+		case 0:  return '#';
+		case 1:  return (n >= 10) ? static_cast<char>('0' + n / 10) : static_cast<char>('0' + n);
+		case 2:  return (n >= 10) ? static_cast<char>('0' + n % 10) : ' ';
+		default: return ' ';
+	}
+}
+
+//---------------------------------------------------------------------//
+// Байт столбца col страницы page — без кадра в SRAM
+//---------------------------------------------------------------------//
+static inline uint8_t Oled_column(volatile OledState &o, const uint8_t page, const uint8_t col)
+{
+	if (page == OLED_PAGE_TITLE) {
+		const auto i = static_cast<uint8_t>(col / OLED_FONT_W);
+		if (i >= OLED_TITLE_CHARS) {
+			return 0;
+		}
+		auto c = static_cast<uint8_t>(Oled_titleChar(o, i));
+		if (c < ' ' || c > 'z') {
+			c = ' ';
+		}
+		return pgm_read_byte(&ssd1306xled_font6x8[(c - ' ') * OLED_FONT_W + (col - i * OLED_FONT_W)]);
+	}
+
+	if (page == OLED_PAGE_BAR) {
+		if (col == 0 || col == OLED_WIDTH - 1) {
+			return OLED_BAR_EDGE;
+		}
+		return (col <= o.bar) ? OLED_BAR_EDGE : OLED_BAR_EMPTY;
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------------------//
+// Инициализация (шина уже в Twi_begin(), прерывания запрещены):
+// команды при выключенном дисплее, все страницы — на очистку.
+// @return true — дисплей ответил.
+//---------------------------------------------------------------------//
+static inline bool Oled_begin(volatile OledState &o, volatile TwiState &twi)
+{
+	// 0x00 + команды — во временный буфер на стеке (только здесь, до sei())
+	volatile uint8_t buf[1 + sizeof(oled_init_cmds)];
+	buf[0] = OLED_CTRL_CMDS;
+	for (uint8_t i = 0; i < sizeof(oled_init_cmds); i++) {
+		buf[1 + i] = pgm_read_byte(&oled_init_cmds[i]);
+	}
+
+	o.xfer.addr   = OLED_I2C_ADDR;
+	o.xfer.tx     = buf;
+	o.xfer.tx_len = sizeof(buf);
+	o.xfer.rx_len = 0;
+	o.ok          = (Twi_run(twi, o.xfer) == TWI_ST_OK) ? 1 : 0;
+
+	o.on     = 0;
+	o.dirty  = 0;
+	o.song   = 0xFF;
+	o.bar    = 0;
+	o.title  = nullptr;
+	o.sent_n = 0;
+	for (uint8_t p = 0; p < OLED_PAGES; p++) {
+		Oled_markDirty(o, p, 0, OLED_WIDTH);
+	}
+
+	return o.ok != 0;
+}
+
+//---------------------------------------------------------------------//
+// idx-я строка из строк PROGMEM подряд через '\0' (song_titles[] в Songs.h).
+// @return nullptr — строк меньше; len — длина строки.
+//---------------------------------------------------------------------//
+static inline const char *Oled_findTitle(const char *titles, const uint16_t size, uint8_t idx, uint8_t &len)
+{
+	uint16_t i = 0;
+	while (idx != 0 && i < size) {
+		if (pgm_read_byte(&titles[i++]) == '\0') {
+			idx--;
+		}
+	}
+	if (i >= size) {
+		return nullptr;
+	}
+
+	len = 0;
+	while (i + len < size && len < 255 && pgm_read_byte(&titles[i + len]) != '\0') {
+		len++;
+	}
+	return (len != 0) ? &titles[i] : nullptr;
+}
+
+//---------------------------------------------------------------------//
+// Новая песня: название (PROGMEM, nullptr — номер) и пустая полоса
+//---------------------------------------------------------------------//
+static inline void Oled_setSong(volatile OledState &o, const uint8_t song, const char *title, const uint8_t len)
+{
+	o.song      = song;
+	o.title     = title;
+	o.title_len = len;
+	Oled_markDirty(o, OLED_PAGE_TITLE, 0, OLED_WIDTH);
+
+	if (o.bar != 0) {
+		Oled_markDirty(o, OLED_PAGE_BAR, 1, static_cast<uint8_t>(o.bar + 1));
+		o.bar = 0;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Полоса: pos из len -> залитых столбцов; экран грязнится только при смене столбца
+//---------------------------------------------------------------------//
+static inline void Oled_setProgress(volatile OledState &o, const uint16_t pos, const uint16_t len)
+{
+	uint8_t bar = 0;
+	if (len != 0 && pos < len) {
+		bar = static_cast<uint8_t>((static_cast<uint32_t>(pos) * OLED_BAR_W) / len);
+	} else if (len != 0) {
+		bar = OLED_BAR_W;
+	}
+
+	const uint8_t old = o.bar;
+	if (bar == old) {
+		return;
+	}
+	o.bar = bar;
+
+	// столбцы old+1..bar (или bar+1..old) — сдвиг на край рамки
+	if (bar > old) {
+		Oled_markDirty(o, OLED_PAGE_BAR, static_cast<uint8_t>(old + 1), static_cast<uint8_t>(bar + 1));
+	} else {
+		Oled_markDirty(o, OLED_PAGE_BAR, static_cast<uint8_t>(bar + 1), static_cast<uint8_t>(old + 1));
+	}
+}
+
+//---------------------------------------------------------------------//
+// Из loop(): следующий кусок грязной страницы (не больше OLED_CHUNK байт) в очередь Twi.h.
+// Ждёт конца своей транзакции и пустой очереди; ошибка — кусок снова грязный.
+//---------------------------------------------------------------------//
+static inline void Oled_poll(volatile OledState &o, volatile TwiState &twi)
+{
+	if (!o.ok) {
+		return;
+	}
+
+	const uint8_t status = o.xfer.status;
+	if (status == TWI_ST_QUEUED) {
+		return;
+	}
+	if (status != TWI_ST_OK && o.sent_n != 0) {
+		Oled_markDirty(o, o.sent_page, o.sent_lo, static_cast<uint8_t>(o.sent_lo + o.sent_n));
+	}
+	o.sent_n      = 0;
+	o.xfer.status = TWI_ST_OK;
+
+	if (!Twi_idle(twi)) {
+		return;
+	}
+
+	o.xfer.addr   = OLED_I2C_ADDR;
+	o.xfer.tx     = o.tx;
+	o.xfer.rx_len = 0;
+
+	const uint8_t dirty = o.dirty;
+	if (dirty == 0) {
+		// экран очищен — включаем (один раз)
+		if (!o.on) {
+			o.tx[0]       = OLED_CTRL_CMDS;
+			o.tx[1]       = 0xAF;
+			o.xfer.tx_len = 2;
+			if (Twi_submit(twi, o.xfer)) {
+				o.on = 1;
+			}
+		}
+		return;
+	}
+
+	uint8_t page = 0;
+	while (!(dirty & _BV(page))) {
+		page++;
+	}
+
+	const uint8_t lo = o.lo[page];
+	const uint8_t hi = o.hi[page];
+	auto n = static_cast<uint8_t>(hi - lo);
+	if (n > OLED_CHUNK) {
+		n = OLED_CHUNK;
+	}
+
+	// страница, столбец (мл., ст. тетрада), данные
+	o.tx[0] = OLED_CTRL_CMD;
+	o.tx[1] = static_cast<uint8_t>(0xB0 | page);
+	o.tx[2] = OLED_CTRL_CMD;
+	o.tx[3] = static_cast<uint8_t>(lo & 0x0F);
+	o.tx[4] = OLED_CTRL_CMD;
+	o.tx[5] = static_cast<uint8_t>(0x10 | (lo >> 4));
+	o.tx[6] = OLED_CTRL_DATA;
+	for (uint8_t i = 0; i < n; i++) {
+		o.tx[OLED_HDR + i] = Oled_column(o, page, static_cast<uint8_t>(lo + i));
+	}
+	o.xfer.tx_len = static_cast<uint8_t>(OLED_HDR + n);
+
+	if (!Twi_submit(twi, o.xfer)) {
+		return;
+	}
+
+	o.sent_page = page;
+	o.sent_lo   = lo;
+	o.sent_n    = n;
+
+	if (static_cast<uint8_t>(lo + n) >= hi) {
+		o.dirty = static_cast<uint8_t>(dirty & ~_BV(page));
+	} else {
+		o.lo[page] = static_cast<uint8_t>(lo + n);
+	}
+}
+
+#endif
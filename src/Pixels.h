@@ -0,0 +1,197 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+/**
+ * @file Pixels.h
+ * Адресная гирлянда WS2811/WS2812 (NeoPixel) на одном пине, БЕЗ потери аудио-сэмплов.
+ *
+ * Проблема:
+ *  - Adafruit_NeoPixel::show() и libraries/WS2811 шлют весь кадр с cli():
+ *    ~30 мкс на светодиод, 20 светодиодов = 600 мкс = ~14 пропущенных аудио-тиков.
+ *
+ * Идея:
+ *  - кадр уходит ПОБАЙТНО: cli() только на 8 бит (~10 мкс при 16.5 МГц),
+ *    между байтами sei() — ожидающее аудио-прерывание отрабатывает сразу
+ *  - 10 мкс меньше периода аудио-тика (~42 мкс) и периода TIM0_OVF (~15.5 мкс),
+ *    поэтому ни один тик не теряется, только сдвигается не более чем на 10 мкс
+ *  - линия между байтами остаётся в 0 на время ISR: пауза длиннее порога защёлки ленты
+ *    рвёт кадр. Поддерживаются только ленты класса WS2812B (WS2812B, SK6812, WS2811 новых
+ *    партий), защёлка после >= 280 мкс нуля; старые WS2811/WS2812 (50 мкс) — НЕТ
+ *
+ * Граница паузы между байтами (проверяется PLAYER_IRQ_PROFILE, IrqProfile.h):
+ *  - аудио-ISR короче двух периодов своего таймера, иначе он теряет тики и счётчики
+ *    audio/t0_ovf за секунду меньше нормы: < 512 тактов (31 мкс) в режиме Timer0,
+ *    < 1376 тактов (83 мкс) в режиме Timer1 — max_cyc показывает худший случай
+ *  - ожидающие USI/ADC/PCINT (кнопки) — десятки тактов, расчёт байта в loop() — ~100 тактов
+ *  - итого < ~100 мкс: под 280 мкс с запасом, под 50 мкс — нет (нотный тик с разбором
+ *    песни и I2C в Timer1 режиме бывает длиннее 50 мкс)
+ *  - приём MIDI держит PCINT ~300 мкс на байт — с PLAYER_MIDI лента не собирается (#error)
+ *  - кадр шлётся из loop() (Pixels_show()), в ISR — только запись события ноты
+ *
+ * Картинка:
+ *  - "след нот": каждая новая нота вдвигает в начало ленты цвет своей ноты (12 цветов
+ *    по высоте звука), старые уезжают дальше и тускнеют
+ *  - общая яркость = текущая яркость гирлянды (Lights.h, q8), т.е. все эффекты LIGHT
+ *
+ * Память:
+ *  - кадровый буфер не нужен: байт цвета считается прямо перед отправкой,
+ *    в SRAM только след из PIXELS_COUNT индексов цвета (по 1 байту)
+ *
+ * Тайминг бита (16.5 МГц, 20 тактов = 1.21 мкс):
+ *  - "0": 6 тактов в 1 (0.36 мкс), "1": 13 тактов в 1 (0.79 мкс)
+ *
+ * Включается PLAYER_PIXELS=1 (CMake: -DMUSICBOX_PIXELS=ON). Пин данных — PIXELS_PIN (PB2).
+ */
+
+#ifndef PLAYER_PIXELS
+	#define PLAYER_PIXELS		0
+#endif
+
+// Количество светодиодов в ленте
+#ifndef PIXELS_COUNT
+	#define PIXELS_COUNT		20
+#endif
+
+// Пин данных (PORTB)
+#ifndef PIXELS_PIN
+	#define PIXELS_PIN			PB2
+#endif
+
+// Каждые PIXELS_FADE_SHIFT светодиодов след тускнеет вдвое
+#define PIXELS_FADE_SHIFT		2
+
+#if (F_CPU < 16000000UL) || (F_CPU > 16500000UL)
+	#error "Pixels.h: bit timing is tuned for 16..16.5 MHz"
+#endif
+
+//=====================================================================//
+// Палитра: цвет по высоте ноты (pitch class 0..11), порядок байт GRB
+//=====================================================================//
+const uint8_t pixels_palette[12][3] PROGMEM = {
+	{   0, 255,   0 },	// C  — красный
+	{  64, 255,   0 },	// C#
+	{ 128, 255,   0 },	// D  — оранжевый
+	{ 255, 255,   0 },	// D# — жёлтый
+	{ 255, 128,   0 },	// E
+	{ 255,   0,   0 },	// F  — зелёный
+	{ 255,   0, 128 },	// F#
+	{ 128,   0, 255 },	// G  — голубой
+	{   0,   0, 255 },	// G# — синий
+	{   0,  64, 255 },	// A
+	{   0, 128, 255 },	// A# — фиолетовый
+	{   0, 255, 128 },	// B  — пурпурный
+};
+
+//=====================================================================//
+// Состояние ленты
+//=====================================================================//
+typedef struct {
+	uint8_t note;					// последняя нота (пишет ISR)
+	uint8_t note_seq;				// счётчик нот (пишет ISR)
+	uint8_t shown_seq;				// до какой ноты след уже сдвинут (loop)
+	uint8_t shown_level;			// яркость последнего отправленного кадра (loop)
+	uint8_t trail[PIXELS_COUNT];	// индекс цвета по светодиодам (loop)
+} PixelsState;
+
+//---------------------------------------------------------------------//
+// Инициализация пина и состояния
+//---------------------------------------------------------------------//
+static inline void Pixels_begin(volatile PixelsState &px)
+{
+	PORTB &= static_cast<uint8_t>(~_BV(PIXELS_PIN));
+	DDRB  |= _BV(PIXELS_PIN);
+
+	px.note        = 0;
+	px.note_seq    = 0;
+	px.shown_seq   = 0;
+	px.shown_level = 0xFF;	// первый кадр уйдёт сразу
+
+	for (uint8_t i = 0; i < PIXELS_COUNT; i++) {
+		px.trail[i] = 0;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Событие из ISR: началась нота (только запись, без вычислений)
+//---------------------------------------------------------------------//
+static inline void Pixels_onNote(volatile PixelsState &px, const uint8_t midiNote) {
+	px.note = midiNote;
+	px.note_seq++;
+}
+
+//---------------------------------------------------------------------//
+// Отправить один байт (MSB первым). cli() только на эти 8 бит.
+//---------------------------------------------------------------------//
+static inline void Pixels_sendByte(uint8_t b)
+{
+	const uint8_t sreg = SREG;
+	cli();
+
+	const uint8_t hi  = static_cast<uint8_t>(PORTB | _BV(PIXELS_PIN));
+	const uint8_t lo  = static_cast<uint8_t>(PORTB & ~_BV(PIXELS_PIN));
+	uint8_t       cnt = 8;
+
+	// такты в скобках — от фронта бита; оба пути до dec = 14 тактов, период = 20
+	__asm__ volatile (
+		"1:	out  %[port], %[hi]	\n"	// (0)  фронт
+		"	nop					\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	sbrs %[b], 7		\n"	// "1" -> пропуск (2 такта)
+		"	out  %[port], %[lo]	\n"	// (6)  спад для "0"
+		"	lsl  %[b]			\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	out  %[port], %[lo]	\n"	// (13) спад для "1"
+		"	nop					\n"
+		"	nop					\n"
+		"	nop					\n"
+		"	dec  %[cnt]			\n"
+		"	brne 1b				\n"	// (20) следующий бит
+		: [b] "+r" (b), [cnt] "+r" (cnt)
+		: [port] "I" (_SFR_IO_ADDR(PORTB)), [hi] "r" (hi), [lo] "r" (lo)
+	);
+
+	SREG = sreg;
+}
+
+//---------------------------------------------------------------------//
+// Из loop(): если была новая нота или сменилась яркость — отправить кадр.
+// level — общая яркость 0..255 (например lights.q8 >> 4).
+// Блокирует только loop() (~1 мс на 20 светодиодов), не ISR.
+//---------------------------------------------------------------------//
+static inline void Pixels_show(volatile PixelsState &px, const uint8_t level)
+{
+	const uint8_t seq = px.note_seq;
+
+	if (seq == px.shown_seq && level == px.shown_level) {
+		return;
+	}
+
+	// новая нота вдвигает свой цвет в начало следа
+	if (seq != px.shown_seq) {
+		for (uint8_t i = PIXELS_COUNT - 1; i > 0; i--) {
+			px.trail[i] = px.trail[i - 1];
+		}
+		px.trail[0] = static_cast<uint8_t>(px.note % 12);
+		px.shown_seq = seq;
+	}
+	px.shown_level = level;
+
+	for (uint8_t i = 0; i < PIXELS_COUNT; i++) {
+		const uint8_t *rgb = pixels_palette[px.trail[i]];
+		const auto shift = static_cast<uint8_t>(i >> PIXELS_FADE_SHIFT);
+
+		for (uint8_t k = 0; k < 3; k++) {
+			const auto c = static_cast<uint16_t>(pgm_read_byte(&rgb[k]) * level);
+			Pixels_sendByte(static_cast<uint8_t>((c >> 8) >> shift));
+		}
+	}
+}
@@ -9,6 +9,8 @@
  *  - гирлянда/LED (PB1 -> MOSFET -> GND) через Timer0 PWM (OCR0B)
  *  - Timer1 в CTC режиме даёт аудио-тик (частота задаётся одним #define),
  *    поверх которого программно делаем "нотные тики".
+ *  - либо (PLAYER_AUDIO_CLOCK_TIMER0) аудио-тик берётся от переполнения Timer0
+ *    с децимацией, синхронно с PWM, а Timer1 остаётся свободным.
  *
  * ФОРМАТ ПЕСНИ (ЛИНЕЙНЫЙ uint8_t):
  *  - данные идут парами байт: [cmd/note, val]
@@ -17,32 +19,271 @@
  *      1..127       = MIDI-нота, val = durFlags
  *      TEMPO (0xFF) = смена темпа, val = tempo10 (9->90 BPM)
  *      TRANS (0xFE) = транспозиция, val = int8_t (0, +1, -1, ...)
+ *      SMPL (0xFD)  = запуск PCM-клипа (Sampler.h), val = индекс клипа
+ *      LIGHT (0xFC) = эффект гирлянды (Lights.h), val = LIGHTS_FX_*
  *
  * Конец песни:
  *  - маркера нет, конец = конец массива (по длине SongInfo.len)
  *
+ * ИСТОЧНИК ПЕСЕН:
+ *  - PROGMEM (songs[] из Songs.h) или внешняя I2C EEPROM (PLAYER_SONG_SOURCE_I2C, SongStream.h);
+ *    разбор читает байты через songByte() — для I2C это блоки с опережением в SRAM
+ *
+ * ВТОРОЙ ГОЛОС (PLAYER_SAMPLER):
+ *  - 4-bit DPCM клипы из Sampler.h, смешиваются с DDS в том же аудио-тике.
+ *
  * ГИРЛЯНДА:
- *  - реализована в Lights.h (Player только дергает Lights_tick() и Lights_applyTempoTicksPer16()).
+ *  - реализована в Lights.h (Player дергает Lights_tick() и Lights_applyTempoTicksPer16(),
+ *    а из разбора песни отдаёт события Lights_onNote()/Lights_onRest()).
+ *
+ * АНСАМБЛЬ (PLAYER_ENSEMBLE):
+ *  - шкатулка играет свою партию (Songs.h, song_parts[]), номер партии — PLAYER_PART
+ *    на этапе сборки или байт EEPROM_ADDR_PART (0xFF = не записан -> партия 0)
+ *  - общий старт и доля — линия Sync.h (ведущий + ведомые), позиции во всех партиях совпадают
  *
  * Ошибки в данных:
- *  - неизвестные cmd (128..253) — игнорируем, звук не портим.
+ *  - неизвестные cmd (128..251) — игнорируем, звук не портим.
  */
 
 #include <Arduino.h>
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
 #include <util/delay.h>
 
 #include "Songs.h"
+#include "Calib.h"		// калибровка часов по эталону (PLAYER_CALIBRATE), до Synth.h
 #include "Synth.h"
+#include "Sampler.h"	// PCM-клипы (второй голос)
+#include "SoftPwm.h"	// доп. гирлянды PB2..PB4 (PLAYER_SOFT_PWM), до Lights.h
 #include "Lights.h"	// гирлянда
+#include "Pixels.h"	// адресная лента WS2811 (PLAYER_PIXELS)
+#include "IrqProfile.h"	// счётчики прерываний (PLAYER_IRQ_PROFILE)
+#include "Sync.h"		// синхронизация нескольких шкатулок (PLAYER_SYNC)
+#include "Resume.h"	// продолжение после пропадания питания (PLAYER_RESUME)
+#include "Schedule.h"	// игра по будильнику RTC (PLAYER_SCHEDULE)
+#include "Oled.h"		// дисплей SSD1306 "сейчас играет" (PLAYER_OLED)
+#include "SongStream.h"	// песни из I2C EEPROM (PLAYER_SONG_SOURCE_I2C)
+#include "Twi.h"		// неблокирующий I2C-мастер на USI (PLAYER_TWI)
+#include "SoftUart.h"	// UART TX из аудио-тика (PLAYER_SOFT_UART)
+#include "Upload.h"		// загрузка песни в EEPROM по UART (PLAYER_SONG_UPLOAD)
+#include "Ir.h"			// ИК-пульт NEC/RC5 из аудио-тика (PLAYER_IR)
+#include "Buttons.h"	// кнопки: PCINT + антидребезг на нотном тике (PLAYER_BUTTONS)
+#include "Adc.h"		// АЦП в фоне: крышка и громкость (PLAYER_LID, PLAYER_VOLUME)
+#include "Midi.h"		// живая игра по MIDI, 31250 бод (PLAYER_MIDI)
 
 /**
  * Аппаратные пины (Digispark / ATtiny85)
  */
-#define PIN_SPEAKER				0	// PB0 -> Buzzer PWM (OC0A)
+#ifndef PLAYER_SPEAKER_OC1B
+	#define PLAYER_SPEAKER_OC1B	0
+#endif
+
+#if PLAYER_SPEAKER_OC1B
+	#define PIN_SPEAKER			4	// PB4 -> Buzzer PWM (OC1B), PB0 свободен под USI SDA
+#else
+	#define PIN_SPEAKER			0	// PB0 -> Buzzer PWM (OC0A)
+#endif
 #define PIN_LIGHTS				1	// PB1 -> LED/Garland PWM (OC0B)
 
+/**
+ * Доп. пины PB2..PB4 делят между собой Pixels.h, SoftPwm.h и Sync.h —
+ * один пин может занимать только один модуль.
+ */
+#if PLAYER_SYNC && PLAYER_PIXELS && (SYNC_PIN == PIXELS_PIN)
+	#error "PLAYER_SYNC and PLAYER_PIXELS use the same pin (SYNC_PIN == PIXELS_PIN)"
+#endif
+#if PLAYER_SYNC && PLAYER_SOFT_PWM && (SYNC_PIN == SOFTPWM_PIN0)
+	#error "PLAYER_SYNC and PLAYER_SOFT_PWM use the same pin (SYNC_PIN == SOFTPWM_PIN0)"
+#endif
+#if PLAYER_PIXELS && PLAYER_SOFT_PWM && (PIXELS_PIN == SOFTPWM_PIN0)
+	#error "PLAYER_PIXELS and PLAYER_SOFT_PWM use the same pin (PIXELS_PIN == SOFTPWM_PIN0)"
+#endif
+#if PLAYER_SOFT_UART && PLAYER_SOFT_PWM && (SOFTPWM_CHANNELS > 1) && (SOFT_UART_PIN == SOFTPWM_PIN1)
+	#error "PLAYER_SOFT_UART uses PB3 (SOFTPWM_PIN1): set SOFTPWM_CHANNELS to 1"
+#endif
+#if PLAYER_SPEAKER_OC1B && PLAYER_SOFT_PWM && (SOFTPWM_CHANNELS > 2)
+	#error "PLAYER_SPEAKER_OC1B uses PB4 (SOFTPWM_PIN2): set SOFTPWM_CHANNELS to 2"
+#endif
+
+/**
+ * I2C (USI, Twi.h) занимает PB0 (SDA) и PB2 (SCL) целиком.
+ */
+#if PLAYER_TWI
+	#if !PLAYER_SPEAKER_OC1B
+		#error "PLAYER_TWI needs PLAYER_SPEAKER_OC1B (USI SDA is PB0, the OC0A speaker pin)"
+	#endif
+	#if PLAYER_SYNC || PLAYER_PIXELS || PLAYER_SOFT_PWM || PLAYER_CALIBRATE
+		#error "PLAYER_TWI uses PB2 (USI SCL): disable PLAYER_SYNC/PIXELS/SOFT_PWM/CALIBRATE"
+	#endif
+#endif
+#if PLAYER_SONG_SOURCE_I2C && PLAYER_ENSEMBLE
+	#error "PLAYER_SONG_SOURCE_I2C does not support PLAYER_ENSEMBLE parts yet"
+#endif
+
+/**
+ * Приём загрузки (Upload.h) — свой пин и PCINT0.
+ */
+#if PLAYER_SONG_UPLOAD
+	#if PLAYER_SONG_SOURCE_I2C
+		#error "PLAYER_SONG_UPLOAD stores songs in the internal EEPROM: disable PLAYER_SONG_SOURCE_I2C"
+	#endif
+	#if (UPLOAD_PIN == PIN_SPEAKER) || (UPLOAD_PIN == PIN_LIGHTS)
+		#error "UPLOAD_PIN is the speaker or lights pin"
+	#endif
+	#if (PLAYER_SYNC && (UPLOAD_PIN == SYNC_PIN)) || (PLAYER_PIXELS && (UPLOAD_PIN == PIXELS_PIN))
+		#error "PLAYER_SONG_UPLOAD and PLAYER_SYNC/PIXELS use the same pin"
+	#endif
+	#if PLAYER_SOFT_PWM && ((UPLOAD_PIN == SOFTPWM_PIN0) || \
+		((SOFTPWM_CHANNELS > 1) && (UPLOAD_PIN == SOFTPWM_PIN1)) || \
+		((SOFTPWM_CHANNELS > 2) && (UPLOAD_PIN == SOFTPWM_PIN2)))
+		#error "PLAYER_SONG_UPLOAD and PLAYER_SOFT_PWM use the same pin"
+	#endif
+	#if (PLAYER_SOFT_UART && (UPLOAD_PIN == SOFT_UART_PIN)) || (PLAYER_CALIBRATE && (UPLOAD_PIN == CALIB_PIN))
+		#error "PLAYER_SONG_UPLOAD and PLAYER_SOFT_UART/CALIBRATE use the same pin"
+	#endif
+#endif
+
+/**
+ * ИК-приёмник (Ir.h) — свой пин, только чтение.
+ */
+#if PLAYER_IR
+	#if (IR_PIN == PIN_SPEAKER) || (IR_PIN == PIN_LIGHTS)
+		#error "IR_PIN is the speaker or lights pin"
+	#endif
+	#if (PLAYER_SYNC && (IR_PIN == SYNC_PIN)) || (PLAYER_PIXELS && (IR_PIN == PIXELS_PIN))
+		#error "PLAYER_IR and PLAYER_SYNC/PIXELS use the same pin"
+	#endif
+	#if PLAYER_SOFT_PWM && ((IR_PIN == SOFTPWM_PIN0) || \
+		((SOFTPWM_CHANNELS > 1) && (IR_PIN == SOFTPWM_PIN1)) || \
+		((SOFTPWM_CHANNELS > 2) && (IR_PIN == SOFTPWM_PIN2)))
+		#error "PLAYER_IR and PLAYER_SOFT_PWM use the same pin"
+	#endif
+	#if (PLAYER_SOFT_UART && (IR_PIN == SOFT_UART_PIN)) || (PLAYER_CALIBRATE && (IR_PIN == CALIB_PIN))
+		#error "PLAYER_IR and PLAYER_SOFT_UART/CALIBRATE use the same pin"
+	#endif
+	#if (PLAYER_TWI && ((IR_PIN == PB0) || (IR_PIN == PB2))) || (PLAYER_SONG_UPLOAD && (IR_PIN == UPLOAD_PIN))
+		#error "PLAYER_IR and PLAYER_TWI/SONG_UPLOAD use the same pin"
+	#endif
+#endif
+
+/**
+ * Кнопки (Buttons.h) — свои пины, PCINT0 общий с Upload.h.
+ */
+#if PLAYER_BUTTONS
+	#if BUTTONS_USE_PIN(PIN_SPEAKER) || BUTTONS_USE_PIN(PIN_LIGHTS)
+		#error "BUTTON_PIN0/1 is the speaker or lights pin"
+	#endif
+	#if (PLAYER_SYNC && BUTTONS_USE_PIN(SYNC_PIN)) || (PLAYER_PIXELS && BUTTONS_USE_PIN(PIXELS_PIN))
+		#error "PLAYER_BUTTONS and PLAYER_SYNC/PIXELS use the same pin"
+	#endif
+	#if PLAYER_SOFT_PWM && (BUTTONS_USE_PIN(SOFTPWM_PIN0) || \
+		((SOFTPWM_CHANNELS > 1) && BUTTONS_USE_PIN(SOFTPWM_PIN1)) || \
+		((SOFTPWM_CHANNELS > 2) && BUTTONS_USE_PIN(SOFTPWM_PIN2)))
+		#error "PLAYER_BUTTONS and PLAYER_SOFT_PWM use the same pin"
+	#endif
+	#if (PLAYER_SOFT_UART && BUTTONS_USE_PIN(SOFT_UART_PIN)) || (PLAYER_CALIBRATE && BUTTONS_USE_PIN(CALIB_PIN))
+		#error "PLAYER_BUTTONS and PLAYER_SOFT_UART/CALIBRATE use the same pin"
+	#endif
+	#if (PLAYER_TWI && (BUTTONS_USE_PIN(PB0) || BUTTONS_USE_PIN(PB2))) || \
+		(PLAYER_SONG_UPLOAD && BUTTONS_USE_PIN(UPLOAD_PIN)) || (PLAYER_IR && BUTTONS_USE_PIN(IR_PIN))
+		#error "PLAYER_BUTTONS and PLAYER_TWI/SONG_UPLOAD/IR use the same pin"
+	#endif
+#endif
+
+/**
+ * INT будильника RTC (Schedule.h) — свой пин, PCINT0 общий с Upload.h/Buttons.h.
+ */
+#if PLAYER_SCHEDULE
+	#if (SCHEDULE_INT_PIN == PIN_SPEAKER) || (SCHEDULE_INT_PIN == PIN_LIGHTS) || \
+		(SCHEDULE_INT_PIN == TWI_PIN_SDA) || (SCHEDULE_INT_PIN == TWI_PIN_SCL)
+		#error "SCHEDULE_INT_PIN is the speaker, lights or I2C pin"
+	#endif
+	#if (PLAYER_SOFT_UART && (SCHEDULE_INT_PIN == SOFT_UART_PIN)) || (PLAYER_BUTTONS && BUTTONS_USE_PIN(SCHEDULE_INT_PIN))
+		#error "PLAYER_SCHEDULE and PLAYER_SOFT_UART/BUTTONS use the same pin"
+	#endif
+	#if (PLAYER_SONG_UPLOAD && (SCHEDULE_INT_PIN == UPLOAD_PIN)) || (PLAYER_IR && (SCHEDULE_INT_PIN == IR_PIN))
+		#error "PLAYER_SCHEDULE and PLAYER_SONG_UPLOAD/IR use the same pin"
+	#endif
+#endif
+
+/**
+ * Аналоговые входы (Adc.h) — свои пины, цифровой вход на них выключен.
+ */
+#if PLAYER_ADC
+	#if ADC_USE_PIN(PIN_SPEAKER) || ADC_USE_PIN(PIN_LIGHTS) || (PLAYER_TWI && (ADC_USE_PIN(PB0) || ADC_USE_PIN(PB2)))
+		#error "ADC_LID_PIN/ADC_VOLUME_PIN is the speaker, lights or I2C pin"
+	#endif
+	#if (PLAYER_SYNC && ADC_USE_PIN(SYNC_PIN)) || (PLAYER_PIXELS && ADC_USE_PIN(PIXELS_PIN))
+		#error "PLAYER_LID/VOLUME and PLAYER_SYNC/PIXELS use the same pin"
+	#endif
+	#if PLAYER_SOFT_PWM && (ADC_USE_PIN(SOFTPWM_PIN0) || \
+		((SOFTPWM_CHANNELS > 1) && ADC_USE_PIN(SOFTPWM_PIN1)) || \
+		((SOFTPWM_CHANNELS > 2) && ADC_USE_PIN(SOFTPWM_PIN2)))
+		#error "PLAYER_LID/VOLUME and PLAYER_SOFT_PWM use the same pin"
+	#endif
+	#if (PLAYER_SOFT_UART && ADC_USE_PIN(SOFT_UART_PIN)) || (PLAYER_CALIBRATE && ADC_USE_PIN(CALIB_PIN))
+		#error "PLAYER_LID/VOLUME and PLAYER_SOFT_UART/CALIBRATE use the same pin"
+	#endif
+	#if (PLAYER_SONG_UPLOAD && ADC_USE_PIN(UPLOAD_PIN)) || (PLAYER_IR && ADC_USE_PIN(IR_PIN))
+		#error "PLAYER_LID/VOLUME and PLAYER_SONG_UPLOAD/IR use the same pin"
+	#endif
+	#if (PLAYER_BUTTONS && (ADC_USE_PIN(BUTTON_PIN0) || ((BUTTONS_COUNT > 1) && ADC_USE_PIN(BUTTON_PIN1)))) || \
+		(PLAYER_SCHEDULE && ADC_USE_PIN(SCHEDULE_INT_PIN))
+		#error "PLAYER_LID/VOLUME and PLAYER_BUTTONS/SCHEDULE use the same pin"
+	#endif
+#endif
+
+/**
+ * Вход MIDI (Midi.h) — свой пин, PCINT0 общий с Buttons.h/Schedule.h.
+ * Байт принимается внутри ISR(PCINT0_vect): модули, считающие время в аудио-тиках, с ним несовместимы.
+ */
+#if PLAYER_MIDI
+	#if PLAYER_SONG_UPLOAD || PLAYER_IR || PLAYER_SYNC
+		#error "PLAYER_MIDI holds audio ticks for a byte: disable PLAYER_SONG_UPLOAD/IR/SYNC"
+	#endif
+	#if (MIDI_PIN == PIN_SPEAKER) || (MIDI_PIN == PIN_LIGHTS) || \
+		(PLAYER_TWI && ((MIDI_PIN == TWI_PIN_SDA) || (MIDI_PIN == TWI_PIN_SCL)))
+		#error "MIDI_PIN is the speaker, lights or I2C pin"
+	#endif
+	#if PLAYER_PIXELS
+		#error "PLAYER_MIDI holds PCINT ~300 us per byte, longer than the WS2812B latch: disable PLAYER_PIXELS"
+	#endif
+	#if PLAYER_SOFT_PWM && ((MIDI_PIN == SOFTPWM_PIN0) || \
+							((SOFTPWM_CHANNELS > 1) && (MIDI_PIN == SOFTPWM_PIN1)) || \
+							((SOFTPWM_CHANNELS > 2) && (MIDI_PIN == SOFTPWM_PIN2)))
+		#error "PLAYER_MIDI and PLAYER_SOFT_PWM use the same pin"
+	#endif
+	#if (PLAYER_SOFT_UART && (MIDI_PIN == SOFT_UART_PIN)) || (PLAYER_CALIBRATE && (MIDI_PIN == CALIB_PIN))
+		#error "PLAYER_MIDI and PLAYER_SOFT_UART/CALIBRATE use the same pin"
+	#endif
+	#if (PLAYER_BUTTONS && BUTTONS_USE_PIN(MIDI_PIN)) || (PLAYER_SCHEDULE && (MIDI_PIN == SCHEDULE_INT_PIN)) || \
+		(PLAYER_ADC && ADC_USE_PIN(MIDI_PIN))
+		#error "PLAYER_MIDI and PLAYER_BUTTONS/SCHEDULE/LID/VOLUME use the same pin"
+	#endif
+#endif
+
+/**
+ * Карта EEPROM (байты):
+ *  - EEPROM_ADDR_PART  — номер партии ансамбля (PLAYER_ENSEMBLE)
+ *  - EEPROM_ADDR_CALIB — калибровка часов, CALIB_EEPROM_LEN байт (PLAYER_CALIBRATE)
+ *  - EEPROM_ADDR_UPLOAD — слот загруженной песни, UPLOAD_SLOT_LEN байт (PLAYER_SONG_UPLOAD)
+ *  - EEPROM_ADDR_RESUME..E2END — кольцо контрольных точек (PLAYER_RESUME), после слота
+ */
+#define EEPROM_ADDR_PART		0
+#define EEPROM_ADDR_CALIB		1
+#define EEPROM_ADDR_UPLOAD		16
+#if PLAYER_SONG_UPLOAD
+	#define EEPROM_ADDR_RESUME	(EEPROM_ADDR_UPLOAD + UPLOAD_SLOT_LEN)
+#else
+	#define EEPROM_ADDR_RESUME	16
+#endif
+
+#if PLAYER_SONG_UPLOAD && (EEPROM_ADDR_UPLOAD + UPLOAD_SLOT_LEN + (PLAYER_RESUME ? 2 * RESUME_RECORD_LEN : 0) > E2END + 1)
+	#error "UPLOAD_MAX_LEN does not fit the EEPROM (PLAYER_RESUME needs at least two records after the slot)"
+#endif
+
 /**
  * Тайминги.
  *
@@ -60,6 +301,31 @@
 /** Минимальная длительность ноты (страховка) в "нотных тиках". */
 #define NOTE_MIN_DELAY_TICKS	4
 
+/**
+ * Переход между песнями (плейлист):
+ *  - PLAYER_SONG_GAP_TICKS — тишина между песнями в "нотных тиках" (0 = без паузы, 200 ~ 1 с)
+ *  - PLAYER_LIGHTS_CROSSFADE — гирлянда на переходе не гаснет, а плавно уходит в новую песню
+ *
+ * Заголовок следующей песни (TEMPO/TRANS/LIGHT до первого события) разбирается заранее,
+ * на последнем событии текущей (prefetchNextSong()); на границе — только копирование.
+ */
+#ifndef PLAYER_SONG_GAP_TICKS
+	#define PLAYER_SONG_GAP_TICKS	200
+#endif
+
+#ifndef PLAYER_LIGHTS_CROSSFADE
+	#define PLAYER_LIGHTS_CROSSFADE	0
+#endif
+
+/**
+ * Второй голос — PCM-клипы по команде SMPL (1 = включён, CMake: -DMUSICBOX_SAMPLER=ON).
+ * Если 0 — клипы не линкуются (~500 байт flash), а SMPL игнорируется как неизвестная команда.
+ * По умолчанию выключен: ни одна песня из Songs.h SMPL пока не использует.
+ */
+#ifndef PLAYER_SAMPLER
+	#define PLAYER_SAMPLER		0
+#endif
+
 /**
  * Timer1 (ATtiny85) - фиксированный прескалер
  *
@@ -74,6 +340,131 @@
 	#error "AUDIO_PRESCALER_DIV and PLAYER_SAMPLE_RATE_HZ must be non-zero"
 #endif
 
+/**
+ * Источник аудио-тика:
+ *  - 0 = Timer1 CTC (PLAYER_SAMPLE_RATE_HZ), TIM1_COMPA_vect
+ *  - 1 = переполнение Timer0 (TIM0_OVF_vect) с децимацией AUDIO_T0_DECIMATION:
+ *        F_AUDIO = F_CPU / 256 / 3 ~ 21484 Гц.
+ *        OCR0A пишется сразу после BOTTOM и защёлкивается на следующем TOP —
+ *        обновление сэмпла всегда выровнено по периоду PWM (нет биений).
+ *        Timer1 не трогаем вообще (millis() ядра, IRLib, VirtualWire и т.п.).
+ *        notes_add[] для этой частоты выбирается в Synth.h.
+ *
+ * Цена режима: TIM0_OVF срабатывает ~64 кГц, на 2 из 3 переполнений ISR
+ * только уменьшает счётчик (~20 тактов из 256).
+ */
+#ifndef PLAYER_AUDIO_CLOCK_TIMER0
+	#define PLAYER_AUDIO_CLOCK_TIMER0	0
+#endif
+
+/** Децимация переполнений Timer0 до аудио-тика (режим PLAYER_AUDIO_CLOCK_TIMER0). */
+#define AUDIO_T0_DECIMATION		3
+
+#if (AUDIO_T0_DECIMATION == 0)
+	#error "AUDIO_T0_DECIMATION must be non-zero"
+#endif
+
+/**
+ * Реальная частота аудио-тика (после округления OCR1C), Гц — для модулей,
+ * которые считают время в аудио-тиках (SoftUart.h, Upload.h, Ir.h).
+ */
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	#define PLAYER_AUDIO_HZ		(F_CPU / 256UL / AUDIO_T0_DECIMATION)
+#else
+	#define PLAYER_AUDIO_HZ		(F_CPU / (AUDIO_PRESCALER_DIV * \
+								 ((F_CPU + AUDIO_PRESCALER_DIV * PLAYER_SAMPLE_RATE_HZ / 2UL) / \
+								  (AUDIO_PRESCALER_DIV * PLAYER_SAMPLE_RATE_HZ))))
+#endif
+
+/**
+ * UART из аудио-тика: аудио-тиков на бит для скорости baud и её ошибка x50
+ * (больше PLAYER_AUDIO_HZ — дальше 2% от baud).
+ */
+#define AUDIO_TICKS_PER_BIT(baud)	((PLAYER_AUDIO_HZ + (baud) / 2UL) / (baud))
+#define AUDIO_BAUD_ERROR_X50(baud)	(((PLAYER_AUDIO_HZ > AUDIO_TICKS_PER_BIT(baud) * (baud)) ? \
+									  (PLAYER_AUDIO_HZ - AUDIO_TICKS_PER_BIT(baud) * (baud)) : \
+									  (AUDIO_TICKS_PER_BIT(baud) * (baud) - PLAYER_AUDIO_HZ)) * 50UL)
+
+#if PLAYER_SOFT_UART
+	#define SOFT_UART_BIT_TICKS	AUDIO_TICKS_PER_BIT(SOFT_UART_BAUD)
+
+	#if (SOFT_UART_BIT_TICKS < 2) || (SOFT_UART_BIT_TICKS > 255)
+		#error "SOFT_UART_BAUD: 2..255 audio ticks per bit required"
+	#endif
+	#if AUDIO_BAUD_ERROR_X50(SOFT_UART_BAUD) > PLAYER_AUDIO_HZ
+		#error "SOFT_UART_BAUD is more than 2% off an integer number of audio ticks per bit"
+	#endif
+#endif
+
+#if PLAYER_SONG_UPLOAD
+	#define UPLOAD_BIT_TICKS	AUDIO_TICKS_PER_BIT(UPLOAD_BAUD)
+
+	// приёму нужна середина бита: не меньше 4 тиков на бит
+	#if (UPLOAD_BIT_TICKS < 4) || (UPLOAD_BIT_TICKS > 255)
+		#error "UPLOAD_BAUD: 4..255 audio ticks per bit required"
+	#endif
+	#if AUDIO_BAUD_ERROR_X50(UPLOAD_BAUD) > PLAYER_AUDIO_HZ
+		#error "UPLOAD_BAUD is more than 2% off an integer number of audio ticks per bit"
+	#endif
+#endif
+
+/**
+ * Динамик на PB4 (PLAYER_SPEAKER_OC1B): Timer1 в PWM без делителя (~64 кГц, как Timer0),
+ * сэмпл пишется в OCR1B. Timer1 должен быть свободен — только с PLAYER_AUDIO_CLOCK_TIMER0.
+ */
+#if PLAYER_SPEAKER_OC1B && !PLAYER_AUDIO_CLOCK_TIMER0
+	#error "PLAYER_SPEAKER_OC1B needs PLAYER_AUDIO_CLOCK_TIMER0 (Timer1 drives the speaker PWM)"
+#endif
+
+#if PLAYER_SPEAKER_OC1B
+	#define SPEAKER_OCR			OCR1B
+#else
+	#define SPEAKER_OCR			OCR0A
+#endif
+
+/**
+ * Слинкован ли wiring.c ядра (init()/millis(), ISR переполнения millis-таймера).
+ * Задаётся из CMake (lean core); в Arduino IDE ядро есть всегда.
+ */
+#ifndef MUSICBOX_CORE_WIRING
+	#define MUSICBOX_CORE_WIRING	1
+#endif
+
+/**
+ * Прерывания таймеров: плеер владеет TIMSK ЦЕЛИКОМ (пишет, а не OR-ит).
+ *
+ * init() ядра на ATtiny85 ставит millis на Timer1 (TIMER_TO_USE_FOR_MILLIS = 1)
+ * и включает TOIE1. Плеер перенастраивает Timer1 под аудио, но раньше TOIE1 не
+ * снимал — ISR(MILLISTIMER_OVF_vect, ISR_NOBLOCK) с 32-битной арифметикой
+ * оставался включённым и мог вкладываться в аудио-путь.
+ *
+ * Таблица (что остаётся включённым после Player::begin()):
+ *
+ *   вектор            | владелец               | Timer1 аудио | Timer0 аудио
+ *   ------------------+------------------------+--------------+---------------------------
+ *   TIM1_COMPA_vect   | плеер (аудио-тик)      | ВКЛ          | выкл
+ *   TIM0_OVF_vect     | плеер (аудио-тик)      | выкл         | ВКЛ
+ *   TIM1_OVF_vect     | ядро (millis)          | выкл         | ВКЛ, если wiring.c слинкован
+ *                     |                        |              | (выкл при PLAYER_SPEAKER_OC1B:
+ *                     |                        |              |  Timer1 = PWM динамика, ~64 кГц)
+ *   TIM0_COMPA_vect   | ядро (tone())          | выкл         | выкл (Timer0 = PWM динамика)
+ *   TIM0_COMPB_vect   | —                      | выкл         | выкл
+ *   TIM1_COMPB_vect   | —                      | выкл         | выкл
+ *
+ * Остальные источники (INT0/PCINT0, USI, ADC, EE_RDY, WDT) плеер не трогает:
+ * их включают модули, которым они нужны (USI_OVF — Twi.h, через USICR; PCINT0 — Upload.h, Buttons.h, Schedule.h, Midi.h;
+ * ADC — Adc.h, автозапуск по флагу TOV0 без его прерывания).
+ */
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	#if MUSICBOX_CORE_WIRING && !PLAYER_SPEAKER_OC1B
+		#define PLAYER_TIMSK		(_BV(TOIE0) | _BV(TOIE1))
+	#else
+		#define PLAYER_TIMSK		_BV(TOIE0)
+	#endif
+#else
+	#define PLAYER_TIMSK			_BV(OCIE1A)
+#endif
+
 /** Цель для "нотных тиков" (примерно как было ~195 Гц). Это НЕ настройка пользователя. */
 static const uint16_t NOTE_TICK_TARGET_HZ  = 196;
 
@@ -88,6 +479,55 @@ static const uint16_t NOTE_TICK_TARGET_HZ  = 196;
  */
 volatile Channel channel;			// NOLINT
 volatile LightsState lights;		// NOLINT
+#if PLAYER_SAMPLER
+volatile SamplerVoice sampler;		// NOLINT
+#endif
+#if PLAYER_PIXELS
+volatile PixelsState pixels;		// NOLINT
+#endif
+#if PLAYER_SOFT_PWM
+volatile SoftPwmState softpwm;		// NOLINT
+#endif
+#if PLAYER_SYNC
+volatile SyncState sync;			// NOLINT
+#endif
+#if PLAYER_TWI
+volatile TwiState twi;				// NOLINT
+#endif
+#if PLAYER_SOFT_UART
+volatile SoftUartState uart;		// NOLINT
+#endif
+#if PLAYER_SONG_SOURCE_I2C
+volatile SongStream song_stream;	// NOLINT
+#endif
+#if PLAYER_SONG_UPLOAD
+volatile UploadState upload;		// NOLINT
+volatile uint16_t upload_len = 0;	// NOLINT — длина песни в слоте (0 = слота нет)
+#endif
+#if PLAYER_IR
+volatile IrState ir;				// NOLINT
+#endif
+#if PLAYER_BUTTONS
+volatile ButtonsState buttons;		// NOLINT
+#endif
+#if PLAYER_ADC
+volatile AdcState adc;				// NOLINT
+#endif
+#if PLAYER_OLED
+volatile OledState oled;			// NOLINT
+#endif
+#if PLAYER_MIDI
+volatile MidiState midi;			// NOLINT
+#endif
+#if PLAYER_SCHEDULE
+volatile ScheduleState schedule;	// NOLINT
+volatile uint8_t song_ended = 0;	// NOLINT — песня доиграла, следующая не начата (ждём будильник)
+#endif
+#if PLAYER_RESUME
+volatile ResumeState resume;		// NOLINT
+ResumePoint resume_saved;			// NOLINT — точка из EEPROM при старте
+bool resume_valid = false;			// NOLINT
+#endif
 
 /** Позиция в песне — БАЙТОВЫЙ индекс (0,2,4,...) в линейном массиве. */
 volatile int16_t  song_pos            = -2;
@@ -95,12 +535,49 @@ volatile int16_t  song_pos            = -2;
 /** Длина текущей песни (в байтах), всегда чётная: пары cmd, val. */
 volatile uint16_t song_len            = 0;
 
+/**
+ * Где лежит песня: указатель в PROGMEM или адрес в I2C EEPROM.
+ * С PLAYER_SONG_UPLOAD — 16-битный адрес: PROGMEM или, с флагом SONG_ADDR_EEPROM, внутренняя EEPROM.
+ */
+#if PLAYER_SONG_SOURCE_I2C
+typedef uint16_t SongAddr;
+#elif PLAYER_SONG_UPLOAD
+typedef uint16_t SongAddr;
+#define SONG_ADDR_EEPROM		0x8000u	// flash ATtiny85 — 8 КБ, старший бит свободен
+#else
+typedef const uint8_t *SongAddr;
+#endif
+
+/** Данные текущей песни — партия этой шкатулки. */
+volatile SongAddr song_data           = 0;
+
 /** Текущая задержка до следующего события (в "нотных тиках"). */
 volatile uint16_t note_delay          = 1;
 
 /** Индекс текущей песни. */
 volatile uint8_t  song_index          = 0;
 
+/**
+ * Следующая песня, подготовленная заранее (заголовок уже разобран).
+ */
+typedef struct {
+	SongAddr data;			// данные (PROGMEM / I2C EEPROM)
+	uint16_t len;			// длина, байт
+	int16_t  pos;			// байтовый индекс первого события (после заголовка)
+	uint8_t  index;			// индекс в songs[]
+	uint8_t  ticks_per_16;	// темп из заголовка (или по умолчанию)
+	int8_t   transpose;		// транспозиция из заголовка
+	uint8_t  fx;			// LIGHT из заголовка (0xFF — не задан)
+	uint8_t  ready;			// 1 = подготовлено для текущей song_index
+} SongPrefetch;
+
+volatile SongPrefetch song_next;	// NOLINT
+
+#if PLAYER_ENSEMBLE
+/** Номер партии ансамбля (0 = основная, из songs[]). */
+volatile uint8_t  song_part           = 0;
+#endif
+
 /** Текущая транспозиция (полутона), применяется к MIDI-нотам 1..127. */
 volatile int8_t   song_transpose      = 0;
 
@@ -110,21 +587,42 @@ volatile uint8_t  note_tick_div_top   = 1;
 /** Счётчик делителя до "нотного тика". */
 volatile uint8_t  note_tick_div_cnt   = 0;
 
+#if PLAYER_IRQ_PROFILE
+volatile IrqCounters irq_acc;		// NOLINT — копится в ISR
+volatile IrqCounters irq_last;		// NOLINT — снимок за последнюю секунду
+volatile uint8_t  irq_ready           = 0;
+volatile uint16_t irq_millis_prev     = 0;
+
+#if MUSICBOX_CORE_WIRING
+extern "C" volatile unsigned long millis_timer_overflow_count;	// wiring.c
+#endif
+#endif
+
+#if PLAYER_AUDIO_CLOCK_TIMER0
+/** Счётчик децимации переполнений Timer0 до аудио-тика. */
+volatile uint8_t  audio_t0_decim_cnt  = AUDIO_T0_DECIMATION;
+#endif
+
 /** Реальная частота "нотного тика" (для расчёта tempo->ticks). */
 volatile uint16_t f_note_hz           = 0;
 
 /** Темп текущей песни: сколько "нотных тиков" в 1/16. */
 volatile uint8_t  song_ticks_per_16   = 1;
 
+#if PLAYER_CALIBRATE
+/** Поправка часов по калибровке (Calib.h), Q1.15: 32768 = номинальная F_CPU. */
+volatile uint16_t clock_tune_q15      = CALIB_TUNE_ONE;
+#endif
+
 //=====================================================================//
 
 /**
  * Настроить пины PB0/PB1 на выход.
  */
 static inline void initPins() {
-	// PB0 -> динамик (OC0A)
+	// PB0 -> динамик (OC0A) или PB4 -> динамик (OC1B)
 	// PB1 -> гирлянда (OC0B)
-	DDRB |= _BV(PB0) | _BV(PB1);
+	DDRB |= _BV(PIN_SPEAKER) | _BV(PIN_LIGHTS);
 }
 
 /**
@@ -138,7 +636,9 @@ static inline void initTimer0Pwm()
 	TCCR0A = 0;
 	TCCR0B = 0;
 
+#if !PLAYER_SPEAKER_OC1B
 	TCCR0A |= _BV(COM0A1);
+#endif
 	TCCR0A |= _BV(COM0B1);
 
 	TCCR0A |= _BV(WGM00) | _BV(WGM01);
@@ -148,12 +648,74 @@ static inline void initTimer0Pwm()
 	OCR0B = 0;
 }
 
+#if PLAYER_SPEAKER_OC1B
+
 /**
- * Настроить Timer1 на CTC для аудио-тиков и включить прерывание.
+ * Timer1 — PWM динамика на OC1B (PB4), без делителя: 16.5 МГц / 256 ~ 64 кГц.
+ */
+static inline void initTimer1Speaker()
+{
+	TCCR1 = _BV(CS10);
+	GTCCR = _BV(PWM1B) | _BV(COM1B1);
+	OCR1C = 255;
+	OCR1B = 0;
+}
+
+#endif
+
+/**
+ * Рассчитать делитель до "нотного тика" по реальной частоте аудио-тика.
  *
- * Также рассчитывает:
+ * Рассчитывает:
  *  - note_tick_div_top (делитель до "нотного тика")
  *  - f_note_hz (реальную частоту "нотного тика")
+ *
+ * @param f_audio_hz Частота аудио-тика при номинальной F_CPU (после округления делителей).
+ */
+static inline void initNoteTickRate(uint32_t f_audio_hz)
+{
+#if PLAYER_CALIBRATE
+	// реальная F_CPU по калибровке
+	f_audio_hz = Calib_scaleHz(f_audio_hz, clock_tune_q15);
+#endif
+
+	uint32_t div = (f_audio_hz + (static_cast<uint32_t>(NOTE_TICK_TARGET_HZ) / 2UL)) /
+		static_cast<uint32_t>(NOTE_TICK_TARGET_HZ);
+
+	if (div < 1UL) div = 1UL;
+	if (div > 255UL) div = 255UL;
+
+	note_tick_div_top = static_cast<uint8_t>(div);
+
+	uint32_t fn = f_audio_hz / static_cast<uint32_t>(note_tick_div_top);
+
+	if (fn < 1UL) fn = 1UL;
+	if (fn > 65535UL) fn = 65535UL;
+
+	f_note_hz = static_cast<uint16_t>(fn);
+}
+
+#if PLAYER_AUDIO_CLOCK_TIMER0
+
+/**
+ * Аудио-тик от переполнения Timer0 (Timer0 уже в Fast PWM без делителя).
+ *
+ * Также рассчитывает делитель до "нотного тика" (см. initNoteTickRate()).
+ */
+static inline void initTimer0Audio()
+{
+	audio_t0_decim_cnt = AUDIO_T0_DECIMATION;
+
+	initNoteTickRate(static_cast<uint32_t>(F_CPU) /
+		(256UL * static_cast<uint32_t>(AUDIO_T0_DECIMATION)));
+}
+
+#else
+
+/**
+ * Настроить Timer1 на CTC для аудио-тиков и включить прерывание.
+ *
+ * Также рассчитывает делитель до "нотного тика" (см. initNoteTickRate()).
  */
 static inline void initTimer1Audio()
 {
@@ -179,26 +741,21 @@ static inline void initTimer1Audio()
 	OCR1C = ocr;
 	OCR1A = ocr;
 
-	TIMSK |= _BV(OCIE1A);
-
 	// Рассчитываем реальную F_AUDIO и делитель до "нотного тика"
-	uint32_t f_audio_hz = static_cast<uint32_t>(F_CPU) /
-		(static_cast<uint32_t>(AUDIO_PRESCALER_DIV) * ocr1c_plus1);
-
-	uint32_t div = (f_audio_hz + (static_cast<uint32_t>(NOTE_TICK_TARGET_HZ) / 2UL)) /
-		static_cast<uint32_t>(NOTE_TICK_TARGET_HZ);
-
-	if (div < 1UL) div = 1UL;
-	if (div > 255UL) div = 255UL;
-
-	note_tick_div_top = static_cast<uint8_t>(div);
-
-	uint32_t fn = f_audio_hz / static_cast<uint32_t>(note_tick_div_top);
+	initNoteTickRate(static_cast<uint32_t>(F_CPU) /
+		(static_cast<uint32_t>(AUDIO_PRESCALER_DIV) * ocr1c_plus1));
+}
 
-	if (fn < 1UL) fn = 1UL;
-	if (fn > 65535UL) fn = 65535UL;
+#endif
 
-	f_note_hz = static_cast<uint16_t>(fn);
+/**
+ * Разрешить ровно те прерывания таймеров, что в PLAYER_TIMSK (см. таблицу выше),
+ * и сбросить висящие флаги (в т.ч. от init() ядра).
+ */
+static inline void initTimerInterrupts()
+{
+	TIMSK = PLAYER_TIMSK;
+	TIFR  = _BV(OCF1A) | _BV(OCF1B) | _BV(TOV1) | _BV(OCF0A) | _BV(OCF0B) | _BV(TOV0);
 }
 
 /**
@@ -217,14 +774,14 @@ static inline void applyTempoTicksPer16(uint8_t ticksPer16)
 }
 
 /**
- * Применить tempo10 (9->90 BPM) к текущей песне.
+ * Перевести tempo10 (9->90 BPM) в "нотные тики" на 1/16.
  *
  * Формула:
  *  - ticksPer16 = round( (F_NOTE_HZ * 15) / BPM )
  *
- * @param tempo10 Темп в десятках BPM (9 -> 90 BPM).
+ * @param tempo10 Темп в десятках BPM (9 -> 90 BPM), 0 = по умолчанию.
  */
-static inline void applyTempo10(uint8_t tempo10)
+static inline uint8_t tempo10ToTicksPer16(uint8_t tempo10)
 {
 	if (tempo10 == 0) {
 		tempo10 = static_cast<uint8_t>(PLAYER_DEFAULT_TEMPO10);
@@ -251,7 +808,14 @@ static inline void applyTempo10(uint8_t tempo10)
 		t = 255UL;
 	}
 
-	applyTempoTicksPer16(static_cast<uint8_t>(t));
+	return static_cast<uint8_t>(t);
+}
+
+/**
+ * Применить tempo10 (9->90 BPM) к текущей песне.
+ */
+static inline void applyTempo10(const uint8_t tempo10) {
+	applyTempoTicksPer16(tempo10ToTicksPer16(tempo10));
 }
 
 /**
@@ -279,82 +843,442 @@ static inline uint16_t durationToTicks(const uint8_t durFlags)
 }
 
 /**
- * Перейти на следующую песню (внутри ISR).
- *
- * Примечание:
- *  - Внутри ISR нельзя долго думать: всё делаем просто и быстро.
+ * Число песен (songs[] или каталог I2C EEPROM).
  */
-static inline void nextSongInternal()
+static inline uint8_t songCount()
 {
-	song_pos = -2;
-	note_delay = 200;
-	song_transpose = 0;
+#if PLAYER_SONG_SOURCE_I2C
+	return song_stream.count;
+#elif PLAYER_SONG_UPLOAD
+	return static_cast<uint8_t>(NUM_SONGS + (upload_len != 0 ? 1 : 0));
+#else
+	return static_cast<uint8_t>(NUM_SONGS);
+#endif
+}
 
-	uint8_t idx = song_index;
-	idx++;
+/**
+ * Байт песни base[pos].
+ * @return false — байт ещё не подкачан (I2C) или EEPROM занята записью (Upload.h, Resume.h):
+ *         повторить на следующем нотном тике.
+ */
+static inline bool songByte(const SongAddr base, const uint16_t pos, uint8_t &out)
+{
+#if PLAYER_SONG_SOURCE_I2C
+	return SongStream_read(song_stream, static_cast<uint16_t>(base + pos), out);
+#elif PLAYER_SONG_UPLOAD
+	const auto addr = static_cast<uint16_t>(base + pos);
+	if (addr & SONG_ADDR_EEPROM) {
+		if (!eeprom_is_ready()) {
+			return false;
+		}
+		out = eeprom_read_byte(reinterpret_cast<const uint8_t*>(addr & ~SONG_ADDR_EEPROM));
+	} else {
+		out = pgm_read_byte(reinterpret_cast<const uint8_t*>(addr));
+	}
+	return true;
+#else
+	out = pgm_read_byte(&base[pos]);
+	return true;
+#endif
+}
 
+/**
+ * Данные и длина песни idx (с учётом партии ансамбля).
+ */
+static inline SongAddr songData(const uint8_t idx, uint16_t &outLen)
+{
+#if PLAYER_SONG_SOURCE_I2C
+	outLen = song_stream.len[idx];
+	return song_stream.addr[idx];
+#else
+#if PLAYER_SONG_UPLOAD
+	// сразу после встроенных — песня из слота EEPROM
 	if (idx >= static_cast<uint8_t>(NUM_SONGS)) {
-		idx = 0;
+		outLen = upload_len;
+		return static_cast<SongAddr>(SONG_ADDR_EEPROM | (EEPROM_ADDR_UPLOAD + UPLOAD_HDR_LEN));
 	}
+#endif
 
-	song_index = idx;
-	song_len = pgm_read_word(&songs[song_index].len);
+	const uint8_t *data = static_cast<const uint8_t*>(pgm_read_ptr(&songs[idx].data));
+	uint16_t len = pgm_read_word(&songs[idx].len);
+
+#if PLAYER_ENSEMBLE
+	const uint8_t part = song_part;
+	if (part != 0) {
+		for (uint8_t i = 0; i < static_cast<uint8_t>(NUM_SONG_PARTS); i++) {
+			if (pgm_read_byte(&song_parts[i].song) == idx && pgm_read_byte(&song_parts[i].part) == part) {
+				data = static_cast<const uint8_t*>(pgm_read_ptr(&song_parts[i].data));
+				len  = pgm_read_word(&song_parts[i].len);
+				break;
+			}
+		}
+	}
+#endif
 
-	applyTempo10(0);
-	Synth_silence(channel);
-	Lights_reset(lights);
+	outLen = len;
+#if PLAYER_SONG_UPLOAD
+	return static_cast<SongAddr>(reinterpret_cast<uintptr_t>(data));
+#else
+	return data;
+#endif
+#endif
 }
 
 /**
- * ISR: записать один аудио-сэмпл в PWM (OCR0A).
+ * Данные и длина песни idx -> song_data / song_len.
  */
-static inline void isrRenderAudioSample() {
-	OCR0A = Synth_renderSample(channel);
+static inline void loadSongInfo(const uint8_t idx)
+{
+	uint16_t len = 0;
+	song_data = songData(idx, len);
+	song_len  = len;
 }
 
 /**
- * ISR: один "нотный тик":
- *  - обновить гирлянда
- *  - уменьшить задержку
- *  - при нуле задержки: разобрать следующий cmd/val из песни
+ * Подготовить следующую песню: разобрать её заголовок (TEMPO/TRANS/LIGHT
+ * до первого события). Вызывается на последнем событии текущей песни,
+ * чтобы на границе ничего не разбирать. Если байты ещё не подкачаны (I2C) —
+ * song_next.ready остаётся 0.
  */
-static inline void isrNoteTick()
+static inline void prefetchNextSong()
 {
-	note_tick_div_cnt++;
-	if (note_tick_div_cnt < note_tick_div_top) {
-		return;
-	}
-	note_tick_div_cnt = 0;
-
-	Lights_tick(lights);
+	uint8_t idx = song_index;
+	idx++;
 
-	if (note_delay > 0) {
-		note_delay--;
+	if (idx >= songCount()) {
+		idx = 0;
 	}
 
-	if (note_delay != 0) {
-		return;
-	}
+	uint16_t len = 0;
+	const SongAddr data = songData(idx, len);
 
-	const auto *song = static_cast<const uint8_t*>(pgm_read_ptr(&songs[song_index].data));
-	uint16_t len = song_len;
+	uint8_t  tempo10   = 0;
+	int8_t   transpose = 0;
+	uint8_t  fx        = 0xFF;
+	uint16_t pos       = 0;
 
-	// Обрабатываем TEMPO/TRANS и мусор подряд без задержки
-	for (uint8_t guard = 0; guard < 64; guard++)
-	{
-		auto nextPos = static_cast<int16_t>(song_pos + 2);
+	for (uint8_t guard = 0; guard < 64 && static_cast<uint16_t>(pos + 1) < len; guard++) {
+		uint8_t cmd = 0;
+		uint8_t val = 0;
+		if (!songByte(data, pos, cmd) || !songByte(data, static_cast<uint16_t>(pos + 1), val)) {
+			return;		// блок ещё не подкачан — повторим на следующем нотном тике
+		}
+
+		if (cmd == static_cast<uint8_t>(TEMPO)) {
+			tempo10 = val;
+		} else if (cmd == static_cast<uint8_t>(TRANS)) {
+			transpose = static_cast<int8_t>(val);
+		} else if (cmd == static_cast<uint8_t>(LIGHT)) {
+			fx = val;
+		} else {
+			break;
+		}
+
+		pos = static_cast<uint16_t>(pos + 2);
+	}
+
+	song_next.data         = data;
+	song_next.len          = len;
+	song_next.pos          = static_cast<int16_t>(pos);
+	song_next.index        = idx;
+	song_next.ticks_per_16 = tempo10ToTicksPer16(tempo10);
+	song_next.transpose    = transpose;
+	song_next.fx           = fx;
+	song_next.ready        = 1;
+}
+
+/**
+ * Перейти на следующую песню (внутри ISR).
+ *
+ * Примечание:
+ *  - Внутри ISR нельзя долго думать: заголовок уже разобран prefetchNextSong(),
+ *    здесь только копирование. Следующий разбор — с первого события песни.
+ *  - note_delay = PLAYER_SONG_GAP_TICKS (0 — первое событие в этом же нотном тике).
+ */
+static inline void nextSongInternal()
+{
+	if (!song_next.ready) {
+		prefetchNextSong();
+	}
+	song_next.ready = 0;
+
+	song_index     = song_next.index;
+	song_data      = song_next.data;
+	song_len       = song_next.len;
+	song_pos       = static_cast<int16_t>(song_next.pos - 2);
+	song_transpose = song_next.transpose;
+	note_delay     = PLAYER_SONG_GAP_TICKS;
+
+#if PLAYER_LIGHTS_CROSSFADE
+	Lights_crossfade(lights);
+#else
+	Lights_reset(lights);
+#endif
+	applyTempoTicksPer16(song_next.ticks_per_16);
+	if (song_next.fx != 0xFF) {
+		Lights_setFx(lights, song_next.fx);
+	}
+
+#if PLAYER_SONG_GAP_TICKS
+	Synth_silence(channel);
+#if PLAYER_SAMPLER
+	Sampler_stop(sampler);
+#endif
+#endif
+}
+
+/**
+ * ISR: записать один аудио-сэмпл в PWM (OCR0A, или OCR1B при PLAYER_SPEAKER_OC1B).
+ */
+#if PLAYER_SYNC == SYNC_FOLLOWER
+
+/**
+ * Ведомый: метка ведущего (старт кадра) — подстроить фазу нотного тика
+ * и разрешить/форсировать начало следующего события на ближайшем нотном тике.
+ */
+static inline void syncOnMarker()
+{
+	note_tick_div_cnt = 0;
+	sync.go = 1;
+
+	if (note_delay > 1) {
+		note_delay = 1;
+	}
+}
+
+/**
+ * Ведомый: кадр принят — сверить песню/позицию/темп с ведущим.
+ */
+static inline void syncApplyFrame()
+{
+	const uint8_t  idx   = sync.buf[0];
+	const uint16_t pos   = static_cast<uint16_t>(sync.buf[1] | (static_cast<uint16_t>(sync.buf[2]) << 8));
+	const uint8_t  tpq16 = sync.buf[3];
+
+	if (idx >= songCount()) {
+		return;
+	}
+
+	sync.alive = SYNC_ALIVE_NOTE_TICKS;
+
+	// темп/транспозиция могли быть пропущены (включились посреди песни)
+	if (tpq16 != 0 && tpq16 != song_ticks_per_16) {
+		applyTempoTicksPer16(tpq16);
+	}
+	song_transpose = static_cast<int8_t>(sync.buf[4]);
+
+	if (idx == song_index && static_cast<int16_t>(pos) == song_pos) {
+		return;
+	}
+
+	// разошлись: перейти к событию ведущего на следующем нотном тике
+	if (idx != song_index) {
+		song_index = idx;
+		song_next.ready = 0;
+		loadSongInfo(idx);
+		Lights_reset(lights);
+#if PLAYER_SAMPLER
+		Sampler_stop(sampler);
+#endif
+	}
+
+	song_pos   = static_cast<int16_t>(pos - 2);
+	note_delay = 1;
+	sync.go    = 1;
+}
+
+/**
+ * Ведомый: пора начинать событие — ждать ли метку ведущего?
+ * @return true — ждём (событие пока не начинать).
+ */
+static inline bool syncHold()
+{
+	if (sync.alive == 0) {
+		return false;
+	}
+
+	if (sync.go) {
+		sync.go   = 0;
+		sync.hold = 0;
+		return false;
+	}
+
+	if (++sync.hold < SYNC_HOLD_MAX_NOTE_TICKS) {
+		return true;
+	}
+
+	sync.hold = 0;
+	return false;
+}
+
+#endif
+
+static inline void isrRenderAudioSample() {
+#if PLAYER_SAMPLER
+	const uint8_t sample = Sampler_mix(Synth_renderSample(channel), Sampler_renderSample(sampler));
+#else
+	const uint8_t sample = Synth_renderSample(channel);
+#endif
+#if PLAYER_VOLUME
+	// ручка громкости (Adc.h): одно умножение 8x8
+	SPEAKER_OCR = Adc_scale(adc, sample);
+#else
+	SPEAKER_OCR = sample;
+#endif
+}
+
+/**
+ * ISR: один "нотный тик":
+ *  - обновить гирлянда
+ *  - уменьшить задержку
+ *  - при нуле задержки: разобрать следующий cmd/val из песни
+ */
+static inline void isrNoteTick()
+{
+	note_tick_div_cnt++;
+	if (note_tick_div_cnt < note_tick_div_top) {
+		return;
+	}
+	note_tick_div_cnt = 0;
+
+#if PLAYER_IRQ_PROFILE
+	#if MUSICBOX_CORE_WIRING
+		const auto millisOvf = static_cast<uint16_t>(millis_timer_overflow_count);
+	#else
+		const uint16_t millisOvf = 0;
+	#endif
+	IrqProfile_onNoteTick(irq_acc, irq_last, irq_ready, irq_millis_prev, millisOvf, f_note_hz);
+#endif
+
+	Lights_tick(lights);
+
+#if PLAYER_SOFT_PWM
+	// доп. каналы: уровни из Lights.h -> новое расписание фронтов (если изменились)
+	uint8_t levels[SOFTPWM_CHANNELS];
+	Lights_channelLevels(lights, levels);
+	SoftPwm_set(softpwm, levels);
+#endif
+
+#if PLAYER_SYNC == SYNC_FOLLOWER
+	if (sync.alive != 0) {
+		sync.alive--;
+	}
+#endif
+
+#if PLAYER_SONG_UPLOAD
+	Upload_noteTick(upload);
+#endif
+
+#if PLAYER_BUTTONS
+	// антидребезг и таймеры нажатия — только после фронта на кнопке
+	Buttons_noteTick(buttons);
+#endif
+
+#if PLAYER_MIDI
+	// живая игра по MIDI — песня стоит, нотный тик короткий (вход в PCINT не опаздывает)
+	if (Midi_noteTick(midi)) {
+		return;
+	}
+#endif
+
+#if PLAYER_LID
+	// крышка закрыта — как у механической шкатулки: барабан стоит, нота дозвучивает
+	if (!adc.lid_open) {
+		return;
+	}
+#endif
+
+	if (note_delay > 0) {
+		note_delay--;
+	}
+
+#if PLAYER_SONG_SOURCE_I2C
+	// заголовок следующей песни не подкачался на последнем событии — пробуем, пока звучит нота
+	if (!song_next.ready && static_cast<uint16_t>(song_pos + 3) >= song_len) {
+		prefetchNextSong();
+	}
+#endif
+
+	if (note_delay != 0) {
+		return;
+	}
+
+#if PLAYER_SONG_SOURCE_I2C
+	// нет EEPROM / образа — играть нечего
+	if (songCount() == 0) {
+		note_delay = 1;
+		return;
+	}
+#endif
+
+#if PLAYER_SYNC == SYNC_FOLLOWER
+	// быстрее ведущего — ждём его метку
+	if (syncHold()) {
+		return;
+	}
+#endif
+
+	SongAddr song = song_data;
+	uint16_t len = song_len;
+
+#if PLAYER_RESUME
+	Resume_tick(resume);
+
+	// позиция события в такте (0 = сильная доля) — до сдвига гирляндой
+	uint8_t evPos16 = 0xFF;
+#endif
+
+	// Обрабатываем TEMPO/TRANS и мусор подряд без задержки
+	for (uint8_t guard = 0; guard < 64; guard++)
+	{
+		auto nextPos = static_cast<int16_t>(song_pos + 2);
 
 		// конец песни = конец массива
 		if (nextPos < 0 || len < 2u || static_cast<uint16_t>(nextPos + 1) >= len) {
+#if PLAYER_SCHEDULE
+			// по расписанию — одна песня на будильник: тишина, loop() уводит в сон
+			if (schedule.ok) {
+				song_ended = 1;
+				note_delay = 1;
+				Synth_silence(channel);
+#if PLAYER_SAMPLER
+				Sampler_stop(sampler);
+#endif
+				return;
+			}
+#endif
+#if PLAYER_SONG_SOURCE_I2C
+			// заголовок следующей песни ещё не в SRAM — держим текущую ноту ещё тик
+			if (!song_next.ready) {
+				prefetchNextSong();
+			}
+			if (!song_next.ready) {
+				note_delay = 1;
+				return;
+			}
+#endif
 			nextSongInternal();
+			if (note_delay != 0) {
+				return;
+			}
+
+			// без паузы: первое событие новой песни — в этом же нотном тике
+			song = song_data;
+			len  = song_len;
+			continue;
+		}
+
+		uint8_t cmd = 0;
+		uint8_t val = 0;
+		if (!songByte(song, static_cast<uint16_t>(nextPos), cmd) ||
+			!songByte(song, static_cast<uint16_t>(nextPos + 1), val)) {
+			// блок не подкачан (I2C): текущая нота звучит ещё тик, пара — заново
+			note_delay = 1;
 			return;
 		}
 
 		song_pos = nextPos;
 
-		uint8_t cmd = pgm_read_byte(&song[song_pos]);
-		uint8_t val = pgm_read_byte(&song[song_pos + 1]);
-
 		// TEMPO, tempo10
 		if (cmd == static_cast<uint8_t>(TEMPO)) {
 			applyTempo10(val);
@@ -367,15 +1291,36 @@ static inline void isrNoteTick()
 			continue;
 		}
 
+#if PLAYER_SAMPLER
+		// SMPL, индекс клипа (поверх текущей ноты, без задержки)
+		if (cmd == static_cast<uint8_t>(SMPL)) {
+			Sampler_trigger(sampler, val);
+			continue;
+		}
+#endif
+
+		// LIGHT, эффект гирлянды
+		if (cmd == static_cast<uint8_t>(LIGHT)) {
+			Lights_setFx(lights, val);
+			continue;
+		}
+
 		// PAUSE, durFlags
 		if (cmd == static_cast<uint8_t>(PAUSE)) {
+#if PLAYER_RESUME
+			evPos16 = lights.pos16;
+#endif
 			note_delay = durationToTicks(val);
 			Synth_silence(channel);
+			Lights_onRest(lights, static_cast<uint8_t>(val & DUR_MASK_16_COUNT));
 			break;
 		}
 
 		// нота: 1..127
 		if (cmd <= 127) {
+#if PLAYER_RESUME
+			evPos16 = lights.pos16;
+#endif
 			note_delay = durationToTicks(val);
 
 			int16_t nn = static_cast<int16_t>(cmd) + static_cast<int16_t>(song_transpose);
@@ -386,11 +1331,22 @@ static inline void isrNoteTick()
 				nn = 127;
 			}
 
+			// LGT: продолжение предыдущей ноты — без атаки и без вспышки
+			if (val & LGT) {
+				Synth_noteLegato(channel, static_cast<uint8_t>(nn));
+				Lights_onRest(lights, static_cast<uint8_t>(val & DUR_MASK_16_COUNT));
+				break;
+			}
+
 			Synth_noteOn(channel, static_cast<uint8_t>(nn));
+			Lights_onNote(lights, static_cast<uint8_t>(nn), static_cast<uint8_t>(val & DUR_MASK_16_COUNT));
+#if PLAYER_PIXELS
+			Pixels_onNote(pixels, static_cast<uint8_t>(nn));
+#endif
 			break;
 		}
 
-		// неизвестный cmd (128..253): просто пропускаем пару
+		// неизвестный cmd (128..251): просто пропускаем пару
 	}
 
 	// Если подряд попался только TEMPO/TRANS/мусор, чтобы не зависнуть — даём короткую тишину.
@@ -398,8 +1354,170 @@ static inline void isrNoteTick()
 		note_delay = NOTE_MIN_DELAY_TICKS;
 		Synth_silence(channel);
 	}
+
+#if PLAYER_RESUME
+	// начало такта — контрольная точка (запишет loop(), не чаще RESUME_MIN_NOTE_TICKS)
+	if (evPos16 == 0) {
+		Resume_onEvent(resume, song_index, static_cast<uint16_t>(song_pos),
+					   song_ticks_per_16, song_transpose, lights.fx);
+	}
+#endif
+
+	// последнее событие песни — заранее разобрать заголовок следующей
+	if (!song_next.ready && static_cast<uint16_t>(song_pos + 3) >= song_len) {
+		prefetchNextSong();
+	}
+
+#if PLAYER_SYNC == SYNC_LEADER
+	// метка для ведомых: событие song_pos началось на этом нотном тике
+	Sync_send(sync, song_index, static_cast<uint16_t>(song_pos), song_ticks_per_16, song_transpose);
+#endif
+}
+
+/**
+ * ISR: линия синхронизации (после нотного тика — старт-бит ведущего уходит в том же тике).
+ */
+static inline void isrSync()
+{
+#if PLAYER_SYNC == SYNC_LEADER
+	Sync_txTick(sync);
+#elif PLAYER_SYNC == SYNC_FOLLOWER
+	Sync_rxTick(sync);
+
+	if (sync.edge) {
+		sync.edge = 0;
+		syncOnMarker();
+	}
+
+	if (sync.ready) {
+		sync.ready = 0;
+		syncApplyFrame();
+	}
+#endif
 }
 
+#if PLAYER_MIDI
+
+/**
+ * ISR(PCINT0_vect): спад на MIDI_PIN — принять байт, не выходя из прерывания (Midi.h).
+ *  - t — тактов от фронта старт-бита: оценка входа (Midi.h) + приращения TCNT0
+ *    (круг Timer0 — 256 тактов, проход цикла короче)
+ *  - выборки: середина старт-бита (не 0 — помеха), 8 бит данных младшим вперёд, стоп-бит;
+ *    стоп-бит в 0 — ждём 1 на линии (не дольше бита), повторный вход по флагу PCINT её и увидит
+ *  - флаг аудио-таймера -> сэмпл, гирлянда, SoftPwm, SoftUart; нотные тики (лёгкие в живом режиме) — после байта
+ *  - note on/off — сразу в синтезатор
+ */
+static inline void isrMidiByte()
+{
+	uint8_t last = TCNT0;
+	if (PINB & _BV(MIDI_PIN)) {
+		return;							// подъём или чужой пин
+	}
+
+	uint16_t t      = MIDI_ENTRY_CYCLES + MIDI_LATE_CYCLES / 2;
+	uint16_t at     = MIDI_BIT_CYCLES / 2;
+	uint8_t  bit    = 0;				// 0 — старт, 1..8 — данные, 9 — стоп, 10 — ждём 1 после ошибки кадра
+	uint8_t  data   = 0;
+	uint8_t  framed = 0;
+	uint8_t  due    = 0;				// аудио-тик пришёл, сэмпл ещё не посчитан
+	uint8_t  ticks  = 0;				// аудио-тиков за байт
+
+	for (;;) {
+		const uint8_t now = TCNT0;
+		t    = static_cast<uint16_t>(t + static_cast<uint8_t>(now - last));
+		last = now;
+
+#if PLAYER_AUDIO_CLOCK_TIMER0
+		if (TIFR & _BV(TOV0)) {
+			TIFR = _BV(TOV0);
+			if (--audio_t0_decim_cnt == 0) {
+				audio_t0_decim_cnt = AUDIO_T0_DECIMATION;
+				due = 1;
+			}
+		}
+#else
+		if (TIFR & _BV(OCF1A)) {
+			TIFR = _BV(OCF1A);
+			due  = 1;
+		}
+#endif
+
+		if (t >= at) {
+			const uint8_t high = PINB & _BV(MIDI_PIN);
+			if (bit == 0) {
+				if (high) {
+					break;				// помеха короче полубита
+				}
+			} else if (bit <= 8) {
+				data = static_cast<uint8_t>(data >> 1);
+				if (high) {
+					data |= 0x80;
+				}
+			} else if (bit == 9) {
+				framed = high;
+				if (high) {
+					break;
+				}
+				// ошибка кадра: линия ещё в 0 — по флагу PCINT остаток стоп-бита приняли бы
+				// за старт-бит и сбили бы следующий байт; ждём 1 не дольше бита
+			} else {
+				break;					// break на линии: дальше — обычный вход по спаду
+			}
+			bit++;
+			at = static_cast<uint16_t>(at + MIDI_BIT_CYCLES);
+		} else if (bit == 10 && (PINB & _BV(MIDI_PIN))) {
+			break;
+		} else if (due && static_cast<uint16_t>(at - t) > MIDI_RENDER_GUARD) {
+			due = 0;
+			ticks++;
+			isrRenderAudioSample();
+#if PLAYER_LED_DITHER
+			Lights_dither(lights);
+#endif
+#if PLAYER_SOFT_PWM
+			SoftPwm_tick(softpwm);
+#endif
+#if PLAYER_SOFT_UART
+			SoftUart_tick(uart);
+#endif
+		}
+	}
+
+	if (due) {
+		ticks++;
+		isrRenderAudioSample();
+	}
+
+	if (bit != 0) {
+		if (!framed) {
+			if (midi.errors != 255) {
+				midi.errors++;
+			}
+		} else {
+			const uint8_t ev = Midi_onByte(midi, data);
+			if (ev == MIDI_EV_NOTE_ON) {
+				Synth_noteOn(channel, midi.key);
+				midi.sounding = midi.key;
+				Midi_touch(midi);
+			} else if (ev == MIDI_EV_NOTE_OFF) {
+				if (midi.key == midi.sounding) {
+					Synth_silence(channel);
+					midi.sounding = MIDI_NOTE_NONE;
+				}
+				Midi_touch(midi);
+			}
+		}
+	}
+
+	// нотные тики, пропущенные за байт (в живом режиме — без разбора песни)
+	while (ticks != 0) {
+		ticks--;
+		isrNoteTick();
+	}
+}
+
+#endif
+
 //=====================================================================//
 
 /**
@@ -420,6 +1538,67 @@ class Player
 
 	/** Переключить на предыдущую песню. */
 	static void prevSong();
+
+#if PLAYER_PIXELS
+	/** Из loop(): отправить кадр адресной ленты, если он изменился (ISR не блокирует). */
+	static void showPixels();
+#endif
+
+#if PLAYER_RESUME
+	/** Продолжить с контрольной точки из EEPROM (false — её нет, ничего не меняем). */
+	static bool resumeSong();
+
+	/** Из loop(): дописать контрольную точку в EEPROM (не больше байта за вызов). */
+	static void pollResume();
+#endif
+
+#if PLAYER_SONG_SOURCE_I2C
+	/** Из loop(): подкачать следующий блок песни из I2C EEPROM (не больше блока за вызов). */
+	static void pollSongStream();
+#endif
+
+#if PLAYER_SOFT_UART
+	/** Байт в UART (PLAYER_SOFT_UART): ждёт место в буфере, аудио не останавливает. */
+	static size_t uartWrite(uint8_t b);
+#endif
+
+#if PLAYER_SONG_UPLOAD
+	/** Из loop(): разобрать принятый байт загрузки и записать его в EEPROM (не больше байта за вызов). */
+	static void pollUpload();
+#endif
+
+#if PLAYER_IR
+	/** Забрать команду ИК-пульта, разобранную в аудио-ISR (false — очередь пуста). */
+	static bool takeIrCommand(IrCommand &out);
+#endif
+
+#if PLAYER_BUTTONS
+	/** Забрать событие кнопки BUTTON_EV_*(n) (false — его не было). Без cli(). */
+	static bool buttonEvent(uint8_t ev);
+#endif
+
+#if PLAYER_BUTTONS || PLAYER_SCHEDULE
+	/** Из loop(): спать до следующего прерывания (idle — аудио и кнопки работают). */
+	static void sleepIdle();
+
+	/** Выключиться (power-down, выходы в 0) до PCINT (кнопка, будильник); вернуться с того же места. */
+	static void powerDown();
+#endif
+
+#if PLAYER_SCHEDULE
+	/** Из loop(): будильник -> его песня; песня доиграла -> power-down до следующего. */
+	static void pollSchedule();
+#endif
+
+#if PLAYER_OLED
+	/** Из loop(): название и прогресс песни -> грязные страницы дисплея, кусок страницы -> шина. */
+	static void pollOled();
+#endif
+
+#if PLAYER_IRQ_PROFILE
+	/** Забрать снимок счётчиков прерываний за последнюю секунду (false — ещё нет нового). */
+	static bool takeIrqProfile(IrqCounters &out);
+#endif
 };
 
 //=====================================================================//
@@ -428,18 +1607,56 @@ class Player
  * Инициализация:
  *  - пины
  *  - синтезатор и гирлянда
- *  - Timer0 PWM и Timer1 аудио-тик
+ *  - Timer0 PWM и аудио-тик (Timer1 или переполнение Timer0)
  *  - дефолтный темп
  */
 inline void Player::begin()
 {
+#if PLAYER_CALIBRATE
+	// до таймеров: OSCCAL + поправка (эталон на CALIB_PIN или EEPROM)
+	clock_tune_q15 = Calib_begin(reinterpret_cast<uint8_t*>(EEPROM_ADDR_CALIB));
+#endif
+
 	initPins();
 
 	// DDS (моноканал)
 	Synth_begin(channel);
+#if PLAYER_CALIBRATE
+	Synth_setTune(channel, clock_tune_q15);
+#endif
+
+#if PLAYER_SAMPLER
+	// PCM-клипы
+	Sampler_begin(sampler);
+#endif
+
+#if PLAYER_ENSEMBLE
+	// номер партии: из сборки или из EEPROM (0xFF — чистая EEPROM)
+	#ifdef PLAYER_PART
+	song_part = PLAYER_PART;
+	#else
+	{
+		const uint8_t part = eeprom_read_byte(reinterpret_cast<const uint8_t*>(EEPROM_ADDR_PART));
+		song_part = (part == 0xFF) ? 0 : part;
+	}
+	#endif
+#endif
 
 	song_pos          = -2;
-	song_len          = pgm_read_word(&songs[0].len);
+	song_next.ready   = 0;
+#if PLAYER_TWI
+	Twi_begin(twi);
+#endif
+#if PLAYER_SONG_SOURCE_I2C
+	SongStream_begin(song_stream, twi);
+#endif
+#if PLAYER_SCHEDULE
+	Schedule_begin(schedule, twi);
+#endif
+#if PLAYER_OLED
+	Oled_begin(oled, twi);
+#endif
+	loadSongInfo(0);
 	note_delay        = 1;
 	song_index        = 0;
 	song_transpose    = 0;
@@ -450,9 +1667,53 @@ inline void Player::begin()
 
 	// гирлянда
 	Lights_begin(lights);
+#if PLAYER_PIXELS
+	Pixels_begin(pixels);
+#endif
+#if PLAYER_SOFT_PWM
+	SoftPwm_begin(softpwm);
+#endif
+#if PLAYER_SYNC
+	Sync_begin(sync);
+#endif
+#if PLAYER_SOFT_UART
+	SoftUart_begin(uart, static_cast<uint8_t>(SOFT_UART_BIT_TICKS));
+#endif
+#if PLAYER_SONG_UPLOAD
+	upload_len = Upload_begin(upload, EEPROM_ADDR_UPLOAD, static_cast<uint8_t>(UPLOAD_BIT_TICKS));
+#endif
+#if PLAYER_IR
+	Ir_begin(ir, PLAYER_AUDIO_HZ);
+#endif
+#if PLAYER_BUTTONS
+	Buttons_begin(buttons);
+#endif
+#if PLAYER_ADC
+	Adc_begin(adc);
+#endif
+#if PLAYER_MIDI
+	Midi_begin(midi);
+#endif
+#if PLAYER_RESUME
+	resume_valid = Resume_begin(resume, EEPROM_ADDR_RESUME, resume_saved);
+#endif
 
 	initTimer0Pwm();
+#if PLAYER_SPEAKER_OC1B
+	initTimer1Speaker();
+#endif
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	initTimer0Audio();
+#else
 	initTimer1Audio();
+#endif
+	initTimerInterrupts();
+
+#if PLAYER_IRQ_PROFILE
+	IrqProfile_clear(irq_acc);
+	IrqProfile_clear(irq_last);
+	irq_ready = 0;
+#endif
 
 	// темп по умолчанию (если песня не задаёт TEMPO)
 	applyTempo10(0);
@@ -463,11 +1724,11 @@ inline void Player::begin()
 /**
  * Выбрать песню по индексу.
  *
- * @param index Индекс (0..NUM_SONGS-1). Если вышли за границы — берём 0.
+ * @param index Индекс (0..songCount()-1). Если вышли за границы — берём 0.
  */
 inline void Player::setSong(uint8_t index)
 {
-	if (index >= static_cast<uint8_t>(NUM_SONGS)) {
+	if (index >= songCount()) {
 		index = 0;
 	}
 
@@ -475,8 +1736,12 @@ inline void Player::setSong(uint8_t index)
 
 	song_index        = index;
 	song_pos          = -2;
-	song_len          = pgm_read_word(&songs[song_index].len);
+	song_next.ready   = 0;
+	loadSongInfo(index);
 	note_delay        = 1;
+#if PLAYER_SCHEDULE
+	song_ended        = 0;
+#endif
 	note_tick_div_cnt = 0;
 
 	// дефолт, песня переопределит TEMPO/TRANS сама
@@ -488,6 +1753,9 @@ inline void Player::setSong(uint8_t index)
 
 	// глушим канал до первой ноты
 	Synth_silence(channel);
+#if PLAYER_SAMPLER
+	Sampler_stop(sampler);
+#endif
 
 	sei();
 }
@@ -500,7 +1768,7 @@ inline void Player::nextSong()
 	uint8_t idx = song_index;
 	idx++;
 
-	if (idx >= static_cast<uint8_t>(NUM_SONGS)) {
+	if (idx >= songCount()) {
 		idx = 0;
 	}
 
@@ -515,7 +1783,7 @@ inline void Player::prevSong()
 	uint8_t idx = song_index;
 
 	if (idx == 0) {
-		idx = static_cast<uint8_t>(NUM_SONGS) - 1;
+		idx = static_cast<uint8_t>(songCount() - 1);
 	} else {
 		idx--;
 	}
@@ -523,16 +1791,534 @@ inline void Player::prevSong()
 	setSong(idx);
 }
 
+#if PLAYER_RESUME
+
+/**
+ * Продолжить с контрольной точки: песня, позиция (начало такта), темп, транспозиция
+ * и эффект гирлянды берутся из записи — песня с начала не разбирается.
+ */
+inline bool Player::resumeSong()
+{
+	if (!resume_valid) {
+		return false;
+	}
+
+	const ResumePoint &p = resume_saved;
+	if (p.song >= songCount()) {
+		return false;
+	}
+
+	setSong(p.song);
+
+	// позиция должна быть событием этой песни (песни могли перепрошить)
+	if ((p.pos & 1u) != 0 || static_cast<uint16_t>(p.pos + 1) >= song_len) {
+		return true;
+	}
+
+	cli();
+	song_pos       = static_cast<int16_t>(p.pos - 2);
+	song_transpose = p.transpose;
+	if (p.ticks_per_16 != 0) {
+		applyTempoTicksPer16(p.ticks_per_16);
+	}
+	Lights_setFx(lights, p.fx);
+	sei();
+
+	return true;
+}
+
+inline void Player::pollResume()
+{
+	Resume_poll(resume);
+}
+
+#endif
+
+#if PLAYER_SOFT_UART
+
+/**
+ * Байт в буфер UART. Буфер полон — ждём, пока аудио-ISR его разберёт
+ * (при запрещённых прерываниях ждать некого — байт теряется).
+ *
+ * @return 1 — байт принят, 0 — потерян.
+ */
+inline size_t Player::uartWrite(const uint8_t b)
+{
+	while (!SoftUart_write(uart, b)) {
+		if (!(SREG & _BV(SREG_I))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+#endif
+
+#if PLAYER_SONG_UPLOAD
+
+/**
+ * Загрузка песни (Upload.h): байт кадра -> слот EEPROM.
+ *  - слот стал пустым — загруженная песня пропадает из списка (играла — переходим на 0)
+ *  - кадр записан — сразу играем новую песню
+ */
+inline void Player::pollUpload()
+{
+	switch (Upload_poll(upload)) {
+		case UPLOAD_EV_START:
+			cli();
+			upload_len      = 0;
+			song_next.ready = 0;		// следующей могла быть песня из слота
+			sei();
+			if (song_index >= static_cast<uint8_t>(NUM_SONGS)) {
+				setSong(0);
+			}
+			break;
+
+		case UPLOAD_EV_DONE:
+			upload_len = upload.len;	// ISR не читает слот, пока upload_len == 0
+			setSong(static_cast<uint8_t>(NUM_SONGS));
+			break;
+
+		default:
+			break;
+	}
+}
+
+#endif
+
+#if PLAYER_BUTTONS
+
+/**
+ * Событие кнопки: ev — константа, бит BUTTONS_EVENTS проверяется и сбрасывается sbis/cbi.
+ */
+inline bool Player::buttonEvent(const uint8_t ev)
+{
+	return Buttons_take(ev);
+}
+
+#endif
+
+#if PLAYER_BUTTONS || PLAYER_SCHEDULE
+
+/**
+ * Idle: стоят только такты CPU, таймеры/PWM идут — разбудит ближайший аудио-тик или кнопка.
+ */
+inline void Player::sleepIdle()
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_mode();
+}
+
+/**
+ * Power-down: все такты (и таймеры) стоят, будит только PCINT (кнопка, INT будильника RTC).
+ *  - сначала ждём отпускания кнопки — иначе отпускание тут же разбудит
+ *  - выходы в 0 (PWM отключён от пинов): застывший PWM мог оставить динамик/гирлянду под током;
+ *    PORTB восстанавливается целиком — SoftPwm.h продолжает переключать фронты с той же фазы
+ *  - АЦП (его включает init() ядра) и аналоговый компаратор выключены, BOD — на время сна
+ *    (ATtiny85 rev. C+): остаются утечки и подтяжки — единицы мкА
+ *  - нажатие, разбудившее шкатулку, событий не даёт (buttons.mute)
+ */
+inline void Player::powerDown()
+{
+#if PLAYER_BUTTONS
+	while (buttons.busy) {
+		sleepIdle();
+	}
+#endif
+
+	cli();
+
+	const uint8_t adcsra = ADCSRA;
+	ADCSRA = 0;
+	ACSR  |= _BV(ACD);
+
+	const uint8_t portb  = PORTB;
+	const uint8_t tccr0a = TCCR0A;
+	TCCR0A = static_cast<uint8_t>(tccr0a & ~(_BV(COM0A1) | _BV(COM0A0) | _BV(COM0B1) | _BV(COM0B0)));
+#if PLAYER_SPEAKER_OC1B
+	const uint8_t gtccr = GTCCR;
+	GTCCR = static_cast<uint8_t>(gtccr & ~(_BV(COM1B1) | _BV(COM1B0)));
+#endif
+	PORTB = static_cast<uint8_t>(portb & ~DDRB);		// выходы в 0, подтяжки входов остаются
+
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+#if defined(BODS) && defined(BODSE)
+	sleep_bod_disable();
+#endif
+	sei();			// sei + sleep_cpu: прерывание между ними не теряется
+	sleep_cpu();
+	sleep_disable();
+
+	cli();
+	PORTB  = portb;
+	TCCR0A = tccr0a;
+#if PLAYER_SPEAKER_OC1B
+	GTCCR  = gtccr;
+#endif
+#if PLAYER_ADC
+	ADCSRA = adcsra | _BV(ADSC);	// автозапуск мог остаться без фронта TOV0 — цепочку начинаем заново
+#else
+	ADCSRA = adcsra;
+#endif
+#if PLAYER_BUTTONS
+	buttons.mute = 1;
+	buttons.busy = 1;
+#endif
+	sei();
+}
+
+#endif
+
+#if PLAYER_OLED
+
+/**
+ * Дисплей (Oled.h): смена песни — название (song_titles[]; песни из EEPROM — номер),
+ * позиция — полоса; на шину уходит не больше OLED_CHUNK байт за раз.
+ */
+inline void Player::pollOled()
+{
+	cli();
+	const uint8_t  idx = song_index;
+	const int16_t  pos = song_pos;
+	const uint16_t len = song_len;
+	sei();
+
+	if (idx != oled.song) {
+		const char *title = nullptr;
+		uint8_t titleLen = 0;
+#if !PLAYER_SONG_SOURCE_I2C
+		title = Oled_findTitle(song_titles, sizeof(song_titles), idx, titleLen);
+#endif
+		Oled_setSong(oled, idx, title, titleLen);
+	}
+
+	Oled_setProgress(oled, (pos < 0) ? 0 : static_cast<uint16_t>(pos + 2), len);
+	Oled_poll(oled, twi);
+}
+
+#endif
+
+#if PLAYER_SCHEDULE
+
+/**
+ * Игра по расписанию (Schedule.h):
+ *  - будильник (INT RTC) -> песня этого будильника, RTC заводится на следующий
+ *    (шина — Twi_run() с cli(): музыка ещё не началась, пропадает несколько мс тишины)
+ *  - песня доиграла -> power-down до будильника (или кнопки)
+ *  - RTC не ответил -> расписания нет, шкатулка играет как обычно
+ */
+inline void Player::pollSchedule()
+{
+	if (schedule.alarm) {
+		cli();
+		const uint8_t song = Schedule_service(schedule, twi);
+		sei();
+
+		if (song == SCHEDULE_SONG_NEXT) {
+			nextSong();
+		} else {
+			setSong(song);
+		}
+		return;
+	}
+
+	if (song_ended && schedule.ok) {
+		powerDown();
+	}
+}
+
+#endif
+
+#if PLAYER_IR
+
+/**
+ * Команда ИК-пульта (Ir.h): очередь с однобайтными индексами, cli() не нужен.
+ */
+inline bool Player::takeIrCommand(IrCommand &out)
+{
+	return Ir_read(ir, out);
+}
+
+#endif
+
+#if PLAYER_SONG_SOURCE_I2C
+
+/**
+ * Подкачать блок песни из I2C EEPROM (из loop(): поставить чтение в очередь Twi.h / забрать готовое).
+ */
+inline void Player::pollSongStream()
+{
+	SongStream_poll(song_stream, twi);
+}
+
+#endif
+
+#if PLAYER_PIXELS
+
+/**
+ * Кадр адресной ленты: яркость берётся у гирлянды (q8 -> 0..240),
+ * байты уходят с cli() только на 8 бит, аудио-тики не теряются.
+ */
+inline void Player::showPixels()
+{
+	cli();
+	const uint16_t q8 = lights.q8;
+	sei();
+
+	Pixels_show(pixels, static_cast<uint8_t>(q8 >> 4));
+}
+
+#endif
+
+#if PLAYER_IRQ_PROFILE
+
+/** Сколько тактов CPU в одном тике busy (TCNT таймера-источника аудио-тика). */
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	#define IRQ_PROFILE_TICK_CYCLES	1UL
+#else
+	#define IRQ_PROFILE_TICK_CYCLES	AUDIO_PRESCALER_DIV
+#endif
+
+/**
+ * Конец аудио-ISR: тиков таймера-источника с аудио-тика.
+ * TCNT уже мог пройти круг (TOV0 / OCF1A снова поднят и ждёт выхода из ISR) — тогда + круг.
+ * Флаг, поднятый между чтением TCNT и TIFR, не считаем (TCNT тогда на самом верху).
+ */
+static inline uint16_t irqProfileElapsed()
+{
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	uint16_t t = TCNT0;
+	if ((TIFR & _BV(TOV0)) && t < 255) {
+		t += 256;
+	}
+#else
+	uint16_t t = TCNT1;
+	if ((TIFR & _BV(OCF1A)) && t < OCR1C) {
+		t += static_cast<uint16_t>(OCR1C) + 1;
+	}
+#endif
+	return t;
+}
+
+/**
+ * Забрать снимок счётчиков прерываний за последнюю секунду.
+ *
+ * @param out Куда скопировать снимок.
+ * @return true, если с прошлого вызова появился новый снимок.
+ */
+inline bool Player::takeIrqProfile(IrqCounters &out)
+{
+	if (!irq_ready) {
+		return false;
+	}
+
+	cli();
+
+	out.audio       = irq_last.audio;
+	out.t0_ovf      = irq_last.t0_ovf;
+	out.note        = irq_last.note;
+	out.core_millis = irq_last.core_millis;
+	out.usi_ovf     = irq_last.usi_ovf;
+	out.adc         = irq_last.adc;
+	out.pcint       = irq_last.pcint;
+	out.busy        = irq_last.busy;
+	out.busy_max    = irq_last.busy_max;
+	irq_ready       = 0;
+
+	sei();
+
+	return true;
+}
+
+#endif
+
 //=====================================================================//
 
+#if PLAYER_AUDIO_CLOCK_TIMER0
+
+/**
+ * Прерывание переполнения Timer0 — каждый AUDIO_T0_DECIMATION-й раз
+ * МОНО аудио + авто-плеер + гирлянда (сразу после BOTTOM, выровнено по PWM)
+ */
+ISR(TIM0_OVF_vect)
+{
+#if PLAYER_IRQ_PROFILE
+	irq_acc.t0_ovf++;
+#endif
+
+	if (--audio_t0_decim_cnt != 0) {
+		return;
+	}
+	audio_t0_decim_cnt = AUDIO_T0_DECIMATION;
+
+	// Аудио-сэмпл (DDS + огибающая + PCM-клип)
+	isrRenderAudioSample();
+
+#if PLAYER_LED_DITHER
+	// Дробная яркость гирлянды -> OCR0B (сигма-дельта)
+	Lights_dither(lights);
+#endif
+
+#if PLAYER_SOFT_PWM
+	// Программный PWM доп. гирлянд (одно сравнение на сэмпл)
+	SoftPwm_tick(softpwm);
+#endif
+
+#if PLAYER_TWI
+	// I2C: один фронт SCL на сэмпл (байты — в ISR(USI_OVF_vect))
+	Twi_tick(twi);
+#endif
+
+#if PLAYER_SOFT_UART
+	// UART TX: бит раз в SOFT_UART_BIT_TICKS сэмплов
+	SoftUart_tick(uart);
+#endif
+
+#if PLAYER_SONG_UPLOAD
+	// приём загрузки: выборка в середине бита (только пока идёт байт)
+	Upload_tick(upload);
+#endif
+
+#if PLAYER_IR
+	// ИК-пульт: чтение пина + длина уровня; на фронте — шаг декодеров NEC/RC5
+	Ir_tick(ir);
+#endif
+
+	// Нотный тик + гирлянда + проигрывание
+	isrNoteTick();
+
+#if PLAYER_SYNC
+	// Линия синхронизации шкатулок
+	isrSync();
+#endif
+
+#if PLAYER_IRQ_PROFILE
+	IrqProfile_onAudioIsr(irq_acc, irqProfileElapsed());
+#endif
+}
+
+#else
+
 /**
  * Прерывание Timer1 — МОНО аудио + авто-плеер + гирлянда
  */
 ISR(TIM1_COMPA_vect)
 {
-	// Аудио-сэмпл (DDS + огибающая)
+	// Аудио-сэмпл (DDS + огибающая + PCM-клип)
 	isrRenderAudioSample();
 
+#if PLAYER_LED_DITHER
+	// Дробная яркость гирлянды -> OCR0B (сигма-дельта)
+	Lights_dither(lights);
+#endif
+
+#if PLAYER_SOFT_PWM
+	// Программный PWM доп. гирлянд (одно сравнение на сэмпл)
+	SoftPwm_tick(softpwm);
+#endif
+
+#if PLAYER_TWI
+	// I2C: один фронт SCL на сэмпл (байты — в ISR(USI_OVF_vect))
+	Twi_tick(twi);
+#endif
+
+#if PLAYER_SOFT_UART
+	// UART TX: бит раз в SOFT_UART_BIT_TICKS сэмплов
+	SoftUart_tick(uart);
+#endif
+
+#if PLAYER_SONG_UPLOAD
+	// приём загрузки: выборка в середине бита (только пока идёт байт)
+	Upload_tick(upload);
+#endif
+
+#if PLAYER_IR
+	// ИК-пульт: чтение пина + длина уровня; на фронте — шаг декодеров NEC/RC5
+	Ir_tick(ir);
+#endif
+
 	// Нотный тик + гирлянда + проигрывание
 	isrNoteTick();
+
+#if PLAYER_SYNC
+	// Линия синхронизации шкатулок
+	isrSync();
+#endif
+
+#if PLAYER_IRQ_PROFILE
+	IrqProfile_onAudioIsr(irq_acc, irqProfileElapsed());
+#endif
 }
+
+#endif
+
+#if PLAYER_TWI
+
+/**
+ * USI досчитал байт / бит ACK — следующий шаг транзакции I2C (Twi.h).
+ * Строб SCL уходит из аудио-ISR, поэтому это прерывание всегда идёт сразу после него.
+ */
+ISR(USI_OVF_vect)
+{
+#if PLAYER_IRQ_PROFILE
+	irq_acc.usi_ovf++;
+#endif
+
+	Twi_onOverflow(twi);
+}
+
+#endif
+
+#if PLAYER_ADC
+
+/**
+ * Преобразование АЦП готово (Adc.h). Следующее стартует по фронту TOV0:
+ *  - Timer0-аудио: TOV0 сбрасывает ISR(TIM0_OVF_vect) — каждое переполнение
+ *  - Timer1-аудио: прерывания TOV0 нет, флаг сбрасываем здесь
+ */
+ISR(ADC_vect)
+{
+#if PLAYER_IRQ_PROFILE
+	irq_acc.adc++;
+#endif
+
+#if !PLAYER_AUDIO_CLOCK_TIMER0
+	TIFR = _BV(TOV0);
+#endif
+	Adc_onConversion(adc);
+}
+
+#endif
+
+#if PLAYER_SONG_UPLOAD || PLAYER_BUTTONS || PLAYER_SCHEDULE || PLAYER_MIDI
+
+/**
+ * Фронт на пинах PCINT:
+ *  - спад на MIDI_PIN — байт MIDI целиком, сразу в синтезатор (Midi.h, isrMidiByte()); первым —
+ *    от фронта старт-бита считается время
+ *  - спад на UPLOAD_PIN — старт-бит загрузки (Upload.h), на время байта PCINT пина выключен
+ *  - кнопки — только флаг busy, разбор на нотном тике (Buttons.h)
+ *  - INT будильника RTC в 0 — флаг alarm (Schedule.h)
+ */
+ISR(PCINT0_vect)
+{
+#if PLAYER_IRQ_PROFILE
+	irq_acc.pcint++;
+#endif
+
+#if PLAYER_MIDI
+	isrMidiByte();
+#endif
+#if PLAYER_SONG_UPLOAD
+	Upload_onEdge(upload);
+#endif
+#if PLAYER_BUTTONS
+	Buttons_onEdge(buttons);
+#endif
+#if PLAYER_SCHEDULE
+	Schedule_onEdge(schedule);
+#endif
+}
+
+#endif
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+
+/**
+ * @file Resume.h
+ * Продолжение с того же места после пропадания питания (крышка с концевиком и т.п.).
+ *
+ * Что сохраняем (контрольная точка):
+ *  - песня, позиция события, темп (ticks_per_16), транспозиция, эффект гирлянды —
+ *    всё, что иначе пришлось бы восстанавливать разбором песни с начала
+ *
+ * Когда:
+ *  - только на начале такта (событие на сильной доле) и не чаще RESUME_MIN_NOTE_TICKS
+ *  - ISR лишь копирует несколько байт в req (Resume_onEvent()); запись в EEPROM —
+ *    из loop() по одному байту за вызов, пока EEPROM готова (Resume_poll()):
+ *    ни ISR, ни loop() не ждут ~3.3 мс записи байта
+ *
+ * Износ (кольцо записей, как в AVR101):
+ *  - записи по RESUME_RECORD_LEN байт по кругу на всю свободную EEPROM
+ *    (EEPROM_ADDR_RESUME..E2END, 62 записи на ATtiny85)
+ *  - последний байт записи — порядковый номер seq, пишется ПОСЛЕДНИМ: в кольце номера
+ *    идут подряд (+1), последняя запись — та, за которой номер "рвётся"
+ *  - питание пропало посреди записи -> seq этой ячейки старый, побеждает предыдущая
+ *  - каждая ячейка переписывается раз в 62 контрольные точки: при точке раз в ~10 с
+ *    ресурс 100k циклов — ~2 года непрерывной игры
+ *
+ * Включается PLAYER_RESUME=1 (CMake: -DMUSICBOX_RESUME=ON).
+ */
+
+#ifndef PLAYER_RESUME
+	#define PLAYER_RESUME			0
+#endif
+
+// Не чаще, чем раз в столько нотных тиков (~10 с при ~196 Гц)
+#ifndef RESUME_MIN_NOTE_TICKS
+	#define RESUME_MIN_NOTE_TICKS	2000
+#endif
+
+// Запись: [song][pos lo][pos hi][ticks_per_16][transpose][fx][check][seq]
+#define RESUME_DATA_LEN			6
+#define RESUME_RECORD_LEN		8
+#define RESUME_CHECK_SALT		0xA5
+
+//=====================================================================//
+// Контрольная точка и состояние записи
+//=====================================================================//
+typedef struct {
+	uint8_t  song;				// индекс песни
+	uint16_t pos;				// байтовый индекс события (начало такта)
+	uint8_t  ticks_per_16;		// темп
+	int8_t   transpose;			// транспозиция
+	uint8_t  fx;				// эффект гирлянды (LIGHTS_FX_*)
+} ResumePoint;
+
+typedef struct {
+	ResumePoint req;			// ISR -> loop: точка к записи
+	uint8_t  req_ready;			// 1 = req заполнен (ISR не трогает req, пока 1)
+	uint16_t quiet;				// нотных тиков с последней точки (ISR)
+
+	uint8_t  rec[RESUME_RECORD_LEN];	// записываемая запись (loop)
+	uint8_t  wr;				// следующий байт rec (RESUME_RECORD_LEN = не пишем)
+	uint8_t  slot;				// слот кольца для следующей записи
+	uint8_t  seq;				// seq следующей записи
+	uint8_t  slots;				// слотов в кольце
+	uint16_t base;				// адрес кольца в EEPROM
+} ResumeState;
+
+//---------------------------------------------------------------------//
+// Адрес байта k слота slot
+//---------------------------------------------------------------------//
+static inline uint8_t *Resume_addr(volatile ResumeState &st, const uint8_t slot, const uint8_t k) {
+	return reinterpret_cast<uint8_t*>(st.base + static_cast<uint16_t>(slot) * RESUME_RECORD_LEN + k);
+}
+
+//---------------------------------------------------------------------//
+// Контрольный байт записи
+//---------------------------------------------------------------------//
+static inline uint8_t Resume_check(const uint8_t *rec)
+{
+	uint8_t c = RESUME_CHECK_SALT;
+	for (uint8_t k = 0; k < RESUME_DATA_LEN; k++) {
+		c ^= rec[k];
+	}
+	return c;
+}
+
+//---------------------------------------------------------------------//
+// Старт: найти последнюю запись кольца и подготовить следующий слот.
+// @param base Адрес кольца (до конца EEPROM).
+// @return true — в out последняя целая контрольная точка.
+//---------------------------------------------------------------------//
+static inline bool Resume_begin(volatile ResumeState &st, const uint16_t base, ResumePoint &out)
+{
+	st.base      = base;
+	st.slots     = static_cast<uint8_t>((static_cast<uint16_t>(E2END) + 1u - base) / RESUME_RECORD_LEN);
+	st.wr        = RESUME_RECORD_LEN;
+	st.req_ready = 0;
+	st.quiet     = 0;
+
+	// последняя = та, за которой seq не +1
+	const uint8_t n = st.slots;
+	uint8_t last = static_cast<uint8_t>(n - 1);
+	uint8_t seq  = eeprom_read_byte(Resume_addr(st, 0, RESUME_RECORD_LEN - 1));
+
+	for (uint8_t i = 0; i + 1 < n; i++) {
+		const uint8_t s = eeprom_read_byte(Resume_addr(st, static_cast<uint8_t>(i + 1), RESUME_RECORD_LEN - 1));
+		if (s != static_cast<uint8_t>(seq + 1)) {
+			last = i;
+			break;
+		}
+		seq = s;
+	}
+
+	uint8_t rec[RESUME_RECORD_LEN];
+	for (uint8_t k = 0; k < RESUME_RECORD_LEN; k++) {
+		rec[k] = eeprom_read_byte(Resume_addr(st, last, k));
+	}
+
+	if (rec[RESUME_DATA_LEN] != Resume_check(rec)) {
+		// чистая EEPROM или мусор — кольцо с начала
+		st.slot = 0;
+		st.seq  = 0;
+		return false;
+	}
+
+	st.slot = static_cast<uint8_t>((last + 1 == n) ? 0 : last + 1);
+	st.seq  = static_cast<uint8_t>(rec[RESUME_RECORD_LEN - 1] + 1);
+
+	out.song         = rec[0];
+	out.pos          = static_cast<uint16_t>(rec[1] | (static_cast<uint16_t>(rec[2]) << 8));
+	out.ticks_per_16 = rec[3];
+	out.transpose    = static_cast<int8_t>(rec[4]);
+	out.fx           = rec[5];
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// ISR, нотный тик: счётчик троттлинга (насыщается)
+//---------------------------------------------------------------------//
+static inline void Resume_tick(volatile ResumeState &st) {
+	if (st.quiet < RESUME_MIN_NOTE_TICKS) {
+		st.quiet++;
+	}
+}
+
+//---------------------------------------------------------------------//
+// ISR, начало события на сильной доле: отдать точку в loop (если пора)
+//---------------------------------------------------------------------//
+static inline void Resume_onEvent(volatile ResumeState &st,
+								  const uint8_t song,
+								  const uint16_t pos,
+								  const uint8_t ticksPer16,
+								  const int8_t transpose,
+								  const uint8_t fx)
+{
+	if (st.req_ready || st.quiet < RESUME_MIN_NOTE_TICKS) {
+		return;
+	}
+
+	st.req.song         = song;
+	st.req.pos          = pos;
+	st.req.ticks_per_16 = ticksPer16;
+	st.req.transpose    = transpose;
+	st.req.fx           = fx;
+	st.quiet            = 0;
+	st.req_ready        = 1;
+}
+
+//---------------------------------------------------------------------//
+// loop(): записать не больше одного байта, если EEPROM свободна
+//---------------------------------------------------------------------//
+static inline void Resume_poll(volatile ResumeState &st)
+{
+	if (!eeprom_is_ready()) {
+		return;
+	}
+
+	// новая точка от ISR -> собрать запись
+	if (st.wr == RESUME_RECORD_LEN) {
+		if (!st.req_ready) {
+			return;
+		}
+
+		uint8_t rec[RESUME_RECORD_LEN];
+		rec[0] = st.req.song;
+		rec[1] = static_cast<uint8_t>(st.req.pos);
+		rec[2] = static_cast<uint8_t>(st.req.pos >> 8);
+		rec[3] = st.req.ticks_per_16;
+		rec[4] = static_cast<uint8_t>(st.req.transpose);
+		rec[5] = st.req.fx;
+		rec[RESUME_DATA_LEN]       = Resume_check(rec);
+		rec[RESUME_RECORD_LEN - 1] = st.seq;
+		st.req_ready = 0;
+
+		for (uint8_t k = 0; k < RESUME_RECORD_LEN; k++) {
+			st.rec[k] = rec[k];
+		}
+		st.wr = 0;
+	}
+
+	// байт за вызов; seq — последним.
+	// cli(): аудио-ISR может читать EEPROM (песня из слота Upload.h) — EEAR общий
+	const uint8_t k = st.wr;
+	const uint8_t sreg = SREG;
+	cli();
+	eeprom_update_byte(Resume_addr(st, st.slot, k), st.rec[k]);
+	SREG = sreg;
+	st.wr = static_cast<uint8_t>(k + 1);
+
+	if (st.wr == RESUME_RECORD_LEN) {
+		st.slot = static_cast<uint8_t>((st.slot + 1 == st.slots) ? 0 : st.slot + 1);
+		st.seq++;
+	}
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+/**
+ * @file Sampler.h
+ * Второй голос шкатулки: проигрывание коротких PCM-клипов (щипок язычка, колокольчик, "дзынь").
+ *
+ * Клипы лежат в PROGMEM как 4-bit DPCM:
+ *  - 1 байт = 2 сэмпла (сначала младший полубайт, потом старший)
+ *  - полубайт = индекс в sampler_dpcm_steps[] (приращение к предыдущему значению)
+ *  - значение — int8_t (-128..127), в начале клипа 0
+ *
+ * Итого 4 бита на сэмпл вместо 8 (2x к сырому PCM) и ещё ~3 раза за счёт
+ * пониженной частоты клипа (7994 Гц) — клипы помещаются рядом с песнями.
+ *
+ * Частота клипа одна для обоих источников аудио-тика (клипы кодируются один раз):
+ *  - Timer1 (23983 Гц): сэмпл клипа на каждые 3 аудио-тика
+ *  - Timer0 (21484 Гц, PLAYER_AUDIO_CLOCK_TIMER0): на каждые 43/16 = 2.6875 аудио-тика —
+ *    дробный делитель (16 сэмплов клипа на 43 тика, как у Брезенхэма), частота та же до герца
+ *
+ * Декодер рассчитан на работу прямо в ISR рядом с DDS:
+ *  - один pgm_read_byte + одно сложение + насыщение на каждый декодированный сэмпл
+ *  - на "промежуточных" аудио-тиках просто отдаём последнее значение
+ *
+ * Запуск клипа — командой песни SMPL, val = индекс клипа (см. Music.h).
+ *
+ * Клипы генерируются утилитой wav2dpcm/wav2dpcm.py (из WAV или встроенного синтеза).
+ * Таблица шагов ниже ОБЯЗАНА совпадать с _STEPS в wav2dpcm.py.
+ */
+
+// Аудио-тиков на сэмпл клипа = SAMPLER_RATE_NUM / SAMPLER_RATE_DEN (частота клипа F_CPU / 2064 ~ 7994 Гц)
+#if defined(PLAYER_AUDIO_CLOCK_TIMER0) && PLAYER_AUDIO_CLOCK_TIMER0
+	#define SAMPLER_RATE_NUM	43		// 768 * 43 / 16 = 2064 такта
+	#define SAMPLER_RATE_DEN	16
+#else
+	#define SAMPLER_RATE_NUM	3		// 688 * 3 = 2064 такта
+	#define SAMPLER_RATE_DEN	1
+#endif
+
+#if (SAMPLER_RATE_NUM < SAMPLER_RATE_DEN) || (SAMPLER_RATE_NUM + SAMPLER_RATE_DEN > 255)
+	#error "Sampler: SAMPLER_RATE_NUM / SAMPLER_RATE_DEN must be >= 1 and fit div_cnt"
+#endif
+
+// Ослабление клипа при смешивании с DDS (>> N), чтобы сумма реже упиралась в 0/255
+#define SAMPLER_MIX_SHIFT		1
+
+//=====================================================================//
+// Метаданные клипа (указатель + длина), как SongInfo в Songs.h
+//=====================================================================//
+typedef struct {
+	const uint8_t *data;
+	uint16_t len;		// длина в байтах (сэмплов = len * 2)
+} SampleInfo;
+
+/** Макрос для записи клипа в таблицу samples[]. */
+#define SAMPLE_ENTRY(x) { x, (uint16_t)sizeof(x) }
+
+//=====================================================================//
+// Состояние голоса (один клип за раз, новый SMPL перезапускает)
+//=====================================================================//
+typedef struct {
+	const uint8_t *data;	// текущий байт клипа (PROGMEM)
+	uint16_t left;			// сколько сэмплов (полубайтов) осталось
+	int8_t   value;			// текущее декодированное значение
+	uint8_t  hi;			// 0 = следующий младший полубайт, 1 = старший
+	uint8_t  div_cnt;		// дробный делитель до следующего сэмпла клипа (в 1/SAMPLER_RATE_DEN тика)
+} SamplerVoice;
+
+//=====================================================================//
+// Таблицы (PROGMEM)
+//=====================================================================//
+
+// приращения DPCM (нелинейные: мелкие шаги для тихих участков, крупные для атаки)
+const int8_t sampler_dpcm_steps[16] PROGMEM = {
+	-110, -72, -40, -22, -12, -6, -3, -1, 0, 1, 3, 6, 12, 22, 40, 72
+};
+
+// клипы — см. wav2dpcm/wav2dpcm.py --synth tine|bell|chime
+// щипок язычка (tine): 256 сэмплов @ 7994 Гц (~32 мс), 128 байт
+const uint8_t smp_tine[] PROGMEM =
+{
+	0xF3, 0xF2, 0x10, 0x6F, 0xFE, 0x82, 0x11, 0xCF, 0xFE, 0x31, 0x13, 0xEF, 0xFB, 0x21, 0x24, 0xFE,
+	0xE4, 0x12, 0x3A, 0xFE, 0xA4, 0x12, 0xCD, 0xFD, 0x43, 0x13, 0xED, 0xEC, 0x26, 0x24, 0xEC, 0xEC,
+	0x23, 0x34, 0xEC, 0xCD, 0x23, 0x54, 0xEC, 0x5D, 0x23, 0xC5, 0xEC, 0x3C, 0x24, 0xD6, 0xDD, 0x3B,
+	0x33, 0xE6, 0xDB, 0x26, 0x44, 0xEA, 0xBC, 0x26, 0x64, 0xEC, 0x6B, 0x24, 0xB6, 0xEC, 0x4A, 0x34,
+	0xC4, 0xDC, 0x3C, 0x34, 0xD6, 0xDC, 0x36, 0x44, 0xD6, 0xAD, 0x36, 0x93, 0xDB, 0xAC, 0x35, 0x94,
+	0xDC, 0x6B, 0x34, 0xB5, 0xDC, 0x4B, 0x44, 0xC4, 0xCC, 0x4B, 0x44, 0xC7, 0xCC, 0x47, 0x93, 0xCA,
+	0xBC, 0x45, 0x64, 0xCB, 0x9C, 0x45, 0xA4, 0xCC, 0x5B, 0x44, 0xB6, 0xBC, 0x5B, 0x54, 0xB6, 0xBC,
+	0x59, 0x54, 0xBA, 0x9C, 0x56, 0x65, 0xBA, 0x7B, 0x66, 0x95, 0xAA, 0x7A, 0x76, 0x97, 0x99, 0x78,
+};
+
+// колокольчик (bell): 384 сэмплов @ 7994 Гц (~48 мс), 192 байт
+const uint8_t smp_bell[] PROGMEM =
+{
+	0xF8, 0x14, 0xDE, 0x11, 0xFD, 0xC9, 0xDD, 0x26, 0x22, 0xDD, 0xC4, 0xEF, 0x21, 0xAD, 0x31, 0xFF,
+	0x43, 0x5E, 0x21, 0xD9, 0xDD, 0xDC, 0x3D, 0x31, 0xBD, 0xE2, 0xEF, 0x31, 0x3E, 0x31, 0xDF, 0xCA,
+	0x9D, 0x22, 0xB3, 0xCD, 0xEB, 0x3E, 0x41, 0x3D, 0xE2, 0xCF, 0xB2, 0x2D, 0x32, 0xED, 0xCA, 0xCD,
+	0x24, 0xA2, 0x5D, 0xE7, 0x4E, 0x52, 0x2B, 0xE2, 0xDE, 0xC5, 0x3C, 0x32, 0xD9, 0xCC, 0xDD, 0x26,
+	0xB2, 0x3B, 0xEB, 0x5E, 0x93, 0x26, 0xD2, 0xCE, 0xDB, 0x4B, 0x32, 0xC5, 0xAC, 0xED, 0x28, 0xA3,
+	0x25, 0xEC, 0x4E, 0xC5, 0x24, 0xB3, 0xCD, 0xCC, 0xAC, 0x23, 0xC5, 0x66, 0xED, 0x3B, 0xB3, 0x33,
+	0xE7, 0x6D, 0xCA, 0x35, 0x82, 0xCC, 0xCB, 0xCD, 0x23, 0xA9, 0x54, 0xED, 0x4B, 0x85, 0x33, 0xD4,
+	0xBD, 0xBC, 0x3A, 0x43, 0xB9, 0xCB, 0xDD, 0x33, 0x65, 0x53, 0xED, 0x57, 0x9A, 0x33, 0xC4, 0xCC,
+	0xCC, 0x4B, 0x33, 0x9B, 0xC6, 0xDD, 0x44, 0x55, 0x43, 0xDC, 0xBC, 0x9B, 0x34, 0x64, 0xBC, 0xDB,
+	0x4C, 0x43, 0x59, 0xC4, 0xDD, 0x55, 0x48, 0x43, 0xCC, 0xBC, 0xAC, 0x35, 0x54, 0x9B, 0xDB, 0x7C,
+	0x63, 0x46, 0xB4, 0xCD, 0x9A, 0x59, 0x43, 0xB8, 0xBC, 0xBC, 0x48, 0x93, 0x69, 0xCA, 0xAC, 0x65,
+	0x46, 0x95, 0xBC, 0xA9, 0x69, 0x55, 0xA6, 0x9A, 0xBA, 0x68, 0x85, 0x78, 0xA8, 0x99, 0x87, 0x87,
+};
+
+// "дзынь" (chime): 320 сэмплов @ 7994 Гц (~40 мс), 160 байт
+const uint8_t smp_chime[] PROGMEM =
+{
+	0xF8, 0x01, 0xFF, 0x21, 0xFF, 0x40, 0xDF, 0xE0, 0x3F, 0xF0, 0x1F, 0xF1, 0x0F, 0xF3, 0x0F, 0xF4,
+	0x0D, 0xFE, 0x03, 0xFF, 0x11, 0xFF, 0x21, 0xEF, 0xB0, 0xDF, 0xE0, 0x3F, 0xF0, 0x1F, 0xF2, 0x1E,
+	0xF2, 0x0E, 0xFC, 0x0B, 0xFE, 0x13, 0xFE, 0x21, 0xEF, 0x21, 0xEF, 0xC0, 0xAF, 0xC1, 0x3F, 0xE1,
+	0x1F, 0xF2, 0x1D, 0xF4, 0x1B, 0xF9, 0x14, 0xFD, 0x22, 0xED, 0x23, 0xDE, 0x32, 0xDE, 0x32, 0x3F,
+	0xB2, 0x4E, 0xD2, 0x2E, 0xE3, 0x2D, 0xE3, 0x2C, 0xE5, 0x27, 0xEC, 0x23, 0xED, 0x33, 0xCD, 0x33,
+	0xAE, 0x43, 0xBD, 0x83, 0x5D, 0xC3, 0x3D, 0xD4, 0x4B, 0xD4, 0x39, 0xD9, 0x36, 0xCB, 0x47, 0xCB,
+	0x54, 0xCB, 0x54, 0x9C, 0x65, 0x9B, 0x85, 0x7B, 0xA5, 0x6A, 0xA6, 0x6A, 0xA7, 0x78, 0x88, 0x88,
+	0x78, 0x99, 0x67, 0x9A, 0x67, 0xAA, 0x66, 0x9B, 0x75, 0x8B, 0x85, 0x7B, 0xA5, 0x5B, 0xB5, 0x5B,
+	0xC5, 0x49, 0xC8, 0x48, 0xC9, 0x46, 0xCB, 0x54, 0xCB, 0x54, 0xBC, 0xA3, 0xBC, 0xB3, 0x7C, 0xB4,
+	0x4C, 0xB5, 0x4C, 0xC5, 0x4A, 0xC7, 0x56, 0xB7, 0x58, 0xBA, 0x65, 0xAA, 0x66, 0x8B, 0x86, 0x89,
+};
+
+/**
+ * Таблица клипов (в PROGMEM).
+ * Порядок соответствует индексам SMP_* из Music.h (val команды SMPL).
+ */
+static const SampleInfo samples[] PROGMEM = {
+	SAMPLE_ENTRY(smp_tine),
+	SAMPLE_ENTRY(smp_bell),
+	SAMPLE_ENTRY(smp_chime),
+};
+
+/** Количество клипов в таблице samples[]. */
+#define NUM_SAMPLES (sizeof(samples) / sizeof(samples[0]))
+
+//=====================================================================//
+// Inline-методы голоса
+//=====================================================================//
+
+//---------------------------------------------------------------------//
+// Остановить клип (тишина)
+//---------------------------------------------------------------------//
+static inline void Sampler_stop(volatile SamplerVoice &v) {
+	v.left  = 0;
+	v.value = 0;
+}
+
+//---------------------------------------------------------------------//
+// Инициализация голоса (тишина)
+//---------------------------------------------------------------------//
+static inline void Sampler_begin(volatile SamplerVoice &v) {
+	v.data    = nullptr;
+	v.hi      = 0;
+	v.div_cnt = 0;
+	Sampler_stop(v);
+}
+
+//---------------------------------------------------------------------//
+// Запустить клип по индексу (неизвестный индекс — игнорируем)
+//---------------------------------------------------------------------//
+static inline void Sampler_trigger(volatile SamplerVoice &v, const uint8_t index)
+{
+	if (index >= static_cast<uint8_t>(NUM_SAMPLES)) {
+		return;
+	}
+
+	v.data    = static_cast<const uint8_t*>(pgm_read_ptr(&samples[index].data));
+	v.left    = static_cast<uint16_t>(pgm_read_word(&samples[index].len) << 1);
+	v.value   = 0;
+	v.hi      = 0;
+	v.div_cnt = 0;
+}
+
+//---------------------------------------------------------------------//
+// Сгенерировать один аудио-сэмпл клипа (-128..127), 0 если клип не играет
+//---------------------------------------------------------------------//
+static inline int8_t Sampler_renderSample(volatile SamplerVoice &v)
+{
+	if (v.left == 0) return 0;
+
+	// между сэмплами клипа держим последнее значение
+	const uint8_t div = v.div_cnt;
+	if (div >= SAMPLER_RATE_DEN) {
+		v.div_cnt = static_cast<uint8_t>(div - SAMPLER_RATE_DEN);
+		return v.value;
+	}
+	v.div_cnt = static_cast<uint8_t>(div + (SAMPLER_RATE_NUM - SAMPLER_RATE_DEN));
+
+	const uint8_t *p = v.data;
+	uint8_t code = pgm_read_byte(p);
+
+	if (v.hi) {
+		code >>= 4;
+		v.data = p + 1;
+	}
+	v.hi ^= 1;
+
+	auto s = static_cast<int16_t>(
+		static_cast<int16_t>(v.value) +
+		static_cast<int8_t>(pgm_read_byte(&sampler_dpcm_steps[code & 0x0F]))
+	);
+
+	if (s < -128) s = -128;
+	if (s > 127) s = 127;
+
+	v.left--;
+	v.value = static_cast<int8_t>(v.left != 0 ? s : 0);
+
+	return v.value;
+}
+
+//---------------------------------------------------------------------//
+// Смешать DDS-сэмпл (0..255) с сэмплом клипа, с насыщением
+//---------------------------------------------------------------------//
+static inline uint8_t Sampler_mix(const uint8_t dds, const int8_t smp)
+{
+	const auto out = static_cast<int16_t>(
+		static_cast<int16_t>(dds) + static_cast<int16_t>(smp >> SAMPLER_MIX_SHIFT)
+	);
+
+	if (out < 0) return 0;
+	if (out > 255) return 255;
+
+	return static_cast<uint8_t>(out);
+}
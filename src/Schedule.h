@@ -0,0 +1,242 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+/**
+ * @file Schedule.h
+ * Игра по расписанию (часы с боем): будильник RTC, между песнями — power-down.
+ *
+ * Проблема:
+ *  - шкатулка, которая играет раз в час, остальное время тратит ~10 мА на ожидание
+ *  - TinyRTClib (RTC_DS1307) будильника не умеет, а шину ждёт циклом (TinyWireM)
+ *
+ * RTC: DS3231 (регистры времени — как у DS1307 из TinyRTClib, адрес 0x68) + будильник 2:
+ *  - срабатывает, когда совпали часы и минуты (секунды = 00), INT/SQW опускается в 0
+ *    и держится, пока не сброшен флаг A2F — провод на SCHEDULE_INT_PIN (PCINT, подтяжка)
+ *  - выход 32 кГц выключается (меньше ток RTC)
+ *  - шина — Twi.h (Twi_run() с cli(): RTC трогаем только в тишине — до и после песни)
+ *
+ * Цикл:
+ *  - старт (Schedule_begin()): время -> будильник на ближайшую строку расписания
+ *  - песня доиграла -> Player::powerDown(): таймеры стоят, выходы в 0, АЦП/компаратор
+ *    выключены, BOD — на время сна; ток — единицы мкА (без светодиода питания Digispark)
+ *  - INT RTC -> PCINT будит -> Schedule_service(): песня этого будильника, следующий будильник
+ *
+ * Расписание — строки {час с, час по, минута, песня}: "в минуту m каждого часа с..по".
+ * Песня SCHEDULE_SONG_NEXT — следующая по кругу. Своё расписание — макрос SCHEDULE_TABLE
+ * со строками через запятую (до подключения Player.h).
+ *
+ * Выбор будильника (Schedule_next()) не трогает железо.
+ * Проверка на хосте: tests/ScheduleTest.cpp (DS3231 на модели шины, будильники через смену суток, сон).
+ *
+ * Включается PLAYER_SCHEDULE=1 (CMake: -DMUSICBOX_SCHEDULE=ON, включает MUSICBOX_TWI).
+ */
+
+#ifndef PLAYER_SCHEDULE
+	#define PLAYER_SCHEDULE			0
+#endif
+
+#include "Twi.h"		// шина (PLAYER_TWI включается сам)
+
+// Пин INT/SQW от RTC (PORTB)
+#ifndef SCHEDULE_INT_PIN
+	#define SCHEDULE_INT_PIN		PB3
+#endif
+
+// Адрес DS3231 на шине
+#define SCHEDULE_RTC_ADDR			0x68
+
+// Регистры DS3231
+#define SCHEDULE_REG_MINUTES		0x01
+#define SCHEDULE_REG_ALARM2			0x0B	// минуты, часы, день
+#define SCHEDULE_CTRL				0x06	// INTCN | A2IE: INT вместо меандра, будильник 2
+#define SCHEDULE_ALARM_ANY_DAY		0x80	// A2M4: день не сравнивать
+
+// Песня "следующая по кругу"
+#define SCHEDULE_SONG_NEXT			0xFF
+
+#define SCHEDULE_MINUTES_PER_DAY	1440u
+
+//=====================================================================//
+// Расписание
+//=====================================================================//
+typedef struct {
+	uint8_t hour_from;				// первый час (0..23)
+	uint8_t hour_to;				// последний час (включительно, >= hour_from)
+	uint8_t minute;					// минута часа (0..59)
+	uint8_t song;					// индекс песни или SCHEDULE_SONG_NEXT
+} ScheduleEntry;
+
+// По умолчанию: каждый час в :00 с 8 до 21 — следующая песня
+#ifndef SCHEDULE_TABLE
+	#define SCHEDULE_TABLE			{ 8, 21, 0, SCHEDULE_SONG_NEXT }
+#endif
+
+static const ScheduleEntry schedule_table[] PROGMEM = { SCHEDULE_TABLE };
+
+#define SCHEDULE_COUNT				(sizeof(schedule_table) / sizeof(schedule_table[0]))
+
+//=====================================================================//
+// Состояние
+//=====================================================================//
+typedef struct {
+	uint8_t  ok;					// RTC ответил, будильник заведён
+	uint8_t  alarm;					// ISR: INT RTC опустился
+	uint8_t  song;					// песня заведённого будильника
+	uint8_t  tx[6];					// регистр + данные
+	uint8_t  rx[2];					// минуты, часы
+	TwiXfer  xfer;
+} ScheduleState;
+
+//---------------------------------------------------------------------//
+// BCD <-> двоичное
+//---------------------------------------------------------------------//
+static inline uint8_t Schedule_fromBcd(const uint8_t v) {
+	return static_cast<uint8_t>((v >> 4) * 10 + (v & 0x0F));
+}
+
+static inline uint8_t Schedule_toBcd(const uint8_t v) {
+	return static_cast<uint8_t>(((v / 10) << 4) | (v % 10));
+}
+
+//---------------------------------------------------------------------//
+// Регистр часов DS3231 (24 ч или 12 ч + AM/PM) -> 0..23
+//---------------------------------------------------------------------//
+static inline uint8_t Schedule_hour(const uint8_t reg)
+{
+	if (!(reg & 0x40)) {
+		return Schedule_fromBcd(reg & 0x3F);
+	}
+	const auto h12 = static_cast<uint8_t>(Schedule_fromBcd(reg & 0x1F) % 12);
+	return static_cast<uint8_t>((reg & 0x20) ? h12 + 12 : h12);
+}
+
+//---------------------------------------------------------------------//
+// Ближайшая строка расписания строго после hour:minute (по кругу через полночь).
+// @param song Песня этой строки.
+// @return минута суток будильника (0..1439); SCHEDULE_MINUTES_PER_DAY — расписание пусто.
+//---------------------------------------------------------------------//
+static inline uint16_t Schedule_next(const ScheduleEntry *table, const uint8_t count,
+									 const uint8_t hour, const uint8_t minute, uint8_t &song)
+{
+	const auto now = static_cast<uint16_t>(hour * 60u + minute);
+	uint16_t best = SCHEDULE_MINUTES_PER_DAY + 1;	// минут до будильника
+	uint16_t at   = SCHEDULE_MINUTES_PER_DAY;
+
+	for (uint8_t i = 0; i < count; i++) {
+		const uint8_t from = pgm_read_byte(&table[i].hour_from);
+		const uint8_t to   = pgm_read_byte(&table[i].hour_to);
+		const uint8_t m    = pgm_read_byte(&table[i].minute);
+
+		for (uint8_t h = from; h <= to && h < 24; h++) {
+			const auto t = static_cast<uint16_t>(h * 60u + m);
+			auto delta = static_cast<uint16_t>((t + SCHEDULE_MINUTES_PER_DAY - now) % SCHEDULE_MINUTES_PER_DAY);
+			if (delta == 0) {
+				delta = SCHEDULE_MINUTES_PER_DAY;	// сейчас — это уже завтра
+			}
+			if (delta < best) {
+				best = delta;
+				at   = t;
+				song = pgm_read_byte(&table[i].song);
+			}
+		}
+	}
+
+	return at;
+}
+
+//---------------------------------------------------------------------//
+// Время RTC (часы, минуты). Только при запрещённых прерываниях (Twi_run()).
+//---------------------------------------------------------------------//
+static inline bool Schedule_readTime(volatile ScheduleState &st, volatile TwiState &twi,
+									 uint8_t &hour, uint8_t &minute)
+{
+	st.tx[0]       = SCHEDULE_REG_MINUTES;
+	st.xfer.addr   = SCHEDULE_RTC_ADDR;
+	st.xfer.tx     = st.tx;
+	st.xfer.tx_len = 1;
+	st.xfer.rx     = st.rx;
+	st.xfer.rx_len = 2;
+	if (Twi_run(twi, st.xfer) != TWI_ST_OK) {
+		return false;
+	}
+
+	minute = Schedule_fromBcd(st.rx[0] & 0x7F);
+	hour   = Schedule_hour(st.rx[1]);
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// Завести будильник на ближайшую строку после текущего времени,
+// сбросить флаги (INT отпускается) и выключить выход 32 кГц.
+//---------------------------------------------------------------------//
+static inline bool Schedule_arm(volatile ScheduleState &st, volatile TwiState &twi)
+{
+	uint8_t hour;
+	uint8_t minute;
+	if (!Schedule_readTime(st, twi, hour, minute)) {
+		return false;
+	}
+
+	uint8_t song = 0;
+	const uint16_t at = Schedule_next(schedule_table, static_cast<uint8_t>(SCHEDULE_COUNT), hour, minute, song);
+	if (at >= SCHEDULE_MINUTES_PER_DAY) {
+		return false;
+	}
+	st.song = song;
+
+	// 0x0B минуты, 0x0C часы, 0x0D день (любой), 0x0E управление, 0x0F статус (= 0)
+	st.tx[0]       = SCHEDULE_REG_ALARM2;
+	st.tx[1]       = Schedule_toBcd(static_cast<uint8_t>(at % 60));
+	st.tx[2]       = Schedule_toBcd(static_cast<uint8_t>(at / 60));
+	st.tx[3]       = SCHEDULE_ALARM_ANY_DAY;
+	st.tx[4]       = SCHEDULE_CTRL;
+	st.tx[5]       = 0;
+	st.xfer.addr   = SCHEDULE_RTC_ADDR;
+	st.xfer.tx     = st.tx;
+	st.xfer.tx_len = 6;
+	st.xfer.rx_len = 0;
+
+	return Twi_run(twi, st.xfer) == TWI_ST_OK;
+}
+
+//---------------------------------------------------------------------//
+// Инициализация (шина уже в Twi_begin(), прерывания запрещены):
+// пин INT с подтяжкой + PCINT, первый будильник.
+// @return true — RTC есть, будильник заведён.
+//---------------------------------------------------------------------//
+static inline bool Schedule_begin(volatile ScheduleState &st, volatile TwiState &twi)
+{
+	DDRB  &= static_cast<uint8_t>(~_BV(SCHEDULE_INT_PIN));
+	PORTB |= _BV(SCHEDULE_INT_PIN);
+	PCMSK |= _BV(SCHEDULE_INT_PIN);
+	GIMSK |= _BV(PCIE);
+
+	st.alarm = 0;
+	st.ok    = Schedule_arm(st, twi) ? 1 : 0;
+	return st.ok != 0;
+}
+
+//---------------------------------------------------------------------//
+// ISR(PCINT0_vect): INT RTC в 0 — будильник
+//---------------------------------------------------------------------//
+static inline void Schedule_onEdge(volatile ScheduleState &st)
+{
+	if (!(PINB & _BV(SCHEDULE_INT_PIN))) {
+		st.alarm = 1;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Будильник сработал: его песня + следующий будильник. Только при cli() (Twi_run()).
+// @return песня (индекс или SCHEDULE_SONG_NEXT).
+//---------------------------------------------------------------------//
+static inline uint8_t Schedule_service(volatile ScheduleState &st, volatile TwiState &twi)
+{
+	const uint8_t song = st.song;
+
+	st.alarm = 0;
+	st.ok    = Schedule_arm(st, twi) ? 1 : 0;
+	return song;
+}
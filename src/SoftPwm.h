@@ -0,0 +1,200 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file SoftPwm.h
+ * Программный PWM для дополнительных гирлянд на PB2/PB3/PB4 прямо в аудио-ISR.
+ *
+ * Аппаратный PWM Timer0 есть только на PB0 (динамик) и PB1 (гирлянда), поэтому
+ * остальные каналы "дёргаем" из аудио-тика.
+ *
+ * Идея (как AVR136 / libraries/DigisparkTinySoftPwm, но дешевле на сэмпл):
+ *  - период PWM = SOFTPWM_STEPS аудио-тиков (16 -> ~1.5 кГц при 24 кГц, мерцания нет)
+ *  - TinySoftPwm_process() на каждом тике сравнивает счётчик с КАЖДЫМ каналом;
+ *    здесь вместо этого заранее строится отсортированное расписание фронтов:
+ *      [0]    pos = 0       toggle = все включённые каналы (начало периода)
+ *      [1..n] pos = уровень toggle = каналы с этим уровнем (выключение)
+ *  - на сэмпл: ОДНО сравнение счётчика с pos[next] и максимум одна запись в порт
+ *  - запись — в PINB (на ATtiny85 запись 1 в PINx переключает пин): атомарно и не
+ *    трогает чужие биты PORTB, маска выключения/включения одна и та же
+ *  - новое расписание строится в нотном тике (SoftPwm_set(), ~196 Гц) во второй буфер
+ *    и подхватывается ISR только в начале периода — в этот момент все каналы выключены
+ *
+ * Уровни: 0..SOFTPWM_STEPS-1 (= 0..LED_MAX_PWM), заполнение уровень/SOFTPWM_STEPS.
+ * Максимум 15/16 — чтобы к концу периода все каналы гарантированно были выключены.
+ *
+ * Пины (Digispark): PB3/PB4 — USB D-/D+ (после загрузчика свободны, но на PB3 стоит
+ * подтяжка 1.5 кОм, и на нём же TX отладочного Serial), PB2 — данные Pixels.h.
+ * Лишние каналы отключаются через SOFTPWM_CHANNELS.
+ *
+ * Включается PLAYER_SOFT_PWM=1 (CMake: -DMUSICBOX_SOFT_PWM=ON).
+ */
+
+#ifndef PLAYER_SOFT_PWM
+	#define PLAYER_SOFT_PWM		0
+#endif
+
+// Число каналов (1..3) и их пины (PORTB)
+#ifndef SOFTPWM_CHANNELS
+	#define SOFTPWM_CHANNELS	3
+#endif
+
+#define SOFTPWM_PIN0			PB2
+#define SOFTPWM_PIN1			PB3
+#define SOFTPWM_PIN2			PB4
+
+// Период PWM в аудио-тиках (степень двойки)
+#define SOFTPWM_STEPS			16
+
+#if (SOFTPWM_CHANNELS < 1) || (SOFTPWM_CHANNELS > 3)
+	#error "SOFTPWM_CHANNELS must be 1..3"
+#endif
+
+#if (SOFTPWM_STEPS & (SOFTPWM_STEPS - 1)) != 0
+	#error "SOFTPWM_STEPS must be a power of two"
+#endif
+
+//=====================================================================//
+// Расписание фронтов и состояние
+//=====================================================================//
+typedef struct {
+	uint8_t pos[SOFTPWM_CHANNELS + 1];		// тик фронта, по возрастанию, pos[0] = 0
+	uint8_t toggle[SOFTPWM_CHANNELS + 1];	// маска для PINB
+	uint8_t count;							// записей в расписании (>= 1)
+} SoftPwmSchedule;
+
+typedef struct {
+	SoftPwmSchedule sched[2];				// активное + следующее
+	uint8_t active;							// индекс активного расписания
+	uint8_t pending;						// следующее готово, взять в начале периода
+	uint8_t tick;							// позиция в периоде 0..SOFTPWM_STEPS-1
+	uint8_t next;							// следующая запись расписания
+	uint8_t levels[SOFTPWM_CHANNELS];		// последние уровни (чтобы не пересобирать)
+} SoftPwmState;
+
+//---------------------------------------------------------------------//
+// Маска пина канала
+//---------------------------------------------------------------------//
+static inline uint8_t SoftPwm_pinMask(const uint8_t ch) {
+	return (ch == 0) ? _BV(SOFTPWM_PIN0) : ((ch == 1) ? _BV(SOFTPWM_PIN1) : _BV(SOFTPWM_PIN2));
+}
+
+//---------------------------------------------------------------------//
+// Инициализация: пины на выход в 0, пустое расписание
+//---------------------------------------------------------------------//
+static inline void SoftPwm_begin(volatile SoftPwmState &sp)
+{
+	uint8_t mask = 0;
+	for (uint8_t ch = 0; ch < SOFTPWM_CHANNELS; ch++) {
+		mask |= SoftPwm_pinMask(ch);
+		sp.levels[ch] = 0;
+	}
+
+	PORTB &= static_cast<uint8_t>(~mask);
+	DDRB  |= mask;
+
+	for (uint8_t b = 0; b < 2; b++) {
+		sp.sched[b].pos[0]    = 0;
+		sp.sched[b].toggle[0] = 0;
+		sp.sched[b].count     = 1;
+	}
+
+	sp.active  = 0;
+	sp.pending = 0;
+	sp.tick    = 0;
+	sp.next    = 0;
+}
+
+//---------------------------------------------------------------------//
+// Новые уровни каналов (0..SOFTPWM_STEPS-1). Вызывать из нотного тика
+// (тот же ISR, что и SoftPwm_tick(), поэтому гонок нет).
+//---------------------------------------------------------------------//
+static inline void SoftPwm_set(volatile SoftPwmState &sp, const uint8_t *levels)
+{
+	uint8_t changed = 0;
+	for (uint8_t ch = 0; ch < SOFTPWM_CHANNELS; ch++) {
+		changed |= static_cast<uint8_t>(levels[ch] ^ sp.levels[ch]);
+	}
+	if (!changed) {
+		return;
+	}
+
+	uint8_t pos[SOFTPWM_CHANNELS];
+	uint8_t tog[SOFTPWM_CHANNELS];
+	uint8_t n  = 0;
+	uint8_t on = 0;
+
+	for (uint8_t ch = 0; ch < SOFTPWM_CHANNELS; ch++) {
+		uint8_t lvl = levels[ch];
+		sp.levels[ch] = lvl;
+
+		if (lvl == 0) {
+			continue;
+		}
+		if (lvl > SOFTPWM_STEPS - 1) {
+			lvl = SOFTPWM_STEPS - 1;
+		}
+
+		const uint8_t m = SoftPwm_pinMask(ch);
+		on |= m;
+
+		// тот же уровень уже есть — один фронт на несколько каналов
+		uint8_t j = 0;
+		while (j < n && pos[j] != lvl) {
+			j++;
+		}
+		if (j < n) {
+			tog[j] |= m;
+			continue;
+		}
+
+		// вставка с сохранением порядка
+		j = n;
+		while (j > 0 && pos[j - 1] > lvl) {
+			pos[j] = pos[j - 1];
+			tog[j] = tog[j - 1];
+			j--;
+		}
+		pos[j] = lvl;
+		tog[j] = m;
+		n++;
+	}
+
+	volatile SoftPwmSchedule &s = sp.sched[sp.active ^ 1];
+	s.pos[0]    = 0;
+	s.toggle[0] = on;
+	for (uint8_t i = 0; i < n; i++) {
+		s.pos[i + 1]    = pos[i];
+		s.toggle[i + 1] = tog[i];
+	}
+	s.count = static_cast<uint8_t>(n + 1);
+
+	sp.pending = 1;
+}
+
+//---------------------------------------------------------------------//
+// Аудио-тик: одно сравнение, максимум одна запись в PINB
+//---------------------------------------------------------------------//
+static inline void SoftPwm_tick(volatile SoftPwmState &sp)
+{
+	const uint8_t t = sp.tick;
+	sp.tick = static_cast<uint8_t>((t + 1) & (SOFTPWM_STEPS - 1));
+
+	uint8_t i = sp.next;
+	if (t != sp.sched[sp.active].pos[i]) {
+		return;
+	}
+
+	// начало периода: все каналы выключены — можно сменить расписание
+	if (i == 0 && sp.pending) {
+		sp.active ^= 1;
+		sp.pending = 0;
+	}
+
+	volatile SoftPwmSchedule &s = sp.sched[sp.active];
+	PINB = s.toggle[i];
+
+	i++;
+	sp.next = (i == s.count) ? 0 : i;
+}
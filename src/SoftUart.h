@@ -0,0 +1,139 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file SoftUart.h
+ * Программный UART (только TX) прямо в аудио-ISR: отладка и телеметрия без пропуска сэмплов.
+ *
+ * Проблема:
+ *  - TinyDebugSerial (cores/tiny) и DigisparkSoftSerial выдают байт циклом с cli():
+ *    ~1 мс на байт при 9600 — это десятки пропущенных аудио-тиков на каждый Serial.print()
+ *
+ * Идея (как линия Sync.h):
+ *  - бит = bit_ticks аудио-тиков, фронты ровно по аудио-тику — дрожания нет,
+ *    ошибка скорости только от округления bit_ticks (Player.h проверяет <= 2%)
+ *  - на сэмпл: декремент счётчика; на границе бита — одна запись в PORTB
+ *  - loop() кладёт байты в кольцевой буфер (SoftUart_write()), ISR забирает по одному,
+ *    индексы однобайтные (один писатель, один читатель) — cli() не нужен
+ *
+ * Скорость (SOFT_UART_BAUD) делит реальную частоту аудио-тика:
+ *  - Timer1 (~23983 Гц): 2400 (10 тиков) и 4800 (5 тиков)
+ *  - Timer0 (~21484 Гц): 2400 (9 тиков, -0.5%)
+ *
+ * Пин: PB3 (как TX у TinyDebugSerial). Формат 8N1, младший бит первым.
+ *
+ * Проверка на хосте: tests/SoftUartTest.cpp (приёмник 8N1 на фронтах пина; 2400/4800 бод, Timer0-аудио).
+ *
+ * Включается PLAYER_SOFT_UART=1 (CMake: -DMUSICBOX_SOFT_UART=ON).
+ */
+
+#ifndef PLAYER_SOFT_UART
+	#define PLAYER_SOFT_UART	0
+#endif
+
+// Пин TX (PORTB)
+#ifndef SOFT_UART_PIN
+	#define SOFT_UART_PIN		PB3
+#endif
+
+// Скорость, бод
+#ifndef SOFT_UART_BAUD
+	#define SOFT_UART_BAUD		2400UL
+#endif
+
+// Буфер передачи (степень двойки)
+#ifndef SOFT_UART_BUF_LEN
+	#define SOFT_UART_BUF_LEN	32
+#endif
+
+#if (SOFT_UART_BUF_LEN & (SOFT_UART_BUF_LEN - 1)) != 0 || (SOFT_UART_BUF_LEN > 128)
+	#error "SOFT_UART_BUF_LEN must be a power of two <= 128"
+#endif
+
+//=====================================================================//
+// Состояние передатчика
+//=====================================================================//
+typedef struct {
+	uint8_t buf[SOFT_UART_BUF_LEN];	// кольцевой буфер
+	uint8_t head;					// следующий байт к передаче (ISR)
+	uint8_t tail;					// куда писать (loop)
+	uint8_t shift;					// сдвиговый регистр байта
+	uint8_t bit;					// 0 = покой, 1..8 = данные, 9 = стоп
+	uint8_t div;					// аудио-тиков до следующего бита
+	uint8_t bit_ticks;				// аудио-тиков на бит
+} SoftUartState;
+
+//---------------------------------------------------------------------//
+// Инициализация: пин на выход в 1 (покой)
+// @param bitTicks Аудио-тиков на бит (Player.h: SOFT_UART_BIT_TICKS).
+//---------------------------------------------------------------------//
+static inline void SoftUart_begin(volatile SoftUartState &u, const uint8_t bitTicks)
+{
+	PORTB |= _BV(SOFT_UART_PIN);
+	DDRB  |= _BV(SOFT_UART_PIN);
+
+	u.head      = 0;
+	u.tail      = 0;
+	u.bit       = 0;
+	u.div       = bitTicks;
+	u.bit_ticks = bitTicks;
+}
+
+//---------------------------------------------------------------------//
+// loop(): положить байт в буфер.
+// @return false — буфер полон (байт не принят).
+//---------------------------------------------------------------------//
+static inline bool SoftUart_write(volatile SoftUartState &u, const uint8_t b)
+{
+	const uint8_t t = u.tail;
+	const auto next = static_cast<uint8_t>((t + 1) & (SOFT_UART_BUF_LEN - 1));
+	if (next == u.head) {
+		return false;
+	}
+
+	u.buf[t] = b;
+	u.tail   = next;
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// Аудио-тик: один бит раз в bit_ticks тиков
+//---------------------------------------------------------------------//
+static inline void SoftUart_tick(volatile SoftUartState &u)
+{
+	if (--u.div != 0) {
+		return;
+	}
+	u.div = u.bit_ticks;
+
+	const uint8_t bit = u.bit;
+
+	if (bit == 0) {
+		// покой: есть байт — старт-бит
+		const uint8_t h = u.head;
+		if (h == u.tail) {
+			return;
+		}
+		u.shift = u.buf[h];
+		u.head  = static_cast<uint8_t>((h + 1) & (SOFT_UART_BUF_LEN - 1));
+		PORTB  &= static_cast<uint8_t>(~_BV(SOFT_UART_PIN));
+		u.bit   = 1;
+		return;
+	}
+
+	if (bit <= 8) {
+		const uint8_t v = u.shift;
+		if (v & 1) {
+			PORTB |= _BV(SOFT_UART_PIN);
+		} else {
+			PORTB &= static_cast<uint8_t>(~_BV(SOFT_UART_PIN));
+		}
+		u.shift = static_cast<uint8_t>(v >> 1);
+		u.bit   = static_cast<uint8_t>(bit + 1);
+		return;
+	}
+
+	PORTB |= _BV(SOFT_UART_PIN);		// стоп
+	u.bit  = 0;
+}
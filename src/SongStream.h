@@ -0,0 +1,213 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/**
+ * @file SongStream.h
+ * Песни из внешней I2C EEPROM 24LCxx (PLAYER_SONG_SOURCE_I2C) вместо PROGMEM.
+ *
+ * Проблема:
+ *  - песни в PROGMEM делят ~6 КБ flash (после micronucleus) с кодом, а 24LC256 — это 32 КБ
+ *
+ * Идея:
+ *  - ISR по-прежнему читает байт по "курсору" (адрес в EEPROM) без ожидания шины:
+ *    байты берутся из двух блоков SRAM по SONG_STREAM_BLOCK байт (чтение с опережением)
+ *  - блок = адрес >> 4, слот = блок & 1: курсор стоит в одном слоте, в другом уже
+ *    лежит следующий блок; ISR только отмечает нужный блок (want)
+ *  - loop() (SongStream_poll()) ставит чтение блока want, затем want+1 в очередь Twi.h
+ *    и сразу возвращается; блок готов — слот помечается его номером
+ *  - нет блока (переход по песне, отстал loop) — ISR получает false и ждёт нотный тик
+ *  - каталог читается при старте, до sei() (Twi_run())
+ *  - проверка на хосте: tests/SongStreamTest.cpp (модель USI + 24LCxx, опоздавший loop(), растяжение SCL)
+ *
+ * Образ EEPROM (midi2code/songimage.py):
+ *  - [0] 'M' [1] 'B' [2] число песен [3] 0
+ *  - [4 + 4*i] адрес песни i (lo, hi), длина (lo, hi) — адрес чётный (пара не рвётся блоком)
+ *  - дальше — потоки песен в том же формате, что и массивы Songs.h
+ *
+ * Пины: USI — SDA = PB0, SCL = PB2 (+ подтяжки 4.7 кОм). PB0 — это динамик (OC0A),
+ * поэтому в этом режиме динамик переезжает на PB4 (PLAYER_SPEAKER_OC1B, см. Player.h).
+ *
+ * Включается PLAYER_SONG_SOURCE_I2C=1 (CMake: -DMUSICBOX_SONG_SOURCE_I2C=ON).
+ */
+
+#ifndef PLAYER_SONG_SOURCE_I2C
+	#define PLAYER_SONG_SOURCE_I2C	0
+#endif
+
+// I2C адрес EEPROM (A2..A0 = 0)
+#ifndef SONG_STREAM_I2C_ADDR
+	#define SONG_STREAM_I2C_ADDR	0x50
+#endif
+
+// Максимум песен в каталоге (каталог держим в SRAM: 4 байта на песню)
+#ifndef SONG_STREAM_MAX_SONGS
+	#define SONG_STREAM_MAX_SONGS	8
+#endif
+
+// Размер блока чтения (степень двойки; ~20 байт на шине — ~15 мс при SCL ~11 кГц)
+#define SONG_STREAM_BLOCK		16
+#define SONG_STREAM_SHIFT		4
+
+#define SONG_STREAM_NO_BLOCK	0xFFFFu
+
+// Попыток чтения каталога при старте (EEPROM может ещё дописывать страницу)
+#define SONG_STREAM_BEGIN_TRIES	4
+
+#if (1 << SONG_STREAM_SHIFT) != SONG_STREAM_BLOCK
+	#error "SONG_STREAM_BLOCK must be 1 << SONG_STREAM_SHIFT"
+#endif
+
+#include "Twi.h"		// шина (PLAYER_TWI включается сам)
+
+//=====================================================================//
+// Состояние потока
+//=====================================================================//
+typedef struct {
+	uint8_t  buf[2][SONG_STREAM_BLOCK];		// два блока с опережением
+	uint16_t tag[2];						// номер блока в слоте (SONG_STREAM_NO_BLOCK — пусто)
+	uint16_t want;							// блок курсора (пишет ISR)
+	uint8_t  count;							// песен в каталоге
+	uint16_t addr[SONG_STREAM_MAX_SONGS];	// каталог: адрес песни
+	uint16_t len[SONG_STREAM_MAX_SONGS];	// каталог: длина песни
+
+	TwiXfer  xfer;							// чтение блока (loop)
+	uint8_t  mem[2];						// адрес в EEPROM (hi, lo) для xfer
+	uint16_t loading;						// блок на шине (SONG_STREAM_NO_BLOCK — нет)
+} SongStream;
+
+//---------------------------------------------------------------------//
+// Подготовить чтение n байт EEPROM с адреса addr: [hi][lo], повторный START, n байт
+//---------------------------------------------------------------------//
+static inline void SongStream_setup(volatile TwiXfer &x, volatile uint8_t *mem,
+									const uint16_t addr, volatile uint8_t *dst, const uint8_t n)
+{
+	mem[0]   = static_cast<uint8_t>(addr >> 8);
+	mem[1]   = static_cast<uint8_t>(addr);
+	x.addr   = SONG_STREAM_I2C_ADDR;
+	x.tx     = mem;
+	x.tx_len = 2;
+	x.rx     = dst;
+	x.rx_len = n;
+}
+
+//---------------------------------------------------------------------//
+// Прочитать n байт с повторами — только при старте, до sei()
+//---------------------------------------------------------------------//
+static inline bool SongStream_readBoot(volatile SongStream &st, volatile TwiState &twi,
+									   const uint16_t addr, uint8_t *dst, const uint8_t n)
+{
+	for (uint8_t i = 0; i < SONG_STREAM_BEGIN_TRIES; i++) {
+		SongStream_setup(st.xfer, st.mem, addr, dst, n);
+		if (Twi_run(twi, st.xfer) == TWI_ST_OK) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------------------//
+// Инициализация: каталог песен (шина уже в Twi_begin(), прерывания запрещены).
+// @return число песен (0 — нет EEPROM или образа).
+//---------------------------------------------------------------------//
+static inline uint8_t SongStream_begin(volatile SongStream &st, volatile TwiState &twi)
+{
+	st.tag[0]  = SONG_STREAM_NO_BLOCK;
+	st.tag[1]  = SONG_STREAM_NO_BLOCK;
+	st.want    = 0;
+	st.count   = 0;
+	st.loading = SONG_STREAM_NO_BLOCK;
+
+	uint8_t hdr[4];
+	if (!SongStream_readBoot(st, twi, 0, hdr, 4) || hdr[0] != 'M' || hdr[1] != 'B') {
+		return 0;
+	}
+
+	uint8_t n = hdr[2];
+	if (n > SONG_STREAM_MAX_SONGS) {
+		n = SONG_STREAM_MAX_SONGS;
+	}
+
+	for (uint8_t i = 0; i < n; i++) {
+		uint8_t e[4];
+		if (!SongStream_readBoot(st, twi, static_cast<uint16_t>(4u + 4u * i), e, 4)) {
+			return 0;
+		}
+		st.addr[i] = static_cast<uint16_t>(e[0] | (static_cast<uint16_t>(e[1]) << 8));
+		st.len[i]  = static_cast<uint16_t>(e[2] | (static_cast<uint16_t>(e[3]) << 8));
+	}
+
+	st.count = n;
+	return n;
+}
+
+//---------------------------------------------------------------------//
+// ISR: байт по адресу addr. Если блока ещё нет — false (loop() загрузит).
+//---------------------------------------------------------------------//
+static inline bool SongStream_read(volatile SongStream &st, const uint16_t addr, uint8_t &out)
+{
+	const auto block = static_cast<uint16_t>(addr >> SONG_STREAM_SHIFT);
+	const uint8_t slot = static_cast<uint8_t>(block & 1u);
+
+	st.want = block;
+
+	if (st.tag[slot] != block) {
+		return false;
+	}
+
+	out = st.buf[slot][addr & (SONG_STREAM_BLOCK - 1)];
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// loop(): блок на шине готов -> слот; иначе поставить в очередь блок курсора,
+// затем следующий. Не ждёт шину.
+//---------------------------------------------------------------------//
+static inline void SongStream_poll(volatile SongStream &st, volatile TwiState &twi)
+{
+	// идёт чтение
+	const uint16_t loading = st.loading;
+	if (loading != SONG_STREAM_NO_BLOCK) {
+		const uint8_t status = st.xfer.status;
+		if (status == TWI_ST_QUEUED) {
+			return;
+		}
+
+		// NACK (EEPROM занята) / сброс шины — блок выберем заново
+		if (status == TWI_ST_OK) {
+			cli();
+			st.tag[loading & 1u] = loading;
+			sei();
+		}
+		st.loading = SONG_STREAM_NO_BLOCK;
+		return;
+	}
+
+	cli();
+	const uint16_t want = st.want;
+	sei();
+
+	for (uint8_t k = 0; k < 2; k++) {
+		const auto block = static_cast<uint16_t>(want + k);
+		const uint8_t slot = static_cast<uint8_t>(block & 1u);
+
+		cli();
+		const bool loaded = (st.tag[slot] == block);
+		if (!loaded) {
+			st.tag[slot] = SONG_STREAM_NO_BLOCK;	// ISR не читает слот, пока он грузится
+		}
+		sei();
+
+		if (loaded) {
+			continue;
+		}
+
+		SongStream_setup(st.xfer, st.mem, static_cast<uint16_t>(block << SONG_STREAM_SHIFT),
+						 st.buf[slot], SONG_STREAM_BLOCK);
+		if (Twi_submit(twi, st.xfer)) {
+			st.loading = block;
+		}
+		return;
+	}
+}
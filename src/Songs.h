@@ -19,13 +19,15 @@
  *  - 1..127       : MIDI-нота (используй макросы C4F / C4D и т.д. из Music.h), val = durFlags
  *  - TEMPO (0xFF) : смена темпа, val = tempo10 (9 -> 90 BPM)
  *  - TRANS (0xFE) : транспозиция, val = int8_t (0, +1, -1, ...)
+ *  - SMPL (0xFD)  : запуск PCM-клипа, val = индекс клипа (SMP_TINE / SMP_BELL / SMP_CHIME)
+ *  - LIGHT (0xFC) : эффект гирлянды, val = LIGHTS_FX_BREATH / LIGHTS_FX_FLASH / LIGHTS_FX_PITCH (| LIGHTS_FX_ACCENT)
  *
  * Конец песни:
  *  - маркера нет, конец = конец массива (по длине)
  *
  * Примечание:
  *  - Пунктирные длительности храним отдельными константами: L8D/L4D/L2D/L1D.
- *  - Если в данных встретится неизвестный cmd (128..253), плеер по договорённости
+ *  - Если в данных встретится неизвестный cmd (128..251), плеер по договорённости
  *    должен игнорировать это, не падая.
  */
 
@@ -46,6 +48,31 @@ typedef struct {
 /** Макрос для записи песни в таблицу songs[]. */
 #define SONG_ENTRY(x) { x, (uint16_t)sizeof(x) }
 
+/**
+ * Ансамбль (PLAYER_ENSEMBLE): несколько шкатулок играют одну песню на голоса.
+ *
+ *  - партия 0 — обычная песня в songs[] (её играет шкатулка без номера партии)
+ *  - партии 1.. — в song_parts[]: { индекс песни, номер партии, данные, длина }
+ *  - все партии одной песни сгенерированы midi2code.py --parts N на общей сетке:
+ *    одинаковое число пар и одинаковые длительности по позициям, поэтому
+ *    song_pos ведущего (Sync.h) — это та же позиция в любой партии
+ *  - нота, продолжающая предыдущую через границу сетки, помечена LGT (без атаки)
+ *  - если для песни нет своей партии — шкатулка играет партию 0
+ */
+#ifndef PLAYER_ENSEMBLE
+	#define PLAYER_ENSEMBLE		0
+#endif
+
+typedef struct {
+	uint8_t song;			// индекс песни в songs[]
+	uint8_t part;			// номер партии (1..)
+	const uint8_t *data;
+	uint16_t len;
+} PartInfo;
+
+/** Макрос для записи партии в таблицу song_parts[]. */
+#define PART_ENTRY(song, part, x) { song, part, x, (uint16_t)sizeof(x) }
+
 
 //=====================================================================//
 // James Lord Pierpont - Jingle Bells
@@ -360,6 +387,46 @@ const uint8_t titanic[] PROGMEM =
 	F6D, L08,	// такт 54
 };
 
+#if PLAYER_ENSEMBLE
+
+/**
+ * "Christmas" дуэтом: midi2code.py songs/Christmas.mid --name christmas --parts 2 --bar-per-line
+ */
+const uint8_t christmas_p0[] PROGMEM =
+{
+	TEMPO, 11, TRANS, 0,	// ~110 BPM
+	G4F, L08, PAUSE, L08, C5F, L08, PAUSE, L08, C5F, L08, D5F, L08, C5F, L08, B4F, L08,	// такт 1
+	A4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, D5F, L08, PAUSE, L08,	// такт 2
+	D5F, L08, E5F, L08, A4F, L08, C5F, L08, B4F, L08, PAUSE, L08, B4F, L08, PAUSE, L08,	// такт 3
+	B4F, L08, PAUSE, L08, E5F, L08, PAUSE, L08, E5F, L08, F5F, L08, E5F, L08, D5F, L08,	// такт 4
+	C5F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, G4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08,	// такт 5
+	D5F, L08, PAUSE, L08, B4F, L08, PAUSE, L08, C5F, L08, PAUSE, L08, C4F, L08, PAUSE, L08,	// такт 6
+	G4F, L08, PAUSE, L08, C5F, L08, PAUSE, L08, C5F, L08, D5F, L08, C5F, L08, B4F, L08,	// такт 7
+	A4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, D5F, L08, PAUSE, L08,	// такт 8
+	D5F, L08, E5F, L08, D5F, L08, C5F, L08, B4F, L08, PAUSE, L08, B4F, L08, PAUSE, L08,	// такт 9
+	B4F, L08, PAUSE, L08, E5F, L08, PAUSE, L08, E5F, L08, F5F, L08, E5F, L08, D5F, L08,	// такт 10
+	C5F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, G4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08,	// такт 11
+	D5F, L08, PAUSE, L08, B4F, L08, PAUSE, L08, C5F, L08,	// такт 12
+};
+
+const uint8_t christmas_p1[] PROGMEM =
+{
+	TEMPO, 11, TRANS, 0,	// ~110 BPM
+	PAUSE, L08, PAUSE, L08, E4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, G4F, L08, PAUSE, L08,	// такт 1
+	F4F, L08, PAUSE, L08, C4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, D4F, L08, PAUSE, L08,	// такт 2
+	F4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, D4F, L08, PAUSE, L08, G4F, L08, PAUSE, L08,	// такт 3
+	PAUSE, L08, PAUSE, L08, E4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, G4F, L08, PAUSE, L08,	// такт 4
+	F4F, L08, PAUSE, L08, C4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, F4F, L08, PAUSE, L08,	// такт 5
+	D4F, L08, PAUSE, L08, G4F, L08, PAUSE, L08, E4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08,	// такт 6
+	PAUSE, L08, PAUSE, L08, E4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, G4F, L08, PAUSE, L08,	// такт 7
+	F4F, L08, PAUSE, L08, C4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, D4F, L08, PAUSE, L08,	// такт 8
+	F4F, L08, PAUSE, L08, A4F, L08, PAUSE, L08, D4F, L08, PAUSE, L08, G4F, L08, PAUSE, L08,	// такт 9
+	PAUSE, L08, PAUSE, L08, E4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, G4F, L08, PAUSE, L08,	// такт 10
+	F4F, L08, PAUSE, L08, C4F, L08, PAUSE, L08, PAUSE, L08, PAUSE, L08, F4F, L08, PAUSE, L08,	// такт 11
+	D4F, L08, PAUSE, L08, G4F, L08, PAUSE, L08, E4F, L08,	// такт 12
+};
+
+#endif
 
 /**
  * Таблица песен (в PROGMEM, чтобы не занимать SRAM).
@@ -375,7 +442,44 @@ static const SongInfo songs[] PROGMEM = {
 	SONG_ENTRY(in_my_memory),
 	SONG_ENTRY(christmas),
 	SONG_ENTRY(deckhalls),
+#if PLAYER_ENSEMBLE
+	SONG_ENTRY(christmas_p0),
+#endif
 };
 
 /** Количество песен в таблице songs[]. */
 #define NUM_SONGS (sizeof(songs) / sizeof(songs[0]))
+
+/**
+ * Названия песен для дисплея (Oled.h): строки подряд через '\0', в порядке songs[],
+ * до 21 символа (шрифт 6x8, символы 32..122). Без дисплея во flash не попадают.
+ */
+static const char song_titles[] PROGMEM =
+	"Jingle Bells\0"
+	"Totoro: A Huge Tree\0"
+	"Minecraft: Wet Hands\0"
+	"My Heart Will Go On\0"
+	"In My Memory\0"
+	"Merry Christmas\0"
+	"Deck the Halls\0"
+#if PLAYER_ENSEMBLE
+	"Merry Christmas (duo)\0"
+#endif
+	;
+
+#if PLAYER_ENSEMBLE
+
+/** Индекс дуэта в songs[] (последняя запись). */
+#define SONG_CHRISTMAS_DUET		(NUM_SONGS - 1)
+
+/**
+ * Партии 1.. ансамблевых песен (PartInfo). Ищутся по (song, part) при смене песни.
+ */
+static const PartInfo song_parts[] PROGMEM = {
+	PART_ENTRY(SONG_CHRISTMAS_DUET, 1, christmas_p1),
+};
+
+/** Количество записей в song_parts[]. */
+#define NUM_SONG_PARTS (sizeof(song_parts) / sizeof(song_parts[0]))
+
+#endif
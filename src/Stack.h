@@ -0,0 +1,110 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file Stack.h
+ * Инструментирование стека/SRAM (ATtiny85: 512 байт SRAM на всё).
+ *
+ * Идея ("покраска" стека):
+ *  - до main() (секция .init1) заливаем всю свободную SRAM от конца .bss (_end)
+ *    до вершины стека (__stack = RAMEND) байтом STACK_CANARY
+ *  - стек растёт вниз и затирает покраску; глубже всего он уходит, когда поверх
+ *    loop() срабатывает ISR(TIM1_COMPA_vect) с разбором песни — этот кадр тоже
+ *    попадает в отметку, т.к. у ISR тот же стек
+ *  - Stack_maxUsed() ищет первый затёртый байт снизу — это "high-water mark"
+ *
+ * Цена:
+ *  - покраска: один раз при старте (~500 байт, несколько сотен тактов)
+ *  - запрос: линейный проход по SRAM, только из loop(), НЕ из ISR
+ *  - в ISR ничего не добавляется
+ *
+ * Проверка на хосте: tests/StackTest.cpp (SRAM — массив, _end/__stack внутри него).
+ *
+ * Включается PLAYER_STACK_PAINT=1 (CMake: -DMUSICBOX_STACK_PAINT=ON).
+ * Если 0 — Stack_*() возвращают 0 и ничего не красится.
+ */
+
+#ifndef PLAYER_STACK_PAINT
+	#define PLAYER_STACK_PAINT	0
+#endif
+
+// Байт покраски (маловероятен как адрес возврата/данные)
+#define STACK_CANARY			0xC5
+
+// Символы линкера (avr-libc): конец статических данных и вершина стека
+extern uint8_t _end;
+extern uint8_t __stack;
+
+#if PLAYER_STACK_PAINT
+
+//---------------------------------------------------------------------//
+// Покраска свободной SRAM до main() (.init1: ещё нет ни стека, ни r1=0,
+// поэтому только asm и только "свои" регистры)
+//---------------------------------------------------------------------//
+#if defined(__AVR__)
+static void Stack_paint() __attribute__((naked, used, section(".init1")));
+static void Stack_paint()
+{
+	__asm__ volatile (
+		"	ldi r30, lo8(_end)		\n"
+		"	ldi r31, hi8(_end)		\n"
+		"	ldi r24, %[canary]		\n"
+		"	ldi r25, hi8(__stack)	\n"
+		"	rjmp 2f					\n"
+		"1:	st Z+, r24				\n"
+		"2:	cpi r30, lo8(__stack)	\n"
+		"	cpc r31, r25			\n"
+		"	brlo 1b					\n"
+		"	breq 1b					\n"
+		:: [canary] "M" (STACK_CANARY)
+	);
+}
+#else
+// Хост (tests/StackTest.cpp): тот же проход, _end..__stack включительно; тест вызывает сам
+static inline void Stack_paint()
+{
+	for (uint8_t *p = &_end; p <= &__stack; p++) {
+		*p = STACK_CANARY;
+	}
+}
+#endif
+
+#endif
+
+//---------------------------------------------------------------------//
+// Статически занятая SRAM (.data + .bss + .noinit), байт
+//---------------------------------------------------------------------//
+static inline uint16_t Stack_staticUsed() {
+	return static_cast<uint16_t>(&_end - reinterpret_cast<uint8_t*>(RAMSTART));
+}
+
+//---------------------------------------------------------------------//
+// Максимальная глубина стека за всё время работы (включая ISR), байт
+//---------------------------------------------------------------------//
+static inline uint16_t Stack_maxUsed()
+{
+#if PLAYER_STACK_PAINT
+	const uint8_t *p = &_end;
+
+	while (p <= &__stack && *p == STACK_CANARY) {
+		p++;
+	}
+
+	return static_cast<uint16_t>(&__stack - p + 1);
+#else
+	return 0;
+#endif
+}
+
+//---------------------------------------------------------------------//
+// Сколько байт между статикой и самым глубоким стеком ни разу не трогали
+//---------------------------------------------------------------------//
+static inline uint16_t Stack_free()
+{
+#if PLAYER_STACK_PAINT
+	return static_cast<uint16_t>((&__stack - &_end + 1) - Stack_maxUsed());
+#else
+	return 0;
+#endif
+}
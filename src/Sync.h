@@ -0,0 +1,242 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file Sync.h
+ * Синхронное проигрывание на нескольких шкатулках по одному проводу (ведущий/ведомые).
+ *
+ * Проблема:
+ *  - у каждой шкатулки свой RC-генератор (свой OSCCAL), за минуту они расходятся
+ *
+ * Линия:
+ *  - один провод SYNC_PIN + общая земля, покой = 1 (у ведомых подтяжка на вход)
+ *  - кадр = SYNC_FRAME_LEN байт "как UART" 8N1, младший бит первым,
+ *    SYNC_BIT_TICKS аудио-тиков на бит (~6 кбит/с), всё делается в аудио-ISR
+ *    без отдельного таймера: передача/приём — счётчик и одна запись/чтение пина
+ *  - кадр: [song_index][song_pos lo][song_pos hi][ticks_per_16][transpose]
+ *
+ * Ведущий (PLAYER_SYNC = SYNC_LEADER):
+ *  - на каждом событии песни (нота/пауза) шлёт кадр; СТАРТ-БИТ кадра уходит в том же
+ *    аудио-тике, что и нотный тик начала события — это и есть метка "событие началось"
+ *
+ * Ведомый (PLAYER_SYNC = SYNC_FOLLOWER):
+ *  - фронт старт-бита после паузы на линии (метка):
+ *      note_tick_div_cnt = 0 — фаза нотного тика подстраивается под ведущего,
+ *      следующее событие начинается на следующем нотном тике (отставание <= 1 нотный тик,
+ *      ~5 мс — на слух не отличить, это ~1.7 м звука в комнате)
+ *  - свои часы идут быстрее -> событие ждёт метку (не дольше SYNC_HOLD_MAX_NOTE_TICKS)
+ *  - свои часы идут медленнее -> метка обрывает текущее событие
+ *  - принятый кадр сверяется с позицией; если не совпало (включили посреди песни,
+ *    пропущен кадр) — переход к песне/позиции/темпу ведущего
+ *  - нет кадров SYNC_ALIVE_NOTE_TICKS нотных тиков (~2 с) — играет сам по себе
+ *
+ * Обе шкатулки должны быть собраны одинаково (песни, источник аудио-тика).
+ * Проверка на хосте: tests/SyncTest.cpp (ведущий + ведомый, часы ведомого ±2%).
+ *
+ * Включается PLAYER_SYNC=1/2 (CMake: -DMUSICBOX_SYNC=LEADER/FOLLOWER).
+ */
+
+#define SYNC_OFF				0
+#define SYNC_LEADER				1
+#define SYNC_FOLLOWER			2
+
+#ifndef PLAYER_SYNC
+	#define PLAYER_SYNC			SYNC_OFF
+#endif
+
+// Пин линии синхронизации (PORTB)
+#ifndef SYNC_PIN
+	#define SYNC_PIN			PB2
+#endif
+
+// Аудио-тиков на бит (чётное; 4 -> допуск расхождения часов ~3%)
+#define SYNC_BIT_TICKS			4
+
+// Байт в кадре
+#define SYNC_FRAME_LEN			5
+
+// Тишина на линии, после которой следующий старт-бит — начало нового кадра (аудио-тики)
+#define SYNC_FRAME_GAP_TICKS	(SYNC_BIT_TICKS * 3)
+
+// Ведущий считается потерянным через столько нотных тиков без кадра (~2 с)
+#define SYNC_ALIVE_NOTE_TICKS	400
+
+// Сколько нотных тиков ведомый ждёт метку, если пришёл к событию раньше
+#define SYNC_HOLD_MAX_NOTE_TICKS	16
+
+#if (SYNC_BIT_TICKS < 2) || (SYNC_BIT_TICKS & 1)
+	#error "SYNC_BIT_TICKS must be even and >= 2"
+#endif
+
+//=====================================================================//
+// Состояние линии
+//=====================================================================//
+typedef struct {
+	uint8_t  buf[SYNC_FRAME_LEN];	// кадр (передаваемый / принимаемый)
+	uint8_t  idx;					// байт кадра
+	uint8_t  bit;					// 0 = старт, 1..8 = данные, 9 = стоп
+	uint8_t  div;					// аудио-тиков до следующего бита
+	uint8_t  shift;					// сдвиговый регистр байта
+	uint8_t  active;				// идёт передача кадра / приём байта
+	uint8_t  idle;					// приём: тиков тишины (насыщается на 255)
+	uint8_t  edge;					// приём: метка (старт нового кадра)
+	uint8_t  ready;					// приём: кадр принят целиком
+	uint8_t  go;					// ведомый: ведущий начал следующее событие
+	uint8_t  hold;					// ведомый: сколько нотных тиков уже ждём метку
+	uint16_t alive;					// ведомый: нотных тиков до "ведущий потерян"
+} SyncState;
+
+//---------------------------------------------------------------------//
+// Инициализация линии
+//---------------------------------------------------------------------//
+static inline void Sync_begin(volatile SyncState &s)
+{
+#if PLAYER_SYNC == SYNC_LEADER
+	PORTB |= _BV(SYNC_PIN);		// покой = 1
+	DDRB  |= _BV(SYNC_PIN);
+#elif PLAYER_SYNC == SYNC_FOLLOWER
+	DDRB  &= static_cast<uint8_t>(~_BV(SYNC_PIN));
+	PORTB |= _BV(SYNC_PIN);		// подтяжка: без ведущего линия в покое
+#endif
+
+	s.idx    = 0;
+	s.bit    = 0;
+	s.div    = 0;
+	s.shift  = 0;
+	s.active = 0;
+	s.idle   = 255;
+	s.edge   = 0;
+	s.ready  = 0;
+	s.go     = 0;
+	s.hold   = 0;
+	s.alive  = 0;
+}
+
+//---------------------------------------------------------------------//
+// Ведущий: поставить кадр в передачу (из нотного тика).
+// Старт-бит уйдёт в ближайшем Sync_txTick() — в том же ISR.
+//---------------------------------------------------------------------//
+static inline void Sync_send(volatile SyncState &s,
+							 const uint8_t songIndex,
+							 const uint16_t songPos,
+							 const uint8_t ticksPer16,
+							 const int8_t transpose)
+{
+	// предыдущий кадр ещё идёт (события короче кадра быть не может, но на всякий случай)
+	if (s.active) {
+		return;
+	}
+
+	s.buf[0] = songIndex;
+	s.buf[1] = static_cast<uint8_t>(songPos);
+	s.buf[2] = static_cast<uint8_t>(songPos >> 8);
+	s.buf[3] = ticksPer16;
+	s.buf[4] = static_cast<uint8_t>(transpose);
+
+	s.idx    = 0;
+	s.bit    = 0;
+	s.div    = 1;
+	s.active = 1;
+}
+
+//---------------------------------------------------------------------//
+// Ведущий: аудио-тик передачи
+//---------------------------------------------------------------------//
+static inline void Sync_txTick(volatile SyncState &s)
+{
+	if (!s.active || --s.div != 0) {
+		return;
+	}
+	s.div = SYNC_BIT_TICKS;
+
+	const uint8_t bit = s.bit;
+
+	if (bit == 0) {
+		s.shift = s.buf[s.idx];
+		PORTB &= static_cast<uint8_t>(~_BV(SYNC_PIN));		// старт
+	} else if (bit <= 8) {
+		const uint8_t v = s.shift;
+		if (v & 1) {
+			PORTB |= _BV(SYNC_PIN);
+		} else {
+			PORTB &= static_cast<uint8_t>(~_BV(SYNC_PIN));
+		}
+		s.shift = static_cast<uint8_t>(v >> 1);
+	} else {
+		PORTB |= _BV(SYNC_PIN);								// стоп
+		s.bit = 0;
+		if (++s.idx == SYNC_FRAME_LEN) {
+			s.active = 0;
+		}
+		return;
+	}
+
+	s.bit = static_cast<uint8_t>(bit + 1);
+}
+
+//---------------------------------------------------------------------//
+// Ведомый: аудио-тик приёма (выборка в середине бита)
+//---------------------------------------------------------------------//
+static inline void Sync_rxTick(volatile SyncState &s)
+{
+	const uint8_t level = PINB & _BV(SYNC_PIN);
+
+	if (!s.active) {
+		if (level) {
+			if (s.idle != 255) {
+				s.idle++;
+			}
+			return;
+		}
+
+		// старт-бит; после паузы — начало кадра и метка события
+		if (s.idle >= SYNC_FRAME_GAP_TICKS) {
+			s.idx  = 0;
+			s.edge = 1;
+		}
+		s.idle   = 0;
+		s.active = 1;
+		s.bit    = 0;
+		s.div    = SYNC_BIT_TICKS / 2;
+		return;
+	}
+
+	if (--s.div != 0) {
+		return;
+	}
+	s.div = SYNC_BIT_TICKS;
+
+	const uint8_t bit = s.bit;
+
+	if (bit == 0) {
+		// середина старт-бита: если уже 1 — это была помеха
+		if (level) {
+			s.active = 0;
+			return;
+		}
+	} else if (bit <= 8) {
+		uint8_t v = static_cast<uint8_t>(s.shift >> 1);
+		if (level) {
+			v |= 0x80;
+		}
+		s.shift = v;
+	} else {
+		s.active = 0;
+
+		// стоп-бит обязан быть 1, иначе кадр отбрасываем до следующей паузы
+		if (!level) {
+			s.idx = SYNC_FRAME_LEN;
+			return;
+		}
+		if (s.idx < SYNC_FRAME_LEN) {
+			s.buf[s.idx] = s.shift;
+			if (++s.idx == SYNC_FRAME_LEN) {
+				s.ready = 1;
+			}
+		}
+		return;
+	}
+
+	s.bit = static_cast<uint8_t>(bit + 1);
+}
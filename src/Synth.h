@@ -19,6 +19,8 @@
  * Важно:
  *  - notes_add[] рассчитана под конкретную частоту аудио-тика (sample rate).
  *    Если меняешь sample rate в плеере — для идеального строя нужно пересчитать notes_add (util/freqs.py).
+ *  - Для режима PLAYER_AUDIO_CLOCK_TIMER0 (аудио-тик от переполнения Timer0, F_CPU/256/3 ~ 21484 Гц)
+ *    есть отдельная таблица: add = round(f_note * 65536 / 21484.375).
  */
 
 // соответствует MIDI-ноте 21 (A0)
@@ -28,10 +30,19 @@
 //=====================================================================//
 // Структура канала (моно DDS)
 //=====================================================================//
+#if defined(PLAYER_CALIBRATE) && PLAYER_CALIBRATE
+	#define SYNTH_TUNE			1	// поправка строя по калибровке часов (Calib.h)
+#else
+	#define SYNTH_TUNE			0
+#endif
+
 typedef struct {
 	uint16_t count;
 	uint16_t add;
 	uint16_t env_count;		// Q8.8 индекс огибающей: (env_count >> 8) -> 0..255
+#if SYNTH_TUNE
+	uint16_t tune;			// множитель приращения фазы, Q1.15 (32768 = 1.0)
+#endif
 } Channel;
 
 //=====================================================================//
@@ -39,6 +50,21 @@ typedef struct {
 //=====================================================================//
 
 // increment amount for different keys (piano key range) - see util/freqs.py
+#if defined(PLAYER_AUDIO_CLOCK_TIMER0) && PLAYER_AUDIO_CLOCK_TIMER0
+// F_AUDIO = 16.5 MHz / 256 / 3 = 21484.375 Hz (TIM0_OVF с децимацией)
+const uint16_t notes_add[SYNTH_NOTES_ADD_COUNT] PROGMEM = {
+	84,  89,  94,  100,  106,  112,  119,  126,  133,  141,  149,  158,
+	168,  178,  188,  200,  211,  224,  237,  251,  266,  282,  299,  317,
+	336,  355,  377,  399,  423,  448,  475,  503,  533,  564,  598,  633,
+	671,  711,  753,  798,  846,  896,  949,  1005,  1065,  1129,  1196,  1267,
+	1342,  1422,  1507,  1596,  1691,  1792,  1898,  2011,  2131,  2257,  2391,  2534,
+	2684,  2844,  3013,  3192,  3382,  3583,  3796,  4022,  4261,  4515,  4783,  5067,
+	5369,  5688,  6026,  6385,  6764,  7166,  7593,  8044,  8522,  9029,  9566,  10135,
+	10737,  11376,  12052,  12769,  13528,  14333,  15185,  16088,  17045,  18058,  19132,  20270,
+	21475,  22752,  24105,  25538,
+};
+#else
+// F_AUDIO = 24000 Hz (Timer1 CTC)
 const uint16_t notes_add[SYNTH_NOTES_ADD_COUNT] PROGMEM = {
 	75,  80,  84,  89,  95,  100,  106,  113,  119,  126,  134,  142,
 	150,  159,  169,  179,  189,  200,  212,  225,  238,  253,  268,  284,
@@ -50,6 +76,7 @@ const uint16_t notes_add[SYNTH_NOTES_ADD_COUNT] PROGMEM = {
 	9612,  10184,  10789,  11431,  12110,  12830,  13593,  14402,  15258,  16165,  17127,  18145,
 	19224,  20367,  21578,  22861,
 };
+#endif
 
 // one period of the note waveform - see util/sin.py // sin^2
 const uint8_t waveform[64] PROGMEM = {
@@ -90,13 +117,29 @@ static inline void Synth_silence(volatile Channel &ch) {
 //---------------------------------------------------------------------//
 static inline void Synth_begin(volatile Channel &ch) {
 	ch.count = 0;
+#if SYNTH_TUNE
+	ch.tune = 32768u;
+#endif
 	Synth_silence(ch);
 }
 
 //---------------------------------------------------------------------//
-// Включить ноту по MIDI-номеру (1..127), сброс фазы и огибающей
+// Поправка строя (Calib.h): tune Q1.15, 32768 = без поправки
 //---------------------------------------------------------------------//
-static inline void Synth_noteOn(volatile Channel &ch, uint8_t midiNote)
+#if SYNTH_TUNE
+static inline void Synth_setTune(volatile Channel &ch, const uint16_t tuneQ15) {
+	ch.tune = tuneQ15;
+}
+#endif
+
+//---------------------------------------------------------------------//
+// Приращение фазы для MIDI-ноты (с поправкой строя, если она есть)
+//---------------------------------------------------------------------//
+#if SYNTH_TUNE
+static inline uint16_t Synth_noteAdd(volatile Channel &ch, uint8_t midiNote)
+#else
+static inline uint16_t Synth_noteAdd(volatile Channel &, uint8_t midiNote)
+#endif
 {
 	// индекс таблицы = midi_note - 21 (A0)
 	int16_t idx = static_cast<int16_t>(midiNote) - static_cast<int16_t>(SYNTH_MIDI_BASE);
@@ -108,11 +151,37 @@ static inline void Synth_noteOn(volatile Channel &ch, uint8_t midiNote)
 
 	uint16_t add = pgm_read_word(&notes_add[idx]);
 
-	ch.add = add;
+#if SYNTH_TUNE
+	add = static_cast<uint16_t>((static_cast<uint32_t>(add) * ch.tune) >> 15);
+#endif
+
+	return add;
+}
+
+//---------------------------------------------------------------------//
+// Включить ноту по MIDI-номеру (1..127), сброс фазы и огибающей
+//---------------------------------------------------------------------//
+static inline void Synth_noteOn(volatile Channel &ch, uint8_t midiNote)
+{
+	ch.add = Synth_noteAdd(ch, midiNote);
 	ch.env_count = 0;
 	ch.count = 0;
 }
 
+//---------------------------------------------------------------------//
+// Legato (LGT): сменить высоту без новой атаки — фаза и огибающая продолжаются.
+// Если канал молчит — обычный noteOn.
+//---------------------------------------------------------------------//
+static inline void Synth_noteLegato(volatile Channel &ch, uint8_t midiNote)
+{
+	if (ch.add == 0) {
+		Synth_noteOn(ch, midiNote);
+		return;
+	}
+
+	ch.add = Synth_noteAdd(ch, midiNote);
+}
+
 //---------------------------------------------------------------------//
 // Сгенерировать один аудио-сэмпл (0..255) для PWM
 //---------------------------------------------------------------------//
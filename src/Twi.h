@@ -0,0 +1,391 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+/**
+ * @file Twi.h
+ * Неблокирующий I2C-мастер на USI: фронты SCL — из аудио-тика, байты — в ISR(USI_OVF_vect).
+ *
+ * Проблема:
+ *  - TinyWireM (USI_TWI_Master.cpp) ждёт каждый фронт SCL в цикле (_delay_us + опрос пина):
+ *    чтение блока EEPROM — миллисекунды, в которые loop() больше ничего не делает
+ *
+ * Идея (USI в двухпроводном режиме, как AVR310, но без ожидания):
+ *  - SCL тактуется программно строб-битом USITC — один строб на аудио-тик (Twi_tick()):
+ *    одна запись в USICR, SCL ~ частота аудио-тика / 2 (~11-12 кГц)
+ *  - 4-битный счётчик USI досчитывает фронты байта (16) или бита ACK (2) и вызывает
+ *    ISR(USI_OVF_vect) — там Twi_onOverflow() ставит следующий байт / ACK (десятки тактов).
+ *    Строб уходит из аудио-ISR, поэтому USI_OVF всегда отрабатывает ПОСЛЕ него и сэмпл не сдвигает
+ *  - START/повторный START/STOP — несколько шагов Twi_tick() (по шагу на аудио-тик)
+ *  - ведомый растягивает SCL — строб ждёт (не дольше TWI_STRETCH_MAX_TICKS, потом сброс шины)
+ *  - детектор START у USI нужен только ведомому — мастер его не включает
+ *
+ * Транзакции:
+ *  - TwiXfer: адрес, что записать (tx), сколько прочитать (rx); при tx и rx —
+ *    повторный START между ними (адрес памяти EEPROM, регистр RTC и т.п.)
+ *  - Twi_submit() ставит транзакцию в очередь (TWI_QUEUE_LEN), статус — в x.status:
+ *    TWI_ST_QUEUED пока идёт, затем TWI_ST_OK / TWI_ST_NACK / TWI_ST_BUS
+ *  - Twi_run() — то же с ожиданием, только до sei() (загрузка: каталог песен и т.п.)
+ *
+ * Пины: SDA = PB0, SCL = PB2 (+ подтяжки 4.7 кОм).
+ *
+ * Включается PLAYER_TWI=1 (CMake: -DMUSICBOX_TWI=ON; его включают модули, которым нужна шина).
+ */
+
+// По умолчанию — если есть модуль на шине (макрос раскрывается при использовании,
+// поэтому порядок подключения SongStream.h/Schedule.h/Oled.h неважен)
+#ifndef PLAYER_TWI
+	#define PLAYER_TWI				(PLAYER_SONG_SOURCE_I2C || PLAYER_SCHEDULE || PLAYER_OLED)
+#endif
+
+#define TWI_PIN_SDA					PB0
+#define TWI_PIN_SCL					PB2
+
+// Транзакций в очереди (степень двойки)
+#ifndef TWI_QUEUE_LEN
+	#define TWI_QUEUE_LEN			4
+#endif
+
+// Сколько аудио-тиков ждать отпущенный SCL (растяжение такта ведомым), ~10 мс
+#define TWI_STRETCH_MAX_TICKS		240
+
+// Шаг Twi_run() до sei() (вместо аудио-тика), мкс
+#define TWI_BOOT_TICK_US			40
+
+#if (TWI_QUEUE_LEN & (TWI_QUEUE_LEN - 1)) != 0
+	#error "TWI_QUEUE_LEN must be a power of two"
+#endif
+
+// Статус транзакции
+#define TWI_ST_OK					0	// готово
+#define TWI_ST_QUEUED				1	// в очереди / на шине
+#define TWI_ST_NACK					2	// ведомый не ответил (нет устройства, EEPROM пишет страницу)
+#define TWI_ST_BUS					3	// SCL не отпускается — шина сброшена
+
+// Шаг Twi_tick()
+#define TWI_PH_IDLE					0	// шина свободна
+#define TWI_PH_ADDR					1	// START дан: SCL = 0, адрес в USIDR
+#define TWI_PH_SHIFT				2	// строб на тик, дальше решает Twi_onOverflow()
+#define TWI_PH_RESTART_SDA			3	// повторный START: отпустить SDA
+#define TWI_PH_RESTART_SCL			4	// отпустить SCL
+#define TWI_PH_RESTART				5	// SCL = 1 -> SDA = 0
+#define TWI_PH_STOP_SDA				6	// STOP: SDA = 0
+#define TWI_PH_STOP_SCL				7	// отпустить SCL
+#define TWI_PH_STOP					8	// SCL = 1 -> отпустить SDA, транзакция закончена
+
+// Что досчитывает счётчик USI (Twi_onOverflow())
+#define TWI_STEP_TX					0	// байт ушёл
+#define TWI_STEP_ACK_IN				1	// ACK от ведомого принят
+#define TWI_STEP_RX					2	// байт принят
+#define TWI_STEP_ACK_OUT			3	// наш ACK/NACK ушёл
+
+// USI: двухпроводный режим, счётчик от USITC, сдвиг по фронту SCL
+#define TWI_USICR					(_BV(USIOIE) | _BV(USIWM1) | _BV(USICS1) | _BV(USICLK))
+#define TWI_USICR_STROBE			(TWI_USICR | _BV(USITC))
+
+// Сброс флагов USI + счётчик: 0 -> 16 фронтов (байт), 14 -> 2 фронта (бит)
+#define TWI_USISR_BYTE				(_BV(USISIF) | _BV(USIOIF) | _BV(USIPF))
+#define TWI_USISR_BIT				(TWI_USISR_BYTE | 14)
+
+//=====================================================================//
+// Транзакция и состояние шины
+//=====================================================================//
+typedef struct {
+	uint8_t addr;					// 7-битный адрес
+	uint8_t tx_len;					// байт записать (0 — только чтение)
+	uint8_t rx_len;					// байт прочитать (0 — только запись)
+	uint8_t status;					// TWI_ST_*
+	const volatile uint8_t *tx;		// что записать
+	volatile uint8_t *rx;			// куда прочитать
+} TwiXfer;
+
+typedef struct {
+	volatile TwiXfer *queue[TWI_QUEUE_LEN];	// очередь; queue[head] — на шине
+	uint8_t head;
+	uint8_t tail;
+	uint8_t phase;					// TWI_PH_*
+	uint8_t step;					// TWI_STEP_*
+	uint8_t idx;					// байт tx/rx
+	uint8_t reading;				// адрес ушёл с битом R
+	uint8_t result;					// статус к концу транзакции (после STOP)
+	uint8_t wait;					// тиков ждём SCL
+} TwiState;
+
+//---------------------------------------------------------------------//
+// Инициализация: линии отпущены, USI в двухпроводном режиме
+//---------------------------------------------------------------------//
+static inline void Twi_begin(volatile TwiState &t)
+{
+	t.head  = 0;
+	t.tail  = 0;
+	t.phase = TWI_PH_IDLE;
+	t.wait  = 0;
+
+	PORTB |= _BV(TWI_PIN_SDA) | _BV(TWI_PIN_SCL);
+	DDRB  |= _BV(TWI_PIN_SDA) | _BV(TWI_PIN_SCL);
+
+	USIDR = 0xFF;
+	USICR = TWI_USICR;
+	USISR = TWI_USISR_BYTE;
+}
+
+//---------------------------------------------------------------------//
+// Поставить транзакцию в очередь (из loop()).
+// @return false — очередь полна, x не тронут.
+//---------------------------------------------------------------------//
+static inline bool Twi_submit(volatile TwiState &t, volatile TwiXfer &x)
+{
+	const uint8_t sreg = SREG;
+	cli();
+
+	const uint8_t tail = t.tail;
+	const auto next = static_cast<uint8_t>((tail + 1) & (TWI_QUEUE_LEN - 1));
+	if (next == t.head) {
+		SREG = sreg;
+		return false;
+	}
+
+	x.status      = TWI_ST_QUEUED;
+	t.queue[tail] = &x;
+	t.tail        = next;
+
+	SREG = sreg;
+	return true;
+}
+
+//---------------------------------------------------------------------//
+// Очередь пуста, шина свободна (из loop(): фоновый трафик — только после срочного)
+//---------------------------------------------------------------------//
+static inline bool Twi_idle(volatile TwiState &t) {
+	return t.head == t.tail;
+}
+
+//---------------------------------------------------------------------//
+// Транзакция закончена (или шина сброшена): статус, следующая в очереди
+//---------------------------------------------------------------------//
+static inline void Twi_finish(volatile TwiState &t, const uint8_t status)
+{
+	t.queue[t.head]->status = status;
+	t.head  = static_cast<uint8_t>((t.head + 1) & (TWI_QUEUE_LEN - 1));
+	t.phase = TWI_PH_IDLE;
+	t.wait  = 0;
+}
+
+//---------------------------------------------------------------------//
+// Ждём отпущенный SCL. @return true — SCL = 1; при таймауте шина сброшена.
+//---------------------------------------------------------------------//
+static inline bool Twi_sclHigh(volatile TwiState &t)
+{
+	if (PINB & _BV(TWI_PIN_SCL)) {
+		t.wait = 0;
+		return true;
+	}
+
+	if (++t.wait >= TWI_STRETCH_MAX_TICKS) {
+		USIDR  = 0xFF;
+		PORTB |= _BV(TWI_PIN_SDA) | _BV(TWI_PIN_SCL);
+		DDRB  |= _BV(TWI_PIN_SDA);
+		Twi_finish(t, TWI_ST_BUS);
+	}
+	return false;
+}
+
+//---------------------------------------------------------------------//
+// Аудио-тик: один шаг шины. Шина свободна и очередь пуста — два чтения и сравнение.
+//---------------------------------------------------------------------//
+static inline void Twi_tick(volatile TwiState &t)
+{
+	const uint8_t ph = t.phase;
+
+	if (ph == TWI_PH_SHIFT) {
+		// SCL отпущен, а на линии 0 — ведомый растягивает такт
+		if ((PORTB & _BV(TWI_PIN_SCL)) && !Twi_sclHigh(t)) {
+			return;
+		}
+		USICR = TWI_USICR_STROBE;
+		return;
+	}
+
+	if (ph == TWI_PH_IDLE) {
+		if (t.head == t.tail) {
+			return;
+		}
+
+		// START: SDA 1 -> 0 при SCL = 1
+		volatile TwiXfer *x = t.queue[t.head];
+		t.reading = (x->tx_len == 0) ? 1 : 0;
+		t.idx     = 0;
+		USIDR     = 0xFF;
+		PORTB    &= static_cast<uint8_t>(~_BV(TWI_PIN_SDA));
+		t.phase   = TWI_PH_ADDR;
+		return;
+	}
+
+	switch (ph) {
+		case TWI_PH_ADDR: {
+			// SCL = 0, дальше SDA ведёт старший бит USIDR
+			PORTB  &= static_cast<uint8_t>(~_BV(TWI_PIN_SCL));
+			USIDR   = static_cast<uint8_t>((t.queue[t.head]->addr << 1) | t.reading);
+			PORTB  |= _BV(TWI_PIN_SDA);
+			USISR   = TWI_USISR_BYTE;
+			t.step  = TWI_STEP_TX;
+			t.phase = TWI_PH_SHIFT;
+			return;
+		}
+
+		case TWI_PH_RESTART_SDA:
+			USIDR   = 0xFF;
+			PORTB  |= _BV(TWI_PIN_SDA);
+			t.phase = TWI_PH_RESTART_SCL;
+			return;
+
+		case TWI_PH_RESTART_SCL:
+			PORTB  |= _BV(TWI_PIN_SCL);
+			t.phase = TWI_PH_RESTART;
+			return;
+
+		case TWI_PH_RESTART:
+			if (!Twi_sclHigh(t)) {
+				return;
+			}
+			PORTB    &= static_cast<uint8_t>(~_BV(TWI_PIN_SDA));
+			t.reading = 1;
+			t.idx     = 0;
+			t.phase   = TWI_PH_ADDR;
+			return;
+
+		case TWI_PH_STOP_SDA:
+			USIDR   = 0xFF;
+			PORTB  &= static_cast<uint8_t>(~_BV(TWI_PIN_SDA));
+			t.phase = TWI_PH_STOP_SCL;
+			return;
+
+		case TWI_PH_STOP_SCL:
+			PORTB  |= _BV(TWI_PIN_SCL);
+			t.phase = TWI_PH_STOP;
+			return;
+
+		case TWI_PH_STOP:
+			if (!Twi_sclHigh(t)) {
+				return;
+			}
+			PORTB |= _BV(TWI_PIN_SDA);
+			Twi_finish(t, t.result);
+			return;
+
+		default:
+			return;
+	}
+}
+
+//---------------------------------------------------------------------//
+// ISR(USI_OVF_vect): счётчик USI досчитал байт или бит ACK (SCL = 0).
+// Каждая ветка пишет USISR — это и сброс USIOIF.
+//---------------------------------------------------------------------//
+static inline void Twi_onOverflow(volatile TwiState &t)
+{
+	volatile TwiXfer *x = t.queue[t.head];
+
+	switch (t.step) {
+		case TWI_STEP_TX:
+			// байт ушёл — ACK читает ведомый на SDA
+			DDRB  &= static_cast<uint8_t>(~_BV(TWI_PIN_SDA));
+			USISR  = TWI_USISR_BIT;
+			t.step = TWI_STEP_ACK_IN;
+			return;
+
+		case TWI_STEP_ACK_IN: {
+			const uint8_t nack = USIDR & 1u;
+			DDRB |= _BV(TWI_PIN_SDA);
+
+			if (nack) {
+				USISR    = TWI_USISR_BYTE;
+				t.result = TWI_ST_NACK;
+				t.phase  = TWI_PH_STOP_SDA;
+				return;
+			}
+
+			if (!t.reading) {
+				const uint8_t i = t.idx;
+				if (i < x->tx_len) {
+					USIDR  = x->tx[i];
+					t.idx  = static_cast<uint8_t>(i + 1);
+					USISR  = TWI_USISR_BYTE;
+					t.step = TWI_STEP_TX;
+					return;
+				}
+				USISR = TWI_USISR_BYTE;
+				if (x->rx_len != 0) {
+					t.phase = TWI_PH_RESTART_SDA;
+					return;
+				}
+				t.result = TWI_ST_OK;
+				t.phase  = TWI_PH_STOP_SDA;
+				return;
+			}
+
+			// адрес с R принят — байты идут от ведомого
+			if (x->rx_len == 0) {
+				USISR    = TWI_USISR_BYTE;
+				t.result = TWI_ST_OK;
+				t.phase  = TWI_PH_STOP_SDA;
+				return;
+			}
+			DDRB  &= static_cast<uint8_t>(~_BV(TWI_PIN_SDA));
+			USISR  = TWI_USISR_BYTE;
+			t.step = TWI_STEP_RX;
+			return;
+		}
+
+		case TWI_STEP_RX: {
+			const uint8_t i = t.idx;
+			x->rx[i] = USIDR;
+			t.idx = static_cast<uint8_t>(i + 1);
+
+			// ACK = 0 (ещё байт), NACK = 1 на последнем
+			USIDR  = (t.idx < x->rx_len) ? 0x00 : 0xFF;
+			DDRB  |= _BV(TWI_PIN_SDA);
+			USISR  = TWI_USISR_BIT;
+			t.step = TWI_STEP_ACK_OUT;
+			return;
+		}
+
+		case TWI_STEP_ACK_OUT:
+		default:
+			if (t.idx < x->rx_len) {
+				DDRB  &= static_cast<uint8_t>(~_BV(TWI_PIN_SDA));
+				USISR  = TWI_USISR_BYTE;
+				t.step = TWI_STEP_RX;
+				return;
+			}
+			DDRB    |= _BV(TWI_PIN_SDA);
+			USISR    = TWI_USISR_BYTE;
+			t.result = TWI_ST_OK;
+			t.phase  = TWI_PH_STOP_SDA;
+			return;
+	}
+}
+
+//---------------------------------------------------------------------//
+// Транзакция с ожиданием — ТОЛЬКО при запрещённых прерываниях (до sei()):
+// шаги вместо аудио-тика, переполнение USI — опросом флага.
+// @return статус TWI_ST_*.
+//---------------------------------------------------------------------//
+static inline uint8_t Twi_run(volatile TwiState &t, volatile TwiXfer &x)
+{
+	if (!Twi_submit(t, x)) {
+		return TWI_ST_BUS;
+	}
+
+	while (x.status == TWI_ST_QUEUED) {
+		Twi_tick(t);
+		if (USISR & _BV(USIOIF)) {
+			Twi_onOverflow(t);
+		}
+		_delay_us(TWI_BOOT_TICK_US);
+	}
+
+	return x.status;
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+/**
+ * @file Upload.h
+ * Загрузка песни в EEPROM по одному проводу — без перепрошивки и не останавливая музыку.
+ *
+ * Проблема:
+ *  - новая песня = новая прошивка через micronucleus (USB, перезагрузка, весь flash)
+ *
+ * Линия:
+ *  - UPLOAD_PIN + общая земля, UART 8N1 UPLOAD_BAUD (USB-UART адаптер, midi2code/songupload.py)
+ *  - старт-бит ловит PCINT (Upload_onEdge()), на время байта он выключен
+ *  - биты — в аудио-тике (Upload_tick()), середина бита по счётчику, как в Sync.h;
+ *    без приёма — одна проверка флага на сэмпл
+ *  - принятый байт — в кольцо UPLOAD_RX_LEN, дальше работает loop()
+ *
+ * Кадр:
+ *  - 'M' 'U' [len lo][len hi] data[len] [crc lo][crc hi]
+ *  - data — поток пар (cmd, val), как массивы Songs.h (midi2code.py --bin)
+ *  - crc — CRC-CCITT по data (_crc_ccitt_update(), начальное 0xFFFF)
+ *
+ * Слот в EEPROM (EEPROM_ADDR_UPLOAD, Player.h):
+ *  - [len lo][len hi][crc lo][crc hi] data[UPLOAD_MAX_LEN]
+ *  - loop() (Upload_poll()) пишет data прямо в слот по байту, когда EEPROM свободна
+ *    (~3.3 мс на байт — быстрее, чем байт приходит на 2400 бод: ~4.2 мс)
+ *  - перед данными len hi = 0xFF (слот пуст), заголовок пишется последним
+ *    и только при совпавшем CRC — оборванная загрузка оставляет пустой слот
+ *  - при старте CRC слота проверяется ещё раз (Upload_begin())
+ *
+ * Песня из слота играется тем же курсором, что и PROGMEM (Player.h: songByte()),
+ * индексом NUM_SONGS — сразу после встроенных.
+ *
+ * Проверка на хосте: tests/UploadTest.cpp (линия PB2 + EEPROM: хороший, битый, оборванный кадр).
+ *
+ * Включается PLAYER_SONG_UPLOAD=1 (CMake: -DMUSICBOX_SONG_UPLOAD=ON).
+ */
+
+#ifndef PLAYER_SONG_UPLOAD
+	#define PLAYER_SONG_UPLOAD		0
+#endif
+
+// Пин приёма (PORTB)
+#ifndef UPLOAD_PIN
+	#define UPLOAD_PIN				PB2
+#endif
+
+// Скорость, бод (должна делить частоту аудио-тика, см. Player.h)
+#ifndef UPLOAD_BAUD
+	#define UPLOAD_BAUD				2400UL
+#endif
+
+// Максимальная длина песни в слоте, байт (чётная)
+#ifndef UPLOAD_MAX_LEN
+	#define UPLOAD_MAX_LEN			252
+#endif
+
+// Кольцо принятых байт (степень двойки)
+#define UPLOAD_RX_LEN				16
+
+// Заголовок слота
+#define UPLOAD_HDR_LEN				4
+#define UPLOAD_SLOT_LEN				(UPLOAD_HDR_LEN + UPLOAD_MAX_LEN)
+
+// Пауза внутри кадра дольше стольких нотных тиков (~1 с) — кадр брошен
+#define UPLOAD_TIMEOUT_NOTE_TICKS	200
+
+#if (UPLOAD_MAX_LEN & 1) || (UPLOAD_MAX_LEN < 2) || (UPLOAD_MAX_LEN > 0x7FFE)
+	#error "UPLOAD_MAX_LEN must be even, 2..0x7FFE"
+#endif
+
+// Разбор кадра (loop)
+#define UPLOAD_ST_SYNC0				0	// ждём 'M'
+#define UPLOAD_ST_SYNC1				1	// ждём 'U'
+#define UPLOAD_ST_LEN_LO			2
+#define UPLOAD_ST_LEN_HI			3
+#define UPLOAD_ST_DATA				4
+#define UPLOAD_ST_CRC_LO			5
+#define UPLOAD_ST_CRC_HI			6
+#define UPLOAD_ST_COMMIT			7	// пишем заголовок
+
+// Что вернул Upload_poll()
+#define UPLOAD_EV_NONE				0
+#define UPLOAD_EV_START				1	// слот стал пустым (пишутся данные)
+#define UPLOAD_EV_DONE				2	// песня в слоте, длина — в len
+#define UPLOAD_EV_ERROR				3	// кадр брошен (CRC, длина, таймаут, переполнение)
+
+//=====================================================================//
+// Состояние приёма
+//=====================================================================//
+typedef struct {
+	// ISR: байт с линии
+	uint8_t  rx[UPLOAD_RX_LEN];		// кольцо принятых байт
+	uint8_t  head;					// следующий к разбору (loop)
+	uint8_t  tail;					// куда класть (ISR)
+	uint8_t  active;				// идёт приём байта
+	uint8_t  bit;					// 0 = старт, 1..8 = данные, 9 = стоп
+	uint8_t  div;					// аудио-тиков до середины следующего бита
+	uint8_t  shift;					// сдвиговый регистр
+	uint8_t  bit_ticks;				// аудио-тиков на бит
+	uint8_t  overrun;				// кольцо было полно — кадр испорчен
+	uint8_t  quiet;					// нотных тиков без байта (насыщается)
+
+	// loop: разбор кадра и запись в слот
+	uint8_t  state;					// UPLOAD_ST_*
+	uint8_t  hdr[UPLOAD_HDR_LEN];	// заголовок к записи: crc lo, crc hi, len lo, len hi
+	uint8_t  commit;				// следующий байт заголовка к записи
+	uint16_t len;					// длина данных кадра
+	uint16_t pos;					// принято байт данных
+	uint16_t crc;					// CRC принятых данных
+	uint16_t base;					// адрес слота
+} UploadState;
+
+//---------------------------------------------------------------------//
+// Адрес байта слота
+//---------------------------------------------------------------------//
+static inline uint8_t *Upload_addr(volatile UploadState &u, const uint16_t k) {
+	return reinterpret_cast<uint8_t*>(u.base + k);
+}
+
+//---------------------------------------------------------------------//
+// Запись байта в EEPROM из loop(): аудио-ISR читает EEPROM (песня из слота),
+// поэтому EEAR/EEDR выставляются с cli() — это десяток тактов, записи не ждём
+//---------------------------------------------------------------------//
+static inline void Upload_eepromWrite(uint8_t *addr, const uint8_t v)
+{
+	const uint8_t sreg = SREG;
+	cli();
+	eeprom_update_byte(addr, v);
+	SREG = sreg;
+}
+
+//---------------------------------------------------------------------//
+// Ждать следующий старт-бит
+//---------------------------------------------------------------------//
+static inline void Upload_arm(volatile UploadState &u)
+{
+	u.active = 0;
+	PCMSK   |= _BV(UPLOAD_PIN);
+}
+
+//---------------------------------------------------------------------//
+// Инициализация: линия с подтяжкой, PCINT на пин, проверка слота.
+// @param base Адрес слота (UPLOAD_SLOT_LEN байт).
+// @param bitTicks Аудио-тиков на бит (Player.h: UPLOAD_BIT_TICKS).
+// @return длина песни в слоте (0 — слот пуст или испорчен).
+//---------------------------------------------------------------------//
+static inline uint16_t Upload_begin(volatile UploadState &u, const uint16_t base, const uint8_t bitTicks)
+{
+	u.base      = base;
+	u.bit_ticks = bitTicks;
+	u.head      = 0;
+	u.tail      = 0;
+	u.overrun   = 0;
+	u.quiet     = 0;
+	u.state     = UPLOAD_ST_SYNC0;
+
+	DDRB  &= static_cast<uint8_t>(~_BV(UPLOAD_PIN));
+	PORTB |= _BV(UPLOAD_PIN);		// подтяжка: без адаптера линия в покое
+	Upload_arm(u);
+	GIMSK |= _BV(PCIE);
+
+	// слот: длина и CRC
+	const auto len = static_cast<uint16_t>(eeprom_read_byte(Upload_addr(u, 0)) |
+		(static_cast<uint16_t>(eeprom_read_byte(Upload_addr(u, 1))) << 8));
+	if (len == 0 || len > UPLOAD_MAX_LEN || (len & 1)) {
+		return 0;
+	}
+
+	uint16_t crc = 0xFFFF;
+	for (uint16_t i = 0; i < len; i++) {
+		crc = _crc_ccitt_update(crc, eeprom_read_byte(Upload_addr(u, static_cast<uint16_t>(UPLOAD_HDR_LEN + i))));
+	}
+
+	const auto stored = static_cast<uint16_t>(eeprom_read_byte(Upload_addr(u, 2)) |
+		(static_cast<uint16_t>(eeprom_read_byte(Upload_addr(u, 3))) << 8));
+
+	return (crc == stored) ? len : 0;
+}
+
+//---------------------------------------------------------------------//
+// ISR(PCINT0_vect): спад на линии в покое — старт-бит
+//---------------------------------------------------------------------//
+static inline void Upload_onEdge(volatile UploadState &u)
+{
+	if (u.active || (PINB & _BV(UPLOAD_PIN))) {
+		return;
+	}
+
+	PCMSK   &= static_cast<uint8_t>(~_BV(UPLOAD_PIN));
+	u.active = 1;
+	u.bit    = 0;
+	u.div    = static_cast<uint8_t>(u.bit_ticks / 2 + 1);	// середина старт-бита (+- пол-тика)
+}
+
+//---------------------------------------------------------------------//
+// Аудио-тик: выборка в середине бита
+//---------------------------------------------------------------------//
+static inline void Upload_tick(volatile UploadState &u)
+{
+	if (!u.active || --u.div != 0) {
+		return;
+	}
+	u.div = u.bit_ticks;
+
+	const uint8_t level = PINB & _BV(UPLOAD_PIN);
+	const uint8_t bit = u.bit;
+
+	if (bit == 0) {
+		// середина старт-бита: уже 1 — помеха
+		if (level) {
+			Upload_arm(u);
+			return;
+		}
+	} else if (bit <= 8) {
+		uint8_t v = static_cast<uint8_t>(u.shift >> 1);
+		if (level) {
+			v |= 0x80;
+		}
+		u.shift = v;
+	} else {
+		// стоп-бит обязан быть 1
+		if (level) {
+			const uint8_t t = u.tail;
+			const auto next = static_cast<uint8_t>((t + 1) & (UPLOAD_RX_LEN - 1));
+			if (next == u.head) {
+				u.overrun = 1;
+			} else {
+				u.rx[t] = u.shift;
+				u.tail  = next;
+			}
+			u.quiet = 0;
+		}
+		Upload_arm(u);
+		return;
+	}
+
+	u.bit = static_cast<uint8_t>(bit + 1);
+}
+
+//---------------------------------------------------------------------//
+// Нотный тик: часы таймаута кадра
+//---------------------------------------------------------------------//
+static inline void Upload_noteTick(volatile UploadState &u) {
+	if (u.quiet != 255) {
+		u.quiet++;
+	}
+}
+
+//---------------------------------------------------------------------//
+// loop(): разобрать не больше одного байта (или записать байт заголовка),
+// только когда EEPROM свободна — ни loop(), ни ISR запись не ждут.
+// @return UPLOAD_EV_*.
+//---------------------------------------------------------------------//
+static inline uint8_t Upload_poll(volatile UploadState &u)
+{
+	if (!eeprom_is_ready()) {
+		return UPLOAD_EV_NONE;
+	}
+
+	uint8_t state = u.state;
+
+	// CRC сошёлся: заголовок по байту, len hi — последним
+	if (state == UPLOAD_ST_COMMIT) {
+		const uint8_t k = u.commit;
+		Upload_eepromWrite(Upload_addr(u, static_cast<uint16_t>((k + 2) & 3)), u.hdr[k]);
+		u.commit = static_cast<uint8_t>(k + 1);
+		if (u.commit != UPLOAD_HDR_LEN) {
+			return UPLOAD_EV_NONE;
+		}
+		u.state = UPLOAD_ST_SYNC0;
+		return UPLOAD_EV_DONE;
+	}
+
+	// переполнение кольца или пауза посреди кадра — кадр брошен
+	if (u.overrun || (state != UPLOAD_ST_SYNC0 && u.quiet > UPLOAD_TIMEOUT_NOTE_TICKS)) {
+		cli();
+		u.overrun = 0;
+		u.head    = u.tail;
+		sei();
+		u.state = UPLOAD_ST_SYNC0;
+		return (state == UPLOAD_ST_SYNC0) ? UPLOAD_EV_NONE : UPLOAD_EV_ERROR;
+	}
+
+	const uint8_t h = u.head;
+	if (h == u.tail) {
+		return UPLOAD_EV_NONE;
+	}
+	const uint8_t b = u.rx[h];
+	u.head = static_cast<uint8_t>((h + 1) & (UPLOAD_RX_LEN - 1));
+
+	switch (state) {
+		case UPLOAD_ST_SYNC0:
+			u.state = (b == 'M') ? UPLOAD_ST_SYNC1 : UPLOAD_ST_SYNC0;
+			return UPLOAD_EV_NONE;
+
+		case UPLOAD_ST_SYNC1:
+			u.state = (b == 'U') ? UPLOAD_ST_LEN_LO : ((b == 'M') ? UPLOAD_ST_SYNC1 : UPLOAD_ST_SYNC0);
+			return UPLOAD_EV_NONE;
+
+		case UPLOAD_ST_LEN_LO:
+			u.len   = b;
+			u.state = UPLOAD_ST_LEN_HI;
+			return UPLOAD_EV_NONE;
+
+		case UPLOAD_ST_LEN_HI: {
+			const auto len = static_cast<uint16_t>(u.len | (static_cast<uint16_t>(b) << 8));
+			if (len == 0 || len > UPLOAD_MAX_LEN || (len & 1)) {
+				u.state = UPLOAD_ST_SYNC0;
+				return UPLOAD_EV_ERROR;
+			}
+			u.len   = len;
+			u.pos   = 0;
+			u.crc   = 0xFFFF;
+			u.state = UPLOAD_ST_DATA;
+
+			// слот пуст, пока не сойдётся CRC
+			Upload_eepromWrite(Upload_addr(u, 1), 0xFF);
+			return UPLOAD_EV_START;
+		}
+
+		case UPLOAD_ST_DATA: {
+			const uint16_t pos = u.pos;
+			Upload_eepromWrite(Upload_addr(u, static_cast<uint16_t>(UPLOAD_HDR_LEN + pos)), b);
+			u.crc = _crc_ccitt_update(u.crc, b);
+			u.pos = static_cast<uint16_t>(pos + 1);
+			if (u.pos == u.len) {
+				u.state = UPLOAD_ST_CRC_LO;
+			}
+			return UPLOAD_EV_NONE;
+		}
+
+		case UPLOAD_ST_CRC_LO:
+			u.hdr[0] = b;
+			u.state  = UPLOAD_ST_CRC_HI;
+			return UPLOAD_EV_NONE;
+
+		case UPLOAD_ST_CRC_HI:
+		default: {
+			const auto crc = static_cast<uint16_t>(u.hdr[0] | (static_cast<uint16_t>(b) << 8));
+			if (crc != u.crc) {
+				u.state = UPLOAD_ST_SYNC0;
+				return UPLOAD_EV_ERROR;
+			}
+
+			// hdr[k] ложится в байт слота (k + 2) & 3: len hi — последним
+			u.hdr[1] = b;
+			u.hdr[2] = static_cast<uint8_t>(u.len);
+			u.hdr[3] = static_cast<uint8_t>(u.len >> 8);
+			u.commit = 0;
+			u.state  = UPLOAD_ST_COMMIT;
+			return UPLOAD_EV_NONE;
+		}
+	}
+}
@@ -13,13 +13,24 @@
  *
  * Этот файл НЕ предназначен для копирования в Arduino IDE.
  * В Arduino IDE main() уже есть внутри core.
+ *
+ * Lean core (MUSICBOX_LEAN_CORE в CMake):
+ *  - wiring.c ядра не линкуется, init() нет — плеер сам настраивает
+ *    таймеры/пины и сам разрешает прерывания (Player::begin()).
+ *  - MUSICBOX_CORE_WIRING=1 возвращает init()/millis()/delay().
  */
 
+#ifndef MUSICBOX_CORE_WIRING
+    #define MUSICBOX_CORE_WIRING 1
+#endif
+
 extern "C" void initVariant(void) __attribute__((weak));
 extern "C" void serialEventRun(void) __attribute__((weak));
 
 int main() {
+#if MUSICBOX_CORE_WIRING
     init();
+#endif
 
     if (initVariant) {
         initVariant();
@@ -0,0 +1,312 @@
+/**
+ * Adc.h через Player.h: крышка (фоторезистор) и ручка громкости, АЦП с автозапуском от TOV0.
+ *
+ * Модель (такты шкатулки):
+ *  - Timer0 переполняется раз в 256 тактов и ставит TOV0; фронт флага запускает преобразование,
+ *    если АЦП свободен (ADATE, ADTS = 100); преобразование — 13.5 тактов АЦП /128, затем ISR(ADC_vect)
+ *  - TOV0 сбрасывает аудио-ISR (Timer0-аудио, вход в TIM0_OVF_vect) или ISR(ADC_vect) (Timer1-аудио)
+ *  - смена MUX — худший случай, всегда на одно преобразование позже: ISR(ADC_vect) опоздала,
+ *    следующее уже стартовало со старым каналом (канал преобразования — ADMUX на старте предыдущего)
+ *  - вход: напряжения крышки и ручки (0..255) + равномерный шум ±noise
+ *
+ * Проверяется: отсчёт чужого канала всегда выбрасывается (n == 0), среднее из ADC_OVERSAMPLE гасит шум,
+ * ~9 кГц преобразований и ~270 значений канала в секунду; крышка — гистерезис ±ADC_LID_HYST без дребезга;
+ * громкость — квадрат ручки (0 -> 0, 255 -> 255), Adc_scale() и сэмплы динамика;
+ * закрытая крышка останавливает песню.
+ */
+#include <Arduino.h>
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "HostAvr.h"
+
+#define PLAYER_LID		1
+#define PLAYER_VOLUME	1
+#include "Player.h"
+
+// Преобразование с автозапуском, такты CPU
+#define ADC_TEST_CONV_CYCLES	(13.5 * 128)
+
+// Первое преобразование после ADEN, такты CPU
+#define ADC_TEST_FIRST_CYCLES	(25 * 128)
+
+namespace {
+
+//=====================================================================//
+// Вход АЦП
+//=====================================================================//
+double lid_in   = 0;				// крышка, 0..255
+double vol_in   = 0;				// ручка, 0..255
+int    noise    = 0;				// шум отсчёта, ±LSB
+
+uint8_t sampleOf(const uint8_t admux)
+{
+	const uint8_t mux = admux & 0x0F;
+	double v = (mux == ADC_MUX_OF_PIN(ADC_LID_PIN)) ? lid_in : (mux == ADC_MUX_OF_PIN(ADC_VOLUME_PIN)) ? vol_in : 0;
+	if (noise) {
+		v += rand() % (2 * noise + 1) - noise;
+	}
+	return static_cast<uint8_t>(std::min(255.0, std::max(0.0, v + 0.5)));
+}
+
+//=====================================================================//
+// Таймеры и АЦП
+//=====================================================================//
+double   cyc        = 0;
+double   t0_next    = 0;			// следующее переполнение Timer0
+double   audio_next = 0;			// следующий аудио-тик (Timer1)
+double   audio_cyc  = 0;
+bool     adc_busy   = false;
+double   adc_done   = 0;			// конец преобразования
+uint8_t  adc_mux    = 0;			// канал идущего преобразования
+uint8_t  mux_prev   = 0;			// ADMUX на старте предыдущего
+
+uint32_t conversions = 0;
+uint32_t foreign     = 0;			// отсчётов чужого канала
+uint32_t foreign_used = 0;			// ... попавших в сумму
+std::vector<uint8_t> speaker;		// записи SPEAKER_OCR
+
+void adcStart(const double at)
+{
+	adc_busy = true;
+	adc_done = at + ((conversions == 0) ? ADC_TEST_FIRST_CYCLES : ADC_TEST_CONV_CYCLES);
+	adc_mux  = mux_prev;			// худший случай: MUX на одно преобразование позже
+	mux_prev = ADMUX.v;
+	ADCSRA.v = static_cast<uint8_t>(ADCSRA.v | _BV(ADSC));
+}
+
+void regWrite(volatile HostReg &r, const uint8_t v)
+{
+	if (&r == &TIFR) {
+		r.v = static_cast<uint8_t>(r.v & ~v);		// флаг сбрасывается записью 1
+		return;
+	}
+	if (&r == &ADCSRA) {
+		r.v = v;
+		if ((v & _BV(ADSC)) && (v & _BV(ADEN)) && !adc_busy) {
+			adcStart(cyc);
+		}
+		return;
+	}
+	if (&r == &SPEAKER_OCR) {
+		speaker.push_back(v);
+	}
+	r.v = v;
+}
+
+void timer0Overflow()
+{
+	const bool rising = !(TIFR.v & _BV(TOV0));
+	TIFR.v = static_cast<uint8_t>(TIFR.v | _BV(TOV0));
+	if (rising && !adc_busy && (ADCSRA.v & _BV(ADEN)) && (ADCSRA.v & _BV(ADATE)) &&
+		(ADCSRB.v & 0x07) == _BV(ADTS2)) {
+		adcStart(cyc);
+	}
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	TIFR.v = static_cast<uint8_t>(TIFR.v & ~_BV(TOV0));	// вход в ISR сбрасывает флаг
+	TIM0_OVF_vect();
+#endif
+}
+
+void adcDone()
+{
+	adc_busy = false;
+	ADCSRA.v = static_cast<uint8_t>(ADCSRA.v & ~_BV(ADSC));
+	ADCH.v   = sampleOf(adc_mux);
+	conversions++;
+
+	if (adc_mux != Adc_admux(adc.slot)) {
+		foreign++;
+		foreign_used += (adc.n != 0);
+	}
+	ADC_vect();
+}
+
+// Модель вперёд на seconds; каждый аудио-тик — hook()
+template <typename Hook>
+void advance(const double seconds, Hook hook)
+{
+	const double end = cyc + seconds * F_CPU;
+	while (cyc < end) {
+		double next = t0_next;
+#if !PLAYER_AUDIO_CLOCK_TIMER0
+		next = std::min(next, audio_next);
+#endif
+		if (adc_busy) {
+			next = std::min(next, adc_done);
+		}
+		cyc = next;
+
+		if (adc_busy && adc_done <= cyc) {
+			adcDone();
+		} else if (t0_next <= cyc) {
+			t0_next += 256;
+			timer0Overflow();
+			hook();
+		} else {
+#if !PLAYER_AUDIO_CLOCK_TIMER0
+			audio_next += audio_cyc;
+			TIM1_COMPA_vect();
+			hook();
+#endif
+		}
+	}
+}
+
+void advance(const double seconds)
+{
+	advance(seconds, [] {});
+}
+
+void start()
+{
+	host_reset();
+	host_reg_write = regWrite;
+	cyc          = 0;
+	t0_next      = 256;
+	adc_busy     = false;
+	conversions  = 0;
+	foreign      = 0;
+	foreign_used = 0;
+	noise        = 0;
+	speaker.clear();
+
+	Player::begin();
+	Player::setSong(0);
+	mux_prev   = ADMUX.v;
+	audio_cyc  = 8.0 * (OCR1C.v + 1);
+	audio_next = audio_cyc;
+	srand(7);
+}
+
+uint8_t curve(const uint8_t knob)
+{
+	return static_cast<uint8_t>((knob * (knob + 1)) >> 8);
+}
+
+} // namespace
+
+int main()
+{
+	// Шум и чужой канал: крышка 200, ручка 30, отсчёты ±8
+	{
+		start();
+		lid_in = 200;
+		vol_in = 30;
+		noise  = 8;
+		advance(0.05);
+
+		const uint32_t conv0 = conversions;
+		uint32_t lid_updates = 0;
+		int lid_dev = 0;
+		int vol_dev = 0;
+		uint8_t lid_last = adc.lid;
+		advance(1.0, [&] {
+			if (adc.lid != lid_last) {
+				lid_updates++;
+				lid_last = adc.lid;
+			}
+			lid_dev = std::max(lid_dev, abs(adc.lid - 200));
+			vol_dev = std::max(vol_dev, abs(static_cast<int>(adc.volume) - curve(30)));
+		});
+		const uint32_t per_s = conversions - conv0;
+
+		HOST_CHECK(foreign > 100);
+		HOST_CHECK_EQ(foreign_used, 0);
+		HOST_CHECK(lid_dev <= 5);					// один отсчёт — до ±8
+		HOST_CHECK(vol_dev <= 2);
+		HOST_CHECK(adc.lid_open);
+		HOST_CHECK(per_s > 9000 && per_s < 9400);	// F_CPU / (7 * 256)
+		HOST_CHECK(lid_updates > 150);				// среднее меняется почти каждое значение канала
+		printf("%u conv/s, %u foreign-channel samples (%u summed), lid dev %d, volume dev %d\n",
+			static_cast<unsigned>(per_s), static_cast<unsigned>(foreign), static_cast<unsigned>(foreign_used),
+			lid_dev, vol_dev);
+	}
+
+	// Крышка: рампа 90 -> 170 -> 90 за 2 с, затем 1 с у порога; шум ±6
+	{
+		start();
+		vol_in = 255;
+		lid_in = 90;
+		noise  = 6;
+		advance(0.05);
+		HOST_CHECK(!adc.lid_open);
+
+		struct Flip { uint8_t open; uint8_t lid; };
+		std::vector<Flip> flips;
+		uint8_t open = adc.lid_open;
+		const double ramp_s = 1.0;
+		auto watch = [&] {
+			if (adc.lid_open != open) {
+				open = adc.lid_open;
+				flips.push_back({open, adc.lid});
+			}
+		};
+		for (int i = 0; i < 200; i++) {
+			lid_in = (i < 100) ? 90 + 80 * (i + 1) / 100.0 : 170 - 80 * (i - 99) / 100.0;
+			advance(ramp_s / 100, watch);
+		}
+		HOST_CHECK_EQ(flips.size(), 2);
+		if (flips.size() == 2) {
+			HOST_CHECK(flips[0].open == 1 && flips[0].lid >= ADC_LID_LEVEL + ADC_LID_HYST);
+			HOST_CHECK(flips[0].lid <= ADC_LID_LEVEL + ADC_LID_HYST + 2);
+			HOST_CHECK(flips[1].open == 0 && flips[1].lid < ADC_LID_LEVEL - ADC_LID_HYST);
+			HOST_CHECK(flips[1].lid >= ADC_LID_LEVEL - ADC_LID_HYST - 3);
+		}
+
+		// у порога с сильным шумом — крышка не дребезжит
+		lid_in = ADC_LID_LEVEL;
+		noise  = 12;
+		flips.clear();
+		advance(1.0, watch);
+		HOST_CHECK_EQ(flips.size(), 0);
+	}
+
+	// Громкость: квадрат ручки, 0 -> 0, 255 -> 255
+	{
+		start();
+		lid_in = 220;
+		uint8_t prev = 0;
+		for (int knob = 0; knob <= 255; knob++) {
+			vol_in = knob;
+			advance(0.012);
+			HOST_CHECK_EQ(adc.volume, curve(static_cast<uint8_t>(knob)));
+			HOST_CHECK(adc.volume >= prev);
+			prev = adc.volume;
+		}
+		HOST_CHECK_EQ(curve(0), 0);
+		HOST_CHECK_EQ(curve(128), 64);
+		HOST_CHECK_EQ(curve(255), 255);
+		for (int s = 0; s <= 255; s++) {
+			HOST_CHECK_EQ(Adc_scale(adc, static_cast<uint8_t>(s)), s);		// 255 — без изменений
+		}
+
+		vol_in = 0;
+		advance(0.02);
+		speaker.clear();
+		advance(0.05);
+		HOST_CHECK(!speaker.empty());
+		HOST_CHECK(std::all_of(speaker.begin(), speaker.end(), [](const uint8_t v) { return v == 0; }));
+	}
+
+	// Крышка закрыта — песня стоит, открыта — идёт
+	{
+		start();
+		vol_in = 255;
+		lid_in = 40;
+		const int16_t pos0 = song_pos;
+		advance(0.5);
+		HOST_CHECK(!adc.lid_open);
+		HOST_CHECK_EQ(song_pos, pos0);
+
+		lid_in = 220;
+		advance(0.5);
+		HOST_CHECK(adc.lid_open);
+		HOST_CHECK(song_pos != pos0);
+	}
+
+	return host_report("AdcTest");
+}
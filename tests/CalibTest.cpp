@@ -0,0 +1,202 @@
+/**
+ * Calib.h: эталонный меандр CALIB_REF_HZ на CALIB_PIN, часы шкатулки сбиты на несколько процентов.
+ *
+ * Модель: реальная частота = F_CPU * (1 + ошибка) * (1 + CALIB_TEST_OSCCAL_STEP на шаг OSCCAL),
+ * Timer1 CK/64 с флагом TOV1 идёт от неё же, каждое чтение PINB/TIFR/TCNT1 — такты цикла опроса.
+ * Проверяется: OSCCAL сдвинут к номиналу, tune_q15 = 32768 * номинал / реальная частота,
+ * запись в EEPROM; без эталона и с чужим сигналом — сохранённая калибровка.
+ */
+#include <math.h>
+
+#include <initializer_list>
+
+#include <Arduino.h>
+
+#include "HostAvr.h"
+
+#define PLAYER_CALIBRATE	1
+#include "Calib.h"
+
+// Шаг OSCCAL ATtiny85 — ~0.4..0.5% частоты
+#define CALIB_TEST_OSCCAL_STEP	0.0045
+
+// Заводской OSCCAL модели
+#define CALIB_TEST_OSCCAL		0x50
+
+// Адрес записи калибровки в EEPROM
+#define CALIB_TEST_ADDR			0x20
+
+namespace {
+
+struct Clock {
+	double   err;			// ошибка частоты при заводском OSCCAL
+	double   ref_hz;		// частота сигнала на пине (0 — пин в 1)
+	double   t;				// время, с
+	uint64_t cyc;			// такты CPU
+	// Timer1
+	uint64_t t1_base;		// такт записи TCNT1
+	uint32_t t1_start;		// записанное значение
+	uint32_t t1_ovf_seen;	// переполнений на момент сброса TOV1
+	bool     t1_pending;	// TOV1 стоял на момент записи TCNT1
+};
+
+Clock clk;
+
+double hz() {
+	return F_CPU * (1.0 + clk.err) * (1.0 + CALIB_TEST_OSCCAL_STEP * (static_cast<int>(OSCCAL.v) - CALIB_TEST_OSCCAL));
+}
+
+void spend(const unsigned cycles)
+{
+	clk.cyc += cycles;
+	clk.t   += cycles / hz();
+}
+
+uint32_t t1Ticks() {
+	return clk.t1_start + static_cast<uint32_t>((clk.cyc - clk.t1_base) / 64u);
+}
+
+bool t1Tov() {
+	return clk.t1_pending || (t1Ticks() >> 8) > clk.t1_ovf_seen;
+}
+
+uint8_t readReg(const volatile HostReg &r)
+{
+	if (&r == &PINB) {
+		spend(6);		// sbic + rjmp + проверка флага
+		if (clk.ref_hz == 0) {
+			return static_cast<uint8_t>(r.v | _BV(CALIB_PIN));
+		}
+		const double phase = clk.t * clk.ref_hz - floor(clk.t * clk.ref_hz);
+		return static_cast<uint8_t>(phase < 0.5 ? (r.v | _BV(CALIB_PIN)) : (r.v & ~_BV(CALIB_PIN)));
+	}
+	if (&r == &TIFR) {
+		spend(3);
+		return static_cast<uint8_t>(t1Tov() ? _BV(TOV1) : 0);
+	}
+	if (&r == &TCNT1) {
+		spend(1);
+		return static_cast<uint8_t>(t1Ticks());
+	}
+	return r.v;
+}
+
+void writeReg(volatile HostReg &r, const uint8_t v)
+{
+	spend(1);
+	if (&r == &TIFR) {
+		if (v & _BV(TOV1)) {
+			clk.t1_pending  = false;
+			clk.t1_ovf_seen = t1Ticks() >> 8;
+		}
+		return;
+	}
+	if (&r == &TCNT1) {
+		clk.t1_pending  = t1Tov();
+		clk.t1_base     = clk.cyc;
+		clk.t1_start    = v;
+		clk.t1_ovf_seen = 0;
+		return;
+	}
+	r.v = v;
+}
+
+void boot(const double err, const double refHz)
+{
+	host_reg_read  = readReg;
+	host_reg_write = writeReg;
+	clk = Clock{err, refHz, 0, 0, 0, 0, 0, false};
+	OSCCAL.v = CALIB_TEST_OSCCAL;
+	SREG.v   = 0;
+	host_eeprom_writes = 0;
+}
+
+uint8_t *addr() {
+	return reinterpret_cast<uint8_t *>(CALIB_TEST_ADDR);
+}
+
+uint16_t savedTune() {
+	return static_cast<uint16_t>(host_eeprom[CALIB_TEST_ADDR + 2] | (host_eeprom[CALIB_TEST_ADDR + 3] << 8));
+}
+
+void calibrate(const double err)
+{
+	host_reset();
+	boot(err, CALIB_REF_HZ);
+
+	const uint16_t tune = Calib_begin(addr());
+	const double   real = hz();
+
+	// шаг OSCCAL: ближайший к номиналу (не дальше половины шага + дрожание)
+	const double left = real / F_CPU - 1.0;
+	// поправка: реальная частота * tune / 32768 = номинал
+	const double fixed = real * tune / CALIB_TUNE_ONE / F_CPU - 1.0;
+
+	printf("clock %+.1f%%: OSCCAL 0x%02X -> 0x%02X, left %+.3f%%, tune %u, corrected %+.4f%%\n",
+		   err * 100, CALIB_TEST_OSCCAL, OSCCAL.v, left * 100, tune, fixed * 100);
+
+	HOST_CHECK(err > 0 ? OSCCAL.v < CALIB_TEST_OSCCAL : OSCCAL.v > CALIB_TEST_OSCCAL);
+	HOST_CHECK(fabs(left) <= CALIB_TEST_OSCCAL_STEP * 0.6);
+	HOST_CHECK(fabs(fixed) < 1e-4);
+
+	// запись: [CALIB_MAGIC][OSCCAL][tune lo][tune hi]
+	HOST_CHECK_EQ(host_eeprom[CALIB_TEST_ADDR], CALIB_MAGIC);
+	HOST_CHECK_EQ(host_eeprom[CALIB_TEST_ADDR + 1], OSCCAL.v);
+	HOST_CHECK_EQ(savedTune(), tune);
+	HOST_CHECK_EQ(host_eeprom_writes, CALIB_EEPROM_LEN);
+	HOST_CHECK_EQ(host_eeprom[CALIB_TEST_ADDR - 1], 0xFF);
+	HOST_CHECK_EQ(host_eeprom[CALIB_TEST_ADDR + CALIB_EEPROM_LEN], 0xFF);
+
+	// Timer1 и пин отпущены, прерывания как были
+	HOST_CHECK_EQ(TCCR1.v, 0);
+	HOST_CHECK_EQ(PORTB.v & _BV(CALIB_PIN), 0);
+	HOST_CHECK_EQ(SREG.v, 0);
+
+	// следующее включение без эталона: сохранённые OSCCAL и tune, EEPROM не трогаем
+	const uint8_t osccal = OSCCAL.v;
+	boot(err, 0);
+	SREG.v = _BV(SREG_I);
+	HOST_CHECK_EQ(Calib_begin(addr()), tune);
+	HOST_CHECK_EQ(OSCCAL.v, osccal);
+	HOST_CHECK_EQ(host_eeprom_writes, 0);
+	HOST_CHECK_EQ(SREG.v, _BV(SREG_I));
+
+	// на пине не эталон (в 1.5 раза чаще): калибровка отброшена, сохранённая остаётся
+	boot(err, CALIB_REF_HZ * 1.5);
+	HOST_CHECK_EQ(Calib_begin(addr()), tune);
+	HOST_CHECK_EQ(OSCCAL.v, osccal);
+	HOST_CHECK_EQ(host_eeprom_writes, 0);
+
+	// та же шкатулка с эталоном ещё раз: OSCCAL тот же, tune в пределах дрожания
+	boot(err, CALIB_REF_HZ);
+	const uint16_t again = Calib_begin(addr());
+	HOST_CHECK_EQ(OSCCAL.v, osccal);
+	HOST_CHECK(again + 2 >= tune && again <= tune + 2);
+	HOST_CHECK(host_eeprom_writes <= 2);
+}
+
+}	// namespace
+
+int main()
+{
+	// Calib_tuneQ15: 32768 * expected / measured, мусор за 1 +- 1/8 -> 0
+	HOST_CHECK_EQ(Calib_tuneQ15(1000, 1000), CALIB_TUNE_ONE);
+	HOST_CHECK_EQ(Calib_tuneQ15(1020, 1000), 32125);
+	HOST_CHECK_EQ(Calib_tuneQ15(2000, 1000), 0);
+	HOST_CHECK_EQ(Calib_tuneQ15(0, 1000), 0);
+	HOST_CHECK_EQ(Calib_scaleHz(24000, CALIB_TUNE_ONE), 24000);
+	HOST_CHECK_EQ(Calib_scaleHz(24000, 0), 24000);
+
+	for (const double err : {-0.05, -0.03, -0.01, 0.02, 0.04, 0.06}) {
+		calibrate(err);
+	}
+
+	// чистая EEPROM и нет эталона: без поправки, OSCCAL заводской
+	host_reset();
+	boot(0.03, 0);
+	HOST_CHECK_EQ(Calib_begin(addr()), CALIB_TUNE_ONE);
+	HOST_CHECK_EQ(OSCCAL.v, CALIB_TEST_OSCCAL);
+	HOST_CHECK_EQ(host_eeprom_writes, 0);
+
+	return host_report("CalibTest");
+}
@@ -0,0 +1,126 @@
+#include "HostAvr.h"
+
+#include <string.h>
+
+//=====================================================================//
+// Регистры
+//=====================================================================//
+#undef HOST_REG
+#undef HOST_REG16
+#define HOST_REG(n)			volatile HostReg n
+#define HOST_REG16(n)		volatile uint16_t n
+
+HOST_REG(DDRB); HOST_REG(PORTB); HOST_REG(PINB);
+HOST_REG(TCCR0A); HOST_REG(TCCR0B); HOST_REG(OCR0A); HOST_REG(OCR0B); HOST_REG(TCNT0);
+HOST_REG(TCCR1); HOST_REG(OCR1A); HOST_REG(OCR1B); HOST_REG(OCR1C); HOST_REG(TCNT1); HOST_REG(GTCCR);
+HOST_REG(TIMSK); HOST_REG(TIFR); HOST_REG(GIMSK); HOST_REG(GIFR); HOST_REG(PCMSK); HOST_REG(MCUCR);
+HOST_REG(ADMUX); HOST_REG(ADCSRA); HOST_REG(ADCSRB); HOST_REG(ADCL); HOST_REG(ADCH); HOST_REG(DIDR0); HOST_REG(ACSR);
+HOST_REG(EECR); HOST_REG(EEDR); HOST_REG(EEARL);
+HOST_REG(USICR); HOST_REG(USISR); HOST_REG(USIDR); HOST_REG(USIBR);
+HOST_REG(OSCCAL); HOST_REG(SREG); HOST_REG(SPL); HOST_REG(SPH); HOST_REG(PLLCSR);
+HOST_REG(WDTCR); HOST_REG(PRR); HOST_REG(MCUSR); HOST_REG(GPIOR0); HOST_REG(GPIOR1); HOST_REG(GPIOR2); HOST_REG(DWDR);
+HOST_REG16(ADC); HOST_REG16(ADCW); HOST_REG16(EEAR); HOST_REG16(SP);
+
+uint8_t (*host_reg_read)(const volatile HostReg &r) = nullptr;
+void (*host_reg_write)(volatile HostReg &r, uint8_t v) = nullptr;
+
+//=====================================================================//
+// Сон
+//=====================================================================//
+int host_sleep_mode = SLEEP_MODE_IDLE;
+void (*host_sleep)(int mode) = nullptr;
+
+//=====================================================================//
+// EEPROM
+//=====================================================================//
+uint8_t  host_eeprom[HOST_EEPROM_SIZE];
+uint16_t host_eeprom_write_ticks = 0;
+uint32_t host_eeprom_writes = 0;
+
+static uint16_t host_eeprom_busy = 0;
+
+static size_t host_eepromIndex(const uint8_t *addr)
+{
+	const auto i = reinterpret_cast<size_t>(addr);
+	if (i >= HOST_EEPROM_SIZE) {
+		printf("EEPROM address %zu out of range\n", i);
+		host_failures++;
+		return 0;
+	}
+	return i;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+	return host_eeprom[host_eepromIndex(addr)];
+}
+
+void eeprom_write_byte(uint8_t *addr, const uint8_t v)
+{
+	if (host_eeprom_busy != 0) {
+		printf("EEPROM written while busy\n");
+		host_failures++;
+	}
+	host_eeprom[host_eepromIndex(addr)] = v;
+	host_eeprom_busy = host_eeprom_write_ticks;
+	host_eeprom_writes++;
+}
+
+void eeprom_update_byte(uint8_t *addr, const uint8_t v)
+{
+	if (host_eeprom[host_eepromIndex(addr)] != v) {
+		eeprom_write_byte(addr, v);
+	}
+}
+
+bool eeprom_is_ready() {
+	return host_eeprom_busy == 0;
+}
+
+void host_eepromTick() {
+	if (host_eeprom_busy != 0) {
+		host_eeprom_busy--;
+	}
+}
+
+//=====================================================================//
+// Сброс
+//=====================================================================//
+void host_reset()
+{
+	host_reg_read  = nullptr;
+	host_reg_write = nullptr;
+	host_sleep     = nullptr;
+	host_sleep_mode = SLEEP_MODE_IDLE;
+
+	volatile HostReg *regs[] = {
+		&DDRB, &PORTB, &PINB, &TCCR0A, &TCCR0B, &OCR0A, &OCR0B, &TCNT0,
+		&TCCR1, &OCR1A, &OCR1B, &OCR1C, &TCNT1, &GTCCR, &TIMSK, &TIFR, &GIMSK, &GIFR, &PCMSK, &MCUCR,
+		&ADMUX, &ADCSRA, &ADCSRB, &ADCL, &ADCH, &DIDR0, &ACSR, &EECR, &EEDR, &EEARL,
+		&USICR, &USISR, &USIDR, &USIBR, &OSCCAL, &SREG, &SPL, &SPH, &PLLCSR,
+		&WDTCR, &PRR, &MCUSR, &GPIOR0, &GPIOR1, &GPIOR2, &DWDR,
+	};
+	for (volatile HostReg *r : regs) {
+		r->v = 0;
+	}
+	ADC = ADCW = EEAR = SP = 0;
+
+	memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+	host_eeprom_write_ticks = 0;
+	host_eeprom_writes = 0;
+	host_eeprom_busy = 0;
+}
+
+//=====================================================================//
+// Итог
+//=====================================================================//
+int host_failures = 0;
+
+int host_report(const char *name)
+{
+	if (host_failures != 0) {
+		printf("%s: %d check(s) FAILED\n", name, host_failures);
+		return 1;
+	}
+	printf("%s: OK\n", name);
+	return 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+
+/**
+ * @file HostAvr.h
+ * Общее для хост-тестов: регистры (stubs/avr/io.h), EEPROM, сон, проверки.
+ *
+ * Тесты собирают настоящие заголовки из src/ обычным g++ — железо моделирует сам тест
+ * через host_reg_read / host_reg_write (линия, таймер, USI) и host_sleep.
+ */
+
+//=====================================================================//
+// EEPROM ATtiny85 (512 байт)
+//=====================================================================//
+#define HOST_EEPROM_SIZE	(E2END + 1)
+
+extern uint8_t  host_eeprom[HOST_EEPROM_SIZE];
+extern uint16_t host_eeprom_write_ticks;	// шагов host_eepromTick() на запись (0 — сразу готова)
+extern uint32_t host_eeprom_writes;			// записей (update с тем же значением не считается)
+
+// Шаг времени EEPROM (обычно — аудио-тик теста)
+void host_eepromTick();
+
+//=====================================================================//
+// Сброс: регистры в 0, перехваты сняты, EEPROM стёрта (0xFF)
+//=====================================================================//
+void host_reset();
+
+//=====================================================================//
+// Проверки: HOST_CHECK не останавливает тест, итог — host_report()
+//=====================================================================//
+extern int host_failures;
+
+#define HOST_CHECK(c) \
+	do { \
+		if (!(c)) { \
+			printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, #c); \
+			host_failures++; \
+		} \
+	} while (0)
+
+#define HOST_CHECK_EQ(a, b) \
+	do { \
+		const long long host_a_ = static_cast<long long>(a); \
+		const long long host_b_ = static_cast<long long>(b); \
+		if (host_a_ != host_b_) { \
+			printf("%s:%d: FAIL: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, host_a_, host_b_); \
+			host_failures++; \
+		} \
+	} while (0)
+
+// @return код выхода теста (0 — все проверки прошли)
+int host_report(const char *name);
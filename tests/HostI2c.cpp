@@ -0,0 +1,355 @@
+#include "HostI2c.h"
+
+#include <string.h>
+
+#define HOST_I2C_SDA		_BV(PB0)
+#define HOST_I2C_SCL		_BV(PB2)
+#define HOST_I2C_SLAVES		4
+
+uint32_t host_i2c_starts    = 0;
+uint32_t host_i2c_stops     = 0;
+uint32_t host_i2c_stretched = 0;
+
+namespace {
+
+// Побитовый автомат ведомой стороны (общий для всех ведомых)
+enum SlaveState {
+	SL_IDLE,		// ждём START
+	SL_ADDR,		// принимаем адрес
+	SL_WRITE,		// принимаем байт данных
+	SL_ACK,			// 8 бит приняты: со спада держим ACK
+	SL_ACK_HELD,	// ACK на линии, ждём его фронт
+	SL_ACK_DONE,	// ACK прочитан: со спада — данные
+	SL_READ,		// выдаём байт
+	SL_ACK_IN,		// ждём ACK мастера
+	SL_IGNORE,		// NACK: до STOP / повторного START
+};
+
+struct Bus {
+	HostI2cSlave *slaves[HOST_I2C_SLAVES];
+	uint8_t       count;
+	HostI2cSlave *sel;			// выбранный ведомый
+
+	uint8_t  usi_cnt;			// 4-битный счётчик USI
+	uint8_t  latch;				// SDA мастера (старший бит USIDR, защёлка при SCL = 0)
+	bool     scl;				// линии
+	bool     sda;
+	bool     slave_sda;			// что держит ведомый (true — отпущено)
+	bool     slave_scl;
+	uint16_t stretch;			// растяжение: шагов держать SCL
+	bool     stretch_armed;		// растяжение начнётся со спада
+
+	SlaveState st;
+	uint8_t  bits;
+	uint8_t  byte;
+	bool     reading;
+	bool     acked;				// ведомый ответил ACK на последний байт
+	uint8_t  out;
+};
+
+Bus bus;
+
+void onStart()
+{
+	if (bus.sel) {
+		bus.sel->stop();
+	}
+	host_i2c_starts++;
+	bus.sel       = nullptr;
+	bus.st        = SL_ADDR;
+	bus.bits      = 0;
+	bus.byte      = 0;
+	bus.slave_sda = true;
+}
+
+void onStop()
+{
+	if (bus.sel) {
+		bus.sel->stop();
+	}
+	host_i2c_stops++;
+	bus.sel       = nullptr;
+	bus.st        = SL_IDLE;
+	bus.slave_sda = true;
+}
+
+void onRise(const bool sda)
+{
+	switch (bus.st) {
+		case SL_ADDR:
+		case SL_WRITE:
+			bus.byte = static_cast<uint8_t>((bus.byte << 1) | (sda ? 1 : 0));
+			if (++bus.bits < 8) {
+				return;
+			}
+			if (bus.st == SL_ADDR) {
+				bus.reading = bus.byte & 1;
+				for (uint8_t i = 0; i < bus.count; i++) {
+					if (bus.slaves[i]->addr == (bus.byte >> 1) && bus.slaves[i]->select(bus.reading)) {
+						bus.sel = bus.slaves[i];
+					}
+				}
+				bus.acked = bus.sel != nullptr;
+			} else {
+				bus.acked = bus.sel->write(bus.byte);
+			}
+			bus.st = bus.acked ? SL_ACK : SL_IGNORE;
+			return;
+
+		case SL_ACK_HELD:
+			bus.st = SL_ACK_DONE;
+			return;
+
+		case SL_READ:
+			if (++bus.bits == 8) {
+				bus.st = SL_ACK_IN;
+			}
+			return;
+
+		case SL_ACK_IN:
+			if (sda) {
+				bus.st = SL_IGNORE;		// NACK: последний байт
+				return;
+			}
+			bus.out  = bus.sel->read();
+			bus.bits = 0;
+			bus.st   = SL_READ;
+			return;
+
+		default:
+			return;
+	}
+}
+
+void onFall()
+{
+	switch (bus.st) {
+		case SL_ACK:
+			bus.slave_sda = false;
+			bus.st = SL_ACK_HELD;
+			return;
+
+		case SL_ACK_DONE:
+			if (bus.reading) {
+				bus.out  = bus.sel->read();
+				bus.bits = 0;
+				bus.st   = SL_READ;
+				bus.slave_sda = (bus.out & 0x80) != 0;
+				return;
+			}
+			bus.st   = SL_WRITE;
+			bus.bits = 0;
+			bus.byte = 0;
+			bus.slave_sda = true;
+			return;
+
+		case SL_READ:
+			bus.slave_sda = (bus.out >> (7 - bus.bits)) & 1;
+			return;
+
+		default:
+			bus.slave_sda = true;
+			return;
+	}
+}
+
+// Линии после любого изменения выходов мастера или ведомого
+void evalBus()
+{
+	for (int it = 0; it < 8; it++) {
+		const bool mScl = !((DDRB.v & HOST_I2C_SCL) && !(PORTB.v & HOST_I2C_SCL));
+		const bool scl  = mScl && bus.slave_scl;
+		if (!scl) {
+			bus.latch = (USIDR.v >> 7) & 1;
+		}
+		const bool mSda = !((DDRB.v & HOST_I2C_SDA) && (!(PORTB.v & HOST_I2C_SDA) || !bus.latch));
+		const bool sda  = mSda && bus.slave_sda;
+
+		if (scl != bus.scl) {
+			bus.scl = scl;
+			if (scl) {
+				USIDR.v = static_cast<uint8_t>((USIDR.v << 1) | (sda ? 1 : 0));
+				onRise(sda);
+			} else {
+				if (bus.stretch_armed) {
+					bus.stretch_armed = false;
+					bus.slave_scl     = false;
+				}
+				onFall();
+			}
+			continue;
+		}
+		if (sda != bus.sda) {
+			bus.sda = sda;
+			if (scl) {
+				if (sda) {
+					onStop();
+				} else {
+					onStart();
+				}
+			}
+			continue;
+		}
+		break;
+	}
+
+	PINB.v = static_cast<uint8_t>((PINB.v & ~(HOST_I2C_SDA | HOST_I2C_SCL)) |
+								  (bus.scl ? HOST_I2C_SCL : 0) | (bus.sda ? HOST_I2C_SDA : 0));
+}
+
+}	// namespace
+
+uint8_t host_i2cRead(const volatile HostReg &r)
+{
+	if (&r == &USISR) {
+		return static_cast<uint8_t>((r.v & 0xF0) | bus.usi_cnt);
+	}
+	return r.v;
+}
+
+void host_i2cWrite(volatile HostReg &r, const uint8_t v)
+{
+	if (&r == &USICR) {
+		r.v = static_cast<uint8_t>(v & ~_BV(USITC));
+		if (v & _BV(USITC)) {
+			PORTB.v ^= HOST_I2C_SCL;
+			bus.usi_cnt = (bus.usi_cnt + 1) & 15;
+			if (bus.usi_cnt == 0) {
+				USISR.v |= _BV(USIOIF);
+			}
+			evalBus();
+		}
+		return;
+	}
+	if (&r == &USISR) {
+		// флаги сбрасываются записью 1, младшие 4 бита — счётчик
+		r.v = static_cast<uint8_t>(r.v & 0xF0 & ~(v & 0xE0));
+		bus.usi_cnt = v & 15;
+		return;
+	}
+	r.v = v;
+	if (&r == &PORTB || &r == &DDRB || &r == &USIDR) {
+		evalBus();
+	}
+}
+
+void host_i2cBegin()
+{
+	memset(&bus, 0, sizeof(bus));
+	bus.scl = bus.sda = true;
+	bus.slave_sda = bus.slave_scl = true;
+	bus.latch = 1;
+	bus.st = SL_IDLE;
+
+	host_i2c_starts = host_i2c_stops = host_i2c_stretched = 0;
+	host_reg_read  = host_i2cRead;
+	host_reg_write = host_i2cWrite;
+	evalBus();
+}
+
+void host_i2cAttach(HostI2cSlave *s)
+{
+	if (bus.count < HOST_I2C_SLAVES) {
+		bus.slaves[bus.count++] = s;
+	}
+}
+
+void host_i2cTick()
+{
+	for (uint8_t i = 0; i < bus.count; i++) {
+		bus.slaves[i]->tick();
+	}
+
+	if (!bus.slave_scl) {
+		host_i2c_stretched++;
+		if (--bus.stretch == 0) {
+			bus.slave_scl = true;
+			evalBus();
+		}
+	}
+}
+
+void host_i2cStretch(const uint16_t ticks)
+{
+	if (ticks == 0) {
+		return;
+	}
+	bus.stretch = ticks;
+	if (bus.scl) {
+		bus.stretch_armed = true;
+	} else {
+		bus.slave_scl = false;
+	}
+}
+
+bool host_i2cOverflow() {
+	return (USISR.v & _BV(USIOIF)) && (USICR.v & _BV(USIOIE));
+}
+
+bool host_i2cIdle() {
+	return bus.scl && bus.sda;
+}
+
+//=====================================================================//
+// 24LCxx
+//=====================================================================//
+HostEeprom24::HostEeprom24(const uint8_t address)
+	: HostI2cSlave(address), write_ticks(0), busy(0), reads(0), ptr_(0), addr_bytes_(0), wrote_(false)
+{
+	memset(mem, 0xFF, sizeof(mem));
+}
+
+bool HostEeprom24::select(const bool read)
+{
+	if (busy != 0) {
+		return false;
+	}
+	if (!read) {
+		addr_bytes_ = 0;
+		wrote_      = false;
+	}
+	return true;
+}
+
+bool HostEeprom24::write(const uint8_t b)
+{
+	if (addr_bytes_ == 0) {
+		ptr_ = static_cast<uint16_t>((b & 0x7F) << 8);
+		addr_bytes_ = 1;
+		return true;
+	}
+	if (addr_bytes_ == 1) {
+		ptr_ = static_cast<uint16_t>(ptr_ | b);
+		addr_bytes_ = 2;
+		return true;
+	}
+
+	// запись страницы: адрес внутри страницы 64 байта по кругу
+	mem[ptr_] = b;
+	ptr_   = static_cast<uint16_t>((ptr_ & ~63u) | ((ptr_ + 1) & 63u));
+	wrote_ = true;
+	return true;
+}
+
+uint8_t HostEeprom24::read()
+{
+	const uint8_t b = mem[ptr_];
+	ptr_ = static_cast<uint16_t>((ptr_ + 1) & 0x7FFF);
+	reads++;
+	return b;
+}
+
+void HostEeprom24::stop()
+{
+	if (wrote_) {
+		wrote_ = false;
+		busy   = write_ticks;
+	}
+}
+
+void HostEeprom24::tick()
+{
+	if (busy != 0) {
+		busy--;
+	}
+}
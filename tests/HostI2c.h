@@ -0,0 +1,98 @@
+#pragma once
+
+#include "HostAvr.h"
+
+/**
+ * @file HostI2c.h
+ * Модель шины I2C для тестов Twi.h: USI ATtiny85 в двухпроводном режиме + ведомые.
+ *
+ *  - USI: строб USITC переключает SCL (PORTB) и считает фронты, на 16-м — USIOIF;
+ *    сдвиг USIDR — по фронту SCL на линии, SDA мастера — старший бит USIDR (защёлка при SCL = 0)
+ *  - линии — монтажное И мастера и ведомых, PINB показывает линии
+ *  - ведомые — побайтно (HostI2cSlave): START/адрес/байты/STOP, ACK и выдачу битов делает шина
+ *  - ведомый может растянуть такт: host_i2cStretch() держит SCL в 0 с ближайшего спада
+ *
+ * Время — шаги host_i2cTick() (аудио-тик теста); USI_OVF тест вызывает сам по host_i2cOverflow().
+ */
+
+//=====================================================================//
+// Ведомый: байты и решения ACK/NACK
+//=====================================================================//
+class HostI2cSlave
+{
+  public:
+	explicit HostI2cSlave(const uint8_t address) : addr(address) {}
+	virtual ~HostI2cSlave() {}
+
+	const uint8_t addr;				// 7-битный адрес
+
+	/** START + адрес. @return false — NACK (занят). */
+	virtual bool select(bool read) { (void)read; return true; }
+
+	/** Байт от мастера. @return false — NACK. */
+	virtual bool write(uint8_t b) = 0;
+
+	/** Следующий байт мастеру. */
+	virtual uint8_t read() = 0;
+
+	/** STOP (или повторный START) после обращения к этому ведомому. */
+	virtual void stop() {}
+
+	/** Шаг времени (host_i2cTick()). */
+	virtual void tick() {}
+};
+
+//=====================================================================//
+// 24LCxx: адрес памяти 2 байта, страница 64 байта, после записи занята (NACK)
+//=====================================================================//
+class HostEeprom24 : public HostI2cSlave
+{
+  public:
+	explicit HostEeprom24(uint8_t address = 0x50);
+
+	uint8_t  mem[32768];
+	uint16_t write_ticks;			// сколько шагов пишет страницу (NACK на адрес)
+	uint16_t busy;					// осталось шагов записи
+	uint32_t reads;					// байт отдано мастеру
+
+	bool select(bool read) override;
+	bool write(uint8_t b) override;
+	uint8_t read() override;
+	void stop() override;
+	void tick() override;
+
+  private:
+	uint16_t ptr_;
+	uint8_t  addr_bytes_;			// принято байт адреса памяти в этой транзакции
+	bool     wrote_;				// были данные — после STOP идёт запись страницы
+};
+
+//=====================================================================//
+// Шина
+//=====================================================================//
+
+// Перехватить регистры PORTB/DDRB/PINB/USI* (host_reg_read / host_reg_write), линии отпущены
+void host_i2cBegin();
+
+// Подключить ведомого (до 4)
+void host_i2cAttach(HostI2cSlave *s);
+
+// Шаг времени: растяжение такта, ведомые
+void host_i2cTick();
+
+// Держать SCL в 0 ticks шагов, начиная с ближайшего спада (сразу, если SCL уже 0)
+void host_i2cStretch(uint16_t ticks);
+
+// USIOIF при разрешённом USIOIE — пора вызвать USI_OVF (Twi_onOverflow())
+bool host_i2cOverflow();
+
+// Линии отпущены (шина свободна)
+bool host_i2cIdle();
+
+// Для тестов со своими перехватами: обработка регистров шины (остальные — как байт)
+uint8_t host_i2cRead(const volatile HostReg &r);
+void host_i2cWrite(volatile HostReg &r, uint8_t v);
+
+extern uint32_t host_i2c_starts;	// START (и повторных)
+extern uint32_t host_i2c_stops;
+extern uint32_t host_i2c_stretched;	// шагов SCL держался ведомым
@@ -0,0 +1,284 @@
+/**
+ * Ir.h через Player.h: посылки пультов NEC и RC5 на IR_PIN, выборка — настоящий аудио-ISR.
+ *
+ * Модель:
+ *  - линия — выход TSOP (0 = метка): метки длиннее номинала на IR_TEST_STRETCH_US, каждый фронт
+ *    сдвинут случайно на ±IR_TEST_JITTER_US, часы пульта сбиты на ±IR_TEST_REMOTE_ERROR
+ *  - время — такты шкатулки: TIM1_COMPA_vect() раз в 8 * (OCR1C + 1) тактов или TIM0_OVF_vect()
+ *    раз в 256 (сэмпл — каждое AUDIO_T0_DECIMATION-е); чтение PINB — уровень линии в этот такт
+ *  - команды — Player::takeIrCommand(), как MusicBox.h
+ *
+ * Проверяется (на частоте аудио-тика этой сборки, PLAYER_AUDIO_HZ): NEC — команда и адрес, коды повтора
+ * и кадр с битой инверсией команды команд не дают, 16-битный адрес; RC5 — адрес и команда (и 64..127),
+ * удержание (тот же бит T) — одна команда; NEC и RC5 вперемешку; полная очередь теряет лишние.
+ */
+#include <Arduino.h>
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include "HostAvr.h"
+
+#define PLAYER_IR		1
+#include "Player.h"
+
+// Приёмник удлиняет метки, мкс
+#define IR_TEST_STRETCH_US		100
+
+// Разброс фронта, мкс
+#define IR_TEST_JITTER_US		60
+
+// Часы пульта относительно номинала (керамический резонатор)
+#define IR_TEST_REMOTE_ERROR	0.04
+
+// Покой между посылками, мкс
+#define IR_TEST_GAP_US			40000
+
+namespace {
+
+//=====================================================================//
+// Линия: фронты (время, уровень после фронта)
+//=====================================================================//
+struct Edge {
+	double  us;
+	uint8_t level;					// 0 = метка
+};
+
+std::vector<Edge> line;
+double now_us = 0;					// конец последней посылки
+double scale  = 1.0;				// часы пульта
+
+double jitter()
+{
+	return (static_cast<double>(rand()) / RAND_MAX * 2.0 - 1.0) * IR_TEST_JITTER_US;
+}
+
+// Метка и пауза, номинал пульта, мкс
+void markSpace(const double mark, const double space)
+{
+	const double start = now_us;
+	const double end   = start + (mark + space) * scale;
+	line.push_back({start + jitter(), 0});
+	line.push_back({start + mark * scale + IR_TEST_STRETCH_US + jitter(), 1});
+	now_us = end;
+}
+
+void gap(const double us = IR_TEST_GAP_US)
+{
+	now_us += us;
+}
+
+// NEC: 9 мс + 4.5 мс, 32 бита младшим вперёд, стоп-метка
+void nec(const uint8_t addr, const uint8_t addr2, const uint8_t cmd, const uint8_t cmd2)
+{
+	const uint32_t d = addr | (static_cast<uint32_t>(addr2) << 8) |
+		(static_cast<uint32_t>(cmd) << 16) | (static_cast<uint32_t>(cmd2) << 24);
+	markSpace(9000, 4500);
+	for (uint8_t i = 0; i < 32; i++) {
+		markSpace(562, ((d >> i) & 1) ? 1687 : 562);
+	}
+	markSpace(562, 0);
+	gap();
+}
+
+void necCmd(const uint8_t addr, const uint8_t cmd)
+{
+	nec(addr, static_cast<uint8_t>(~addr), cmd, static_cast<uint8_t>(~cmd));
+}
+
+// NEC: код повтора (кнопка держится), раз в 108 мс от начала кадра
+void necRepeat()
+{
+	markSpace(9000, 2250);
+	markSpace(562, 0);
+	now_us += (108000 - 9000 - 2250 - 562) * scale;
+}
+
+// RC5: 14 бит старшим вперёд (S1 S2 T A4..A0 C5..C0), 1 = пауза -> метка, полбита 889 мкс
+void rc5(const uint8_t toggle, const uint8_t addr, const uint8_t cmd)
+{
+	const uint16_t d = static_cast<uint16_t>((1u << 13) | ((cmd & 0x40) ? 0 : (1u << 12)) |
+		(toggle << 11) | ((addr & 0x1F) << 6) | (cmd & 0x3F));
+
+	// полубиты уровнем (1 = метка) -> фронты
+	std::vector<uint8_t> halves;
+	for (int i = 13; i >= 0; i--) {
+		const uint8_t b = (d >> i) & 1;
+		halves.push_back(b ? 0 : 1);
+		halves.push_back(b ? 1 : 0);
+	}
+	size_t i = 0;
+	while (i < halves.size()) {
+		if (!halves[i]) {
+			now_us += 889 * scale;
+			i++;
+			continue;
+		}
+		size_t n = 0;
+		while (i + n < halves.size() && halves[i + n]) {
+			n++;
+		}
+		markSpace(889.0 * n, 0);
+		i += n;
+	}
+	gap();
+}
+
+//=====================================================================//
+// Шкатулка: аудио-ISR по тактам, PINB — уровень линии
+//=====================================================================//
+double   cyc    = 0;
+size_t   edge_i = 0;
+uint8_t  level  = 1;
+
+uint8_t regRead(const volatile HostReg &r)
+{
+	if (&r == &PINB) {
+		const double us = cyc * 1e6 / F_CPU;
+		while (edge_i < line.size() && line[edge_i].us <= us) {
+			level = line[edge_i].level;
+			edge_i++;
+		}
+		return static_cast<uint8_t>((r.v & ~_BV(IR_PIN)) | (level ? _BV(IR_PIN) : 0));
+	}
+	return r.v;
+}
+
+// Прогнать линию до конца (+ покой), команды — в out
+void run(std::vector<IrCommand> &out, const bool read = true)
+{
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	const double isr_cyc = 256;
+#else
+	const double isr_cyc = 8.0 * (OCR1C.v + 1);
+#endif
+	const double end_cyc = (now_us + IR_TEST_GAP_US) * F_CPU / 1e6;
+
+	while (cyc < end_cyc) {
+		cyc += isr_cyc;
+#if PLAYER_AUDIO_CLOCK_TIMER0
+		TIM0_OVF_vect();
+#else
+		TIM1_COMPA_vect();
+#endif
+		IrCommand c;
+		while (read && Player::takeIrCommand(c)) {
+			out.push_back(c);
+		}
+	}
+	now_us = cyc * 1e6 / F_CPU;
+}
+
+void start(const double remoteError, const unsigned seed)
+{
+	host_reset();
+	host_reg_read = regRead;
+	line.clear();
+	edge_i = 0;
+	level  = 1;
+	cyc    = 0;
+	now_us = 0;
+	scale  = 1.0 + remoteError;
+	srand(seed);
+
+	Player::begin();
+	Player::setSong(0);
+	gap();
+}
+
+bool same(const IrCommand &c, const uint8_t proto, const uint8_t addr, const uint8_t cmd)
+{
+	return c.proto == proto && c.addr == addr && c.cmd == cmd;
+}
+
+//---------------------------------------------------------------------//
+// Все сценарии при ошибке часов пульта
+//---------------------------------------------------------------------//
+void check(const double remoteError, const unsigned seed)
+{
+	std::vector<IrCommand> got;
+
+	// NEC: кадр + коды повтора -> одна команда; 16-битный адрес; битая инверсия команды -> ничего
+	start(remoteError, seed);
+	necCmd(0x00, IR_NEC_CMD_NEXT);
+	for (int i = 0; i < 4; i++) {
+		necRepeat();
+	}
+	nec(0x7F, 0x12, IR_NEC_CMD_PREV, static_cast<uint8_t>(~IR_NEC_CMD_PREV));
+	nec(0x00, 0xFF, 0x15, 0x15);
+	necCmd(0xA5, 0x5A);
+	run(got);
+	HOST_CHECK_EQ(got.size(), 3);
+	if (got.size() == 3) {
+		HOST_CHECK(same(got[0], IR_PROTO_NEC, 0x00, IR_NEC_CMD_NEXT));
+		HOST_CHECK(same(got[1], IR_PROTO_NEC, 0x7F, IR_NEC_CMD_PREV));
+		HOST_CHECK(same(got[2], IR_PROTO_NEC, 0xA5, 0x5A));
+	}
+
+	// RC5: удержание (тот же T) — одна команда; новый T — новая; команды 64..127 (S2 = 0)
+	got.clear();
+	start(remoteError, seed + 1);
+	rc5(0, 0x00, IR_RC5_CMD_NEXT);
+	rc5(0, 0x00, IR_RC5_CMD_NEXT);
+	rc5(0, 0x00, IR_RC5_CMD_NEXT);
+	rc5(1, 0x00, IR_RC5_CMD_PREV);
+	rc5(0, 0x05, 0x45);
+	rc5(1, 0x1F, 0x3F);
+	rc5(0, 0x10, 0x00);
+	run(got);
+	HOST_CHECK_EQ(got.size(), 5);
+	if (got.size() == 5) {
+		HOST_CHECK(same(got[0], IR_PROTO_RC5, 0x00, IR_RC5_CMD_NEXT));
+		HOST_CHECK(same(got[1], IR_PROTO_RC5, 0x00, IR_RC5_CMD_PREV));
+		HOST_CHECK(same(got[2], IR_PROTO_RC5, 0x05, 0x45));
+		HOST_CHECK(same(got[3], IR_PROTO_RC5, 0x1F, 0x3F));
+		HOST_CHECK(same(got[4], IR_PROTO_RC5, 0x10, 0x00));
+	}
+
+	// Оба пульта вперемешку
+	got.clear();
+	start(remoteError, seed + 2);
+	necCmd(0x04, 0x08);
+	rc5(1, 0x00, IR_RC5_CMD_NEXT);
+	necCmd(0x04, 0x09);
+	necRepeat();
+	rc5(0, 0x00, IR_RC5_CMD_NEXT);
+	run(got);
+	HOST_CHECK_EQ(got.size(), 4);
+	if (got.size() == 4) {
+		HOST_CHECK(same(got[0], IR_PROTO_NEC, 0x04, 0x08));
+		HOST_CHECK(same(got[1], IR_PROTO_RC5, 0x00, IR_RC5_CMD_NEXT));
+		HOST_CHECK(same(got[2], IR_PROTO_NEC, 0x04, 0x09));
+		HOST_CHECK(same(got[3], IR_PROTO_RC5, 0x00, IR_RC5_CMD_NEXT));
+	}
+
+	// loop() не забирает: в очереди IR_QUEUE_LEN - 1 первых, остальные потеряны
+	got.clear();
+	start(remoteError, seed + 3);
+	for (uint8_t i = 0; i < IR_QUEUE_LEN + 2; i++) {
+		necCmd(0x01, static_cast<uint8_t>(0x10 + i));
+	}
+	run(got, false);
+	run(got);
+	HOST_CHECK_EQ(got.size(), IR_QUEUE_LEN - 1);
+	for (size_t i = 0; i < got.size(); i++) {
+		HOST_CHECK(same(got[i], IR_PROTO_NEC, 0x01, static_cast<uint8_t>(0x10 + i)));
+	}
+}
+
+} // namespace
+
+int main()
+{
+	printf("audio tick %lu Hz\n", static_cast<unsigned long>(PLAYER_AUDIO_HZ));
+
+	const double errors[] = {-IR_TEST_REMOTE_ERROR, 0.0, IR_TEST_REMOTE_ERROR};
+	for (unsigned seed = 1; seed <= 8; seed++) {
+		for (const double e : errors) {
+			check(e, seed * 10);
+		}
+	}
+
+	return host_report("IrTest");
+}
@@ -0,0 +1,601 @@
+/**
+ * Midi.h + isrMidiByte() (Player.h): поток .mid на 31250 бод через настоящую ISR(PCINT0_vect).
+ *
+ * Модель (такты шкатулки, часы расходятся с передатчиком на ±1%):
+ *  - линия — байты 8N1 по расписанию midilive.py: сообщение не раньше своего времени и конца предыдущего
+ *  - PCINT: флаг ставит любой фронт; вход — после конца текущего прерывания + MIDI_ENTRY_CYCLES,
+ *    флаг сбрасывается на входе, фронты во время ISR — повторный вход сразу после выхода
+ *  - в ISR время идёт чтениями TCNT0 (проход цикла) и сэмплом (запись SPEAKER_OCR);
+ *    TCNT0 — младший байт такта (Timer0 без делителя); флаг аудио-таймера (OCF1A / TOV0) — по сетке тика
+ *  - аудио-ISR — на сетке тика, когда CPU свободен; длина — как в midilive.py (нотный тик длиннее)
+ *
+ * В поток вставлены: SysEx (running status сброшен, байты данных после него — мусор),
+ * real-time 0xF8 посреди сообщений, program change / controller, байты с нулевым стоп-битом.
+ *
+ * Проверяется: события note on/off совпадают с разбором переданного потока (без битых байт),
+ * ошибок кадра — ровно вставленные, звук от конца сообщения <= аудио-тик + 15.5 мкс,
+ * ни одного потерянного сэмпла за весь поток.
+ */
+#include <Arduino.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "HostAvr.h"
+
+#define PLAYER_MIDI		1
+#include "Synth.h"
+
+// события синтезатора из PCINT — в журнал теста
+static void midiTestNoteOn(volatile Channel &ch, uint8_t note);
+static void midiTestSilence(volatile Channel &ch);
+#define Synth_noteOn(ch, n)		midiTestNoteOn(ch, n)
+#define Synth_silence(ch)		midiTestSilence(ch)
+#include "Player.h"
+#undef Synth_noteOn
+#undef Synth_silence
+
+// Модель времени кода, такты (как midilive.py)
+#define MIDI_TEST_LOOP			28		// проход цикла приёма (чтение TCNT0)
+#define MIDI_TEST_RENDER		110		// сэмпл
+#define MIDI_TEST_ISR_ENTRY		20		// вход в аудио-ISR до сэмпла
+#define MIDI_TEST_ISR_TAIL		30		// после сэмпла (всего 160)
+#define MIDI_TEST_NOTE_TAIL		130		// после сэмпла на нотном тике (всего 260)
+#define MIDI_TEST_PCINT_EXIT	30		// эпилог PCINT
+
+// Период PWM Timer0 (защёлка сэмпла), такты
+#define MIDI_TEST_PWM			256
+
+// Допуск задержки из Midi.h: аудио-тик + 15.5 мкс
+#define MIDI_TEST_LATENCY_US	65.0
+
+namespace {
+
+//=====================================================================//
+// .mid -> сообщения note on/off (формат 0/1, PPQ)
+//=====================================================================//
+struct Message {
+	double  t;						// с
+	uint8_t status;
+	uint8_t note;
+	uint8_t vel;
+};
+
+struct Reader {
+	const std::vector<uint8_t> &d;
+	size_t p;
+
+	uint32_t vlq() {
+		uint32_t v = 0;
+		while (p < d.size()) {
+			const uint8_t b = d[p++];
+			v = (v << 7) | (b & 0x7F);
+			if (!(b & 0x80)) {
+				break;
+			}
+		}
+		return v;
+	}
+	uint32_t be(const int n) {
+		uint32_t v = 0;
+		for (int i = 0; i < n && p < d.size(); i++) {
+			v = (v << 8) | d[p++];
+		}
+		return v;
+	}
+};
+
+bool readMidi(const char *path, std::vector<Message> &out)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		printf("%s: not found\n", path);
+		return false;
+	}
+	std::vector<uint8_t> d;
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) != 0) {
+		d.insert(d.end(), buf, buf + n);
+	}
+	fclose(f);
+
+	Reader r{d, 0};
+	if (d.size() < 14 || memcmp(d.data(), "MThd", 4) != 0) {
+		return false;
+	}
+	r.p = 8;
+	r.be(2);								// формат
+	const uint32_t tracks = r.be(2);
+	const uint32_t ppq    = r.be(2);
+	if (ppq & 0x8000) {
+		return false;						// SMPTE не нужен
+	}
+
+	struct Ev { uint32_t tick; uint32_t seq; uint8_t status, a, b; uint32_t tempo; };
+	std::vector<Ev> evs;
+	uint32_t seq = 0;
+
+	for (uint32_t k = 0; k < tracks && r.p + 8 <= d.size(); k++) {
+		const bool trk = memcmp(&d[r.p], "MTrk", 4) == 0;
+		r.p += 4;
+		const uint32_t len = r.be(4);
+		const size_t end = std::min(d.size(), r.p + len);
+		if (!trk) {
+			r.p = end;
+			continue;
+		}
+		uint32_t tick = 0;
+		uint8_t running = 0;
+		while (r.p < end) {
+			tick += r.vlq();
+			uint8_t st = d[r.p];
+			if (st & 0x80) {
+				r.p++;
+			} else {
+				st = running;
+			}
+			if (st == 0xFF) {
+				const uint8_t type = d[r.p++];
+				const uint32_t l = r.vlq();
+				if (type == 0x51 && l == 3) {
+					evs.push_back(Ev{tick, seq++, 0xFF, 0, 0, (uint32_t(d[r.p]) << 16) | (d[r.p + 1] << 8) | d[r.p + 2]});
+				}
+				r.p += l;
+			} else if (st == 0xF0 || st == 0xF7) {
+				r.p += r.vlq();
+			} else {
+				running = st;
+				const uint8_t a = d[r.p++];
+				const uint8_t kind = st & 0xF0;
+				const uint8_t b = (kind == 0xC0 || kind == 0xD0) ? 0 : d[r.p++];
+				if (kind == 0x80 || kind == 0x90) {
+					evs.push_back(Ev{tick, seq++, st, a, b, 0});
+				}
+			}
+		}
+		r.p = end;
+	}
+
+	std::stable_sort(evs.begin(), evs.end(), [](const Ev &x, const Ev &y) { return x.tick < y.tick; });
+
+	double t = 0;
+	uint32_t last = 0;
+	double us_per_tick = 500000.0 / ppq;
+	for (const Ev &e : evs) {
+		t += (e.tick - last) * us_per_tick * 1e-6;
+		last = e.tick;
+		if (e.status == 0xFF) {
+			us_per_tick = static_cast<double>(e.tempo) / ppq;
+		} else {
+			out.push_back(Message{t, e.status, e.a, e.b});
+		}
+	}
+	return !out.empty();
+}
+
+//=====================================================================//
+// Линия: байты 8N1
+//=====================================================================//
+struct WireByte {
+	double  start;					// с
+	uint8_t value;
+	uint8_t stop;					// 0 — ошибка кадра
+};
+
+std::vector<WireByte> wire;
+std::vector<double>   edges;		// такты шкатулки
+double bit_cyc = 0;					// бит в тактах шкатулки
+double hz      = 0;					// такты шкатулки в секунду
+
+// Поток: running status (note off -> note on с velocity 0), вставки SysEx / real-time / битых байт
+size_t buildWire(const std::vector<Message> &msgs)
+{
+	const double byte_s = 10.0 / MIDI_BAUD;
+	const double bit_s  = 1.0 / MIDI_BAUD;
+	double free = 0.2;				// Player::begin() и первая нота песни
+	uint8_t last = 0;
+	size_t bad = 0;
+
+	auto put = [&](const uint8_t v, const uint8_t stop = 1) {
+		wire.push_back(WireByte{free, v, stop});
+		free += byte_s;
+		if (!stop) {
+			free += 2 * bit_s;		// линия вернулась в 1 — следующий старт-бит виден
+		}
+	};
+
+	for (size_t i = 0; i < msgs.size(); i++) {
+		const Message &m = msgs[i];
+		free = std::max(free, m.t + 0.2);
+
+		if (i % 97 == 0) {
+			// SysEx сбрасывает статус: байты данных за ним — не ноты
+			for (const uint8_t b : {0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7, 0x3C, 0x40}) {
+				put(b);
+			}
+			last = 0;
+		}
+		if (i % 50 == 25) {
+			// program change + volume: один и два байта данных, статус сменился
+			for (const uint8_t b : {0xC0, 0x05, 0xB0, 0x07, 0x64}) {
+				put(b);
+			}
+			last = 0xB0;
+		}
+
+		uint8_t status = m.status;
+		uint8_t vel    = m.vel;
+		if ((status & 0xF0) == 0x80) {
+			status = static_cast<uint8_t>(0x90 | (status & 0x0F));
+			vel    = 0;
+		}
+
+		if (i % 61 == 30 && status == last) {
+			// битый note off на месте статуса: принятый, он сломал бы running status
+			put(static_cast<uint8_t>(0x80 | (status & 0x0F)), 0);
+			bad++;
+		}
+
+		if (status != last) {
+			put(status);
+			last = status;
+		}
+		put(m.note);
+		if (i % 8 == 3) {
+			put(0xF8);				// timing clock посреди сообщения
+		}
+		put(vel);
+	}
+	return bad;
+}
+
+void buildEdges()
+{
+	edges.clear();
+	for (const WireByte &w : wire) {
+		const double s = w.start * hz;
+		uint8_t lvl = 1;
+		for (int k = 0; k < 10; k++) {
+			const uint8_t v = (k == 0) ? 0 : (k <= 8) ? ((w.value >> (k - 1)) & 1) : w.stop;
+			if (v != lvl) {
+				edges.push_back(s + k * bit_cyc);
+				lvl = v;
+			}
+		}
+		if (!w.stop) {
+			edges.push_back(s + 10 * bit_cyc);
+		}
+	}
+}
+
+uint8_t lineLevel(const double cyc)
+{
+	const double t = cyc / hz;
+	auto it = std::upper_bound(wire.begin(), wire.end(), t,
+							   [](const double x, const WireByte &w) { return x < w.start; });
+	if (it == wire.begin()) {
+		return 1;
+	}
+	--it;
+	const auto bit = static_cast<int>(floor((cyc - it->start * hz) / bit_cyc));
+	if (bit == 0) {
+		return 0;
+	}
+	if (bit <= 8) {
+		return (it->value >> (bit - 1)) & 1;
+	}
+	return (bit == 9) ? it->stop : 1;
+}
+
+//=====================================================================//
+// CPU: такт, флаги прерываний
+//=====================================================================//
+double   cyc       = 0;				// текущий такт
+double   tick_cyc  = 0;				// период флага аудио-таймера (OCF1A / TOV0)
+int64_t  handled   = 0;				// последний сброшенный период флага
+bool     in_pcint  = false;
+double   pcint_cyc = 0;				// такт входа в PCINT
+struct   Stuck {};					// PCINT не выходит: приём завис
+
+struct Sound {
+	uint8_t on;
+	uint8_t note;
+	double  cyc;
+};
+std::vector<Sound>  sounds;			// события синтезатора из PCINT
+std::vector<double> samples;		// такты сэмплов (запись SPEAKER_OCR)
+
+uint8_t regRead(const volatile HostReg &r)
+{
+	if (&r == &TCNT0) {
+		if (in_pcint) {
+			cyc += MIDI_TEST_LOOP;
+			if (cyc - pcint_cyc > 40 * bit_cyc) {
+				throw Stuck();
+			}
+		}
+		return static_cast<uint8_t>(static_cast<int64_t>(cyc) & 0xFF);
+	}
+	if (&r == &PINB) {
+		return static_cast<uint8_t>((r.v & ~_BV(MIDI_PIN)) | (lineLevel(cyc) ? _BV(MIDI_PIN) : 0));
+	}
+	if (&r == &TIFR) {
+		const bool due = static_cast<int64_t>(floor(cyc / tick_cyc)) > handled;
+#if PLAYER_AUDIO_CLOCK_TIMER0
+		return due ? _BV(TOV0) : 0;
+#else
+		return due ? _BV(OCF1A) : 0;
+#endif
+	}
+	return r.v;
+}
+
+void regWrite(volatile HostReg &r, const uint8_t v)
+{
+	if (&r == &TIFR) {
+		if (v & (_BV(TOV0) | _BV(OCF1A))) {
+			handled = static_cast<int64_t>(floor(cyc / tick_cyc));
+		}
+		return;
+	}
+	if (&r == &SPEAKER_OCR) {
+		cyc += MIDI_TEST_RENDER;
+		samples.push_back(cyc);
+	}
+	r.v = v;
+}
+
+void runAudioIsr()
+{
+	const uint8_t div = note_tick_div_cnt;
+	cyc += MIDI_TEST_ISR_ENTRY;
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	TIM0_OVF_vect();
+#else
+	TIM1_COMPA_vect();
+#endif
+	cyc += (note_tick_div_cnt > div) ? MIDI_TEST_NOTE_TAIL : MIDI_TEST_ISR_TAIL;
+}
+
+struct Run {
+	uint32_t pcint;
+	double   latency_max;			// мкс
+	double   latency_sum;
+	uint32_t latency_n;
+	int64_t  lost;					// тиков без сэмпла
+	double   gap_max;				// тактов между сэмплами
+};
+
+// Весь поток: прерывания в порядке флагов, PCINT — приоритетнее аудио
+Run runWire()
+{
+	Run run = {};
+	size_t pcif = 0;				// первый фронт после сброса флага PCINT
+	const double end = wire.back().start * hz + 12 * bit_cyc + 4 * tick_cyc;
+	const double begin_cyc = cyc;
+	const size_t samples0 = samples.size();
+
+	while (cyc < end) {
+		const double next_tick = (handled + 1) * tick_cyc;
+		const double next_edge = (pcif < edges.size()) ? edges[pcif] : 1e300;
+
+		if (next_edge <= cyc || (next_edge <= next_tick && next_edge < end)) {
+			// PCINT: вход после текущего прерывания, флаг сброшен на входе
+			const double start = std::max(cyc, next_edge);
+			pcif = std::upper_bound(edges.begin(), edges.end(), start) - edges.begin();
+			cyc = start + MIDI_ENTRY_CYCLES - MIDI_TEST_LOOP;	// первое чтение TCNT0 — через MIDI_ENTRY_CYCLES
+			in_pcint  = true;
+			pcint_cyc = cyc;
+			try {
+				PCINT0_vect();
+			} catch (const Stuck &) {
+				in_pcint = false;
+				HOST_CHECK(!"PCINT0_vect не вышел за 40 бит");
+				break;
+			}
+			in_pcint = false;
+			cyc += MIDI_TEST_PCINT_EXIT;
+			run.pcint++;
+			continue;
+		}
+
+		cyc = std::max(cyc, next_tick);
+		handled = static_cast<int64_t>(floor(cyc / tick_cyc));
+		runAudioIsr();
+	}
+
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	const double audio_tick = tick_cyc * AUDIO_T0_DECIMATION;
+#else
+	const double audio_tick = tick_cyc;
+#endif
+	const auto expected = static_cast<int64_t>((cyc - begin_cyc) / audio_tick);
+	run.lost = expected - static_cast<int64_t>(samples.size() - samples0);
+	for (size_t i = samples0 + 1; i < samples.size(); i++) {
+		run.gap_max = std::max(run.gap_max, samples[i] - samples[i - 1]);
+	}
+	return run;
+}
+
+//=====================================================================//
+// Эталонный разбор переданного потока (без байт с ошибкой кадра)
+//=====================================================================//
+struct Expected {
+	uint8_t on;
+	uint8_t note;
+	double  wire_end;				// такт конца стоп-бита последнего байта сообщения
+};
+
+std::vector<Expected> expectedEvents()
+{
+	std::vector<Expected> out;
+	uint8_t status = 0;
+	uint8_t have   = 0;
+	uint8_t data0  = 0;
+	uint8_t sounding = MIDI_NOTE_NONE;
+
+	for (const WireByte &w : wire) {
+		const uint8_t b = w.value;
+		if (!w.stop || b >= 0xF8) {
+			continue;
+		}
+		if (b & 0x80) {
+			status = (b >= 0xF0) ? 0 : b;
+			have   = 0;
+			continue;
+		}
+		const uint8_t kind = status & 0xF0;
+		if (status == 0 || kind == 0xC0 || kind == 0xD0) {
+			continue;
+		}
+		if (!have) {
+			data0 = b;
+			have  = 1;
+			continue;
+		}
+		have = 0;
+		const double end = w.start * hz + 10 * bit_cyc;
+		if (kind == 0x90 && b != 0) {
+			out.push_back(Expected{1, data0, end});
+			sounding = data0;
+		} else if ((kind == 0x80 || kind == 0x90) && data0 == sounding) {
+			out.push_back(Expected{0, data0, end});
+			sounding = MIDI_NOTE_NONE;
+		}
+	}
+	return out;
+}
+
+//---------------------------------------------------------------------//
+// Один прогон: файл, ошибка часов шкатулки, %
+//---------------------------------------------------------------------//
+void check(const std::vector<Message> &msgs, const double clockErrorPct)
+{
+	host_reset();
+	host_reg_read  = regRead;
+	host_reg_write = regWrite;
+	wire.clear();
+	sounds.clear();
+	samples.clear();
+	cyc     = 0;
+	handled = 0;
+
+	hz      = F_CPU * (1.0 + clockErrorPct / 100.0);
+	bit_cyc = hz / MIDI_BAUD;
+
+	Player::begin();
+	Player::setSong(0);
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	tick_cyc = 256;
+#else
+	tick_cyc = 8.0 * (OCR1C.v + 1);
+#endif
+
+	const size_t bad = buildWire(msgs);
+	buildEdges();
+	const Run run = runWire();
+	const std::vector<Expected> want = expectedEvents();
+
+	bool same = want.size() == sounds.size();
+	for (size_t i = 0; same && i < want.size(); i++) {
+		same = want[i].on == sounds[i].on && want[i].note == sounds[i].note;
+	}
+
+	// задержка note on: конец сообщения на линии -> первый сэмпл после события -> защёлка PWM
+	double lat_max = 0;
+	double lat_sum = 0;
+	size_t lat_n   = 0;
+	if (same) {
+		for (size_t i = 0; i < want.size(); i++) {
+			if (!want[i].on) {
+				continue;
+			}
+			const auto s = std::upper_bound(samples.begin(), samples.end(), sounds[i].cyc);
+			if (s == samples.end()) {
+				continue;
+			}
+			const double latch = ceil(*s / MIDI_TEST_PWM) * MIDI_TEST_PWM;
+			const double us = (latch - want[i].wire_end) / hz * 1e6;
+			lat_max = std::max(lat_max, us);
+			lat_sum += us;
+			lat_n++;
+		}
+	}
+
+	printf("clock %+.1f%%: %zu bytes, %u PCINT, %u framing errors (%zu sent), events %zu/%zu %s, "
+		   "note on -> sound avg %.1f / max %.1f us, lost samples %lld, max gap %.0f cycles\n",
+		   clockErrorPct, wire.size(), run.pcint, midi.errors, bad, sounds.size(), want.size(),
+		   same ? "match" : "MISMATCH", lat_n ? lat_sum / lat_n : 0.0, lat_max,
+		   static_cast<long long>(run.lost), run.gap_max);
+
+	HOST_CHECK(bad > 0);
+	HOST_CHECK_EQ(midi.errors, bad);
+	HOST_CHECK(want.size() > 100);
+	HOST_CHECK(same);
+	HOST_CHECK_EQ(lat_n, std::count_if(want.begin(), want.end(), [](const Expected &e) { return e.on; }));
+	HOST_CHECK(lat_max < MIDI_TEST_LATENCY_US);
+	HOST_CHECK(run.lost <= 1);
+	HOST_CHECK(run.gap_max < 2 * tick_cyc * (PLAYER_AUDIO_CLOCK_TIMER0 ? AUDIO_T0_DECIMATION : 1));
+}
+
+}	// namespace
+
+static void midiTestNoteOn(volatile Channel &ch, const uint8_t note)
+{
+	if (in_pcint) {
+		sounds.push_back(Sound{1, note, cyc});
+	}
+	::Synth_noteOn(ch, note);
+}
+
+static void midiTestSilence(volatile Channel &ch)
+{
+	if (in_pcint) {
+		sounds.push_back(Sound{0, midi.key, cyc});
+	}
+	::Synth_silence(ch);
+}
+
+int main()
+{
+	std::vector<Message> msgs;
+	HOST_CHECK(readMidi(MIDI_TEST_FILE, msgs));
+	if (msgs.empty()) {
+		return host_report("MidiTest");
+	}
+
+	// running status, real-time и SysEx без железа
+	{
+		MidiState m;
+		Midi_begin(m);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x3C), MIDI_EV_NONE);		// данные без статуса
+		HOST_CHECK_EQ(Midi_onByte(m, 0x91), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x3C), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0xF8), MIDI_EV_NONE);		// real-time посреди сообщения
+		HOST_CHECK_EQ(Midi_onByte(m, 0x40), MIDI_EV_NOTE_ON);
+		HOST_CHECK_EQ(m.key, 0x3C);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x3E), MIDI_EV_NONE);		// running status
+		HOST_CHECK_EQ(Midi_onByte(m, 0x00), MIDI_EV_NOTE_OFF);	// velocity 0
+		HOST_CHECK_EQ(m.key, 0x3E);
+		HOST_CHECK_EQ(Midi_onByte(m, 0xF0), MIDI_EV_NONE);		// SysEx: статус сброшен
+		HOST_CHECK_EQ(Midi_onByte(m, 0x3C), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x40), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0xC2), MIDI_EV_NONE);		// program change: один байт данных
+		HOST_CHECK_EQ(Midi_onByte(m, 0x05), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x06), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x80), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x3C), MIDI_EV_NONE);
+		HOST_CHECK_EQ(Midi_onByte(m, 0x7F), MIDI_EV_NOTE_OFF);
+	}
+
+	printf("%s: %zu note messages\n", MIDI_TEST_FILE, msgs.size());
+	check(msgs, +1.0);
+	check(msgs, -1.0);
+
+	return host_report("MidiTest");
+}
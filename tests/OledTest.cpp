@@ -0,0 +1,348 @@
+/**
+ * Oled.h через Player.h: SSD1306 — ведомый HostI2c с кадром 128x64, "сейчас играет" понемногу по Twi.h.
+ *
+ * Модель:
+ *  - SSD1306 (0x3C): управляющий байт (Co, D/C#) перед командой или данными, постраничная адресация
+ *    (0xB0 | страница, столбец — две тетрады), данные пишутся в кадр со сдвигом столбца; 0xAE / 0xAF
+ *  - ОЗУ контроллера после включения — мусор; "видно" только после 0xAF
+ *  - время — переполнения Timer0 (аудио — TIM0_OVF_vect(), шаг шины на аудио-тик, USI_OVF по флагу),
+ *    loop() — Player::pollOled() через несколько переполнений
+ *
+ * Проверяется: инициализация при выключенном дисплее, к 0xAF весь кадр уже очищен (мусора не видно)
+ * и нарисован; кадр всё время совпадает с названием (font6x8) и полосой прогресса песни;
+ * смена песни перерисовывает название и сбрасывает полосу; NACK дисплея — кусок уходит снова;
+ * транзакция не длиннее OLED_HDR + OLED_CHUNK; без дисплея шина молчит.
+ */
+#include <Arduino.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "HostAvr.h"
+#include "HostI2c.h"
+
+#include "Player.h"
+
+// Переполнений Timer0 между вызовами loop()
+#define OLED_TEST_LOOP			16
+
+// Предел ожидания (переполнений Timer0, ~10 с)
+#define OLED_TEST_MAX_OVF		(10UL * F_CPU / 256UL)
+
+namespace {
+
+// Названия первых песен (Songs.h: song_titles[])
+const char *const titles[] = {"Jingle Bells", "Totoro: A Huge Tree", "Minecraft: Wet Hands", "My Heart Will Go On"};
+
+//=====================================================================//
+// SSD1306
+//=====================================================================//
+class HostSsd1306 : public HostI2cSlave
+{
+  public:
+	HostSsd1306() : HostI2cSlave(OLED_I2C_ADDR) {}
+
+	uint8_t fb[OLED_PAGES][OLED_WIDTH];
+	uint8_t shown[OLED_PAGES][OLED_WIDTH];	// кадр в момент 0xAF
+	bool    present    = true;
+	bool    on         = false;
+	uint8_t on_count   = 0;
+	uint8_t page       = 0;
+	uint8_t col        = 0;
+	uint8_t addr_mode  = 0xFF;
+	uint8_t nack       = 0;					// NACK на столько ближайших адресов
+	uint32_t nacked    = 0;
+	uint32_t xfers     = 0;
+	uint32_t bytes_max = 0;					// байт за транзакцию (без адреса)
+	std::vector<uint8_t> cmds;				// команды с параметрами
+
+	void reset() {
+		for (auto &p : fb) {
+			for (auto &b : p) {
+				b = static_cast<uint8_t>(rand());
+			}
+		}
+		on        = false;
+		on_count  = 0;
+		addr_mode = 0xFF;
+		nack      = 0;
+		nacked    = 0;
+		xfers     = 0;
+		bytes_max = 0;
+		cmds.clear();
+	}
+
+	bool select(const bool read) override {
+		if (!present || read) {
+			return false;
+		}
+		if (nack != 0) {
+			nack--;
+			nacked++;
+			return false;
+		}
+		ctrl_  = true;
+		bytes_ = 0;
+		xfers++;
+		return true;
+	}
+
+	bool write(const uint8_t b) override {
+		if (++bytes_ > bytes_max) {
+			bytes_max = bytes_;
+		}
+		if (ctrl_) {
+			co_   = (b & 0x80) != 0;
+			data_ = (b & 0x40) != 0;
+			ctrl_ = false;
+			return true;
+		}
+		if (data_) {
+			fb[page][col] = b;
+			col = static_cast<uint8_t>((col + 1) % OLED_WIDTH);		// страничная адресация: по кругу в странице
+		} else {
+			command(b);
+		}
+		ctrl_ = co_;
+		return true;
+	}
+
+	uint8_t read() override {
+		return 0xFF;
+	}
+
+  private:
+	bool    ctrl_  = true;					// следующий байт — управляющий
+	bool    co_    = false;
+	bool    data_  = false;
+	uint8_t param_ = 0;						// команда ждёт параметр
+	uint32_t bytes_ = 0;
+
+	void command(const uint8_t b) {
+		cmds.push_back(b);
+		if (param_ != 0) {
+			if (param_ == 0x20) {
+				addr_mode = b;
+			}
+			param_ = 0;
+			return;
+		}
+		switch (b) {
+			case 0x20: case 0x81: case 0xA8: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB: case 0x8D:
+				param_ = b;
+				return;
+			case 0xAE:
+				on = false;
+				return;
+			case 0xAF:
+				on = true;
+				on_count++;
+				memcpy(shown, fb, sizeof(fb));
+				return;
+			default:
+				break;
+		}
+		if (b >= 0xB0 && b <= 0xB7) {
+			page = static_cast<uint8_t>(b & 0x07);
+		} else if (b <= 0x0F) {
+			col = static_cast<uint8_t>((col & 0xF0) | b);
+		} else if (b <= 0x1F) {
+			col = static_cast<uint8_t>((col & 0x0F) | ((b & 0x0F) << 4));
+		}
+	}
+};
+
+HostSsd1306 lcd;
+
+//=====================================================================//
+// Ожидаемый экран: название шрифтом 6x8 на странице 1, полоса bar столбцов на странице 4
+//=====================================================================//
+uint8_t expected(const std::string &title, const uint8_t bar, const uint8_t page, const uint8_t col)
+{
+	if (page == OLED_PAGE_TITLE) {
+		const unsigned i = col / OLED_FONT_W;
+		if (i >= OLED_TITLE_CHARS) {
+			return 0;
+		}
+		const char c = (i < title.size()) ? title[i] : ' ';
+		return ssd1306xled_font6x8[(c - ' ') * OLED_FONT_W + col % OLED_FONT_W];
+	}
+	if (page == OLED_PAGE_BAR) {
+		return (col == 0 || col == OLED_WIDTH - 1 || col <= bar) ? 0x7E : 0x42;
+	}
+	return 0;
+}
+
+// Кадр совпадает с экраном; @return несовпавших байт
+unsigned diff(const uint8_t (&f)[OLED_PAGES][OLED_WIDTH], const std::string &title, const uint8_t bar)
+{
+	unsigned n = 0;
+	for (uint8_t p = 0; p < OLED_PAGES; p++) {
+		for (uint8_t c = 0; c < OLED_WIDTH; c++) {
+			n += (f[p][c] != expected(title, bar, p, c));
+		}
+	}
+	return n;
+}
+
+// Полоса по позиции песни, как Oled_setProgress()
+uint8_t barOf(const int16_t pos, const uint16_t len)
+{
+	const uint32_t p = (pos < 0) ? 0 : static_cast<uint32_t>(pos + 2);
+	return static_cast<uint8_t>((p >= len) ? OLED_BAR_W : p * OLED_BAR_W / len);
+}
+
+//=====================================================================//
+// Шкатулка
+//=====================================================================//
+uint32_t ovf = 0;
+
+void overflow()
+{
+	if (audio_t0_decim_cnt == 1) {
+		host_i2cTick();							// этот вызов — аудио-тик: фронт SCL
+	}
+	TIM0_OVF_vect();
+	if (host_i2cOverflow()) {
+		USI_OVF_vect();
+	}
+	ovf++;
+}
+
+// Играть, loop() — pollOled(); каждый loop() — check(). @return false — не дождались done()
+template <typename Done, typename Check>
+bool play(Done done, Check check)
+{
+	for (uint32_t i = 1; i <= OLED_TEST_MAX_OVF; i++) {
+		overflow();
+		if (i % OLED_TEST_LOOP == 0) {
+			Player::pollOled();
+			check();
+			if (done()) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool drawn()
+{
+	return lcd.on && oled.dirty == 0 && oled.xfer.status != TWI_ST_QUEUED;
+}
+
+void boot()
+{
+	host_reset();
+	lcd.reset();
+	host_i2cBegin();
+	host_i2cAttach(&lcd);
+	ovf = 0;
+
+	Player::begin();
+	Player::setSong(0);
+}
+
+} // namespace
+
+int main()
+{
+	//=================================================================//
+	// Инициализация и первый кадр
+	//=================================================================//
+	boot();
+	HOST_CHECK_EQ(oled.ok, 1);
+	HOST_CHECK(!lcd.on);
+	{
+		std::vector<uint8_t> init(oled_init_cmds, oled_init_cmds + sizeof(oled_init_cmds));
+		HOST_CHECK(lcd.cmds == init);
+	}
+	HOST_CHECK_EQ(lcd.addr_mode, 0x02);
+	lcd.bytes_max = 0;							// дальше — только куски страниц
+
+	HOST_CHECK(play([] { return drawn(); }, [] {}));
+	HOST_CHECK_EQ(lcd.on_count, 1);
+	HOST_CHECK_EQ(diff(lcd.shown, titles[0], oled.bar), 0);		// к 0xAF мусора нет, всё нарисовано
+	HOST_CHECK(lcd.bytes_max <= OLED_HDR + OLED_CHUNK);
+	printf("display on after %.2f s, %u transactions\n", ovf * 256.0 / F_CPU, static_cast<unsigned>(lcd.xfers));
+
+	//=================================================================//
+	// Песня идёт: полоса растёт, кадр успевает за ней
+	//=================================================================//
+	{
+		const uint8_t bar0 = oled.bar;
+		unsigned stale = 0;							// loop() с кадром, отставшим больше чем на 1 столбец
+		uint8_t  last  = bar0;
+		const uint32_t xfers0 = lcd.xfers;
+		play([] { return false; }, [&] {
+			HOST_CHECK_EQ(oled.bar, barOf(song_pos, song_len));
+			HOST_CHECK(oled.bar >= last);
+			last = oled.bar;
+			if (drawn() && diff(lcd.fb, titles[0], oled.bar) != 0) {
+				stale++;
+			}
+		});
+		HOST_CHECK_EQ(stale, 0);
+		HOST_CHECK(oled.bar > bar0);
+		HOST_CHECK_EQ(lcd.on_count, 1);
+		// только полоса: по транзакции на новый столбец (плюс запас на кусок из двух столбцов)
+		HOST_CHECK(lcd.xfers - xfers0 <= static_cast<uint32_t>(oled.bar - bar0) + 2);
+		printf("bar %u -> %u columns in 10 s, %u transactions\n", bar0, oled.bar,
+			static_cast<unsigned>(lcd.xfers - xfers0));
+	}
+
+	//=================================================================//
+	// Смена песни: название заново, полоса с нуля
+	//=================================================================//
+	Player::setSong(3);
+	HOST_CHECK(play([] { return oled.song == 3 && drawn(); }, [] {}));
+	HOST_CHECK_EQ(diff(lcd.fb, titles[3], oled.bar), 0);
+	HOST_CHECK(oled.bar <= 2);
+
+	//=================================================================//
+	// NACK дисплея: кусок снова грязный, кадр всё равно верный
+	//=================================================================//
+	Player::setSong(1);
+	lcd.nack = 3;
+	HOST_CHECK(play([] { return oled.song == 1 && lcd.nack == 0 && drawn(); }, [] {}));
+	HOST_CHECK_EQ(lcd.nacked, 3);
+	HOST_CHECK_EQ(diff(lcd.fb, titles[1], oled.bar), 0);
+	HOST_CHECK(lcd.bytes_max <= OLED_HDR + OLED_CHUNK);
+
+	//=================================================================//
+	// Без названия — номер песни; строки song_titles[]
+	//=================================================================//
+	{
+		uint8_t len = 0;
+		const char *t = Oled_findTitle(song_titles, sizeof(song_titles), 2, len);
+		HOST_CHECK(t != nullptr);
+		HOST_CHECK_EQ(len, strlen(titles[2]));
+		HOST_CHECK(t && strncmp(t, titles[2], len) == 0);
+		HOST_CHECK(Oled_findTitle(song_titles, sizeof(song_titles), 40, len) == nullptr);
+
+		// песня без названия (из EEPROM и т.п.) — "#12"
+		static volatile OledState o;
+		Oled_setSong(o, 11, nullptr, 0);
+		for (uint8_t c = 0; c < OLED_WIDTH; c++) {
+			HOST_CHECK_EQ(Oled_column(o, OLED_PAGE_TITLE, c), expected("#12", 0, OLED_PAGE_TITLE, c));
+		}
+		Oled_setSong(o, 4, nullptr, 0);
+		HOST_CHECK_EQ(Oled_column(o, OLED_PAGE_TITLE, OLED_FONT_W + 2), expected("#5", 0, OLED_PAGE_TITLE, OLED_FONT_W + 2));
+	}
+
+	//=================================================================//
+	// Дисплея нет: NACK на инициализацию, дальше шина молчит
+	//=================================================================//
+	lcd.present = false;
+	boot();
+	HOST_CHECK_EQ(oled.ok, 0);
+	const uint32_t starts = host_i2c_starts;
+	play([] { return false; }, [] {});
+	HOST_CHECK_EQ(host_i2c_starts, starts);
+	HOST_CHECK(!lcd.on);
+
+	return host_report("OledTest");
+}
@@ -0,0 +1,302 @@
+/**
+ * Schedule.h через Player.h: будильник DS3231, песня на будильник, power-down между песнями.
+ *
+ * Модель:
+ *  - DS3231 — ведомый HostI2c (0x68): указатель регистра, время BCD, будильник 2 (минуты + часы,
+ *    A2M4 — любой день), флаг A2F держит INT/SQW в 0, пока его не сбросят
+ *  - сон: host_sleep в power-down — часы RTC идут по минуте до INT, INT -> PINB -> PCINT0_vect()
+ *  - loop() — Player::pollSchedule() между переполнениями Timer0 (аудио — TIM0_OVF_vect())
+ *
+ * Проверяется: регистры будильника (BCD, маска дня, управление, сброс флагов и 32 кГц),
+ * цепочка будильников через смену часа и суток с песнями строк расписания,
+ * сон только после конца песни и с выключенными выходами; без RTC — обычная игра без сна.
+ */
+#include <Arduino.h>
+
+#include "HostAvr.h"
+#include "HostI2c.h"
+
+// 8..21 каждый час — следующая песня, 12:30 — песня 3, 23:59 — песня 5, полночь — песня 1
+#define SCHEDULE_TABLE	{ 8, 21, 0, SCHEDULE_SONG_NEXT }, { 12, 12, 30, 3 }, { 23, 23, 59, 5 }, { 0, 0, 0, 1 }
+#include "Player.h"
+
+// Регистры DS3231
+#define DS3231_REGS				0x13
+#define DS3231_CTRL_INTCN		0x04
+#define DS3231_CTRL_A2IE		0x02
+#define DS3231_STATUS_A2F		0x02
+#define DS3231_STATUS_EN32KHZ	0x08
+#define DS3231_STATUS_OSF		0x80
+
+// Переполнений Timer0 между вызовами loop()
+#define SCHEDULE_TEST_LOOP		16
+
+// Предел игры одной песни, переполнений Timer0 (~10 мин)
+#define SCHEDULE_TEST_MAX_OVF	(10UL * 60UL * F_CPU / 256UL)
+
+namespace {
+
+//=====================================================================//
+// DS3231
+//=====================================================================//
+class HostDs3231 : public HostI2cSlave
+{
+  public:
+	HostDs3231() : HostI2cSlave(SCHEDULE_RTC_ADDR), regs(), present(true), day(0), ptr_(0), first_(false) {
+		regs[0x0E] = 0x1C;												// после включения: INTCN, меандр 1 Гц
+		regs[0x0F] = DS3231_STATUS_OSF | DS3231_STATUS_EN32KHZ;
+	}
+
+	uint8_t regs[DS3231_REGS];
+	bool    present;				// false — NACK на адрес
+	uint8_t day;					// сутки с начала теста
+
+	bool select(const bool read) override {
+		first_ = !read;
+		return present;
+	}
+
+	bool write(const uint8_t b) override {
+		if (first_) {
+			ptr_   = static_cast<uint8_t>(b % DS3231_REGS);
+			first_ = false;
+		} else {
+			regs[ptr_] = b;
+			ptr_ = static_cast<uint8_t>((ptr_ + 1) % DS3231_REGS);
+		}
+		return true;
+	}
+
+	uint8_t read() override {
+		const uint8_t b = regs[ptr_];
+		ptr_ = static_cast<uint8_t>((ptr_ + 1) % DS3231_REGS);
+		return b;
+	}
+
+	void stop() override {
+		updateInt();
+	}
+
+	void setTime(const uint8_t hour, const uint8_t minute) {
+		regs[0x00] = 0;
+		regs[0x01] = Schedule_toBcd(minute);
+		regs[0x02] = Schedule_toBcd(hour);
+	}
+
+	uint16_t minuteOfDay() const {
+		return static_cast<uint16_t>(Schedule_fromBcd(regs[0x02] & 0x3F) * 60u + Schedule_fromBcd(regs[0x01]));
+	}
+
+	// Следующая минута; будильник 2 сравнивает минуты и часы (биты A2M2/A2M3 = 0), день — если A2M4 = 0
+	void tickMinute() {
+		auto t = static_cast<uint16_t>(minuteOfDay() + 1);
+		if (t == SCHEDULE_MINUTES_PER_DAY) {
+			t = 0;
+			day++;
+		}
+		setTime(static_cast<uint8_t>(t / 60), static_cast<uint8_t>(t % 60));
+
+		const bool minutes = !(regs[0x0B] & 0x80) && regs[0x0B] == regs[0x01];
+		const bool hours   = !(regs[0x0C] & 0x80) && (regs[0x0C] & 0x3F) == (regs[0x02] & 0x3F);
+		const bool anyDay  = (regs[0x0D] & 0x80) != 0;
+		if (minutes && hours && anyDay) {
+			regs[0x0F] |= DS3231_STATUS_A2F;
+		}
+		updateInt();
+	}
+
+	// INT/SQW: 0, пока A2F при INTCN + A2IE
+	bool intLow() const {
+		return (regs[0x0E] & DS3231_CTRL_INTCN) && (regs[0x0E] & DS3231_CTRL_A2IE) &&
+			   (regs[0x0F] & DS3231_STATUS_A2F);
+	}
+
+	void updateInt() {
+		PINB.v = static_cast<uint8_t>(intLow() ? (PINB.v & ~_BV(SCHEDULE_INT_PIN)) : (PINB.v | _BV(SCHEDULE_INT_PIN)));
+	}
+
+  private:
+	uint8_t ptr_;
+	bool    first_;					// следующий записанный байт — адрес регистра
+};
+
+HostDs3231 rtc;
+
+uint32_t sleeps      = 0;		// power-down
+uint32_t sleep_bad   = 0;		// уснула не в тишине / с выходами под током
+uint32_t wake_missed = 0;		// INT так и не пришёл (2 суток)
+
+//---------------------------------------------------------------------//
+// Сон: часы идут до INT; INT -> PCINT0
+//---------------------------------------------------------------------//
+void sleep(const int mode)
+{
+	if (mode != SLEEP_MODE_PWR_DOWN) {
+		return;
+	}
+	sleeps++;
+
+	const bool quiet = song_ended && (PORTB.v & DDRB.v) == 0 && ADCSRA.v == 0 &&
+					   !(TCCR0A.v & (_BV(COM0A1) | _BV(COM0A0) | _BV(COM0B1) | _BV(COM0B0))) &&
+					   !(GTCCR.v & (_BV(COM1B1) | _BV(COM1B0))) && (SREG.v & _BV(SREG_I));
+	if (!quiet) {
+		sleep_bad++;
+	}
+
+	for (uint16_t m = 0; m < 2 * SCHEDULE_MINUTES_PER_DAY; m++) {
+		rtc.tickMinute();
+		if (rtc.intLow()) {
+			PCINT0_vect();
+			return;
+		}
+	}
+	wake_missed++;
+}
+
+//---------------------------------------------------------------------//
+// Играть до сна (или до конца песни без сна). @return переполнений Timer0
+//---------------------------------------------------------------------//
+uint32_t playUntil(const uint32_t sleepsBefore, const uint8_t songBefore)
+{
+	for (uint32_t ovf = 1; ovf <= SCHEDULE_TEST_MAX_OVF; ovf++) {
+		TIM0_OVF_vect();
+		if (ovf % SCHEDULE_TEST_LOOP == 0) {
+			Player::pollSchedule();
+			if (sleeps != sleepsBefore || song_index != songBefore) {
+				return ovf;
+			}
+		}
+	}
+	return 0;
+}
+
+void checkAlarm(const uint8_t hour, const uint8_t minute)
+{
+	HOST_CHECK_EQ(rtc.regs[0x0B], Schedule_toBcd(minute));
+	HOST_CHECK_EQ(rtc.regs[0x0C], Schedule_toBcd(hour));
+	HOST_CHECK_EQ(rtc.regs[0x0D], SCHEDULE_ALARM_ANY_DAY);
+	HOST_CHECK_EQ(rtc.regs[0x0E], DS3231_CTRL_INTCN | DS3231_CTRL_A2IE);
+	HOST_CHECK_EQ(rtc.regs[0x0F], 0);
+	HOST_CHECK(PINB.v & _BV(SCHEDULE_INT_PIN));
+}
+
+//---------------------------------------------------------------------//
+// Выбор будильника без железа
+//---------------------------------------------------------------------//
+void checkNext()
+{
+	for (uint8_t v = 0; v < 60; v++) {
+		HOST_CHECK_EQ(Schedule_fromBcd(Schedule_toBcd(v)), v);
+	}
+	HOST_CHECK_EQ(Schedule_hour(0x23), 23);
+	HOST_CHECK_EQ(Schedule_hour(0x40 | 0x12), 0);				// 12 AM
+	HOST_CHECK_EQ(Schedule_hour(0x40 | 0x20 | 0x12), 12);		// 12 PM
+	HOST_CHECK_EQ(Schedule_hour(0x40 | 0x20 | 0x11), 23);		// 11 PM
+	HOST_CHECK_EQ(Schedule_hour(0x40 | 0x01), 1);
+
+	const auto count = static_cast<uint8_t>(SCHEDULE_COUNT);
+	uint8_t song = 0;
+	HOST_CHECK_EQ(Schedule_next(schedule_table, 0, 10, 0, song), SCHEDULE_MINUTES_PER_DAY);
+	HOST_CHECK_EQ(Schedule_next(schedule_table, count, 8, 0, song), 9 * 60);		// сейчас — уже следующая
+	HOST_CHECK_EQ(Schedule_next(schedule_table, count, 12, 10, song), 12 * 60 + 30);
+	HOST_CHECK_EQ(song, 3);
+	HOST_CHECK_EQ(Schedule_next(schedule_table, count, 21, 1, song), 23 * 60 + 59);
+	HOST_CHECK_EQ(song, 5);
+	HOST_CHECK_EQ(Schedule_next(schedule_table, count, 23, 59, song), 0);			// через полночь
+	HOST_CHECK_EQ(song, 1);
+
+	// единственная строка, сейчас ровно она — завтра она же
+	static const ScheduleEntry one[] PROGMEM = { { 7, 7, 15, 2 } };
+	HOST_CHECK_EQ(Schedule_next(one, 1, 7, 15, song), 7 * 60 + 15);
+}
+
+}	// namespace
+
+int main()
+{
+	checkNext();
+
+	//=================================================================//
+	// С RTC: 20:45 -> будильники через смену часа и суток
+	//=================================================================//
+	host_reset();
+	host_i2cBegin();
+	host_i2cAttach(&rtc);
+	host_sleep = sleep;
+	rtc.setTime(20, 45);
+	rtc.updateInt();
+
+	Player::begin();
+	Player::setSong(0);
+
+	HOST_CHECK_EQ(schedule.ok, 1);
+	HOST_CHECK(PCMSK.v & _BV(SCHEDULE_INT_PIN));
+	checkAlarm(21, 0);
+
+	struct Wake {
+		uint8_t hour;
+		uint8_t minute;
+		uint8_t day;
+		uint8_t song;				// песня будильника
+		uint8_t next_hour;			// следующий будильник
+		uint8_t next_minute;
+	};
+	static const Wake wakes[] = {
+		{ 21,  0, 0, 1, 23, 59 },	// NEXT: 0 -> 1
+		{ 23, 59, 0, 5,  0,  0 },	// через полночь
+		{  0,  0, 1, 1,  8,  0 },
+		{  8,  0, 1, 2,  9,  0 },
+		{  9,  0, 1, 3, 10,  0 },
+		{ 10,  0, 1, 4, 11,  0 },
+		{ 11,  0, 1, 5, 12,  0 },
+		{ 12,  0, 1, 6, 12, 30 },
+		{ 12, 30, 1, 3, 13,  0 },
+	};
+
+	uint8_t song = song_index;
+	for (const Wake &w : wakes) {
+		const uint32_t before = sleeps;
+
+		// песня доигрывает -> сон до будильника
+		const uint32_t played = playUntil(before, song);
+		HOST_CHECK(played != 0);
+		HOST_CHECK_EQ(sleeps, before + 1);
+		HOST_CHECK_EQ(song_index, song);
+		HOST_CHECK_EQ(rtc.minuteOfDay(), w.hour * 60u + w.minute);
+		HOST_CHECK_EQ(rtc.day, w.day);
+		HOST_CHECK_EQ(schedule.alarm, 1);
+
+		// будильник -> песня строки, следующий будильник, INT отпущен
+		Player::pollSchedule();
+		printf("%u %02u:%02u: song %u (%.1f s played), next alarm %02X:%02X\n", rtc.day, w.hour, w.minute,
+			   song_index, played * 256.0 / F_CPU, rtc.regs[0x0C], rtc.regs[0x0B]);
+		HOST_CHECK_EQ(song_index, w.song);
+		HOST_CHECK_EQ(song_ended, 0);
+		HOST_CHECK_EQ(schedule.alarm, 0);
+		checkAlarm(w.next_hour, w.next_minute);
+		song = song_index;
+	}
+	HOST_CHECK_EQ(sleep_bad, 0);
+	HOST_CHECK_EQ(wake_missed, 0);
+
+	//=================================================================//
+	// Без RTC (NACK): расписания нет — песни идут подряд, сна нет
+	//=================================================================//
+	host_reset();
+	host_i2cBegin();
+	host_i2cAttach(&rtc);
+	host_sleep = sleep;
+	rtc.present = false;
+	sleeps = 0;
+
+	Player::begin();
+	Player::setSong(0);
+	HOST_CHECK_EQ(schedule.ok, 0);
+
+	HOST_CHECK(playUntil(0, 0) != 0);
+	HOST_CHECK_EQ(song_index, 1);
+	HOST_CHECK_EQ(sleeps, 0);
+	HOST_CHECK_EQ(song_ended, 0);
+
+	return host_report("ScheduleTest");
+}
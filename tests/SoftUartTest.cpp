@@ -0,0 +1,205 @@
+/**
+ * SoftUart.h через Player.h: байты Player::uartWrite() -> фронты на SOFT_UART_PIN -> приёмник 8N1.
+ *
+ * Модель:
+ *  - время — такты шкатулки: TIM1_COMPA_vect() раз в 8 * (OCR1C + 1) тактов или TIM0_OVF_vect()
+ *    раз в 256 (сэмпл — каждое AUDIO_T0_DECIMATION-е); запись PORTB — фронт в этот такт
+ *  - loop() ждёт место в буфере, читая SREG: пока бит I стоит, за чтение проходит одно прерывание таймера
+ *  - приёмник — обычный UART на номинальной SOFT_UART_BAUD: спад старт-бита, выборки в серединах бит
+ *
+ * Проверяется: принятый текст совпадает с переданным (буфер переполняется — uartWrite() ждёт),
+ * старт 0 и стоп 1 у каждого байта, фронты на сетке номинала (ошибка скорости <= 2%);
+ * при запрещённых прерываниях полный буфер не ждёт — байт теряется, принятые уходят после sei().
+ */
+#include <Arduino.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "HostAvr.h"
+
+#define PLAYER_SOFT_UART	1
+#include "Player.h"
+
+// Допуск фронта от сетки номинала, доля бита: ошибка скорости <= 2% (Player.h) к последнему фронту байта
+#define SOFT_UART_TEST_EDGE_TOL		(9 * 0.02)
+
+namespace {
+
+struct Edge {
+	double  cyc;
+	uint8_t level;
+};
+
+std::vector<Edge> edges;			// фронты TX (до первого — 1)
+double   cyc     = 0;
+double   isr_cyc = 0;				// период прерывания таймера
+uint8_t  tx      = 1;
+bool     in_isr  = false;
+
+void timerIsr()
+{
+	in_isr = true;
+	cyc += isr_cyc;
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	TIM0_OVF_vect();
+#else
+	TIM1_COMPA_vect();
+#endif
+	in_isr = false;
+}
+
+uint8_t regRead(const volatile HostReg &r)
+{
+	// loop() в цикле ожидания: прерывания разрешены — таймер его прерывает
+	if (&r == &SREG && !in_isr && (r.v & _BV(SREG_I))) {
+		timerIsr();
+	}
+	return r.v;
+}
+
+void regWrite(volatile HostReg &r, const uint8_t v)
+{
+	r.v = v;
+	if (&r == &PORTB) {
+		const uint8_t level = (v & _BV(SOFT_UART_PIN)) ? 1 : 0;
+		if (level != tx) {
+			tx = level;
+			edges.push_back({cyc, level});
+		}
+	}
+}
+
+// Линия до покоя: буфер пуст, последний байт ушёл целиком
+void drain()
+{
+	while (uart.head != uart.tail || uart.bit != 0) {
+		timerIsr();
+	}
+	for (unsigned i = 0; i < 2 * SOFT_UART_BIT_TICKS * 3; i++) {		// два бита покоя (и на Timer0)
+		timerIsr();
+	}
+}
+
+double edge_dev_max = 0;			// худший фронт, доля бита
+
+// Приёмник 8N1 на номинальной скорости
+std::string decode()
+{
+	const double bit = static_cast<double>(F_CPU) / SOFT_UART_BAUD;
+	std::string out;
+	size_t i = 0;
+
+	while (i < edges.size()) {
+		if (edges[i].level != 0) {
+			HOST_CHECK(!"фронт в 1 вне байта");
+			i++;
+			continue;
+		}
+		const double start = edges[i].cyc;
+
+		// уровень в момент t
+		auto at = [&](const double t) {
+			uint8_t level = 1;
+			for (size_t j = 0; j < edges.size() && edges[j].cyc <= t; j++) {
+				level = edges[j].level;
+			}
+			return level;
+		};
+
+		HOST_CHECK_EQ(at(start + 0.5 * bit), 0);
+		uint8_t b = 0;
+		for (int k = 0; k < 8; k++) {
+			b |= static_cast<uint8_t>(at(start + (1.5 + k) * bit) << k);
+		}
+		HOST_CHECK_EQ(at(start + 9.5 * bit), 1);
+		out.push_back(static_cast<char>(b));
+
+		// фронты байта — на сетке бит номинала
+		const double end = start + 9.5 * bit;
+		i++;
+		while (i < edges.size() && edges[i].cyc < end) {
+			const double pos = (edges[i].cyc - start) / bit;
+			edge_dev_max = std::max(edge_dev_max, fabs(pos - round(pos)));
+			i++;
+		}
+	}
+	return out;
+}
+
+void start()
+{
+	host_reset();
+	edges.clear();
+	cyc          = 0;
+	tx           = 1;
+	edge_dev_max = 0;
+
+	Player::begin();
+	Player::setSong(0);
+#if PLAYER_AUDIO_CLOCK_TIMER0
+	isr_cyc = 256;
+#else
+	isr_cyc = 8.0 * (OCR1C.v + 1);
+#endif
+	host_reg_read  = regRead;
+	host_reg_write = regWrite;
+}
+
+} // namespace
+
+int main()
+{
+	printf("audio tick %lu Hz, %lu baud, %u ticks/bit\n", static_cast<unsigned long>(PLAYER_AUDIO_HZ),
+		static_cast<unsigned long>(SOFT_UART_BAUD), static_cast<unsigned>(SOFT_UART_BIT_TICKS));
+
+	// Текст длиннее буфера: uartWrite() ждёт место, все байты 0..255
+	{
+		start();
+		sei();
+		std::string text = "Stack: static 180, max 141, free 191\r\n";
+		for (int b = 0; b < 256; b++) {
+			text.push_back(static_cast<char>(b));
+		}
+		text += "IRQ: audio avg 212 max 540 cyc\r\n";
+
+		size_t accepted = 0;
+		for (const char c : text) {
+			accepted += Player::uartWrite(static_cast<uint8_t>(c));
+		}
+		HOST_CHECK_EQ(accepted, text.size());
+		drain();
+
+		const std::string got = decode();
+		HOST_CHECK_EQ(got.size(), text.size());
+		HOST_CHECK(got == text);
+		HOST_CHECK(edge_dev_max < SOFT_UART_TEST_EDGE_TOL);
+		printf("%zu bytes, edge off grid max %.3f bit\n", got.size(), edge_dev_max);
+	}
+
+	// Прерывания запрещены: полный буфер — байт теряется, ожидания нет
+	{
+		start();
+		cli();
+		std::string text;
+		size_t accepted = 0;
+		for (int i = 0; i < SOFT_UART_BUF_LEN + 8; i++) {
+			const auto c = static_cast<char>('A' + i % 26);
+			if (Player::uartWrite(static_cast<uint8_t>(c))) {
+				text.push_back(c);
+				accepted++;
+			}
+		}
+		HOST_CHECK_EQ(accepted, SOFT_UART_BUF_LEN - 1);
+		HOST_CHECK(edges.empty());
+
+		sei();
+		drain();
+		HOST_CHECK(decode() == text);
+	}
+
+	return host_report("SoftUartTest");
+}
@@ -0,0 +1,238 @@
+/**
+ * SongStream.h: чтение песни с опережением (два блока в SRAM) из 24LCxx через Twi.h.
+ *
+ * Модель: шина USI + EEPROM (HostI2c), аудио-тик = шаг шины + Twi_tick(), нотный тик
+ * (каждые SONG_TEST_NOTE_DIV аудио-тиков) читает следующую пару байт песни, как isrNoteTick();
+ * loop() — SongStream_poll() между аудио-тиками.
+ *
+ * Проверяется: ни одного неверного байта; без помех чтение не ждёт ни разу;
+ * loop() опоздал — ISR ждёт (false), затем догоняет; ведомый растянул такт посреди байта
+ * и EEPROM занята записью (NACK) — блок дочитывается, песня продолжается.
+ */
+#include <Arduino.h>
+
+#include "HostAvr.h"
+#include "HostI2c.h"
+
+#define PLAYER_SONG_SOURCE_I2C	1
+#include "SongStream.h"
+
+// Аудио-тиков на нотный тик (~5 мс при 24 кГц)
+#define SONG_TEST_NOTE_DIV		120
+
+// Песни образа: адрес (чётный), длина
+#define SONG_TEST_SONGS			3
+
+// Нотных тиков на чтение блока с нуля (~20 байт на шине, ~370 аудио-тиков) + ожидание loop()
+#define SONG_TEST_BLOCK_TICKS	4
+
+namespace {
+
+const uint16_t song_addr[SONG_TEST_SONGS] = {0x0040, 0x0500, 0x1236};
+const uint16_t song_len[SONG_TEST_SONGS]  = {704, 322, 518};
+
+HostEeprom24 eeprom;
+volatile TwiState twi;
+volatile SongStream st;
+
+struct Reader {
+	uint8_t  song;
+	uint16_t pos;
+	uint32_t pairs;			// пар прочитано
+	uint32_t wrong;			// неверных байт
+	uint32_t misses;		// нотных тиков без пары (блок не готов)
+	uint32_t run;			// подряд без пары
+	uint32_t run_max;
+};
+
+Reader reader;
+uint32_t note_div = 0;
+uint32_t bus_errors = 0;	// TWI_ST_BUS у блока
+uint32_t nacks = 0;			// TWI_ST_NACK у блока
+
+void writeImage()
+{
+	uint8_t *m = eeprom.mem;
+	m[0] = 'M';
+	m[1] = 'B';
+	m[2] = SONG_TEST_SONGS;
+	m[3] = 0;
+	for (uint8_t i = 0; i < SONG_TEST_SONGS; i++) {
+		m[4 + 4 * i] = static_cast<uint8_t>(song_addr[i]);
+		m[5 + 4 * i] = static_cast<uint8_t>(song_addr[i] >> 8);
+		m[6 + 4 * i] = static_cast<uint8_t>(song_len[i]);
+		m[7 + 4 * i] = static_cast<uint8_t>(song_len[i] >> 8);
+		for (uint16_t k = 0; k < song_len[i]; k++) {
+			m[song_addr[i] + k] = static_cast<uint8_t>(k * 7 + i * 31 + (k >> 8));
+		}
+	}
+}
+
+// Нотный тик: следующая пара байт (как isrNoteTick(): нет блока — ждём следующий тик)
+void noteTick()
+{
+	Reader &r = reader;
+	const auto a = static_cast<uint16_t>(st.addr[r.song] + r.pos);
+
+	uint8_t cmd = 0;
+	uint8_t val = 0;
+	if (!SongStream_read(st, a, cmd) || !SongStream_read(st, static_cast<uint16_t>(a + 1), val)) {
+		r.misses++;
+		if (++r.run > r.run_max) {
+			r.run_max = r.run;
+		}
+		return;
+	}
+	r.run = 0;
+	r.pairs++;
+	if (cmd != eeprom.mem[a] || val != eeprom.mem[a + 1]) {
+		r.wrong++;
+	}
+
+	r.pos = static_cast<uint16_t>(r.pos + 2);
+	if (r.pos >= st.len[r.song]) {
+		r.song = static_cast<uint8_t>((r.song + 1) % SONG_TEST_SONGS);
+		r.pos  = 0;
+	}
+}
+
+// Аудио-ISR: фронт SCL, нотный тик; затем USI_OVF
+void audioTick()
+{
+	host_i2cTick();
+	Twi_tick(twi);
+	if (++note_div == SONG_TEST_NOTE_DIV) {
+		note_div = 0;
+		noteTick();
+	}
+	if (host_i2cOverflow()) {
+		Twi_onOverflow(twi);
+	}
+}
+
+// loop(): опрос потока; статус законченного блока — до того, как poll его заберёт
+void loopPoll()
+{
+	if (st.loading != SONG_STREAM_NO_BLOCK) {
+		const uint8_t status = st.xfer.status;
+		if (status == TWI_ST_BUS) {
+			bus_errors++;
+		} else if (status == TWI_ST_NACK) {
+			nacks++;
+		}
+	}
+	SongStream_poll(st, twi);
+}
+
+void run(const uint32_t ticks, const bool polling)
+{
+	for (uint32_t i = 0; i < ticks; i++) {
+		audioTick();
+		if (polling) {
+			loopPoll();
+		}
+	}
+}
+
+// До начала песни song (первая пара уже прочитана)
+void runToSong(const uint8_t song)
+{
+	for (uint32_t guard = 0; guard < 2000000; guard++) {
+		if (reader.song == song && reader.pos == 2) {
+			return;
+		}
+		run(1, true);
+	}
+	HOST_CHECK(!"song never reached");
+}
+
+void resetCounters()
+{
+	reader.misses  = 0;
+	reader.run     = 0;
+	reader.run_max = 0;
+}
+
+}	// namespace
+
+int main()
+{
+	host_reset();
+	writeImage();
+	host_i2cBegin();
+	host_i2cAttach(&eeprom);
+	eeprom.write_ticks = 120;
+
+	// загрузка: каталог через Twi_run() до sei()
+	Twi_begin(twi);
+	HOST_CHECK_EQ(SongStream_begin(st, twi), SONG_TEST_SONGS);
+	for (uint8_t i = 0; i < SONG_TEST_SONGS; i++) {
+		HOST_CHECK_EQ(st.addr[i], song_addr[i]);
+		HOST_CHECK_EQ(st.len[i], song_len[i]);
+	}
+	HOST_CHECK(host_i2cIdle());
+	sei();
+
+	// 1. первая песня: после первого блока чтение не ждёт ни разу
+	//    (при старте want = 0 — сначала подкачивается блок каталога, потом блок песни)
+	runToSong(0);
+	const uint32_t coldMisses = reader.misses;
+	resetCounters();
+	runToSong(1);
+	printf("steady: %u pairs, cold start %u note ticks, jump to song 1 %u\n",
+		   reader.pairs, coldMisses, reader.misses);
+	HOST_CHECK(coldMisses <= 2 * SONG_TEST_BLOCK_TICKS);
+	// переход на песню в другом месте EEPROM — блок курсора подкачивается с нуля, один раз
+	HOST_CHECK(reader.misses <= SONG_TEST_BLOCK_TICKS);
+	HOST_CHECK_EQ(reader.misses, reader.run_max);
+
+	// 2. loop() опоздал на 40 нотных тиков посреди песни: ISR ждёт (false), потом догоняет
+	run(SONG_TEST_NOTE_DIV * 20, true);
+	resetCounters();
+	run(SONG_TEST_NOTE_DIV * 40, false);
+	const uint32_t stalled = reader.misses;
+	resetCounters();
+	run(SONG_TEST_NOTE_DIV * 20, true);
+	printf("late refill: read-ahead covered %u of 40 note ticks, caught up in %u\n", 40 - stalled, reader.misses);
+	// в запасе — остаток блока курсора + следующий блок (<= 16 пар)
+	HOST_CHECK(stalled >= 40 - SONG_STREAM_BLOCK);
+	HOST_CHECK(stalled < 40);
+	HOST_CHECK(reader.misses <= SONG_TEST_BLOCK_TICKS);
+
+	// 3. ведомый держит SCL посреди байта блока (меньше TWI_STRETCH_MAX_TICKS):
+	//    блок дочитан без сброса шины, опережение покрывает задержку
+	runToSong(2);
+	resetCounters();
+	while (!(st.loading != SONG_STREAM_NO_BLOCK && twi.phase == TWI_PH_SHIFT && twi.step == TWI_STEP_RX)) {
+		run(1, true);
+	}
+	host_i2cStretch(TWI_STRETCH_MAX_TICKS - 40);
+	run(SONG_TEST_NOTE_DIV * 10, true);
+	printf("stalled byte: SCL held %u ticks, %u note ticks waiting\n", host_i2c_stretched, reader.misses);
+	HOST_CHECK(host_i2c_stretched >= TWI_STRETCH_MAX_TICKS - 40);
+	HOST_CHECK_EQ(bus_errors, 0);
+	HOST_CHECK_EQ(reader.misses, 0);
+
+	// 4. EEPROM пишет страницу, когда loop() ставит блок: NACK на адрес, блок перезапрашивается
+	resetCounters();
+	while (st.loading == SONG_STREAM_NO_BLOCK) {
+		run(1, true);
+	}
+	eeprom.busy = 2 * SONG_TEST_NOTE_DIV;
+	run(SONG_TEST_NOTE_DIV * 10, true);
+	printf("busy EEPROM: %u NACKs, %u note ticks waiting\n", nacks, reader.misses);
+	HOST_CHECK(nacks > 0);
+	HOST_CHECK_EQ(reader.misses, 0);
+
+	// дальше — без помех, круг до второй песни: ждём только на переходах между песнями
+	resetCounters();
+	runToSong(0);
+	runToSong(1);
+	printf("total: %u pairs, %u wrong bytes, %u bus errors\n", reader.pairs, reader.wrong, bus_errors);
+	HOST_CHECK_EQ(reader.wrong, 0);
+	HOST_CHECK_EQ(bus_errors, 0);
+	HOST_CHECK(reader.run_max <= SONG_TEST_BLOCK_TICKS);
+	HOST_CHECK(reader.misses <= 3 * SONG_TEST_BLOCK_TICKS);
+
+	return host_report("SongStreamTest");
+}
@@ -0,0 +1,121 @@
+/**
+ * Stack.h: покраска свободной SRAM и отметка самого глубокого стека.
+ *
+ * Модель: SRAM ATtiny85 (RAMSTART..RAMEND, 512 байт) — массив host_sram, символы линкера
+ * _end (конец статики) и __stack (RAMEND) — его элементы. Стек растёт вниз от __stack:
+ * кадр — запись N байт под вершиной, возврат покраску не восстанавливает.
+ * Проверяется: покраска ровно _end..__stack, статика не тронута; Stack_maxUsed() / Stack_free()
+ * после кадров разной глубины, ISR поверх loop(), байты, совпавшие с STACK_CANARY, стек до _end.
+ */
+#include <string.h>
+
+#include <avr/io.h>
+
+#include "HostAvr.h"
+
+// Статика модели (.data + .bss), байт
+#define STACK_TEST_STATIC	150
+
+// Вершина стека (__stack = RAMEND) — от начала SRAM (для .set — числом)
+#define STACK_TEST_TOP		511
+
+// SRAM модели: RAMSTART — начало массива
+uint8_t host_sram[RAMEND - RAMSTART + 1];
+static_assert(sizeof(host_sram) == STACK_TEST_TOP + 1, "STACK_TEST_TOP != RAMEND - RAMSTART");
+#undef  RAMSTART
+#define RAMSTART			host_sram
+
+// Символы линкера — внутри массива (ниже, .set)
+#define _end				host_end
+#define __stack				host_stack
+
+#define PLAYER_STACK_PAINT	1
+#include "Stack.h"
+
+#define STACK_TEST_STR(x)	#x
+#define STACK_TEST_XSTR(x)	STACK_TEST_STR(x)
+__asm__(
+	".globl host_end\n"
+	".set host_end, host_sram + " STACK_TEST_XSTR(STACK_TEST_STATIC) "\n"
+	".globl host_stack\n"
+	".set host_stack, host_sram + " STACK_TEST_XSTR(STACK_TEST_TOP) "\n"
+);
+
+namespace {
+
+// Свободная SRAM между статикой и вершиной (включительно), байт
+const uint16_t FREE = sizeof(host_sram) - STACK_TEST_STATIC;
+
+// Кадр стека глубиной depth от вершины: байты-"адреса возврата" и данные (не только не-канарейка)
+void push(const uint16_t depth, const uint8_t seed)
+{
+	for (uint16_t i = 0; i < depth; i++) {
+		const auto v = static_cast<uint8_t>(seed + i * 7);
+		// глубже всего — заведомо не канарейка, выше — как придётся (в т.ч. STACK_CANARY)
+		(&__stack)[-static_cast<int>(i)] = (i == depth - 1 && v == STACK_CANARY) ? 0 : v;
+	}
+}
+
+} // namespace
+
+int main()
+{
+	host_reset();
+
+	// SRAM после сброса — мусор, статика — свои данные
+	for (size_t i = 0; i < sizeof(host_sram); i++) {
+		host_sram[i] = static_cast<uint8_t>(i * 13 + 1);
+	}
+	uint8_t statics[STACK_TEST_STATIC];
+	memcpy(statics, host_sram, sizeof(statics));
+
+	HOST_CHECK(&_end == host_sram + STACK_TEST_STATIC);
+	HOST_CHECK(&__stack == host_sram + sizeof(host_sram) - 1);
+	HOST_CHECK_EQ(Stack_staticUsed(), STACK_TEST_STATIC);
+
+	// Покраска: ровно _end..__stack включительно
+	Stack_paint();
+	HOST_CHECK(memcmp(statics, host_sram, sizeof(statics)) == 0);
+	uint16_t painted = 0;
+	for (size_t i = STACK_TEST_STATIC; i < sizeof(host_sram); i++) {
+		painted += (host_sram[i] == STACK_CANARY);
+	}
+	HOST_CHECK_EQ(painted, FREE);
+	HOST_CHECK_EQ(Stack_maxUsed(), 0);
+	HOST_CHECK_EQ(Stack_free(), FREE);
+
+	// Один байт на вершине — граница __stack включительно
+	(&__stack)[0] = 0x12;
+	HOST_CHECK_EQ(Stack_maxUsed(), 1);
+	HOST_CHECK_EQ(Stack_free(), FREE - 1);
+
+	// loop(): кадр 60 байт; возврат покраску не восстанавливает, мелкий кадр отметку не двигает
+	push(60, 0x21);
+	HOST_CHECK_EQ(Stack_maxUsed(), 60);
+	push(20, 0x40);
+	HOST_CHECK_EQ(Stack_maxUsed(), 60);
+	HOST_CHECK_EQ(Stack_free(), FREE - 60);
+
+	// ISR поверх loop(): ещё 41 байт под кадром loop() (push считает от вершины)
+	push(101, 0x55);
+	HOST_CHECK_EQ(Stack_maxUsed(), 101);
+	HOST_CHECK_EQ(Stack_free(), FREE - 101);
+	HOST_CHECK_EQ(Stack_maxUsed() + Stack_free(), FREE);
+
+	// Внутри кадра байт STACK_CANARY — отметку ищут снизу, он не мешает
+	(&__stack)[-50] = STACK_CANARY;
+	HOST_CHECK_EQ(Stack_maxUsed(), 101);
+
+	// Стек дошёл до конца статики: свободно 0, статика цела
+	push(FREE, 0x77);
+	HOST_CHECK_EQ(Stack_maxUsed(), FREE);
+	HOST_CHECK_EQ(Stack_free(), 0);
+	HOST_CHECK(memcmp(statics, host_sram, sizeof(statics)) == 0);
+
+	// Повторная покраска (как после сброса) — снова всё свободно
+	Stack_paint();
+	HOST_CHECK_EQ(Stack_maxUsed(), 0);
+	HOST_CHECK_EQ(Stack_free(), FREE);
+
+	return host_report("StackTest");
+}
@@ -0,0 +1,42 @@
+/**
+ * Player.h в пространстве имён SYNC_BOX (leader / follower, задаётся при сборке).
+ * Системные заголовки и заглушки — снаружи, до пространства имён (#pragma once).
+ */
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
+
+#include "SyncBox.h"
+
+namespace SYNC_BOX {
+
+// свои пины у каждой шкатулки (закрывают глобальные из stubs/avr/io.h)
+volatile HostReg PORTB;		// NOLINT
+volatile HostReg DDRB;		// NOLINT
+volatile HostReg PINB;		// NOLINT
+
+#include "Player.h"
+
+static void boxBegin() { Player::begin(); }
+static void boxAudioTick() { TIM1_COMPA_vect(); }
+static uint8_t boxPort() { return PORTB.v; }
+static uint8_t boxDdr() { return DDRB.v; }
+static void boxSetPin(const uint8_t pinb) { PINB.v = pinb; }
+static uint8_t boxSongIndex() { return song_index; }
+static int16_t boxSongPos() { return song_pos; }
+static uint8_t boxNoteTickDivCnt() { return note_tick_div_cnt; }
+static uint8_t boxNoteTickDivTop() { return note_tick_div_top; }
+
+#if PLAYER_SYNC == SYNC_FOLLOWER
+static uint16_t boxAlive() { return sync.alive; }
+#else
+static uint16_t boxAlive() { return 0; }
+#endif
+
+extern const SyncBox box = {
+	boxBegin, boxAudioTick, boxPort, boxDdr, boxSetPin,
+	boxSongIndex, boxSongPos, boxNoteTickDivCnt, boxNoteTickDivTop, boxAlive,
+};
+
+}	// namespace SYNC_BOX
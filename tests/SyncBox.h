@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @file SyncBox.h
+ * Одна шкатулка для SyncTest: Player.h, собранный в своём пространстве имён
+ * (SyncBox.cpp дважды: leader — PLAYER_SYNC=1, follower — PLAYER_SYNC=2).
+ *
+ * У каждой шкатулки свои PORTB/DDRB/PINB — провод между ними соединяет тест.
+ */
+struct SyncBox {
+	void     (*begin)();
+	void     (*audioTick)();				// ISR аудио-тика
+	uint8_t  (*port)();						// PORTB
+	uint8_t  (*ddr)();						// DDRB
+	void     (*setPin)(uint8_t pinb);		// PINB перед следующим тиком
+	uint8_t  (*songIndex)();
+	int16_t  (*songPos)();
+	uint8_t  (*noteTickDivCnt)();
+	uint8_t  (*noteTickDivTop)();
+	uint16_t (*alive)();					// ведомый: нотных тиков до "ведущий потерян"
+};
+
+namespace leader { extern const SyncBox box; }
+namespace follower { extern const SyncBox box; }
@@ -0,0 +1,173 @@
+/**
+ * Sync.h: ведущий и ведомый на одном проводе, часы ведомого сбиты на несколько процентов.
+ *
+ * Каждое событие песни (song_index, song_pos) ведомый должен начинать не раньше ведущего
+ * и не позже чем через нотный тик (+ пара аудио-тиков на приём старт-бита), весь прогон —
+ * в том числе если ведомого включили посреди песни. Без провода те же часы расходятся.
+ */
+#include <vector>
+
+#include <Arduino.h>
+
+#include "HostAvr.h"
+#include "SyncBox.h"
+#include "Sync.h"
+
+// Допуск фазы нотного тика: аудио-тик на приём старт-бита + расхождение часов за нотный тик
+#define SYNC_TEST_PHASE_TICKS	6
+
+namespace {
+
+struct Event {
+	double  t;			// с
+	uint8_t idx;
+	int16_t pos;
+	bool    song;		// смена песни (начало паузы между песнями), не событие
+	uint8_t peer;		// ведомый: note_tick_div_cnt ведущего в этот момент
+};
+
+struct Box {
+	const SyncBox &b;
+	double tick;		// период аудио-тика, с
+	double start;		// включение, с
+	uint32_t n;			// аудио-тиков
+	uint8_t idx;
+	int16_t pos;
+	std::vector<Event> events;
+
+	double next() const { return start + n * tick; }
+
+	void step()
+	{
+		b.audioTick();
+		n++;
+		const uint8_t i = b.songIndex();
+		const int16_t p = b.songPos();
+		if (i != idx || p != pos) {
+			events.push_back(Event{next(), i, p, i != idx, 0});
+			idx = i;
+			pos = p;
+		}
+	}
+};
+
+struct Result {
+	size_t events;		// событий ведомого после захвата
+	size_t late;		// из них вне окна
+	double lag_max;		// с
+	uint8_t phase_max;	// самое большое расхождение фазы нотного тика, аудио-тиков
+	uint16_t alive;
+};
+
+/**
+ * @param skew   — ошибка часов ведомого (0.02 = на 2% быстрее)
+ * @param start  — ведомый включается позже, с
+ * @param wired  — провод подключён
+ */
+Result run(const double skew, const double start, const bool wired, const double seconds)
+{
+	host_reset();
+	leader::box.begin();
+	follower::box.begin();
+
+	const double tick = 8.0 * (OCR1C + 1) / F_CPU;
+	Box l{leader::box, tick, 0, 0, 0xFF, -1, {}};
+	Box f{follower::box, tick / (1.0 + skew), start, 0, 0xFF, -1, {}};
+
+	while (l.next() < seconds || f.next() < seconds) {
+		if (l.next() <= f.next()) {
+			l.step();
+			continue;
+		}
+
+		// линия: ведущий держит выход, иначе — подтяжка ведомого
+		uint8_t line = _BV(SYNC_PIN);
+		if (wired && (leader::box.ddr() & _BV(SYNC_PIN))) {
+			line = leader::box.port() & _BV(SYNC_PIN);
+		}
+		f.b.setPin(line);
+		const size_t was = f.events.size();
+		f.step();
+		if (f.events.size() != was) {
+			f.events.back().peer = leader::box.noteTickDivCnt();
+		}
+	}
+
+	// захват: кадр (5 байт по 10 бит по 4 тика) + событие на случай расхождения
+	const double lock = start + 0.5;
+	const double note = f.b.noteTickDivTop() * f.tick;
+	const uint8_t top = l.b.noteTickDivTop();
+
+	Result r{0, 0, 0, 0, f.b.alive()};
+	for (const Event &e : f.events) {
+		// смена песни меткой не отмечается (кадр уйдёт с первым событием после паузы)
+		if (e.song || e.t < lock || e.t > seconds - 1.0) {
+			continue;
+		}
+		r.events++;
+
+		// последнее событие ведущего с той же позицией, начавшееся до ведомого
+		double lag = 1e9;
+		for (size_t k = l.events.size(); k-- > 0;) {
+			const Event &le = l.events[k];
+			if (le.t > e.t + 2 * tick) {
+				continue;
+			}
+			if (le.idx == e.idx && le.pos == e.pos) {
+				lag = e.t - le.t;
+				break;
+			}
+			if (e.t - le.t > 1.0) {
+				break;
+			}
+		}
+
+		if (lag < -2 * tick || lag > note + 3 * tick) {
+			r.late++;
+		} else if (lag > r.lag_max) {
+			r.lag_max = lag;
+		}
+
+		// ведомый начал событие на своём нотном тике (счётчик 0) — у ведущего тоже около нуля
+		const uint8_t phase = (e.peer < top / 2) ? e.peer : static_cast<uint8_t>(top - e.peer);
+		if (phase > r.phase_max) {
+			r.phase_max = phase;
+		}
+	}
+	return r;
+}
+
+void checkLocked(const char *name, const Result &r)
+{
+	printf("%s: %zu events, %zu out of window, lag max %.2f ms, phase max %u ticks\n",
+		   name, r.events, r.late, r.lag_max * 1e3, r.phase_max);
+	HOST_CHECK(r.events > 100);
+	HOST_CHECK_EQ(r.late, 0);
+	HOST_CHECK(r.phase_max <= SYNC_TEST_PHASE_TICKS);
+	HOST_CHECK(r.alive > 0);
+}
+
+}	// namespace
+
+int main()
+{
+	const double seconds = 60.0;
+
+	// ведомый на 2% быстрее: ждёт метку ведущего (syncHold)
+	checkLocked("follower +2%", run(0.02, 0, true, seconds));
+
+	// ведомый на 2% медленнее: метка обрывает текущее событие
+	checkLocked("follower -2%", run(-0.02, 0, true, seconds));
+
+	// включили посреди песни: кадр переводит на позицию ведущего
+	checkLocked("follower +1%, late start", run(0.01, 7.3, true, seconds));
+
+	// без провода те же часы расходятся — окно проверки не пустое
+	const Result free = run(0.02, 0, false, seconds);
+	printf("unwired +2%%: %zu events, %zu out of window, phase max %u ticks\n", free.events, free.late, free.phase_max);
+	HOST_CHECK(free.late > free.events / 2);
+	HOST_CHECK(free.phase_max > SYNC_TEST_PHASE_TICKS);
+	HOST_CHECK_EQ(free.alive, 0);
+
+	return host_report("SyncTest");
+}
@@ -0,0 +1,235 @@
+/**
+ * Upload.h: кадры songupload.py по линии PB2 -> слот EEPROM.
+ *
+ * Модель:
+ *  - линия — фронты UART 8N1 UPLOAD_BAUD, часы адаптера сбиты на 1%, между байтами — случайные паузы
+ *  - фронт -> PCINT0 (Upload_onEdge(), пока бит пина в PCMSK); аудио-тик — Upload_tick(),
+ *    нотный тик — Upload_noteTick(), loop() — Upload_poll() через тик; частоты — как Player.h (Timer1)
+ *  - EEPROM — массив, запись байта ~3.3 мс; запись в занятую EEPROM — ошибка (HostAvr)
+ *  - события разбираются, как Player::pollUpload(): START — слот пропал, DONE — длина слота
+ *
+ * Сценарий: хороший кадр (после мусора на линии) -> слот; испорченный (CRC) -> брошен, слот пуст;
+ * оборванный -> брошен по таймауту; пауза 2 с, второй хороший кадр другой длины -> слот.
+ */
+#include <math.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <Arduino.h>
+#include "HostAvr.h"
+
+#define PLAYER_SONG_UPLOAD		1
+#include "Upload.h"
+
+// Аудио-тик Player.h без Timer0: CK/8, OCR1C = 85
+#define UPLOAD_TEST_AUDIO_HZ	(F_CPU / 688.0)
+
+// Аудио-тиков на нотный тик (~5 мс)
+#define UPLOAD_TEST_NOTE_TICKS	120
+
+// Слот, как EEPROM_ADDR_UPLOAD в Player.h
+#define UPLOAD_TEST_BASE		16
+
+// Часы USB-UART адаптера относительно номинала
+#define UPLOAD_TEST_BAUD_ERROR	0.01
+
+// Запись байта EEPROM ATtiny85, с
+#define UPLOAD_TEST_EEPROM_S	0.0033
+
+namespace {
+
+struct Edge {
+	double  t;
+	uint8_t level;
+};
+
+volatile UploadState upload;
+
+std::vector<Edge>    line;
+std::vector<uint8_t> events;		// UPLOAD_EV_* из loop()
+size_t   edge_i   = 0;
+uint32_t ticks    = 0;
+uint8_t  level    = 1;
+uint16_t slot_len = 0;				// как upload_len в Player.h
+
+std::vector<uint8_t> frame(const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> f = {'M', 'U', static_cast<uint8_t>(data.size()), static_cast<uint8_t>(data.size() >> 8)};
+	uint16_t crc = 0xFFFF;
+	for (const uint8_t b : data) {
+		f.push_back(b);
+		crc = _crc_ccitt_update(crc, b);
+	}
+	f.push_back(static_cast<uint8_t>(crc));
+	f.push_back(static_cast<uint8_t>(crc >> 8));
+	return f;
+}
+
+// Поток пар (нота, длительность), как midi2code.py --bin
+std::vector<uint8_t> song(const size_t pairs, const uint8_t seed)
+{
+	std::vector<uint8_t> s;
+	for (size_t i = 0; i < pairs; i++) {
+		s.push_back(static_cast<uint8_t>(60 + (i * 5 + seed) % 24));
+		s.push_back(static_cast<uint8_t>(1 + (i + seed) % 8));
+	}
+	return s;
+}
+
+// Байты на линию с момента t, с; @return конец последнего стоп-бита, с
+double send(const std::vector<uint8_t> &bytes, double t)
+{
+	const double bit = 1.0 / (UPLOAD_BAUD * (1.0 + UPLOAD_TEST_BAUD_ERROR));
+	for (const uint8_t b : bytes) {
+		for (int k = 0; k < 10; k++) {
+			const uint8_t v = (k == 0) ? 0 : (k <= 8) ? ((b >> (k - 1)) & 1) : 1;
+			line.push_back(Edge{t, v});
+			t += bit;
+		}
+		t += bit * (rand() % 4) * 0.25;
+	}
+	return t;
+}
+
+// loop(): Player::pollUpload()
+void pollUpload()
+{
+	const uint8_t ev = Upload_poll(upload);
+	if (ev == UPLOAD_EV_NONE) {
+		return;
+	}
+	events.push_back(ev);
+	if (ev == UPLOAD_EV_START) {
+		slot_len = 0;
+	} else if (ev == UPLOAD_EV_DONE) {
+		slot_len = upload.len;
+	}
+}
+
+// Фронты, аудио-тики и loop() до момента t, с
+void runUntil(const double t)
+{
+	for (;;) {
+		const double tick = ticks / UPLOAD_TEST_AUDIO_HZ;
+
+		if (edge_i < line.size() && line[edge_i].t <= tick) {
+			const uint8_t v = line[edge_i++].level;
+			if (v != level) {
+				level  = v;
+				PINB.v = static_cast<uint8_t>(v ? (PINB.v | _BV(UPLOAD_PIN)) : (PINB.v & ~_BV(UPLOAD_PIN)));
+				if ((GIMSK.v & _BV(PCIE)) && (PCMSK.v & _BV(UPLOAD_PIN))) {
+					Upload_onEdge(upload);
+				}
+			}
+			continue;
+		}
+		if (tick > t) {
+			return;
+		}
+
+		Upload_tick(upload);
+		if (ticks % UPLOAD_TEST_NOTE_TICKS == 0) {
+			Upload_noteTick(upload);
+		}
+		host_eepromTick();
+		if (ticks & 1) {
+			pollUpload();
+		}
+		ticks++;
+	}
+}
+
+bool slotHolds(const std::vector<uint8_t> &data)
+{
+	for (size_t i = 0; i < data.size(); i++) {
+		if (host_eeprom[UPLOAD_TEST_BASE + UPLOAD_HDR_LEN + i] != data[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Слот после перезагрузки: CRC заново
+uint16_t slotAfterReboot(const uint8_t bitTicks)
+{
+	UploadState fresh;
+	return Upload_begin(fresh, UPLOAD_TEST_BASE, bitTicks);
+}
+
+bool eventsAre(const std::vector<uint8_t> &want)
+{
+	const bool same = (events == want);
+	events.clear();
+	return same;
+}
+
+}	// namespace
+
+int main()
+{
+	host_reset();
+	srand(1);
+
+	const auto bit_ticks = static_cast<uint8_t>(lround(UPLOAD_TEST_AUDIO_HZ / UPLOAD_BAUD));
+	host_eeprom_write_ticks = static_cast<uint16_t>(ceil(UPLOAD_TEST_EEPROM_S * UPLOAD_TEST_AUDIO_HZ));
+	PINB.v = _BV(UPLOAD_PIN);
+
+	slot_len = Upload_begin(upload, UPLOAD_TEST_BASE, bit_ticks);
+	HOST_CHECK_EQ(slot_len, 0);
+	HOST_CHECK(PCMSK.v & _BV(UPLOAD_PIN));
+	HOST_CHECK(PORTB.v & _BV(UPLOAD_PIN));
+
+	// 1. хороший кадр; перед ним мусор и лишняя 'M' — синхронизация по "MU"
+	const std::vector<uint8_t> a = song(60, 0);
+	std::vector<uint8_t> bytes = {0x00, 0x55, 'M'};
+	const std::vector<uint8_t> fa = frame(a);
+	bytes.insert(bytes.end(), fa.begin(), fa.end());
+	double t = send(bytes, 0.05);
+	runUntil(t + 0.1);
+
+	printf("frame 1: slot len %u, %u EEPROM writes\n", slot_len, host_eeprom_writes);
+	HOST_CHECK(eventsAre({UPLOAD_EV_START, UPLOAD_EV_DONE}));
+	HOST_CHECK_EQ(slot_len, a.size());
+	HOST_CHECK(slotHolds(a));
+	HOST_CHECK_EQ(slotAfterReboot(bit_ticks), a.size());
+
+	// 2. испорченный кадр: бит данных перевёрнут — CRC не сходится, слот пуст
+	std::vector<uint8_t> fb = frame(song(40, 3));
+	fb[UPLOAD_HDR_LEN + 11] ^= 0x10;
+	t = send(fb, t + 0.5);
+	runUntil(t + 0.1);
+
+	printf("frame 2 (bad CRC): slot len %u, len hi 0x%02X\n", slot_len, host_eeprom[UPLOAD_TEST_BASE + 1]);
+	HOST_CHECK(eventsAre({UPLOAD_EV_START, UPLOAD_EV_ERROR}));
+	HOST_CHECK_EQ(slot_len, 0);
+	HOST_CHECK_EQ(upload.state, UPLOAD_ST_SYNC0);
+	HOST_CHECK_EQ(host_eeprom[UPLOAD_TEST_BASE + 1], 0xFF);
+	HOST_CHECK_EQ(slotAfterReboot(bit_ticks), 0);
+
+	// 3. оборванный кадр: адаптер выдернули на середине — бросается по таймауту
+	// (UPLOAD_TIMEOUT_NOTE_TICKS нотных тиков = 1 с)
+	const std::vector<uint8_t> fc = frame(song(50, 5));
+	t = send(std::vector<uint8_t>(fc.begin(), fc.begin() + 40), t + 0.5);
+	runUntil(t + 0.9);
+	HOST_CHECK(eventsAre({UPLOAD_EV_START}));
+	HOST_CHECK_EQ(upload.state, UPLOAD_ST_DATA);
+	runUntil(t + 1.1);
+	HOST_CHECK(eventsAre({UPLOAD_EV_ERROR}));
+	HOST_CHECK_EQ(upload.state, UPLOAD_ST_SYNC0);
+	HOST_CHECK_EQ(slotAfterReboot(bit_ticks), 0);
+
+	// 4. пауза, второй хороший кадр другой длины
+	const std::vector<uint8_t> d = song(24, 7);
+	t = send(frame(d), t + 2.0);
+	runUntil(t + 0.1);
+
+	printf("frame 4 after pause: slot len %u, %u EEPROM writes\n", slot_len, host_eeprom_writes);
+	HOST_CHECK(eventsAre({UPLOAD_EV_START, UPLOAD_EV_DONE}));
+	HOST_CHECK_EQ(slot_len, d.size());
+	HOST_CHECK(slotHolds(d));
+	HOST_CHECK_EQ(slotAfterReboot(bit_ticks), d.size());
+	HOST_CHECK_EQ(upload.overrun, 0);
+
+	return host_report("UploadTest");
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+// Хост-заглушка ядра Digistump: плееру из ядра нужна только F_CPU
+#ifndef F_CPU
+	#define F_CPU			16500000UL
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file eeprom.h
+ * Хост-заглушка: EEPROM — массив host_eeprom (tests/HostAvr.cpp).
+ * Запись держит EEPROM занятой host_eeprom_write_ticks шагов host_eepromTick().
+ */
+
+#define EEMEM
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_write_byte(uint8_t *addr, uint8_t v);
+void eeprom_update_byte(uint8_t *addr, uint8_t v);
+bool eeprom_is_ready();
+
+#define eeprom_busy_wait()
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <avr/io.h>
+
+/**
+ * @file interrupt.h
+ * Хост-заглушка: ISR — обычная функция (её вызывает тест), cli()/sei() — бит I в SREG.
+ */
+
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR(v, ...)			void v(void)
+
+static inline void cli() { SREG.v = static_cast<uint8_t>(SREG.v & ~_BV(SREG_I)); }
+static inline void sei() { SREG.v = static_cast<uint8_t>(SREG.v | _BV(SREG_I)); }
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file io.h
+ * Хост-заглушка <avr/io.h> для тестов (tests/): регистры ATtiny85 — объекты HostReg.
+ *
+ * По умолчанию регистр — просто байт. Тест, которому нужно железо (линия, таймер, USI),
+ * ставит host_reg_read / host_reg_write и узнаёт регистр по адресу (&r == &PINB).
+ */
+
+#define __AVR_ATtiny85__	1
+
+struct HostReg;
+
+// Перехват чтения/записи регистров (nullptr — обычный байт)
+extern uint8_t (*host_reg_read)(const volatile HostReg &r);
+extern void (*host_reg_write)(volatile HostReg &r, uint8_t v);
+
+struct HostReg {
+	uint8_t v;
+
+	operator uint8_t() const volatile {
+		return host_reg_read ? host_reg_read(*this) : v;
+	}
+	// void: прошивка присваивания регистров не сцепляет
+	void operator=(const unsigned n) volatile {
+		if (host_reg_write) {
+			host_reg_write(*this, static_cast<uint8_t>(n));
+		} else {
+			v = static_cast<uint8_t>(n);
+		}
+	}
+	void operator|=(const unsigned n) volatile { *this = static_cast<uint8_t>(*this) | n; }
+	void operator&=(const unsigned n) volatile { *this = static_cast<uint8_t>(*this) & n; }
+	void operator^=(const unsigned n) volatile { *this = static_cast<uint8_t>(*this) ^ n; }
+};
+
+#define HOST_REG(n)			extern volatile HostReg n
+#define HOST_REG16(n)		extern volatile uint16_t n
+
+HOST_REG(DDRB); HOST_REG(PORTB); HOST_REG(PINB);
+HOST_REG(TCCR0A); HOST_REG(TCCR0B); HOST_REG(OCR0A); HOST_REG(OCR0B); HOST_REG(TCNT0);
+HOST_REG(TCCR1); HOST_REG(OCR1A); HOST_REG(OCR1B); HOST_REG(OCR1C); HOST_REG(TCNT1); HOST_REG(GTCCR);
+HOST_REG(TIMSK); HOST_REG(TIFR); HOST_REG(GIMSK); HOST_REG(GIFR); HOST_REG(PCMSK); HOST_REG(MCUCR);
+HOST_REG(ADMUX); HOST_REG(ADCSRA); HOST_REG(ADCSRB); HOST_REG(ADCL); HOST_REG(ADCH); HOST_REG(DIDR0); HOST_REG(ACSR);
+HOST_REG(EECR); HOST_REG(EEDR); HOST_REG(EEARL);
+HOST_REG(USICR); HOST_REG(USISR); HOST_REG(USIDR); HOST_REG(USIBR);
+HOST_REG(OSCCAL); HOST_REG(SREG); HOST_REG(SPL); HOST_REG(SPH); HOST_REG(PLLCSR);
+HOST_REG(WDTCR); HOST_REG(PRR); HOST_REG(MCUSR); HOST_REG(GPIOR0); HOST_REG(GPIOR1); HOST_REG(GPIOR2); HOST_REG(DWDR);
+HOST_REG16(ADC); HOST_REG16(ADCW); HOST_REG16(EEAR); HOST_REG16(SP);
+
+#define _BV(b)				(1u << (b))
+#define _SFR_IO_ADDR(r)		0
+
+// PORTB
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+#define PINB4 4
+#define PINB5 5
+
+// Timer0
+#define COM0A1 7
+#define COM0A0 6
+#define COM0B1 5
+#define COM0B0 4
+#define WGM01 1
+#define WGM00 0
+#define WGM02 3
+#define CS02 2
+#define CS01 1
+#define CS00 0
+
+// Timer1
+#define CTC1 7
+#define PWM1A 6
+#define COM1A1 5
+#define COM1A0 4
+#define CS13 3
+#define CS12 2
+#define CS11 1
+#define CS10 0
+#define TSM 7
+#define PWM1B 6
+#define COM1B1 5
+#define COM1B0 4
+#define PSR1 1
+#define PSR0 0
+
+// TIMSK / TIFR
+#define OCIE1A 6
+#define OCIE1B 5
+#define OCIE0A 4
+#define OCIE0B 3
+#define TOIE1 2
+#define TOIE0 1
+#define OCF1A 6
+#define OCF1B 5
+#define OCF0A 4
+#define OCF0B 3
+#define TOV1 2
+#define TOV0 1
+
+// Внешние прерывания
+#define INT0 6
+#define PCIE 5
+#define INTF0 6
+#define PCIF 5
+#define ISC01 1
+#define ISC00 0
+#define PCINT0 0
+#define PCINT1 1
+#define PCINT2 2
+#define PCINT3 3
+#define PCINT4 4
+#define PCINT5 5
+
+// АЦП / компаратор
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define REFS2 4
+#define MUX3 3
+#define MUX2 2
+#define MUX1 1
+#define MUX0 0
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+#define ADC1D 2
+#define ADC2D 4
+#define ADC3D 3
+#define ACD 7
+
+// EEPROM
+#define EEPM1 5
+#define EEPM0 4
+#define EERIE 3
+#define EEMPE 2
+#define EEPE 1
+#define EERE 0
+
+// USI
+#define USISIE 7
+#define USIOIE 6
+#define USIWM1 5
+#define USIWM0 4
+#define USICS1 3
+#define USICS0 2
+#define USICLK 1
+#define USITC 0
+#define USISIF 7
+#define USIOIF 6
+#define USIPF 5
+#define USIDC 4
+#define USICNT3 3
+#define USICNT0 0
+
+// Сон / питание
+#define SE 5
+#define SM1 4
+#define SM0 3
+#define PRTIM1 3
+#define PRTIM0 2
+#define PRUSI 1
+#define PRADC 0
+
+#define SREG_I 7
+
+#define RAMSTART 0x60
+#define RAMEND 0x25F
+#define E2END 0x1FF
+#define FLASHEND 0x1FFF
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Хост-заглушка: PROGMEM — обычная память
+#define PROGMEM
+#define PGM_P				const char *
+#define PSTR(s)				(s)
+#define pgm_read_byte(p)	(*reinterpret_cast<const uint8_t *>(p))
+#define pgm_read_word(p)	(*reinterpret_cast<const uint16_t *>(p))
+#define pgm_read_dword(p)	(*reinterpret_cast<const uint32_t *>(p))
+#define pgm_read_ptr(p)		(*reinterpret_cast<const void * const *>(p))
+#define memcpy_P			memcpy
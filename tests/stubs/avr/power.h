@@ -0,0 +1,13 @@
+#pragma once
+
+// Хост-заглушка
+#define power_adc_disable()
+#define power_adc_enable()
+#define power_usi_disable()
+#define power_usi_enable()
+#define power_timer0_disable()
+#define power_timer0_enable()
+#define power_timer1_disable()
+#define power_timer1_enable()
+#define power_all_disable()
+#define power_all_enable()
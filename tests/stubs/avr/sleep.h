@@ -0,0 +1,17 @@
+#pragma once
+
+// Хост-заглушка: режим сна запоминается, sleep_cpu() зовёт host_sleep (tests/HostAvr.cpp)
+
+#define SLEEP_MODE_IDLE		0
+#define SLEEP_MODE_ADC		1
+#define SLEEP_MODE_PWR_DOWN	2
+
+extern int host_sleep_mode;
+extern void (*host_sleep)(int mode);
+
+static inline void set_sleep_mode(const int mode) { host_sleep_mode = mode; }
+static inline void sleep_enable() {}
+static inline void sleep_disable() {}
+static inline void sleep_cpu() { if (host_sleep) host_sleep(host_sleep_mode); }
+static inline void sleep_mode() { sleep_cpu(); }
+static inline void sleep_bod_disable() {}
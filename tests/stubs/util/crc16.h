@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+// Хост-заглушка: то же, что _crc_ccitt_update() из avr-libc (описание на C в util/crc16.h)
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+	data ^= static_cast<uint8_t>(crc);
+	data ^= static_cast<uint8_t>(data << 4);
+	return static_cast<uint16_t>(((static_cast<uint16_t>(data) << 8) | (crc >> 8)) ^
+								 static_cast<uint8_t>(data >> 4) ^ (static_cast<uint16_t>(data) << 3));
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Хост-заглушка: задержки ничего не ждут
+static inline void _delay_ms(double) {}
+static inline void _delay_us(double) {}
@@ -25,6 +25,7 @@ set(CMAKE_ASM_COMPILER "${AVR_BIN}/avr-gcc.exe")
 set(CMAKE_AR      "${AVR_BIN}/avr-ar.exe")
 set(CMAKE_OBJCOPY "${AVR_BIN}/avr-objcopy.exe")
 set(CMAKE_SIZE    "${AVR_BIN}/avr-size.exe")
+set(CMAKE_NM      "${AVR_BIN}/avr-nm.exe")
 
 # --- Флаги компиляции ---
 set(COMMON_FLAGS "-mmcu=${AVR_MCU} -DF_CPU=${AVR_F_CPU} -Os -ffunction-sections -fdata-sections")
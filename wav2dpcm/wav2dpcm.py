@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+wav2dpcm.py
+
+WAV (или встроенный синтез) -> 4-bit DPCM клип для Sampler.h (MusicBox).
+
+Вывод:
+    // tine: 256 сэмплов @ 7994 Гц (~32 мс)
+    const uint8_t smp_tine[] PROGMEM =
+    {
+        0x87, 0x9A, ...
+    };
+
+Правила:
+ - Моно: при стерео WAV каналы усредняются.
+ - Ресемплинг линейный, в частоту клипа = F_AUDIO / 3 (Timer1, ~7994 Гц).
+   В режиме PLAYER_AUDIO_CLOCK_TIMER0 Sampler.h декодирует с той же частотой
+   (дробный делитель 43/16), поэтому клипы одни на оба режима.
+ - Нормализация пика до --peak (по умолчанию 100 из 127).
+ - Кодирование: DPCM с фиксированной нелинейной таблицей шагов (sampler_dpcm_steps[]
+   в Sampler.h), замкнутый цикл — кодер следит за тем же value, что и декодер,
+   поэтому ошибка не накапливается.
+ - 2 сэмпла на байт: сначала младший полубайт, потом старший.
+ - Хвост клипа плавно уводится к 0, чтобы не было щелчка при окончании.
+
+ВАЖНО:
+ - Таблица _STEPS ниже ОБЯЗАНА совпадать с sampler_dpcm_steps[] в Sampler.h.
+"""
+
+from __future__ import annotations
+
+import argparse
+import math
+import random
+import re
+import wave
+from typing import List
+
+#=====================================================================#
+# Параметры (должны совпадать с прошивкой)
+#=====================================================================#
+
+# sampler_dpcm_steps[] из Sampler.h
+_STEPS = [-110, -72, -40, -22, -12, -6, -3, -1, 0, 1, 3, 6, 12, 22, 40, 72]
+
+# F_CPU / (8 * 86) — реальная F_AUDIO после округления OCR1C (см. Player.h)
+_F_AUDIO_HZ = 16500000 // (8 * 86)
+
+# аудио-тиков на сэмпл клипа в режиме Timer1 (SAMPLER_RATE_NUM / SAMPLER_RATE_DEN из Sampler.h)
+_RATE_DIV = 3
+
+
+#=====================================================================#
+# Общие хелперы
+#=====================================================================#
+
+def clamp(v: int, lo: int, hi: int) -> int:
+	if v < lo:
+		return lo
+	if v > hi:
+		return hi
+	return v
+
+def read_wav_mono(path: str) -> tuple[List[float], int]:
+	with wave.open(path, "rb") as w:
+		ch = w.getnchannels()
+		width = w.getsampwidth()
+		rate = w.getframerate()
+		raw = w.readframes(w.getnframes())
+
+	if width not in (1, 2):
+		raise SystemExit(f"Поддерживаются только 8/16-bit WAV, а тут {width * 8}-bit.")
+
+	out: List[float] = []
+	step = width * ch
+	for i in range(0, len(raw) - step + 1, step):
+		acc = 0.0
+		for c in range(ch):
+			off = i + c * width
+			if width == 1:
+				acc += (raw[off] - 128) / 128.0
+			else:
+				acc += int.from_bytes(raw[off:off + 2], "little", signed=True) / 32768.0
+		out.append(acc / ch)
+	return out, rate
+
+def resample_linear(src: List[float], src_rate: int, dst_rate: int) -> List[float]:
+	if not src or src_rate == dst_rate:
+		return list(src)
+
+	n = int(len(src) * dst_rate / src_rate)
+	out: List[float] = []
+	for i in range(n):
+		t = i * src_rate / dst_rate
+		j = int(t)
+		f = t - j
+		a = src[j]
+		b = src[j + 1] if j + 1 < len(src) else a
+		out.append(a + (b - a) * f)
+	return out
+
+
+#=====================================================================#
+# Встроенный синтез (чтобы клипы в Sampler.h были воспроизводимы)
+#=====================================================================#
+
+def synth(kind: str, rate: int, samples: int) -> List[float]:
+	rnd = random.Random(85)
+	out: List[float] = []
+	for i in range(samples):
+		t = i / rate
+		if kind == "tine":
+			# короткий щипок язычка: основной тон + негармонический обертон + шум атаки
+			v = math.sin(2 * math.pi * 1046.5 * t) * math.exp(-t * 60.0)
+			v += 0.5 * math.sin(2 * math.pi * 2930.0 * t) * math.exp(-t * 140.0)
+			v += 0.6 * (rnd.random() * 2 - 1) * math.exp(-t * 900.0)
+		elif kind == "bell":
+			# колокольчик: набор негармонических парциалов с разным затуханием
+			v = math.sin(2 * math.pi * 784.0 * t) * math.exp(-t * 25.0)
+			v += 0.6 * math.sin(2 * math.pi * 1568.0 * 1.19 * t) * math.exp(-t * 45.0)
+			v += 0.4 * math.sin(2 * math.pi * 784.0 * 2.76 * t) * math.exp(-t * 70.0)
+		elif kind == "chime":
+			# "дзынь": высокий тон с биением двух близких частот
+			v = math.sin(2 * math.pi * 2093.0 * t) * math.exp(-t * 35.0)
+			v += math.sin(2 * math.pi * 2111.0 * t) * math.exp(-t * 35.0)
+		else:
+			raise SystemExit(f"Неизвестный --synth: {kind}")
+		out.append(v)
+	return out
+
+
+#=====================================================================#
+# Кодер DPCM
+#=====================================================================#
+
+def normalize(src: List[float], peak: int) -> List[int]:
+	m = max((abs(v) for v in src), default=0.0)
+	if m <= 0.0:
+		return [0] * len(src)
+	k = peak / m
+	return [int(round(v * k)) for v in src]
+
+def fade_tail(src: List[int], fade: int) -> List[int]:
+	n = len(src)
+	fade = min(fade, n)
+	out = list(src)
+	for i in range(fade):
+		k = (fade - i) / float(fade + 1)
+		out[n - fade + i] = int(round(out[n - fade + i] * k))
+	return out
+
+def encode_dpcm(pcm: List[int]) -> List[int]:
+	"""
+	Замкнутый цикл: выбираем код, который ближе всего приводит value декодера к цели.
+	Возвращает список 4-битных кодов.
+	"""
+	codes: List[int] = []
+	value = 0
+	for target in pcm:
+		best = 8
+		best_err = None
+		for code, d in enumerate(_STEPS):
+			v = clamp(value + d, -128, 127)
+			err = abs(target - v)
+			if best_err is None or err < best_err:
+				best = code
+				best_err = err
+		value = clamp(value + _STEPS[best], -128, 127)
+		codes.append(best)
+
+	# нечётное количество — добиваем "нулевым" шагом
+	if len(codes) & 1:
+		codes.append(8)
+	return codes
+
+def pack_nibbles(codes: List[int]) -> List[int]:
+	return [(codes[i] & 0x0F) | ((codes[i + 1] & 0x0F) << 4) for i in range(0, len(codes), 2)]
+
+
+#=====================================================================#
+# Форматирование C-массива
+#=====================================================================#
+
+def format_as_c_array(data: List[int], name: str, title: str, samples: int, rate: int) -> str:
+	ms = int(round(samples * 1000.0 / rate))
+	lines: List[str] = []
+	lines.append(f"// {title}: {samples} сэмплов @ {rate} Гц (~{ms} мс), {len(data)} байт")
+	lines.append(f"const uint8_t {name}[] PROGMEM =")
+	lines.append("{")
+	for i in range(0, len(data), 16):
+		row = ", ".join(f"0x{b:02X}" for b in data[i:i + 16])
+		lines.append(f"\t{row},")
+	lines.append("};")
+	return "\n".join(lines)
+
+
+#=====================================================================#
+# main
+#=====================================================================#
+
+def sanitize_name_lower(name: str) -> str:
+	n = (name or "").strip().lower()
+	n = re.sub(r"[^a-z0-9_]", "_", n)
+	if not n:
+		n = "smp0"
+	if re.match(r"^[0-9]", n):
+		n = "smp_" + n
+	return n
+
+def main() -> None:
+	ap = argparse.ArgumentParser(description="Convert WAV to 4-bit DPCM PROGMEM clip for Sampler.h.")
+	ap.add_argument("wav", nargs="?", help="Input WAV file (8/16-bit PCM)")
+	ap.add_argument("--synth", type=str, default=None, help="Built-in sound instead of WAV: tine | bell | chime")
+	ap.add_argument("--name", type=str, default="smp0", help="C array name for output.")
+	ap.add_argument("--samples", type=int, default=256, help="Clip length in samples (truncate / synth length).")
+	ap.add_argument("--peak", type=int, default=100, help="Normalize peak to this value (1..127).")
+	ap.add_argument("--rate-div", type=int, default=_RATE_DIV, help="Audio ticks per clip sample (Timer1 mode of Sampler.h).")
+	ap.add_argument("--f-audio", type=int, default=_F_AUDIO_HZ, help="Real Timer1 audio tick rate (the Timer0 mode decodes clips at the same clip rate).")
+	args = ap.parse_args()
+
+	rate = args.f_audio // max(1, args.rate_div)
+
+	if args.synth:
+		src = synth(args.synth, rate, args.samples)
+		title = args.synth
+	elif args.wav:
+		src, src_rate = read_wav_mono(args.wav)
+		src = resample_linear(src, src_rate, rate)[:args.samples]
+		title = args.wav
+	else:
+		raise SystemExit("Нужен WAV или --synth. Пример: python wav2dpcm.py --synth tine --name smp_tine")
+
+	pcm = fade_tail(normalize(src, clamp(args.peak, 1, 127)), max(1, len(src) // 8))
+	codes = encode_dpcm(pcm)
+	data = pack_nibbles(codes)
+
+	print(format_as_c_array(data, sanitize_name_lower(args.name), title, len(codes), rate))
+
+if __name__ == "__main__":
+	main()